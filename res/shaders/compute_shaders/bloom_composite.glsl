@@ -0,0 +1,26 @@
+#version 440
+
+// Adds the blurred bright pixels back on top of the image for bloom (see Bloom.h)
+
+#define TILE_SIZE 16
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// The full resolution image, and the blurred glow from the blur chain
+uniform layout(binding = 0) sampler2D s_Image;
+uniform layout(binding = 1) sampler2D s_Glow;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+uniform float u_Intensity;
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+    vec3 color = textureLod(s_Image, uv, 0).rgb + textureLod(s_Glow, uv, 0).rgb * u_Intensity;
+    imageStore(u_Output, pixel, vec4(color, 1.0));
+}
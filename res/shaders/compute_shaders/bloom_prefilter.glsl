@@ -0,0 +1,31 @@
+#version 440
+
+// Pulls the bright parts of the image out at half resolution for bloom (see Bloom.h). Pixels fade in as they
+// get brighter than the threshold, rather than switching on, so that the glow doesn't flicker
+
+#define TILE_SIZE 16
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// The full resolution image
+uniform layout(binding = 0) sampler2D s_Image;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+uniform float u_Threshold;
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    // A bilinear sample in the middle of each 2x2 block averages the block
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+    vec3 color = textureLod(s_Image, uv, 0).rgb;
+
+    // Keep the part of the color that is above the threshold, based on the brightest channel so colors stay saturated
+    float brightness = max(color.r, max(color.g, color.b));
+    float contribution = max(brightness - u_Threshold, 0.0) / max(brightness, 0.0001);
+    imageStore(u_Output, pixel, vec4(color * contribution, 1.0));
+}
@@ -0,0 +1,50 @@
+#version 440
+
+// Runs a full 2D convolution, for kernels that can't be split into two 1D passes (see Convolution.h). Each
+// work group loads a tile of the image and the kernel's radius around it into shared memory, so that
+// neighbouring pixels share their texture reads
+
+#define TILE_SIZE 16
+#define MAX_RADIUS 4
+#define CACHE_SIZE (TILE_SIZE + MAX_RADIUS * 2)
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+uniform layout(binding = 0) sampler2D s_Image;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+uniform int   u_Radius;
+// Stored row by row, starting from the bottom row (-y)
+uniform float u_Weights[(MAX_RADIUS * 2 + 1) * (MAX_RADIUS * 2 + 1)];
+
+shared vec3 s_Cache[CACHE_SIZE][CACHE_SIZE];
+
+void main() {
+    ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE;
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 maxCoord = textureSize(s_Image, 0) - 1;
+    int cacheSize = TILE_SIZE + u_Radius * 2;
+
+    // Load the tile and its border, clamping at the edges of the image
+    for (int iy = local.y; iy < cacheSize; iy += TILE_SIZE) {
+        for (int ix = local.x; ix < cacheSize; ix += TILE_SIZE) {
+            ivec2 coord = clamp(origin + ivec2(ix, iy) - u_Radius, ivec2(0), maxCoord);
+            s_Cache[iy][ix] = texelFetch(s_Image, coord, 0).rgb;
+        }
+    }
+    barrier();
+
+    ivec2 pixel = origin + local;
+    if (any(greaterThanEqual(pixel, imageSize(u_Output)))) {
+        return;
+    }
+
+    int width = u_Radius * 2 + 1;
+    vec3 accumulator = vec3(0);
+    for (int iy = 0; iy < width; iy++) {
+        for (int ix = 0; ix < width; ix++) {
+            accumulator += s_Cache[local.y + iy][local.x + ix] * u_Weights[iy * width + ix];
+        }
+    }
+    imageStore(u_Output, pixel, vec4(accumulator, 1.0));
+}
@@ -0,0 +1,46 @@
+#version 440
+
+// Runs one direction of a separable convolution (see Convolution.h). Each work group filters a
+// segment of a row or column, loading the segment and the kernel's radius on either side into
+// shared memory once, so every pixel is only read from the image once no matter how wide the kernel is
+
+#define GROUP_SIZE 128
+#define MAX_RADIUS 32
+
+layout(local_size_x = GROUP_SIZE, local_size_y = 1) in;
+
+uniform layout(binding = 0) sampler2D s_Image;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+uniform int   u_Radius;
+uniform float u_Weights[MAX_RADIUS * 2 + 1];
+// (1, 0) for the horizontal pass, (0, 1) for the vertical pass
+uniform ivec2 u_Direction;
+
+shared vec3 s_Cache[GROUP_SIZE + MAX_RADIUS * 2];
+
+void main() {
+    // Work groups are laid out along the direction we are filtering in, with one row of groups per line of pixels
+    ivec2 across = ivec2(1) - u_Direction;
+    ivec2 origin = u_Direction * int(gl_WorkGroupID.x * GROUP_SIZE) + across * int(gl_WorkGroupID.y);
+    ivec2 maxCoord = textureSize(s_Image, 0) - 1;
+    int local = int(gl_LocalInvocationID.x);
+
+    // Load our segment of the line, clamping at the edges of the image
+    for (int ix = local; ix < GROUP_SIZE + u_Radius * 2; ix += GROUP_SIZE) {
+        ivec2 coord = clamp(origin + u_Direction * (ix - u_Radius), ivec2(0), maxCoord);
+        s_Cache[ix] = texelFetch(s_Image, coord, 0).rgb;
+    }
+    barrier();
+
+    ivec2 pixel = origin + u_Direction * local;
+    if (any(greaterThanEqual(pixel, imageSize(u_Output)))) {
+        return;
+    }
+
+    vec3 accumulator = vec3(0);
+    for (int ix = 0; ix <= u_Radius * 2; ix++) {
+        accumulator += s_Cache[local + ix] * u_Weights[ix];
+    }
+    imageStore(u_Output, pixel, vec4(accumulator, 1.0));
+}
@@ -0,0 +1,60 @@
+#version 440
+
+// Applies the depth of field blur at full resolution (see DepthOfField.h). Every pixel picks the levels of the
+// blur chain that match its circle of confusion, and blends between them, so the cost doesn't depend on how
+// large the blur is
+
+#define TILE_SIZE 16
+// The prefiltered image plus the levels of the blur chain, must match DepthOfField::MAX_LEVELS
+#define MAX_LEVELS 6
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// The full resolution image and depth buffer
+uniform layout(binding = 0) sampler2D s_Image;
+uniform layout(binding = 1) sampler2D s_Depth;
+// The half resolution prefiltered image, then each level of the blur chain. Colors are weighted by how blurry
+// they are, with the total weight in a
+uniform layout(binding = 2) sampler2D s_Levels[MAX_LEVELS];
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+// The number of levels that are bound
+uniform int u_LevelCount;
+
+#include "../fragments/frame_uniforms.glsl"
+#include "../fragments/depth_of_field_common.glsl"
+
+// Sampler arrays can only be indexed with values that are the same across the whole draw, so we switch instead
+vec4 SampleLevel(int level, vec2 uv) {
+    switch (level) {
+        case 0:  return textureLod(s_Levels[0], uv, 0);
+        case 1:  return textureLod(s_Levels[1], uv, 0);
+        case 2:  return textureLod(s_Levels[2], uv, 0);
+        case 3:  return textureLod(s_Levels[3], uv, 0);
+        case 4:  return textureLod(s_Levels[4], uv, 0);
+        default: return textureLod(s_Levels[5], uv, 0);
+    }
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+    float depth = DepthToDist(uv, texelFetch(s_Depth, ivec2(uv * textureSize(s_Depth, 0)), 0).r);
+    float coc = GetBlurSize(depth, u_FocalDepth, GetFocalLength());
+
+    // The prefiltered image blurs over about a pixel, and each level of the chain doubles that
+    float level = clamp(log2(max(coc, 1.0)), 0.0, float(u_LevelCount - 1));
+    int lower = int(level);
+    int upper = min(lower + 1, u_LevelCount - 1);
+    vec4 blurred = mix(SampleLevel(lower, uv), SampleLevel(upper, uv), level - float(lower));
+
+    // Blurs smaller than a couple of pixels can't be seen at half resolution, so we fade in the blurred image as the circle grows
+    vec3 sharp = textureLod(s_Image, uv, 0).rgb;
+    vec3 color = blurred.a > 0.0001 ? blurred.rgb / blurred.a : sharp;
+    imageStore(u_Output, pixel, vec4(mix(sharp, color, smoothstep(0.5, 2.0, coc)), 1.0));
+}
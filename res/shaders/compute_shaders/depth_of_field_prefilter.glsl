@@ -0,0 +1,37 @@
+#version 440
+
+// Prepares the image for the depth of field blur chain (see DepthOfField.h). The image is downsampled to half
+// resolution, and each pixel is weighted by how blurry it is, with the weight stored in alpha. The blur chain
+// averages the weighted colors, so dividing by the blurred weight afterwards means pixels that are in focus
+// don't bleed out into the blurry pixels around them
+
+#define TILE_SIZE 16
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// The full resolution image and depth buffer
+uniform layout(binding = 0) sampler2D s_Image;
+uniform layout(binding = 1) sampler2D s_Depth;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+#include "../fragments/frame_uniforms.glsl"
+#include "../fragments/depth_of_field_common.glsl"
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    // A bilinear sample in the middle of each 2x2 block averages the color, and we keep the closest depth of the
+    // block so that foreground edges don't get lost
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+    vec4 depths = textureGather(s_Depth, uv, 0);
+    float depth = DepthToDist(uv, min(min(depths.x, depths.y), min(depths.z, depths.w)));
+    float coc = GetBlurSize(depth, u_FocalDepth, GetFocalLength());
+
+    // Blurs smaller than a couple of pixels can't be seen, the composite keeps the sharp image there
+    float weight = smoothstep(0.5, 2.0, coc);
+    imageStore(u_Output, pixel, vec4(textureLod(s_Image, uv, 0).rgb * weight, weight));
+}
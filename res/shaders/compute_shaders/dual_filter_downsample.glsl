@@ -0,0 +1,34 @@
+#version 440
+
+// One step down a dual filter blur chain (see PostProcessingLayer::AddBlurChain). Each output pixel covers a
+// 2x2 block of the input, so a bilinear sample in the middle averages the block, and four more samples on the
+// block's corners pull in its neighbours. Each level blurs over about twice the radius of the level before it
+
+#define TILE_SIZE 16
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+uniform layout(binding = 0) sampler2D s_Image;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+// Scales the distance to the corner samples, in input pixels
+uniform float u_Offset;
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+    vec2 offset = u_Offset / vec2(textureSize(s_Image, 0));
+
+    vec4 sum = textureLod(s_Image, uv, 0) * 4.0;
+    sum += textureLod(s_Image, uv + vec2(-offset.x, -offset.y), 0);
+    sum += textureLod(s_Image, uv + vec2( offset.x, -offset.y), 0);
+    sum += textureLod(s_Image, uv + vec2(-offset.x,  offset.y), 0);
+    sum += textureLod(s_Image, uv + vec2( offset.x,  offset.y), 0);
+
+    imageStore(u_Output, pixel, sum / 8.0);
+}
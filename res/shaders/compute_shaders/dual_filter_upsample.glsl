@@ -0,0 +1,37 @@
+#version 440
+
+// One step up a dual filter blur chain (see PostProcessingLayer::AddBlurChain). Each output pixel takes a ring
+// of 8 bilinear samples from the level below it, which smooths out the blocks left over from downsampling
+
+#define TILE_SIZE 16
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+uniform layout(binding = 0) sampler2D s_Image;
+layout(binding = 0) uniform writeonly image2D u_Output;
+
+// Scales the distance to the samples, in input pixels
+uniform float u_Offset;
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+    vec2 halfPixel = 0.5 * u_Offset / vec2(textureSize(s_Image, 0));
+
+    // The samples on the edges of the ring are a full input pixel away, the diagonals are closer so they count twice
+    vec4 sum = textureLod(s_Image, uv + vec2(-halfPixel.x * 2.0, 0.0), 0);
+    sum += textureLod(s_Image, uv + vec2( halfPixel.x * 2.0, 0.0), 0);
+    sum += textureLod(s_Image, uv + vec2(0.0, -halfPixel.y * 2.0), 0);
+    sum += textureLod(s_Image, uv + vec2(0.0,  halfPixel.y * 2.0), 0);
+    sum += textureLod(s_Image, uv + vec2(-halfPixel.x, -halfPixel.y), 0) * 2.0;
+    sum += textureLod(s_Image, uv + vec2( halfPixel.x, -halfPixel.y), 0) * 2.0;
+    sum += textureLod(s_Image, uv + vec2(-halfPixel.x,  halfPixel.y), 0) * 2.0;
+    sum += textureLod(s_Image, uv + vec2( halfPixel.x,  halfPixel.y), 0) * 2.0;
+
+    imageStore(u_Output, pixel, sum / 12.0);
+}
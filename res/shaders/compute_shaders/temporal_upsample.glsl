@@ -0,0 +1,78 @@
+#version 440
+
+// Brings the scene from the dynamic resolution back up to the output resolution (see RenderLayer.h). The projection
+// is jittered by a different sub-pixel offset every frame, so over a few frames the low resolution samples land all over
+// each output pixel. Each output pixel finds last frame's result by reprojecting its depth with the camera's motion,
+// then blends in this frame's closest sample. The history is clamped to the colors around the sample, so that it can't
+// drag in colors that have been uncovered or have moved away
+
+#define TILE_SIZE 16
+// How much of the current frame is blended in when a sample lands right in the middle of an output pixel
+#define BLEND_FACTOR 0.1
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+// The scene at the dynamic resolution
+uniform layout(binding = 0) sampler2D s_Image;
+uniform layout(binding = 1) sampler2D s_Depth;
+// Last frame's output
+uniform layout(binding = 2) sampler2D s_History;
+layout(binding = 0) uniform writeonly image2D u_Output;
+layout(binding = 1) uniform writeonly image2D u_NextHistory;
+
+// Takes a position in clip space this frame to clip space last frame, without the jitter
+uniform mat4 u_Reprojection;
+// The offset of this frame's samples, in low resolution pixels
+uniform vec2 u_Jitter;
+// False if there is no usable history (first frame, or after a resize)
+uniform bool u_HistoryValid;
+
+void main() {
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_Output);
+    if (any(greaterThanEqual(pixel, size))) {
+        return;
+    }
+
+    ivec2 lowSize = textureSize(s_Image, 0);
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+
+    // Find the low resolution sample closest to this pixel, each sample was taken at its pixel's center plus the jitter
+    vec2 samplePos = uv * vec2(lowSize) - 0.5 - u_Jitter;
+    ivec2 nearest = clamp(ivec2(round(samplePos)), ivec2(0), lowSize - 1);
+    vec2 offset = (samplePos - vec2(nearest)) * vec2(size) / vec2(lowSize);
+
+    // Gather the range of colors around the sample, and the closest depth so that edges follow the object in front
+    vec3 current = texelFetch(s_Image, nearest, 0).rgb;
+    vec3 minColor = current;
+    vec3 maxColor = current;
+    float depth = texelFetch(s_Depth, nearest, 0).r;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 coord = clamp(nearest + ivec2(x, y), ivec2(0), lowSize - 1);
+            vec3 color = texelFetch(s_Image, coord, 0).rgb;
+            minColor = min(minColor, color);
+            maxColor = max(maxColor, color);
+            depth = min(depth, texelFetch(s_Depth, coord, 0).r);
+        }
+    }
+
+    // Find where this pixel was last frame
+    vec4 prevClip = u_Reprojection * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec2 prevUv = (prevClip.xy / prevClip.w) * 0.5 + 0.5;
+
+    vec3 result;
+    if (u_HistoryValid && all(greaterThanEqual(prevUv, vec2(0.0))) && all(lessThanEqual(prevUv, vec2(1.0)))) {
+        vec3 history = clamp(textureLod(s_History, prevUv, 0).rgb, minColor, maxColor);
+
+        // Samples that land further from the pixel's center are trusted less
+        float weight = BLEND_FACTOR * exp(-2.0 * dot(offset, offset));
+        result = mix(history, current, weight);
+    } else {
+        // Nothing to blend with, so we just filter the low resolution image
+        result = textureLod(s_Image, uv - u_Jitter / vec2(lowSize), 0).rgb;
+    }
+
+    imageStore(u_Output, pixel, vec4(result, 1.0));
+    imageStore(u_NextHistory, pixel, vec4(result, 1.0));
+}
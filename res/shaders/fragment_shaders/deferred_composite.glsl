@@ -13,6 +13,9 @@ uniform layout(binding = 4) sampler2D s_Emissive;
 #include "../fragments/color_correction.glsl"
 #include "../fragments/multiple_point_lights.glsl"
 
+// The render flags for each buffer, these are compiled into separate variants of the shader (see RenderLayer::_Composite)
+#pragma keywords ENABLE_ALBEDO ENABLE_DIFFUSE ENABLE_SPECULAR ENABLE_EMISSIVE
+
 void main() {
     vec3 albedo = vec3(0);
     vec3 diffuse = vec3(0);
@@ -21,40 +24,21 @@ void main() {
 
     outColor = vec4(0);
 
-
-    if (IsFlagSet(FLAG_ENABLE_ALBEDO)) {
-
+    #ifdef ENABLE_ALBEDO
     albedo = texture(s_Albedo, inUV).rgb;
+    #endif
 
-
-    }
-
-    if (IsFlagSet(FLAG_ENABLE_DIFFUSE)) {
-
+    #ifdef ENABLE_DIFFUSE
     diffuse = texture(s_DiffuseAccumulation, inUV).rgb;
+    #endif
 
-
-    }
-
-
-
-        if (IsFlagSet(FLAG_ENABLE_SPECULAR)) {
-
+    #ifdef ENABLE_SPECULAR
     specular = texture(s_SpecularAccumulation, inUV).rgb;
+    #endif
 
-
-    }
-
-
-    if (IsFlagSet(FLAG_ENABLE_EMISSIVE)) {
-
-    vec4 emissive = texture(s_Emissive, inUV);
-
-
-    }
-
-
-
+    #ifdef ENABLE_EMISSIVE
+    emissive = texture(s_Emissive, inUV);
+    #endif
 
 	outColor = vec4(albedo * (diffuse + specular + (emissive.rgb * emissive.a)), 1.0);
 }
\ No newline at end of file
@@ -16,12 +16,18 @@ struct Material {
 	sampler2D EmissiveMap;
 	sampler2D NormalMap;
 	sampler2D MetallicShininessMap;
-	float     DiscardThreshold;
 };
 // Create a uniform for the material
 uniform Material u_Material;
 
+// The material's other parameters are packed into a buffer by the material, and are set as u_Material.<Name>
+// DiscardThreshold is kept first so that depth_masked.glsl can read from the same buffer
+layout (std140, binding = 3) uniform b_Material {
+	float DiscardThreshold;
+} u_MaterialParams;
+
 #include "../fragments/frame_uniforms.glsl"
+#include "../fragments/gbuffer_normals.glsl"
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
@@ -32,7 +38,7 @@ void main() {
 	vec4 lightingParams = texture(u_Material.MetallicShininessMap, inUV);
 
 	// Discarding fragments who's alpha is below the material's threshold
-	if (albedoColor.a < u_Material.DiscardThreshold) {
+	if (albedoColor.a < u_MaterialParams.DiscardThreshold) {
 		discard;
 	}
 
@@ -46,10 +52,8 @@ void main() {
 
     // Here we apply the TBN matrix to transform the normal from tangent space to view space
     normal = normalize(inTBN * normal);
-	
-	// Map [-1, 1] to [0, 1]
-	normal = clamp((normal + 1) / 2.0, 0, 1);
-	normal_metallic = vec4(normal, lightingParams.y);
+
+	normal_metallic = EncodeGBufferNormal(normal, lightingParams.y);
 
 	// Extract emissive from the material
 	emissive = texture(u_Material.EmissiveMap, inUV);
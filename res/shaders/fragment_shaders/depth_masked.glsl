@@ -0,0 +1,22 @@
+#version 430
+
+// Used for depth-only passes of masked materials (ex: foliage), where we still need to
+// discard cut-out texels. The UVs come from the material's own vertex shader
+layout(location = 3) in vec2 inUV;
+
+// Only the parts of the material we need for alpha testing, see deferred_forward.glsl
+struct Material {
+	sampler2D AlbedoMap;
+};
+uniform Material u_Material;
+
+// This has to match the start of the material shader's block, so the material's buffer can be bound as-is
+layout (std140, binding = 3) uniform b_Material {
+	float DiscardThreshold;
+} u_MaterialParams;
+
+void main() {
+	if (texture(u_Material.AlbedoMap, inUV).a < u_MaterialParams.DiscardThreshold) {
+		discard;
+	}
+}
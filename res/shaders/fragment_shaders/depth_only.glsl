@@ -0,0 +1,5 @@
+#version 430
+
+// Depth-only passes have no color outputs, the depth is written by the fixed function pipeline
+void main() {
+}
@@ -4,9 +4,6 @@ layout(location = 0) in vec2 inUV;
 layout(location = 0) out vec4 outDiffuse;
 layout(location = 1) out vec4 outSpecular;
 
-// The maximum number of lights the shader supports, increasing this will lower performance!
-#define MAX_LIGHTS 8
-
 // Represents a single light source
 struct Light {
 	vec4  PositionIntensity;
@@ -14,24 +11,35 @@ struct Light {
 	vec4  ColorAttenuation;
 };
 
-// Our uniform buffer that will store all our lighting data
-// so that it can be shared between shaders
-layout (std140, binding = 2) uniform b_LightBlock {
-    // Stores ambient light color in rgb, and number
-	// of lights in w, allowing for easier struct packing
-	// on the C++ side
-    vec4  AmbientColAndNumLights;
+// The range of the light index list that belongs to a cluster
+struct Cluster {
+	uint Offset;
+	uint Count;
+};
 
-    // Our array of all lights
-    Light Lights[MAX_LIGHTS];
+// The number of clusters along each axis, must match LightClusterGrid
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
 
-    // The rotation of the skybox/environment map
-	mat3  EnvironmentRotation;
+// All the lights in the scene, in view space
+layout (std430, binding = 2) readonly buffer b_ClusterLights {
+	Light u_Lights[];
 };
 
-#include "../fragments/deferred_post_common.glsl"
+// The list of lights for each cluster, indexed as x + y * CLUSTERS_X + z * CLUSTERS_X * CLUSTERS_Y
+layout (std430, binding = 3) readonly buffer b_Clusters {
+	Cluster u_Clusters[];
+};
+
+// The indices of the lights touching each cluster, packed back to back
+layout (std430, binding = 4) readonly buffer b_ClusterLightIndices {
+	uint u_ClusterLightIndices[];
+};
 
 #include "../fragments/frame_uniforms.glsl"
+#include "../fragments/gbuffer_normals.glsl"
+#include "../fragments/deferred_post_common.glsl"
 
 // Calculates the contribution the given point light has 
 // for the current fragment
@@ -60,6 +68,18 @@ void CalcPointLightContribution(vec3 viewPos, vec3 normal, Light light, float sh
         specular += VdotR * light.ColorAttenuation.rgb * shininess * attenuation * light.PositionIntensity.w;
 }
 
+// Gets the depth slice for a view space position, must match LightClusterGrid::_GetSlice
+uint GetClusterSlice(vec3 viewPos) {
+    float slice = log(max(-viewPos.z, u_ZNear) / u_ZNear) / log(u_ZFar / u_ZNear) * CLUSTERS_Z;
+    return uint(clamp(slice, 0, CLUSTERS_Z - 1));
+}
+
+// Gets the index of the cluster that a fragment falls into
+uint GetClusterIndex(vec2 uv, vec3 viewPos) {
+    uvec2 tile = uvec2(clamp(uv * vec2(CLUSTERS_X, CLUSTERS_Y), vec2(0), vec2(CLUSTERS_X - 1, CLUSTERS_Y - 1)));
+    return tile.x + CLUSTERS_X * (tile.y + CLUSTERS_Y * GetClusterSlice(viewPos));
+}
+
 void main() {
     vec3 normal = GetNormal(inUV);
     
@@ -76,8 +96,12 @@ void main() {
 
     vec3 diffuse = vec3(0);
     vec3 specular = vec3(0);
-    for (int ix = 0; ix < AmbientColAndNumLights.w && ix < MAX_LIGHTS; ix++) {
-        CalcPointLightContribution(viewPos, normal, Lights[ix], specularPow, diffuse, specular);
+
+    // Only evaluate the lights that were assigned to this fragment's cluster
+    Cluster cluster = u_Clusters[GetClusterIndex(inUV, viewPos)];
+    for (uint ix = 0; ix < cluster.Count; ix++) {
+        uint lightIx = u_ClusterLightIndices[cluster.Offset + ix];
+        CalcPointLightContribution(viewPos, normal, u_Lights[lightIx], specularPow, diffuse, specular);
     }
 
     outDiffuse = vec4(diffuse, 1);
@@ -1,17 +1,10 @@
-#version 430
+// Post effect body, see fragments/post_effect_fusion.glsl
 
-layout(location = 0) in vec2 inUV;
+uniform sampler3D STAGE_Lut;
 
-layout(location = 0) out vec3 outColor;
+uniform float STAGE_Strength;
 
-uniform layout(binding = 0) sampler2D s_Image;
-uniform layout(binding = 1) sampler3D s_Lut;
-
-uniform float u_Strength;
-
-void main() {
-    vec3 color = texture(s_Image, inUV).rgb;
-    outColor = mix(color, texture(s_Lut, color).rgb, clamp(u_Strength, 0, 1));
+vec3 STAGE_Apply(vec2 uv) {
+    vec3 color = STAGE_Input(uv);
+    return mix(color, texture(STAGE_Lut, color).rgb, clamp(STAGE_Strength, 0, 1));
 }
-
-
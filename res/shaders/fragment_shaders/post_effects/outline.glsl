@@ -1,67 +1,54 @@
-#version 430
+// Post effect body, see fragments/post_effect_fusion.glsl
 
 // Based on the Unity shader found at
 // https://roystan.net/articles/outline-shader.html
 
-layout (location = 0) in vec2 inUV;
-layout (location = 1) in vec3 inViewDir;
+uniform vec4  STAGE_OutlineColor;
+uniform float STAGE_Scale;
+uniform float STAGE_DepthThreshold;
+uniform float STAGE_NormalThreshold;
+uniform float STAGE_DepthNormThreshold;
+uniform float STAGE_DepthNormThresholdScale;
+uniform vec2  STAGE_PixelSize;
 
-layout (location = 0) out vec3 outColor;
+vec3 STAGE_Apply(vec2 uv) {
+    // The view direction through this pixel, the same way the fullscreen quad calculates it
+    vec3 viewDir = (u_InvProjection * vec4(uv * 2 - 1, 0, 1)).xyz;
 
-uniform layout(binding = 0) sampler2D s_Image;
-uniform layout(binding = 1) sampler2D s_Depth;
-uniform layout(binding = 2) sampler2D s_Normals;
+    float depth = GetDepth(uv);
+    vec3 norm = DecodeGBufferNormal(texture(s_Normals, uv));
 
-uniform vec4  u_OutlineColor;
-uniform float u_Scale;
-uniform float u_DepthThreshold;
-uniform float u_NormalThreshold;
-uniform float u_DepthNormThreshold;
-uniform float u_DepthNormThresholdScale;
-uniform vec2  u_PixelSize;
-
-#include "../../fragments/frame_uniforms.glsl"
-
-float GetDepth(vec2 uv) {
-    return texelFetch(s_Depth, ivec2(uv * textureSize(s_Depth, 0)), 0).r;
-}
-
-void main() {
-
-    float depth = GetDepth(inUV);
-    vec3 norm = texture(s_Normals, inUV).rgb * 2 - 1;
-
-    float halfScale = u_Scale * 0.5f;
+    float halfScale = STAGE_Scale * 0.5f;
 
     // We calculate an x shape around our UV that we'll sample the corners of
-    vec2 u0 = inUV + vec2(-u_PixelSize.x, -u_PixelSize.y) * floor(halfScale);
-    vec2 u1 = inUV + vec2( u_PixelSize.x,  u_PixelSize.y) * ceil(halfScale);
-    vec2 u2 = inUV + vec2( u_PixelSize.x, -u_PixelSize.y) * floor(halfScale);
-    vec2 u3 = inUV + vec2(-u_PixelSize.x,  u_PixelSize.y) * ceil(halfScale);
+    vec2 u0 = uv + vec2(-STAGE_PixelSize.x, -STAGE_PixelSize.y) * floor(halfScale);
+    vec2 u1 = uv + vec2( STAGE_PixelSize.x,  STAGE_PixelSize.y) * ceil(halfScale);
+    vec2 u2 = uv + vec2( STAGE_PixelSize.x, -STAGE_PixelSize.y) * floor(halfScale);
+    vec2 u3 = uv + vec2(-STAGE_PixelSize.x,  STAGE_PixelSize.y) * ceil(halfScale);
 
     // Grab our depth samples
-    float d0 = GetDepth(inUV);
-    float d1 = GetDepth(inUV);
-    float d2 = GetDepth(inUV);
-    float d3 = GetDepth(inUV);
+    float d0 = GetDepth(uv);
+    float d1 = GetDepth(uv);
+    float d2 = GetDepth(uv);
+    float d3 = GetDepth(uv);
 
     // Grab normals
-    vec3 n0 = texture(s_Normals, u0).rgb * 2 - 1;
-    vec3 n1 = texture(s_Normals, u1).rgb * 2 - 1;
-    vec3 n2 = texture(s_Normals, u2).rgb * 2 - 1;
-    vec3 n3 = texture(s_Normals, u3).rgb * 2 - 1;
+    vec3 n0 = DecodeGBufferNormal(texture(s_Normals, u0));
+    vec3 n1 = DecodeGBufferNormal(texture(s_Normals, u1));
+    vec3 n2 = DecodeGBufferNormal(texture(s_Normals, u2));
+    vec3 n3 = DecodeGBufferNormal(texture(s_Normals, u3));
 
     // Compute a threshold term based on the dot product between the camera and the normal
-    float nDotV = 1 - dot(norm, -inViewDir);
-    float normalThreshold = clamp((nDotV - u_DepthNormThreshold) / (1 - u_DepthNormThreshold), 0, 1);
-    normalThreshold = normalThreshold * u_DepthNormThresholdScale + 1;
+    float nDotV = 1 - dot(norm, -viewDir);
+    float normalThreshold = clamp((nDotV - STAGE_DepthNormThreshold) / (1 - STAGE_DepthNormThreshold), 0, 1);
+    normalThreshold = normalThreshold * STAGE_DepthNormThresholdScale + 1;
 
     // Robert's cross depth
     float dDiff0 = d1 - d0;
     float dDiff1 = d3 - d2;
 
     float edgeDepth = sqrt(pow(dDiff0, 2) + pow(dDiff1, 2)) * 64;
-    edgeDepth = edgeDepth > u_DepthThreshold * normalThreshold * depth ? 1 : 0;
+    edgeDepth = edgeDepth > STAGE_DepthThreshold * normalThreshold * depth ? 1 : 0;
     
 
     // Robert's cross normals
@@ -69,13 +56,11 @@ void main() {
     vec3 nDiff1 = n3 - n2;
 
     float edgeNorm = sqrt(dot(nDiff0, nDiff0) + dot(nDiff1, nDiff1));
-    edgeNorm = edgeNorm > u_NormalThreshold ? 1 : 0;
+    edgeNorm = edgeNorm > STAGE_NormalThreshold ? 1 : 0;
 
     float edgeFactor = max(edgeDepth, edgeNorm);
 
-    vec3 color = texture(s_Image, inUV).rgb;
-
-    vec3 result = (u_OutlineColor.rgb * u_OutlineColor.a * edgeFactor) + (1 - edgeFactor) * color;
+    vec3 color = STAGE_Input(uv);
 
-    outColor = vec3(result);
+    return (STAGE_OutlineColor.rgb * STAGE_OutlineColor.a * edgeFactor) + (1 - edgeFactor) * color;
 }
@@ -6,8 +6,11 @@ layout(location = 0) out vec4 outDiffuse;
 layout(location = 1) out vec4 outSpecular;
 
 // Note the use of sampler2DShadow here! This lets us perform
-// linear sampling on a depth buffer (more or less)
+// linear sampling on a depth buffer (more or less). This is the shadow
+// atlas that all lights share
 layout (binding = 5) uniform sampler2DShadow s_ShadowDepth;
+// The region of the atlas for this light, as (offset.x, offset.y, scale.x, scale.y)
+uniform vec4  u_AtlasRect;
 
 // Image to project
 layout (binding = 6) uniform sampler2D s_ProjectionMask;
@@ -22,26 +25,15 @@ uniform vec3  u_LightPosViewspace;
 // Shadow settings
 uniform float u_ShadowBias;
 uniform float u_NormalBias;
-uniform uint  u_ShadowFlags;
 
 // Light settings
 uniform float u_Attenuation;
 uniform float u_Intensity;
 uniform vec3  u_LightColor;
 
-// Flags
-#define FLAG_PROJECTION_ENABLED (1 << 0)
-#define FLAG_ENABLE_PCF (1 << 1)
-#define FLAG_ENABLE_ATTENUATION (1 << 2)
-#define FLAG_ENABLE_WIDE_PCF (1 << 3)
-
-/*
- * Determines if one of the shadow option flags is set,
- * if multiple flags are provided, checks all of them
- */
-bool ShadowFlagSet(uint flag) {
-    return (u_ShadowFlags & flag) == flag;
-}
+// Shadow options, these are compiled into separate variants of the shader (see ShadowCamera::GetShaderKeywords)
+// so that each light only runs the code for the options it has enabled
+#pragma keywords SHADOW_PROJECTION SHADOW_PCF SHADOW_WIDE_PCF SHADOW_ATTENUATION
 
 // Represents a single light source
 struct Light {
@@ -50,8 +42,9 @@ struct Light {
 	vec4  ColorAttenuation;
 };
 
-#include "../fragments/deferred_post_common.glsl"
 #include "../fragments/frame_uniforms.glsl"
+#include "../fragments/gbuffer_normals.glsl"
+#include "../fragments/deferred_post_common.glsl"
 
 // Showing off another way to extract view pos from depth
 vec4 GetViewPos(vec2 uv) {
@@ -82,9 +75,9 @@ void CalcDirectionalLightContribution(vec3 viewPos, vec3 normal, Light light, fl
         float attenuation = 1.0;
         // We'll use a modified distance squared attenuation factor to keep it simple
         // We add the one to prevent divide by zero errors
-        if (ShadowFlagSet(FLAG_ENABLE_ATTENUATION)) {
-            attenuation = clamp(1.0 / (1.0 + light.ColorAttenuation.w * pow(dist, 2)), 0, 256);
-        }
+        #ifdef SHADOW_ATTENUATION
+        attenuation = clamp(1.0 / (1.0 + light.ColorAttenuation.w * pow(dist, 2)), 0, 256);
+        #endif
 
         // Dot product between normal and light
         float NdotL = max(dot(normal, lightDir), 0.0);
@@ -96,6 +89,16 @@ void CalcDirectionalLightContribution(vec3 viewPos, vec3 normal, Light light, fl
         specular += VdotR * light.ColorAttenuation.rgb * shininess * attenuation * light.PositionIntensity.w;
 }
 
+// Performs a depth comparison against this light's tile in the shadow atlas
+// @param uv    The position to sample in the light's normalized clip space
+// @param depth The depth to compare against
+// @param texelSize The size of a texel in the light's tile
+float SampleShadow(vec2 uv, float depth, vec2 texelSize) {
+    // Keep our samples inside of the tile, so that filtering doesn't pick up neighbouring lights
+    uv = clamp(uv, texelSize * 0.5, 1.0 - texelSize * 0.5);
+    return texture(s_ShadowDepth, vec3(u_AtlasRect.xy + uv * u_AtlasRect.zw, depth));
+}
+
 // This function will sample multiple points around our sample, and average the results
 // This gives a slight blur to the edges of the shadows, and helps to soften them up
 // @param fragPos The position in the shadow's normalized clip space to sample
@@ -103,65 +106,60 @@ void CalcDirectionalLightContribution(vec3 viewPos, vec3 normal, Light light, fl
 float PCF(vec3 fragPos, float bias) {
 
     // If we're doing PCF, we want to take multiple samples
-    if (ShadowFlagSet(FLAG_ENABLE_PCF)) {
-        float result = 0.0; // accumulator
-        vec2 texelSize = 1.0 / textureSize(s_ShadowDepth, 0); // Determine the texel size of the shadow sampler
-        
-        // 5x5 kernel
-        if (ShadowFlagSet(FLAG_ENABLE_WIDE_PCF)) {
-            // Normalized 5x5 gaussian kernel
-            const float kernel[5][5] = {
-                { 1.0/273,  4.0/273,  7.0/273,  4.0/273, 1.0/273 },
-                { 4.0/273, 16.0/273, 26.0/273, 16.0/273, 4.0/273 },
-                { 7.0/273, 26.0/273, 41.0/273, 26.0/273, 7.0/273 },
-                { 4.0/273, 16.0/273, 26.0/273, 16.0/273, 4.0/273 },
-                { 1.0/273,  4.0/273,  7.0/273,  4.0/273, 1.0/273 },
-            };
-
-            // Iterate over a 5x5 area of texels around our sample location
-            for(int x = -2; x <= 2; ++x) { 
-                for(int y = -2; y <= 2; ++y) {
-                    // Note the use of a vec3 for sample pos! The z is the depth to compare,
-                    // OpenGL will take care of the rest and return a value between 0 and 1
-                    // as long as the texture is a sampler2DShadow. This is also where bias is
-                    // applied.
-                    float contrib =
-                        texture(
-                            s_ShadowDepth, 
-                            vec3(fragPos.xy + vec2(x,y) * texelSize, fragPos.z - bias)
-                        );
-                    // Apply kernel weights to the result
-                    result += contrib * kernel[x+2][y+2];
-                }    
-            }
-        }
-        // 3x3 kernel
-        else {
-            // Normalized 3x3 gaussian kernel
-            const float kernel[3][3] = {
-                { 1.0/16, 2.0/16, 1.0/16 },
-                { 2.0/16, 4.0/16, 2.0/16 },
-                { 1.0/16, 2.0/16, 1.0/16 }
-            };
-
-            // Iterate over a 3x3 area of texels around our sample location
-            for(int x = -1; x <= 1; ++x) { 
-                for(int y = -1; y <= 1; ++y) {
-                    // See above notes about texture
-                    float contrib = texture(s_ShadowDepth, vec3(fragPos.xy + vec2(x,y) * texelSize, fragPos.z - bias));
-                    result += contrib * kernel[x+1][y+1];
-                }    
-            }
-        }
-
-        return result;
+#ifdef SHADOW_PCF
+    float result = 0.0; // accumulator
+    vec2 texelSize = 1.0 / (textureSize(s_ShadowDepth, 0) * u_AtlasRect.zw); // Determine the texel size of the light's tile
+    
+    // 5x5 kernel
+    #ifdef SHADOW_WIDE_PCF
+    // Normalized 5x5 gaussian kernel
+    const float kernel[5][5] = {
+        { 1.0/273,  4.0/273,  7.0/273,  4.0/273, 1.0/273 },
+        { 4.0/273, 16.0/273, 26.0/273, 16.0/273, 4.0/273 },
+        { 7.0/273, 26.0/273, 41.0/273, 26.0/273, 7.0/273 },
+        { 4.0/273, 16.0/273, 26.0/273, 16.0/273, 4.0/273 },
+        { 1.0/273,  4.0/273,  7.0/273,  4.0/273, 1.0/273 },
+    };
+
+    // Iterate over a 5x5 area of texels around our sample location
+    for(int x = -2; x <= 2; ++x) { 
+        for(int y = -2; y <= 2; ++y) {
+            // Note the use of a vec3 for sample pos! The z is the depth to compare,
+            // OpenGL will take care of the rest and return a value between 0 and 1
+            // as long as the texture is a sampler2DShadow. This is also where bias is
+            // applied.
+            float contrib = SampleShadow(fragPos.xy + vec2(x,y) * texelSize, fragPos.z - bias, texelSize);
+            // Apply kernel weights to the result
+            result += contrib * kernel[x+2][y+2];
+        }    
     }
-    // PCF is not enabled, take 1 sample
-    else {
-        // See above notes about texture
-        float contrib = texture(s_ShadowDepth, vec3(fragPos.xy, fragPos.z - bias));
-        return contrib; // Perform the depth test, and return the result
+    // 3x3 kernel
+    #else
+    // Normalized 3x3 gaussian kernel
+    const float kernel[3][3] = {
+        { 1.0/16, 2.0/16, 1.0/16 },
+        { 2.0/16, 4.0/16, 2.0/16 },
+        { 1.0/16, 2.0/16, 1.0/16 }
+    };
+
+    // Iterate over a 3x3 area of texels around our sample location
+    for(int x = -1; x <= 1; ++x) { 
+        for(int y = -1; y <= 1; ++y) {
+            // See above notes about texture
+            float contrib = SampleShadow(fragPos.xy + vec2(x,y) * texelSize, fragPos.z - bias, texelSize);
+            result += contrib * kernel[x+1][y+1];
+        }    
     }
+    #endif
+
+    return result;
+
+    // PCF is not enabled, take 1 sample
+#else
+    // See above notes about texture
+    float contrib = SampleShadow(fragPos.xy, fragPos.z - bias, 1.0 / (textureSize(s_ShadowDepth, 0) * u_AtlasRect.zw));
+    return contrib; // Perform the depth test, and return the result
+#endif
 }
 
 void main() {
@@ -214,14 +212,13 @@ void main() {
         l.PositionIntensity = vec4(u_LightPosViewspace, u_Intensity);
 
         // If we want to use the projection mask, we sample it and multiply by light color
-        if (ShadowFlagSet(FLAG_PROJECTION_ENABLED)) {
-            vec3 color = texture(s_ProjectionMask, shadowPos.xy).rgb * u_LightColor;
-            l.ColorAttenuation = vec4(color, u_Attenuation);
-        }
+        #ifdef SHADOW_PROJECTION
+        vec3 color = texture(s_ProjectionMask, shadowPos.xy).rgb * u_LightColor;
+        l.ColorAttenuation = vec4(color, u_Attenuation);
         // We do not want to use the projection mask, just use the light color
-        else {
-            l.ColorAttenuation = vec4(u_LightColor, u_Attenuation);
-        }
+        #else
+        l.ColorAttenuation = vec4(u_LightColor, u_Attenuation);
+        #endif
 
         // We'll also grab specular power from the G-Buffer
         float specularPow = texture(s_AlbedoSpec, inUV).a;
@@ -10,11 +10,14 @@ layout(location = 1) out vec4 normal_metallic;
 layout(location = 2) out vec4 emissive;
 layout(location = 3) out vec3 view_pos;
 
+#include "../fragments/frame_uniforms.glsl"
+#include "../fragments/gbuffer_normals.glsl"
+
 void main() {
     vec3 norm = normalize(inNormal);
 
     albedo_specPower = vec4(texture(s_Environment, norm).rgb, 0.0);
-    normal_metallic = vec4(0.5, 0.5, 1, 0);
+    normal_metallic = EncodeGBufferNormal(vec3(0, 0, 1), 0);
     emissive = vec4(0);
     view_pos = vec3(0);
 }
\ No newline at end of file
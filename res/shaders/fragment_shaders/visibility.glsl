@@ -0,0 +1,13 @@
+#version 430
+
+// Writes the object and triangle that cover each pixel into the visibility buffer. Triangle
+// indices restart for each draw command, so they are relative to the start of the object's mesh
+layout(location = 0) flat in uint inObjectIndex;
+
+layout(location = 0) out uint outVisibility;
+
+#include "../fragments/visibility_buffer.glsl"
+
+void main() {
+	outVisibility = PackVisibility(inObjectIndex, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,11 @@
+#version 430
+
+// Writes the depth of the material that covers each pixel, so that each material's resolve pass can
+// use an equal depth test to only shade its own pixels. Empty pixels go to the far plane, which
+// no material uses
+#include "../fragments/visibility_buffer.glsl"
+
+void main() {
+	uint packed = imageLoad(u_VisibilityBuffer, ivec2(gl_FragCoord.xy)).r;
+	gl_FragDepth = packed == 0u ? 1.0 : u_VisibilityObjects[VisibilityObject(packed)].MaterialDepth;
+}
@@ -6,8 +6,14 @@ uniform layout(binding=3) sampler2D s_Emissive;
 uniform layout(binding=4) sampler2D s_Position;
 
 
+// Note that this requires frame_uniforms.glsl and gbuffer_normals.glsl to be included first
+
+float GetDepth(vec2 uv) {
+    return texelFetch(s_Depth, ivec2(uv * textureSize(s_Depth, 0)), 0).r;
+}
+
 vec3 GetNormal(vec2 uv) {
-    return ((texture(s_NormalsMetallic, uv).xyz) * 2) - 1;
+    return DecodeGBufferNormal(texture(s_NormalsMetallic, uv));
 }
 
 vec3 GetAlbedo(vec2 uv) {
@@ -15,9 +21,11 @@ vec3 GetAlbedo(vec2 uv) {
 }
 
 vec3 GetViewPosition(vec2 uv) {
+    // The compact G-Buffer has no position target, so we reconstruct it from depth
+    if (IsFlagSet(FLAG_COMPACT_GBUFFER)) {
+        vec4 clipPos = vec4(uv * 2 - 1, GetDepth(uv) * 2 - 1, 1);
+        vec4 viewPos = u_InvProjection * clipPos;
+        return viewPos.xyz / viewPos.w;
+    }
     return texture(s_Position, uv).rgb;
-}
-
-float GetDepth(vec2 uv) {
-    return texelFetch(s_Depth, ivec2(uv * textureSize(s_Depth, 0)), 0).r;
 }
\ No newline at end of file
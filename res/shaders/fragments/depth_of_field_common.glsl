@@ -0,0 +1,36 @@
+// Circle of confusion helpers for the depth of field effect, must be included after frame_uniforms.glsl
+
+// Modified from:
+// http://tuxedolabs.blogspot.com/2018/05/bokeh-depth-of-field-in-single-pass.html
+
+// Converts a screen space coord and a raw depth value into a world-space distance
+// @param screen The screen-space coordinate to convert
+// @param rawValue The raw, non-linear depth value to convert
+// @returns A distance to the camera in world units
+float DepthToDist(vec2 screen, float rawValue) {
+	vec4 screenPos = vec4(screen.x, screen.y, rawValue, 1.0) * 2.0 - 1.0;
+	vec4 viewPosition = u_InvProjection * screenPos;
+
+	return -(viewPosition.z / viewPosition.w);
+}
+
+/*
+* Calculates the Circle of Confusion for a given depth value
+* @param depth The depth of the fragment to caluculate for (in world units)
+* @param focalPlane The distance from the lense to the focal plane (in world units)
+* @param focalLength The focal length parameter (calculated as 1/F = 1/focalPlane + 1/distToSensor)
+* @returns The radius of the circle of confusion, in full resolution pixels
+* @see http://fileadmin.cs.lth.se/cs/Education/EDAN35/lectures/12DOF.pdf
+*/
+float GetBlurSize(float depth, float focalPlane, float focalLength) {
+	float coc = clamp(
+        (focalLength * (focalPlane - depth)) / 
+        (depth * (focalPlane - focalLength)), 
+        -1.0, 1.0);
+	return abs(coc) * u_Aperture;
+}
+
+// Calculates the focal length from the camera settings in the frame uniforms
+float GetFocalLength() {
+    return 1.0f / (1.0 / u_FocalDepth + 1.0 / u_LensDepth);
+}
@@ -35,6 +35,36 @@ layout (std140, binding = 0) uniform b_FrameLevelUniforms {
 
 };
 
+#if defined(INSTANCED) || defined(VISIBILITY_RESOLVE)
+// When rendering instanced, the per-object transforms come from the object buffer, which is 
+// filled once per frame and shared by all passes. Every draw is an instanced draw where the
+// base instance points to the draw's slice of the draw index list, which stores indices into
+// the object buffer (requires GL_ARB_shader_draw_parameters, injected with INSTANCED)
+// The visibility buffer resolve reads the object buffer directly, see visibility_resolve.glsl
+struct ObjectData {
+    // Just the model transform
+    mat4 Model;
+    // Normal Matrix for transforming normals, only the upper 3x3 is used
+    mat4 NormalMatrix;
+};
+layout (std430, binding = 0) readonly buffer b_ObjectData {
+    ObjectData u_Objects[];
+};
+#endif
+
+#ifdef INSTANCED
+layout (std430, binding = 1) readonly buffer b_DrawIndices {
+    uint u_DrawObjectIndices[];
+};
+
+#define OBJECT_INDEX (u_DrawObjectIndices[gl_BaseInstanceARB + gl_InstanceID])
+
+// Map the instance level uniforms onto the object buffer so shaders don't need to care how they're drawn
+#define u_Model               (u_Objects[OBJECT_INDEX].Model)
+#define u_ModelView           (u_View * u_Model)
+#define u_ModelViewProjection (u_ViewProjection * u_Model)
+#define u_NormalMatrix        (u_Objects[OBJECT_INDEX].NormalMatrix)
+#else
 // Stores uniforms that change every object/instance
 layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
     // Complete MVP
@@ -46,12 +76,14 @@ layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
     // Normal Matrix for transforming normals
     uniform mat4 u_NormalMatrix;
 };
+#endif
 
 #define FLAG_ENABLE_COLOR_CORRECTION (1 << 0)
 #define FLAG_ENABLE_ALBEDO (1 << 1)
 #define FLAG_ENABLE_DIFFUSE (1 << 2)
 #define FLAG_ENABLE_SPECULAR (1 << 3)
 #define FLAG_ENABLE_EMISSIVE (1 << 4)
+#define FLAG_COMPACT_GBUFFER (1 << 5)
 
 bool IsFlagSet(uint flag) {
     return (u_Flags & flag) != 0;
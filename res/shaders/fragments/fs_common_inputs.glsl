@@ -1,5 +1,32 @@
+#ifdef VISIBILITY_RESOLVE
+// In the visibility buffer resolve there is no vertex stage to interpolate our inputs, instead they are
+// rebuilt from the triangle stored in the visibility buffer before the material's main runs, see
+// fragments/visibility_resolve.glsl
+vec3 inViewPos;
+vec3 inColor;
+vec3 inNormal;
+vec2 inUV;
+mat3 inTBN;
+
+// The screen space derivatives of inUV. Neighbouring pixels may belong to other triangles, so the
+// hardware derivatives can't be used for picking mip levels, and 2D texture lookups use these instead
+vec2 inUVDx;
+vec2 inUVDy;
+
+vec4 ResolveTexture(sampler2D map, vec2 uv) {
+    return textureGrad(map, uv, inUVDx, inUVDy);
+}
+vec4 ResolveTexture(samplerCube map, vec3 dir) {
+    return texture(map, dir);
+}
+#define texture ResolveTexture
+
+// The material's main is called by the resolve's main
+#define main MaterialMain
+#else
 layout(location = 0) in vec3 inViewPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
-layout(location = 4) in mat3 inTBN;
\ No newline at end of file
+layout(location = 4) in mat3 inTBN;
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+ * Helpers for reading and writing normals in the G-Buffer, must be included
+ * after frame_uniforms.glsl
+ *
+ * With the default layout, normals are stored as xyz mapped to [0, 1]. With the
+ * compact layout (FLAG_COMPACT_GBUFFER), normals are octahedral encoded and
+ * quantized to 12 bits per component, packed into the rgb channels. In both
+ * layouts the alpha channel stores the metallic value
+ *
+ * Usage:
+ * normal_metallic = EncodeGBufferNormal(normal, metallic);
+ * vec3 normal = DecodeGBufferNormal(texture(s_NormalsMetallic, uv));
+*/
+
+// Maps a unit vector onto the [-1, 1] square by projecting it onto an octahedron
+// https://knarkowicz.wordpress.com/2014/04/16/octahedron-normal-vector-encoding/
+vec2 OctEncode(vec3 n) {
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    vec2 result = n.xy;
+    if (n.z < 0) {
+        result = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    }
+    return result;
+}
+
+// Inverse of OctEncode
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0, 1);
+    n.xy += vec2(n.x >= 0 ? -t : t, n.y >= 0 ? -t : t);
+    return normalize(n);
+}
+
+// Encodes a view space normal and metallic value for the normals target
+vec4 EncodeGBufferNormal(vec3 normal, float metallic) {
+    if (IsFlagSet(FLAG_COMPACT_GBUFFER)) {
+        // Quantize each component to 12 bits, and split them across three 8 bit channels
+        uvec2 q = uvec2(round((OctEncode(normal) * 0.5 + 0.5) * 4095.0));
+        uvec3 packed = uvec3(q.x >> 4, ((q.x & 15u) << 4) | (q.y >> 8), q.y & 255u);
+        return vec4(vec3(packed) / 255.0, metallic);
+    } else {
+        return vec4(clamp((normal + 1) / 2.0, 0, 1), metallic);
+    }
+}
+
+// Decodes a normal from the normals target, returns a zero vector for pixels
+// that had no geometry written to them
+vec3 DecodeGBufferNormal(vec4 value) {
+    if (IsFlagSet(FLAG_COMPACT_GBUFFER)) {
+        // The target is cleared to zero, which encodes a normal facing directly away from 
+        // the camera, so we can treat it as empty
+        uvec3 packed = uvec3(round(value.rgb * 255.0));
+        if (packed == uvec3(0)) {
+            return vec3(0);
+        }
+        uvec2 q = uvec2((packed.x << 4) | (packed.y >> 4), ((packed.y & 15u) << 8) | packed.z);
+        return OctDecode(vec2(q) / 4095.0 * 2.0 - 1.0);
+    } else {
+        return (value.xyz * 2) - 1;
+    }
+}
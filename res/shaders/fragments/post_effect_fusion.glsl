@@ -0,0 +1,29 @@
+#version 440
+
+// Common header for the generated post processing shaders (see PostProcessingLayer::_GetFusedShader)
+//
+// A generated shader runs a chain of effects in a single pass. Each effect provides a GLSL body
+// (in fragment_shaders/post_effects) where every identifier starts with STAGE_, which is replaced with
+// a unique prefix for each stage. A body must define:
+//     vec3 STAGE_Apply(vec2 uv)
+// which returns the effect's color for a pixel, and can read the previous stage with:
+//     vec3 STAGE_Input(vec2 uv)
+// Bodies should not include anything themselves, this header includes the common fragments once
+// for the whole chain
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+// The output of the previous pass
+uniform layout(binding = 0) sampler2D s_Image;
+// The depth and normals from the G-Buffer, bound for every stage
+uniform layout(binding = 1) sampler2D s_Depth;
+uniform layout(binding = 2) sampler2D s_Normals;
+
+#include "frame_uniforms.glsl"
+#include "gbuffer_normals.glsl"
+
+float GetDepth(vec2 uv) {
+    return texelFetch(s_Depth, ivec2(uv * textureSize(s_Depth, 0)), 0).r;
+}
@@ -0,0 +1,31 @@
+// Shared layout of the visibility buffer. Each pixel stores the object that covers it and the
+// index of the triangle within that object's mesh, packed into a single uint. 0 means empty,
+// so object indices are stored plus one. Must match the constants in RenderLayer.h
+#define VISIBILITY_TRIANGLE_BITS 20
+#define VISIBILITY_TRIANGLE_MASK ((1u << VISIBILITY_TRIANGLE_BITS) - 1u)
+
+uint PackVisibility(uint objectIndex, uint triangle) {
+    return ((objectIndex + 1u) << VISIBILITY_TRIANGLE_BITS) | (triangle & VISIBILITY_TRIANGLE_MASK);
+}
+
+uint VisibilityObject(uint packed) {
+    return (packed >> VISIBILITY_TRIANGLE_BITS) - 1u;
+}
+
+uint VisibilityTriangle(uint packed) {
+    return packed & VISIBILITY_TRIANGLE_MASK;
+}
+
+// Where each object's mesh lives in the geometry arena, and the depth its material is resolved at
+struct VisibilityObjectData {
+    uint  FirstIndex;
+    int   BaseVertex;
+    float MaterialDepth;
+    uint  Padding;
+};
+layout (std430, binding = 7) readonly buffer b_VisibilityObjects {
+    VisibilityObjectData u_VisibilityObjects[];
+};
+
+// The visibility buffer itself, bound as an image so it doesn't take up one of the material's texture slots
+layout (r32ui, binding = 0) readonly uniform uimage2D u_VisibilityBuffer;
@@ -0,0 +1,110 @@
+// Appended to a material's fragment shader (compiled with VISIBILITY_RESOLVE defined) to make its
+// visibility buffer resolve variant, see ShaderProgram::GetVisibilityVariant. The inputs that the
+// vertex shader would have given us are rebuilt from the triangle in the visibility buffer, the
+// same way that vertex_shaders/basic.glsl calculates them, then the material's main is run
+#undef main
+
+#include "visibility_buffer.glsl"
+
+// The geometry arena's vertices and indices. Vertices use the VertexPosNormTexColTangents layout
+layout (std430, binding = 5) readonly buffer b_VisibilityVertices {
+    float u_VisibilityVertices[];
+};
+layout (std430, binding = 6) readonly buffer b_VisibilityIndices {
+    uint u_VisibilityIndices[];
+};
+
+#define VERTEX_STRIDE 18
+
+vec3 FetchVec3(int vertex, int offset) {
+    int base = vertex * VERTEX_STRIDE + offset;
+    return vec3(u_VisibilityVertices[base], u_VisibilityVertices[base + 1], u_VisibilityVertices[base + 2]);
+}
+
+vec2 FetchVec2(int vertex, int offset) {
+    int base = vertex * VERTEX_STRIDE + offset;
+    return vec2(u_VisibilityVertices[base], u_VisibilityVertices[base + 1]);
+}
+
+// Intersects the view ray through a pixel with a view space triangle, returning the barycentric
+// coordinates of the hit. Since this is done in view space the result is perspective correct, and
+// it works for triangles that cross the near plane
+vec3 RayBarycentrics(vec2 ndc, vec3 p0, vec3 p1, vec3 p2) {
+    vec4 nearPoint = u_InvProjection * vec4(ndc, -1.0, 1.0);
+    vec4 farPoint  = u_InvProjection * vec4(ndc,  1.0, 1.0);
+    vec3 origin = nearPoint.xyz / nearPoint.w;
+    vec3 dir    = farPoint.xyz / farPoint.w - origin;
+
+    vec3 edge1 = p1 - p0;
+    vec3 edge2 = p2 - p0;
+    vec3 p = cross(dir, edge2);
+    float det = dot(edge1, p);
+    // Triangles seen exactly edge on can still cover a pixel, just use the center
+    if (abs(det) < 1e-12) {
+        return vec3(1.0 / 3.0);
+    }
+    vec3 t = origin - p0;
+    vec3 q = cross(t, edge1);
+    float u = dot(t, p) / det;
+    float v = dot(dir, q) / det;
+    return vec3(1.0 - u - v, u, v);
+}
+
+void ResolveVisibility() {
+    uint packed = imageLoad(u_VisibilityBuffer, ivec2(gl_FragCoord.xy)).r;
+    uint objectIndex = VisibilityObject(packed);
+    VisibilityObjectData object = u_VisibilityObjects[objectIndex];
+
+    // Fetch the triangle's vertices from the arena
+    uint firstIndex = object.FirstIndex + VisibilityTriangle(packed) * 3u;
+    int vertices[3] = int[3](
+        int(u_VisibilityIndices[firstIndex])      + object.BaseVertex,
+        int(u_VisibilityIndices[firstIndex + 1u]) + object.BaseVertex,
+        int(u_VisibilityIndices[firstIndex + 2u]) + object.BaseVertex
+    );
+
+    mat4 modelView = u_View * u_Objects[objectIndex].Model;
+    vec3 viewPos[3];
+    for (int ix = 0; ix < 3; ix++) {
+        viewPos[ix] = (modelView * vec4(FetchVec3(vertices[ix], 0), 1.0)).xyz;
+    }
+
+    // Find where the pixel and its right and upper neighbours land on the triangle, the neighbours give
+    // us the UV derivatives for texture filtering
+    vec2 pixelSize = 2.0 / vec2(imageSize(u_VisibilityBuffer));
+    vec2 ndc = gl_FragCoord.xy * pixelSize - 1.0;
+    vec3 bary   = RayBarycentrics(ndc, viewPos[0], viewPos[1], viewPos[2]);
+    vec3 baryDx = RayBarycentrics(ndc + vec2(pixelSize.x, 0.0), viewPos[0], viewPos[1], viewPos[2]);
+    vec3 baryDy = RayBarycentrics(ndc + vec2(0.0, pixelSize.y), viewPos[0], viewPos[1], viewPos[2]);
+
+    vec3 normal = vec3(0.0);
+    vec3 tangent = vec3(0.0);
+    vec3 biTangent = vec3(0.0);
+    vec3 color = vec3(0.0);
+    inUV = vec2(0.0);
+    inUVDx = vec2(0.0);
+    inUVDy = vec2(0.0);
+    inViewPos = vec3(0.0);
+    for (int ix = 0; ix < 3; ix++) {
+        vec2 uv = FetchVec2(vertices[ix], 6);
+        inViewPos += viewPos[ix] * bary[ix];
+        inUV      += uv * bary[ix];
+        inUVDx    += uv * (baryDx[ix] - bary[ix]);
+        inUVDy    += uv * (baryDy[ix] - bary[ix]);
+        normal    += FetchVec3(vertices[ix], 3) * bary[ix];
+        color     += FetchVec3(vertices[ix], 8) * bary[ix];
+        tangent   += FetchVec3(vertices[ix], 12) * bary[ix];
+        biTangent += FetchVec3(vertices[ix], 15) * bary[ix];
+    }
+
+    // Transform into view space, matching basic.glsl
+    mat3 normalMatrix = mat3(u_View) * mat3(u_Objects[objectIndex].NormalMatrix);
+    inNormal = normalMatrix * normal;
+    inTBN = mat3(normalize(normalMatrix * tangent), normalize(normalMatrix * biTangent), normalize(inNormal));
+    inColor = color;
+}
+
+void main() {
+    ResolveVisibility();
+    MaterialMain();
+}
@@ -0,0 +1,11 @@
+#version 440
+
+// A minimal vertex shader for depth-only passes (ex: shadow maps), only the position is read
+layout(location = 0) in vec3 inPosition;
+
+// Include the matrices and frame level parameters
+#include "../fragments/frame_uniforms.glsl"
+
+void main() {
+	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 440
+
+// Vertex shader for the visibility buffer pass, only the position is read. This is always drawn
+// with the instanced variant, so that the object index can be passed on to the fragment stage
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) flat out uint outObjectIndex;
+
+// Include the matrices and frame level parameters
+#include "../fragments/frame_uniforms.glsl"
+
+void main() {
+	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+#ifdef INSTANCED
+	outObjectIndex = OBJECT_INDEX;
+#else
+	outObjectIndex = 0;
+#endif
+}
@@ -0,0 +1,11 @@
+#version 440
+
+// Draws a fullscreen quad at the depth of the material being resolved. With an equal depth test,
+// only the pixels that the material depth pass assigned to this material will be shaded
+layout (location = 0) in vec2 inPos;
+
+uniform float u_MaterialDepth;
+
+void main() {
+    gl_Position = vec4(inPos, u_MaterialDepth * 2.0 - 1.0, 1);
+}
@@ -27,6 +27,7 @@
 #include "Graphics/Font.h"
 #include "Graphics/GuiBatcher.h"
 #include "Graphics/Framebuffer.h"
+#include "Graphics/RenderState.h"
 
 // Gameplay
 #include "Gameplay/Material.h"
@@ -76,7 +77,8 @@ Application::Application() :
 	_isEditor(true),
 	_windowTitle("INFR - 2350U"),
 	_currentScene(nullptr),
-	_targetScene(nullptr)
+	_targetScene(nullptr),
+	_renderGraph(std::make_shared<RenderGraph>())
 { }
 
 Application::~Application() = default; 
@@ -234,6 +236,9 @@ void Application::_Run()
 		InputEngine::EndFrame();
 		ImGuiHelper::EndFrame();
 
+		// ImGui's renderer changes state without going through our cache, so we need to forget what we know
+		RenderState::EndFrame();
+
 		glfwSwapBuffers(_window);
 
 	}
@@ -317,12 +322,16 @@ void Application::_PreRender()
 {
 	glm::ivec2 size ={ 0, 0 };
 	glfwGetWindowSize(_window, &size.x, &size.y);
-	glViewport(0, 0, size.x, size.y);
-	glScissor(0, 0, size.x, size.y);
+	RenderState::SetViewport(0, 0, size.x, size.y);
+	RenderState::SetScissor(0, 0, size.x, size.y);
 
 	// Clear the screen
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+	// Start a new render graph for the frame, whatever is in the back buffer at the end is what gets presented
+	_renderGraph->Reset();
+	_renderGraph->MarkOutput(_renderGraph->Import("Back Buffer", nullptr));
+
 	for (const auto& layer : _layers) {
 		if (layer->Enabled && *(layer->Overrides & AppLayerFunctions::OnPreRender)) {
 			layer->OnPreRender();
@@ -348,6 +357,9 @@ void Application::_PostRender() {
 			layer->OnPostRender();
 		}
 	}
+
+	// Now that every layer has added its passes, we can run the ones that contribute to the back buffer
+	_renderGraph->Execute();
 }
 
 void Application::_Unload() {
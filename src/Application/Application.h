@@ -5,6 +5,7 @@
 #include "Utils/Macros.h"
 #include "Application/ApplicationLayer.h"
 #include "Gameplay/Scene.h"
+#include "Graphics/RenderGraph.h"
 
 struct GLFWwindow;
 
@@ -103,6 +104,13 @@ public:
 		return nullptr;
 	}
 	
+	/**
+	 * Gets the render graph for the current frame. The graph is reset in pre-render with the default framebuffer
+	 * imported as "Back Buffer", layers add their passes to it during post-render, and it is executed once all
+	 * layers have had their post-render called
+	 */
+	const RenderGraph::Sptr& GetRenderGraph() const { return _renderGraph; }
+
 	/**
 	 * Saves the application settings to a file in %APPDATA% 
 	 */
@@ -140,6 +148,9 @@ protected:
 	// Stores all the layers of the application, in the order they should be invoked
 	std::vector<ApplicationLayer::Sptr> _layers;
 
+	// The passes for the frame that layers have submitted
+	RenderGraph::Sptr _renderGraph;
+
 	void _Run();
 	void _RegisterClasses();
 	void _Load();
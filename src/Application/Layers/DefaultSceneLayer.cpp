@@ -264,6 +264,7 @@ void DefaultSceneLayer::_CreateScene()
 		Material::Sptr foliageMaterial = ResourceManager::CreateAsset<Material>(foliageShader);
 		{
 			foliageMaterial->Name = "Foliage Shader";
+			foliageMaterial->Masked = true;
 			foliageMaterial->Set("u_Material.AlbedoMap", leafTex);
 			foliageMaterial->Set("u_Material.Shininess", 0.1f);
 			foliageMaterial->Set("u_Material.DiscardThreshold", 0.1f);
@@ -279,6 +280,7 @@ void DefaultSceneLayer::_CreateScene()
 		Material::Sptr toonMaterial = ResourceManager::CreateAsset<Material>(celShader);
 		{
 			toonMaterial->Name = "Toon"; 
+			toonMaterial->Masked = true;
 			toonMaterial->Set("u_Material.AlbedoMap", boxTexture);
 			toonMaterial->Set("u_Material.NormalMap", normalMapDefault);
 			toonMaterial->Set("s_ToonTerm", toonLut);
@@ -294,6 +296,7 @@ void DefaultSceneLayer::_CreateScene()
 			Texture2D::Sptr diffuseMap      = ResourceManager::CreateAsset<Texture2D>("textures/bricks_diffuse.png");
 
 			displacementTest->Name = "Displacement Map";
+			displacementTest->Masked = true;
 			displacementTest->Set("u_Material.AlbedoMap", diffuseMap);
 			displacementTest->Set("u_Material.NormalMap", normalMap);
 			displacementTest->Set("s_Heightmap", displacementMap);
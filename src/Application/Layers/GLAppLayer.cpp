@@ -2,9 +2,13 @@
 #include "GLFW/glfw3.h"
 #include "Logging.h"
 #include "Application/Application.h"
+#include "Graphics/ShaderProgram.h"
+#include "Utils/JsonGlmHelpers.h"
+#include <filesystem>
 
 GLAppLayer::GLAppLayer() :
-	ApplicationLayer() {
+	ApplicationLayer(),
+	_shaderCacheEnabled(true) {
 	Name = "OpenGL Layer";
 	Overrides = AppLayerFunctions::OnAppLoad | AppLayerFunctions::OnAppUnload;
 }
@@ -40,6 +44,27 @@ void GLAppLayer::OnAppLoad(const nlohmann::json& config) {
 	// Display our GPU and OpenGL version
 	LOG_INFO(glGetString(GL_RENDERER));
 	LOG_INFO(glGetString(GL_VERSION));
+
+	// Let the driver compile shaders on its own threads, ShaderProgram only waits on them when they're first used
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+		// Our GL loader doesn't include the extension, so we load it ourselves
+		typedef void (APIENTRYP MaxShaderCompilerThreadsFunc)(GLuint count);
+		MaxShaderCompilerThreadsFunc maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+		if (maxShaderCompilerThreads != nullptr) {
+			// 0xFFFFFFFF lets the driver pick the number of threads
+			maxShaderCompilerThreads(0xFFFFFFFF);
+			LOG_INFO("Parallel shader compilation enabled");
+		}
+	}
+
+	// Cache linked shaders next to our settings, so that later runs can skip compiling them
+	if (config.contains(Name)) {
+		_shaderCacheEnabled = JsonGet(config[Name], "shader_cache", _shaderCacheEnabled);
+	}
+	const char* appdata = getenv("APPDATA");
+	if (_shaderCacheEnabled && appdata != nullptr) {
+		ShaderProgram::SetBinaryCacheDirectory((std::filesystem::path(appdata) / app._applicationName / "shader-cache").string());
+	}
 }
 
 void GLAppLayer::OnAppUnload()
@@ -53,6 +78,12 @@ void GLAppLayer::OnAppUnload()
 	glfwTerminate();
 }
 
+nlohmann::json GLAppLayer::GetDefaultConfig() {
+	return {
+		{ "shader_cache", _shaderCacheEnabled }
+	};
+}
+
 void GLAppLayer::GlDebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
 	std::string sourceTxt;
 	switch (source) {
@@ -20,8 +20,12 @@ public:
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
 	virtual void OnAppUnload() override;
+	virtual nlohmann::json GetDefaultConfig() override;
 
 protected:
+	// True if linked shader programs should be cached on disk, see ShaderProgram::SetBinaryCacheDirectory
+	bool _shaderCacheEnabled;
+
 	static void GlDebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 	static void GlWindowResizedCallback(GLFWwindow* window, int width, int height);
 };
\ No newline at end of file
@@ -17,6 +17,7 @@
 #include "../Windows/PostProcessingSettingsWindow.h"
 
 #include "Graphics/DebugDraw.h"
+#include "Graphics/RenderState.h"
 
 ImGuiDebugLayer::ImGuiDebugLayer() :
 	ApplicationLayer(),
@@ -249,17 +250,23 @@ void ImGuiDebugLayer::OnRender(const Framebuffer::Sptr& prevLayer)
 void ImGuiDebugLayer::OnPostRender()
 {
 	// HACK HACK HACK - Getting debug gizmos to show up
-	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
-	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
- 
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(true);
-
-	glClear(GL_DEPTH_BUFFER_BIT);
-
-	DebugDrawer::Get().SetViewProjection(app.CurrentScene()->MainCamera->GetViewProjection());
-	DebugDrawer::Get().FlushAll();
+	const RenderGraph::Sptr& graph = Application::Get().GetRenderGraph();
+	RenderGraph::Resource backBuffer = graph->Find("Back Buffer");
+	graph->AddPass("Debug Gizmos", [&](RenderGraph::PassBuilder& builder) {
+		builder.Write(backBuffer);
+	}, [](const RenderGraph&) {
+		Application& app = Application::Get();
+		const glm::uvec4& viewport = app.GetPrimaryViewport();
+		RenderState::SetViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	 
+		RenderState::Enable(GL_DEPTH_TEST);
+		RenderState::SetDepthMask(true);
+
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		DebugDrawer::Get().SetViewProjection(app.CurrentScene()->MainCamera->GetViewProjection());
+		DebugDrawer::Get().FlushAll();
+	});
 }
 
 void ImGuiDebugLayer::_RenderGameWindow()
@@ -2,6 +2,7 @@
 #include "Gameplay/Components/ParticleSystem.h"
 #include "Application/Application.h"
 #include "RenderLayer.h"
+#include "Graphics/RenderState.h"
 
 ParticleLayer::ParticleLayer() :
 	ApplicationLayer()
@@ -32,20 +33,24 @@ void ParticleLayer::OnUpdate()
 
 void ParticleLayer::OnPostRender()
 {
-	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
-
-	// Restore viewport to game viewport
-	RenderLayer::Sptr renderer = app.GetLayer<RenderLayer>();
-	const Framebuffer::Sptr renderOutput = renderer->GetRenderOutput();
-	renderOutput->Bind();
-	glViewport(0, 0, renderOutput->GetWidth(), renderOutput->GetHeight());
-
-	Application::Get().CurrentScene()->Components().Each<ParticleSystem>([](const ParticleSystem::Sptr& system) {
-		if (system->IsEnabled) {
-			system->Render(); 
-		}
-	});
+	// Particles are drawn on top of the render layer's output
+	const RenderGraph::Sptr& graph = Application::Get().GetRenderGraph();
+	RenderGraph::Resource sceneColor = graph->Find("Scene Color");
+	if (sceneColor == RenderGraph::InvalidResource) {
+		return;
+	}
+
+	graph->AddPass("Particles", [&](RenderGraph::PassBuilder& builder) {
+		builder.Write(sceneColor);
+	}, [sceneColor](const RenderGraph& graph) {
+		const Framebuffer::Sptr& renderOutput = graph.GetFramebuffer(sceneColor);
+		renderOutput->Bind();
+		RenderState::SetViewport(0, 0, renderOutput->GetWidth(), renderOutput->GetHeight());
 
-	//renderer->GetRenderOutput()->Unbind();
+		Application::Get().CurrentScene()->Components().Each<ParticleSystem>([](const ParticleSystem::Sptr& system) {
+			if (system->IsEnabled) {
+				system->Render(); 
+			}
+		});
+	});
 }
@@ -0,0 +1,102 @@
+#include "Bloom.h"
+
+#include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ImGuiHelper.h"
+#include "Application/Application.h"
+
+// Work group size for both passes, must match the compute shaders
+static const uint32_t TILE_SIZE = 16;
+
+static constexpr UniformHandle UNIFORM_THRESHOLD("u_Threshold");
+static constexpr UniformHandle UNIFORM_INTENSITY("u_Intensity");
+
+Bloom::Bloom() :
+	PostProcessingLayer::Effect(),
+	Threshold(0.8f),
+	Intensity(0.5f),
+	Radius(64.0f),
+	_prefilterShader(nullptr),
+	_compositeShader(nullptr)
+{
+	Name = "Bloom";
+	_format = RenderTargetType::ColorRgb8;
+
+	_fusion = EffectFusion::Custom;
+
+	_prefilterShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/bloom_prefilter.glsl" }
+	});
+	_compositeShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/bloom_composite.glsl" }
+	});
+}
+
+Bloom::~Bloom() = default;
+
+RenderGraph::Resource Bloom::AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size)
+{
+	struct BloomPass {
+		RenderGraph::Resource Output;
+	};
+
+	if (Intensity <= 0.0f) {
+		return input;
+	}
+
+	// Pull out the bright pixels at half resolution
+	glm::uvec2 halfSize = glm::max((size + 1u) / 2u, glm::uvec2(1));
+	RenderGraph::Resource bright = graph.AddPass<BloomPass>(Name + " (Prefilter)", [&](RenderGraph::PassBuilder& builder, BloomPass& data) {
+		builder.Read(input);
+		data.Output = builder.Create(Name + " (Half Resolution)", { halfSize.x, halfSize.y, RenderTargetType::ColorRgba16F });
+	}, [this, input, halfSize](const BloomPass& data, const RenderGraph& graph) {
+		_prefilterShader->Bind();
+		_prefilterShader->SetUniform(UNIFORM_THRESHOLD, Threshold);
+		graph.GetFramebuffer(input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+		PostProcessingLayer::DispatchCompute(graph.GetFramebuffer(data.Output), (halfSize + TILE_SIZE - 1u) / TILE_SIZE);
+	}).Output;
+
+	// Spread them out, our radius is in full resolution pixels
+	PostProcessingLayer::BlurChain chain = Application::Get().GetLayer<PostProcessingLayer>()->AddBlurChain(graph, Name, bright, halfSize, Radius * 0.5f);
+	RenderGraph::Resource glow = chain.Output;
+
+	// Add the glow back on top of the image
+	return graph.AddPass<BloomPass>(Name + " (Composite)", [&](RenderGraph::PassBuilder& builder, BloomPass& data) {
+		builder.Read(input);
+		builder.Read(glow);
+		data.Output = builder.Create(Name, { size.x, size.y, RenderTargetType::ColorRgba8 });
+	}, [this, input, glow, size](const BloomPass& data, const RenderGraph& graph) {
+		_compositeShader->Bind();
+		_compositeShader->SetUniform(UNIFORM_INTENSITY, Intensity);
+		graph.GetFramebuffer(input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+		graph.GetFramebuffer(glow)->BindAttachment(RenderTargetAttachment::Color0, 1);
+		PostProcessingLayer::DispatchCompute(graph.GetFramebuffer(data.Output), (size + TILE_SIZE - 1u) / TILE_SIZE);
+	}).Output;
+}
+
+void Bloom::RenderImGui()
+{
+	ImGui::SliderFloat("Threshold", &Threshold, 0.0f, 1.0f);
+	ImGui::DragFloat("Intensity", &Intensity, 0.01f, 0.0f, 4.0f);
+	ImGui::DragFloat("Radius", &Radius, 1.0f, 2.0f, 512.0f);
+}
+
+Bloom::Sptr Bloom::FromJson(const nlohmann::json& data)
+{
+	Bloom::Sptr result = std::make_shared<Bloom>();
+	result->Enabled = JsonGet(data, "enabled", true);
+	result->Threshold = JsonGet(data, "threshold", result->Threshold);
+	result->Intensity = JsonGet(data, "intensity", result->Intensity);
+	result->Radius = JsonGet(data, "radius", result->Radius);
+	return result;
+}
+
+nlohmann::json Bloom::ToJson() const
+{
+	return {
+		{ "enabled", Enabled },
+		{ "threshold", Threshold },
+		{ "intensity", Intensity },
+		{ "radius", Radius }
+	};
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Application/Layers/PostProcessingLayer.h"
+#include "Graphics/ShaderProgram.h"
+
+/**
+ * Makes bright parts of the image glow. The pixels brighter than the threshold are pulled out at half resolution,
+ * spread out with the post processing layer's blur chain, and added back on top of the image
+ */
+class Bloom : public PostProcessingLayer::Effect {
+public:
+	MAKE_PTRS(Bloom);
+
+	// How bright a pixel needs to be before it starts to glow
+	float Threshold;
+	// How strong the glow is when it's added back to the image
+	float Intensity;
+	// How far the glow spreads, in full resolution pixels
+	float Radius;
+
+	Bloom();
+	virtual ~Bloom();
+
+	virtual RenderGraph::Resource AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size) override;
+	virtual void RenderImGui() override;
+
+	// Inherited from IResource
+
+	Bloom::Sptr FromJson(const nlohmann::json& data);
+	virtual nlohmann::json ToJson() const override;
+
+protected:
+	// Pulls the bright pixels out of the image at half resolution
+	ShaderProgram::Sptr _prefilterShader;
+	// Adds the blurred glow back on top of the image
+	ShaderProgram::Sptr _compositeShader;
+};
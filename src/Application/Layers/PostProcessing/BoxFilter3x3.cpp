@@ -16,19 +16,15 @@ BoxFilter3x3::BoxFilter3x3() :
 	memset(Filter, 0, sizeof(float) * 9);
 	Filter[4] = 1.0f;
 
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/box_filter_3.glsl" }
-	});
+	_fusion = EffectFusion::Custom;
+	_convolution = std::make_shared<Convolution>();
 }
 
 BoxFilter3x3::~BoxFilter3x3() = default;
 
-void BoxFilter3x3::Apply(const Framebuffer::Sptr& gBuffer)
+RenderGraph::Resource BoxFilter3x3::AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size)
 {
-	_shader->Bind(); 
-	_shader->SetUniform("u_Filter", Filter, 9); 
-	_shader->SetUniform("u_PixelSize", glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize()); 
+	return _convolution->AddPasses(graph, Name, input, size, Filter, 1);
 }
 
 void BoxFilter3x3::RenderImGui()
@@ -48,6 +44,8 @@ void BoxFilter3x3::RenderImGui()
 	}
 	ImGui::Columns(1);
 
+	ImGui::TextDisabled(_convolution->IsSeparable() ? "Separable, runs as 2 x 3 taps" : "Not separable, runs as 9 taps");
+
 	if (ImGui::Button("Normalize")) {
 		float sum = 0.0f;
 		for (int ix = 0; ix < 9; ix++) {
@@ -3,6 +3,7 @@
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/Textures/Texture3D.h"
 #include "Graphics/Framebuffer.h"
+#include "Convolution.h"
 
 class BoxFilter3x3 : public PostProcessingLayer::Effect {
 public:
@@ -12,7 +13,7 @@ public:
 	BoxFilter3x3();
 	virtual ~BoxFilter3x3();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual RenderGraph::Resource AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size) override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -21,6 +22,6 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
+	Convolution::Sptr _convolution;
 };
 
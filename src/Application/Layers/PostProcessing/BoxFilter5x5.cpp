@@ -15,19 +15,15 @@ BoxFilter5x5::BoxFilter5x5() :
 	memset(Filter, 0, sizeof(float) * 25);
 	Filter[12] = 1.0f;
 
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/box_filter_5.glsl" }
-	});
+	_fusion = EffectFusion::Custom;
+	_convolution = std::make_shared<Convolution>();
 }
 
 BoxFilter5x5::~BoxFilter5x5() = default;
 
-void BoxFilter5x5::Apply(const Framebuffer::Sptr& gBuffer)
+RenderGraph::Resource BoxFilter5x5::AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size)
 {
-	_shader->Bind();
-	_shader->SetUniform("u_Filter", Filter, 25);
-	_shader->SetUniform("u_PixelSize", glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize()); 
+	return _convolution->AddPasses(graph, Name, input, size, Filter, 2);
 }
 
 void BoxFilter5x5::RenderImGui()
@@ -47,6 +43,8 @@ void BoxFilter5x5::RenderImGui()
 	}
 	ImGui::Columns(1);
 
+	ImGui::TextDisabled(_convolution->IsSeparable() ? "Separable, runs as 2 x 5 taps" : "Not separable, runs as 25 taps");
+
 	if (ImGui::Button("Normalize")) {
 		float sum = 0.0f;
 		for (int ix = 0; ix < 25; ix++) {
@@ -3,6 +3,7 @@
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/Textures/Texture3D.h"
 #include "Graphics/Framebuffer.h"
+#include "Convolution.h"
 
 class BoxFilter5x5 : public PostProcessingLayer::Effect {
 public:
@@ -12,7 +13,7 @@ public:
 	BoxFilter5x5();
 	virtual ~BoxFilter5x5();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual RenderGraph::Resource AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size) override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -21,5 +22,5 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
+	Convolution::Sptr _convolution;
 };
\ No newline at end of file
@@ -8,17 +8,13 @@ ColorCorrectionEffect::ColorCorrectionEffect() :
 
 ColorCorrectionEffect::ColorCorrectionEffect(bool defaultLut) :
 	PostProcessingLayer::Effect(),
-	_shader(nullptr),
 	_strength(1.0f),
 	Lut(nullptr)
 {
 	Name = "Color Correction";
 	_format = RenderTargetType::ColorRgb8;
-
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/color_correction.glsl" }
-	});
+	_fusion = EffectFusion::ColorRemap;
+	_fusionSource = "shaders/fragment_shaders/post_effects/color_correction.glsl";
 
 	if (defaultLut) {
 		Lut = ResourceManager::CreateAsset<Texture3D>("luts/cool.cube");
@@ -27,11 +23,10 @@ ColorCorrectionEffect::ColorCorrectionEffect(bool defaultLut) :
 
 ColorCorrectionEffect::~ColorCorrectionEffect() = default;
 
-void ColorCorrectionEffect::Apply(const Framebuffer::Sptr& gBuffer)
+void ColorCorrectionEffect::ApplyFused(PostProcessingLayer::FusedStage& stage)
 {
-	_shader->Bind();
-	Lut->Bind(1);
-	_shader->SetUniform("u_Strength", _strength);
+	stage.BindTexture("Lut", Lut);
+	stage.SetUniform("Strength", _strength);
 }
 
 void ColorCorrectionEffect::RenderImGui()
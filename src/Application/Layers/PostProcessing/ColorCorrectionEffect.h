@@ -12,7 +12,7 @@ public:
 	ColorCorrectionEffect(bool defaultLut);
 	virtual ~ColorCorrectionEffect();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual void ApplyFused(PostProcessingLayer::FusedStage& stage) override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -21,7 +21,6 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
 	float _strength;
 };
 
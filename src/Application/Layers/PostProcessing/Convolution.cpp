@@ -0,0 +1,123 @@
+#include "Convolution.h"
+#include "Application/Layers/PostProcessingLayer.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+
+// Work group sizes, must match the compute shaders
+static const uint32_t SEPARABLE_GROUP_SIZE = 128;
+static const uint32_t TILE_SIZE = 16;
+
+static constexpr UniformHandle UNIFORM_RADIUS("u_Radius");
+static constexpr UniformHandle UNIFORM_WEIGHTS("u_Weights");
+static constexpr UniformHandle UNIFORM_DIRECTION("u_Direction");
+
+Convolution::Convolution() :
+	_separableShader(nullptr),
+	_shader2D(nullptr),
+	_separable(false)
+{
+	_separableShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/convolution_separable.glsl" }
+	});
+	_shader2D = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/convolution_2d.glsl" }
+	});
+}
+
+RenderGraph::Resource Convolution::AddPasses(RenderGraph& graph, const std::string& name, RenderGraph::Resource input, const glm::uvec2& size, const float* kernel, int radius)
+{
+	int width = radius * 2 + 1;
+	int count = width * width;
+
+	// A kernel that just keeps the center pixel doesn't change anything, so there's no need to run it
+	bool identity = true;
+	for (int ix = 0; ix < count && identity; ix++) {
+		identity = kernel[ix] == (ix == count / 2 ? 1.0f : 0.0f);
+	}
+	if (identity) {
+		_separable = true;
+		return input;
+	}
+
+	std::vector<float> column, row;
+	_separable = radius <= MAX_SEPARABLE_RADIUS && Factor(kernel, width, column, row);
+
+	RenderGraph::TargetDescriptor output = { size.x, size.y, RenderTargetType::ColorRgba8 };
+	if (_separable) {
+		// The result of the first pass can be negative (ex: edge detection), so it needs a float target
+		RenderGraph::Resource horizontal = _AddPass(graph, name + " (Horizontal)", input, { size.x, size.y, RenderTargetType::ColorRgba16F }, row, radius, glm::ivec2(1, 0));
+		return _AddPass(graph, name + " (Vertical)", horizontal, output, column, radius, glm::ivec2(0, 1));
+	} else {
+		LOG_ASSERT(radius <= MAX_RADIUS, "Non-separable kernels can have a radius of at most {}", MAX_RADIUS);
+		return _AddPass(graph, name, input, output, std::vector<float>(kernel, kernel + count), radius, glm::ivec2(0));
+	}
+}
+
+bool Convolution::Factor(const float* kernel, int width, std::vector<float>& column, std::vector<float>& row)
+{
+	column.assign(width, 0.0f);
+	row.assign(width, 0.0f);
+
+	// Use the largest weight as our pivot, so that we don't divide by anything close to zero
+	int pivot = 0;
+	for (int ix = 1; ix < width * width; ix++) {
+		if (glm::abs(kernel[ix]) > glm::abs(kernel[pivot])) {
+			pivot = ix;
+		}
+	}
+	float scale = glm::abs(kernel[pivot]);
+	if (scale == 0.0f) {
+		return true;
+	}
+
+	// The column through the pivot, and the row through the pivot scaled so that their product gives back the pivot
+	int pivotRow = pivot / width;
+	int pivotColumn = pivot % width;
+	for (int ix = 0; ix < width; ix++) {
+		column[ix] = kernel[ix * width + pivotColumn];
+		row[ix] = kernel[pivotRow * width + ix] / kernel[pivot];
+	}
+
+	// If the kernel is the product of the two, every weight will match
+	for (int iy = 0; iy < width; iy++) {
+		for (int ix = 0; ix < width; ix++) {
+			if (glm::abs(kernel[iy * width + ix] - column[iy] * row[ix]) > scale * 1e-4f) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+RenderGraph::Resource Convolution::_AddPass(RenderGraph& graph, const std::string& name, RenderGraph::Resource input, const RenderGraph::TargetDescriptor& output,
+	const std::vector<float>& weights, int radius, const glm::ivec2& direction)
+{
+	ShaderProgram::Sptr shader = direction == glm::ivec2(0) ? _shader2D : _separableShader;
+
+	// Separable passes have a group per segment of a line, with one row of groups per line. 2D passes have a group per tile
+	glm::uvec2 groups;
+	if (direction.x != 0) {
+		groups = glm::uvec2((output.Width + SEPARABLE_GROUP_SIZE - 1) / SEPARABLE_GROUP_SIZE, output.Height);
+	} else if (direction.y != 0) {
+		groups = glm::uvec2((output.Height + SEPARABLE_GROUP_SIZE - 1) / SEPARABLE_GROUP_SIZE, output.Width);
+	} else {
+		groups = (glm::uvec2(output.Width, output.Height) + TILE_SIZE - 1u) / TILE_SIZE;
+	}
+
+	struct ConvolutionPass {
+		RenderGraph::Resource Output;
+	};
+	return graph.AddPass<ConvolutionPass>(name, [&](RenderGraph::PassBuilder& builder, ConvolutionPass& data) {
+		builder.Read(input);
+		data.Output = builder.Create(name, output);
+	}, [shader, input, weights, radius, direction, groups](const ConvolutionPass& data, const RenderGraph& graph) {
+		shader->Bind();
+		shader->SetUniform(UNIFORM_RADIUS, radius);
+		shader->SetUniform(UNIFORM_WEIGHTS, weights.data(), (int)weights.size());
+		if (direction != glm::ivec2(0)) {
+			shader->SetUniform(UNIFORM_DIRECTION, direction);
+		}
+
+		graph.GetFramebuffer(input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+		PostProcessingLayer::DispatchCompute(graph.GetFramebuffer(data.Output), groups);
+	}).Output;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Utils/Macros.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/RenderGraph.h"
+
+/**
+ * Runs square convolution kernels over an image with compute shaders, used by the box filter effects.
+ * Kernels that are separable (every row is a multiple of the same row, such as any kernel filled with
+ * one value and normalized) are run as a horizontal and a vertical pass, so they cost 2N taps per pixel
+ * instead of N^2. Everything else runs as a single 2D pass
+ */
+class Convolution {
+public:
+	MAKE_PTRS(Convolution);
+
+	// The largest radius that can be run as two 1D passes, must match compute_shaders/convolution_separable.glsl
+	static const int MAX_SEPARABLE_RADIUS = 32;
+	// The largest radius that can be run as a single 2D pass, must match compute_shaders/convolution_2d.glsl
+	static const int MAX_RADIUS = 4;
+
+	Convolution();
+	~Convolution() = default;
+
+	/**
+	 * Adds the passes to filter an image to the render graph
+	 * @param graph The graph for the current frame
+	 * @param name The name for the passes
+	 * @param input The image to filter
+	 * @param size The size of the output in pixels
+	 * @param kernel The weights of the kernel, row by row starting from the bottom row (-y). Must have (2 * radius + 1)^2 entries
+	 * @param radius The radius of the kernel, a 3x3 kernel has a radius of 1
+	 * @returns The resource holding the filtered image, or the input if the kernel does not change the image
+	 */
+	RenderGraph::Resource AddPasses(RenderGraph& graph, const std::string& name, RenderGraph::Resource input, const glm::uvec2& size, const float* kernel, int radius);
+
+	/**
+	 * Gets whether the last kernel passed to AddPasses could be split into two 1D passes
+	 */
+	bool IsSeparable() const { return _separable; }
+
+	/**
+	 * Splits a kernel into a column and a row, such that kernel[y][x] = column[y] * row[x]
+	 * @param kernel The weights of the kernel, row by row
+	 * @param width The width and height of the kernel
+	 * @param column Will be filled with the vertical weights
+	 * @param row Will be filled with the horizontal weights
+	 * @returns True if the kernel is separable, false if it needs a 2D pass
+	 */
+	static bool Factor(const float* kernel, int width, std::vector<float>& column, std::vector<float>& row);
+
+protected:
+	ShaderProgram::Sptr _separableShader;
+	ShaderProgram::Sptr _shader2D;
+	bool                _separable;
+
+	/**
+	 * Adds a single compute pass to the graph
+	 * @param direction The direction of a separable pass, or zero for a 2D pass
+	 */
+	RenderGraph::Resource _AddPass(RenderGraph& graph, const std::string& name, RenderGraph::Resource input, const RenderGraph::TargetDescriptor& output,
+		const std::vector<float>& weights, int radius, const glm::ivec2& direction);
+};
@@ -5,25 +5,80 @@
 #include "../RenderLayer.h"
 #include "Application/Application.h"
 
+// Work group size for both passes, must match the compute shaders
+static const uint32_t TILE_SIZE = 16;
+
+static constexpr UniformHandle UNIFORM_LEVEL_COUNT("u_LevelCount");
+
 DepthOfField::DepthOfField() :
 	PostProcessingLayer::Effect(),
-	_shader(nullptr)
+	_prefilterShader(nullptr),
+	_compositeShader(nullptr)
 {
 	Name = "Depth of Field";
 	_format = RenderTargetType::ColorRgb8;
 
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/depth_of_field.glsl" }
+	_fusion = EffectFusion::Custom;
+
+	// Our settings all come from the camera through the frame uniforms
+	_prefilterShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/depth_of_field_prefilter.glsl" }
+	});
+	_compositeShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/depth_of_field_composite.glsl" }
 	});
 }
 
 DepthOfField::~DepthOfField() = default;
 
-void DepthOfField::Apply(const Framebuffer::Sptr& gBuffer)
+RenderGraph::Resource DepthOfField::AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size)
 {
-	_shader->Bind();
-	gBuffer->BindAttachment(RenderTargetAttachment::Depth, 1);
+	struct DepthOfFieldPass {
+		RenderGraph::Resource Output;
+	};
+
+	// Downsample to half resolution, weighting each pixel by how blurry it is
+	glm::uvec2 halfSize = glm::max((size + 1u) / 2u, glm::uvec2(1));
+	RenderGraph::Resource prefiltered = graph.AddPass<DepthOfFieldPass>(Name + " (Prefilter)", [&](RenderGraph::PassBuilder& builder, DepthOfFieldPass& data) {
+		builder.Read(input);
+		builder.Read(gBuffer);
+		data.Output = builder.Create(Name + " (Half Resolution)", { halfSize.x, halfSize.y, RenderTargetType::ColorRgba16F });
+	}, [this, input, gBuffer, halfSize](const DepthOfFieldPass& data, const RenderGraph& graph) {
+		_prefilterShader->Bind();
+		graph.GetFramebuffer(input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+		graph.GetFramebuffer(gBuffer)->BindAttachment(RenderTargetAttachment::Depth, 1);
+		PostProcessingLayer::DispatchCompute(graph.GetFramebuffer(data.Output), (halfSize + TILE_SIZE - 1u) / TILE_SIZE);
+	}).Output;
+
+	// The largest circle of confusion is the aperture in full resolution pixels (see fragments/depth_of_field_common.glsl),
+	// so the chain needs to cover half that at half resolution
+	const auto& cam = Application::Get().CurrentScene()->MainCamera;
+	float maxBlur = cam != nullptr ? cam->Aperture : 20.0f;
+	PostProcessingLayer::BlurChain chain = Application::Get().GetLayer<PostProcessingLayer>()->AddBlurChain(graph, Name, prefiltered, halfSize, maxBlur * 0.5f);
+
+	std::vector<RenderGraph::Resource> levels = { prefiltered };
+	for (size_t ix = 0; ix < chain.Levels.size() && levels.size() < MAX_LEVELS; ix++) {
+		levels.push_back(chain.Levels[ix]);
+	}
+
+	// Pick the blur for each pixel at full resolution, blending with the sharp image where things are in focus
+	return graph.AddPass<DepthOfFieldPass>(Name + " (Composite)", [&](RenderGraph::PassBuilder& builder, DepthOfFieldPass& data) {
+		builder.Read(input);
+		builder.Read(gBuffer);
+		for (RenderGraph::Resource level : levels) {
+			builder.Read(level);
+		}
+		data.Output = builder.Create(Name, { size.x, size.y, RenderTargetType::ColorRgba8 });
+	}, [this, input, gBuffer, levels, size](const DepthOfFieldPass& data, const RenderGraph& graph) {
+		_compositeShader->Bind();
+		_compositeShader->SetUniform(UNIFORM_LEVEL_COUNT, (int)levels.size());
+		graph.GetFramebuffer(input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+		graph.GetFramebuffer(gBuffer)->BindAttachment(RenderTargetAttachment::Depth, 1);
+		for (size_t ix = 0; ix < levels.size(); ix++) {
+			graph.GetFramebuffer(levels[ix])->BindAttachment(RenderTargetAttachment::Color0, 2 + (int)ix);
+		}
+		PostProcessingLayer::DispatchCompute(graph.GetFramebuffer(data.Output), (size + TILE_SIZE - 1u) / TILE_SIZE);
+	}).Output;
 }
 
 void DepthOfField::RenderImGui()
@@ -5,14 +5,22 @@
 #include "Graphics/Textures/Texture3D.h"
 #include "Graphics/Framebuffer.h"
 
+/**
+ * Blurs the parts of the image that are out of focus, based on the camera's lens settings. The image is
+ * prefiltered at half resolution and run through the post processing layer's blur chain, then every pixel
+ * blends between the levels of the chain that match its circle of confusion
+ */
 class DepthOfField : public PostProcessingLayer::Effect {
 public:
 	MAKE_PTRS(DepthOfField);
 
+	// The prefiltered image plus the levels of the blur chain that we use, must match compute_shaders/depth_of_field_composite.glsl
+	static const int MAX_LEVELS = 6;
+
 	DepthOfField();
 	virtual ~DepthOfField();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual RenderGraph::Resource AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size) override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -21,5 +29,8 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
+	// Downsamples the image to half resolution, weighting each pixel by its blur
+	ShaderProgram::Sptr _prefilterShader;
+	// Picks the blur for each pixel from the levels of the blur chain
+	ShaderProgram::Sptr _compositeShader;
 };
\ No newline at end of file
@@ -5,7 +5,6 @@
 
 OutlineEffect::OutlineEffect() :
 	PostProcessingLayer::Effect(),
-	_shader(nullptr),
 	_outlineColor(glm::vec4(0, 0, 0, 1)),
 	_scale(1.0f),
 	_depthThreshold(0.1f),
@@ -16,26 +15,22 @@ OutlineEffect::OutlineEffect() :
 	Name = "Outline Effect";
 	_format = RenderTargetType::ColorRgb8;
 
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/outline.glsl" }
-	}); 
+	_fusion = EffectFusion::Pointwise;
+	_fusionSource = "shaders/fragment_shaders/post_effects/outline.glsl";
 }
 
 OutlineEffect::~OutlineEffect() = default;
 
-void OutlineEffect::Apply(const Framebuffer::Sptr& gBuffer)
+void OutlineEffect::ApplyFused(PostProcessingLayer::FusedStage& stage)
 {
-	_shader->Bind();
-	_shader->SetUniform("u_OutlineColor", _outlineColor);
-	_shader->SetUniform("u_Scale", _scale);
-	_shader->SetUniform("u_DepthThreshold", _depthThreshold);
-	_shader->SetUniform("u_NormalThreshold", _normalThreshold);
-	_shader->SetUniform("u_DepthNormThreshold", _depthNormalThreshold);
-	_shader->SetUniform("u_DepthNormThresholdScale", _depthNormalThresholdScale);
-	_shader->SetUniform("u_PixelSize", glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize());
-	gBuffer->BindAttachment(RenderTargetAttachment::Depth, 1);
-	gBuffer->BindAttachment(RenderTargetAttachment::Color1, 2); // The normal buffer
+	// The depth and normals are already bound for fused effects
+	stage.SetUniform("OutlineColor", _outlineColor);
+	stage.SetUniform("Scale", _scale);
+	stage.SetUniform("DepthThreshold", _depthThreshold);
+	stage.SetUniform("NormalThreshold", _normalThreshold);
+	stage.SetUniform("DepthNormThreshold", _depthNormalThreshold);
+	stage.SetUniform("DepthNormThresholdScale", _depthNormalThresholdScale);
+	stage.SetUniform("PixelSize", glm::vec2(1.0f) / (glm::vec2)stage.GetGBuffer()->GetSize());
 }
 
 void OutlineEffect::RenderImGui()
@@ -10,7 +10,7 @@ public:
 	OutlineEffect();
 	virtual ~OutlineEffect();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual void ApplyFused(PostProcessingLayer::FusedStage& stage) override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -19,7 +19,6 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
 	glm::vec4           _outlineColor;
 	float               _scale;
 	float               _depthThreshold;
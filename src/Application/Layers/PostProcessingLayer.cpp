@@ -2,15 +2,50 @@
 
 #include "Application/Application.h"
 #include "RenderLayer.h"
+#include "Graphics/RenderState.h"
+#include "Utils/FileHelpers.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ResourceManager/ResourceManager.h"
 
 #include "PostProcessing/ColorCorrectionEffect.h"
 #include "PostProcessing/BoxFilter3x3.h"
 #include "PostProcessing/BoxFilter5x5.h"
 #include "PostProcessing/OutlineEffect.h"
 #include "PostProcessing/DepthOfField.h"
+#include "PostProcessing/Bloom.h"
+
+namespace {
+	// Work group size for the blur chain passes, must match the compute shaders
+	const uint32_t BLUR_TILE_SIZE = 16;
+	constexpr UniformHandle UNIFORM_OFFSET("u_Offset");
+
+	struct BlurPass {
+		RenderGraph::Resource Output;
+	};
+
+	/**
+	 * Adds a single step of a blur chain to the graph
+	 */
+	RenderGraph::Resource AddBlurPass(RenderGraph& graph, const std::string& name, const ShaderProgram::Sptr& shader, RenderGraph::Resource input, const glm::uvec2& size, float offset)
+	{
+		return graph.AddPass<BlurPass>(name, [&](RenderGraph::PassBuilder& builder, BlurPass& data) {
+			builder.Read(input);
+			data.Output = builder.Create(name, { size.x, size.y, RenderTargetType::ColorRgba16F });
+		}, [shader, input, size, offset](const BlurPass& data, const RenderGraph& graph) {
+			shader->Bind();
+			shader->SetUniform(UNIFORM_OFFSET, offset);
+			graph.GetFramebuffer(input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+			PostProcessingLayer::DispatchCompute(graph.GetFramebuffer(data.Output), (size + BLUR_TILE_SIZE - 1u) / BLUR_TILE_SIZE);
+		}).Output;
+	}
+}
 
 PostProcessingLayer::PostProcessingLayer() :
-	ApplicationLayer()
+	ApplicationLayer(),
+	_blurDownsampleShader(nullptr),
+	_blurUpsampleShader(nullptr),
+	_fusionEnabled(true),
+	_fusedShaders()
 {
 	Name = "Post Processing";
 	Overrides =
@@ -26,29 +61,40 @@ void PostProcessingLayer::AddEffect(const Effect::Sptr& effect) {
 	_effects.push_back(effect);
 }
 
+void PostProcessingLayer::SetFusionEnabled(bool enabled) {
+	_fusionEnabled = enabled;
+}
+
+bool PostProcessingLayer::IsFusionEnabled() const {
+	return _fusionEnabled;
+}
+
 void PostProcessingLayer::OnAppLoad(const nlohmann::json& config)
 {
+	if (config.contains(Name)) {
+		_fusionEnabled = JsonGet(config[Name], "fuse_effects", _fusionEnabled);
+	}
+
+	// The blur chain is shared by all the effects, so the layer owns its shaders
+	_blurDownsampleShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/dual_filter_downsample.glsl" }
+	});
+	_blurUpsampleShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Compute, "shaders/compute_shaders/dual_filter_upsample.glsl" }
+	});
+
 	// Loads some effects in
 	_effects.push_back(std::make_shared<ColorCorrectionEffect>());
 	_effects.push_back(std::make_shared<BoxFilter3x3>());
 	_effects.push_back(std::make_shared<BoxFilter5x5>());
 	_effects.push_back(std::make_shared<OutlineEffect>());
 	_effects.push_back(std::make_shared<DepthOfField>());
+	_effects.push_back(std::make_shared<Bloom>());
 
 	GetEffect<OutlineEffect>()->Enabled = false;
+	GetEffect<Bloom>()->Enabled = false;
 
-	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
-
-	// Initialize all the effect's output FBOs (inefficient) 
-	for (const auto& effect : _effects) {
-		FramebufferDescriptor fboDesc = FramebufferDescriptor();
-		fboDesc.Width  = viewport.z * effect->_outputScale.x;
-		fboDesc.Height = viewport.w * effect->_outputScale.y;
-		fboDesc.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(effect->_format);
-
-		effect->_output = std::make_shared<Framebuffer>(fboDesc);
-	}
+	// Note that effects don't own their outputs, they get transient targets from the render graph each frame
 
 	// We need a mesh for drawing fullscreen quads
 	glm::vec2 positions[6] = {
@@ -70,68 +116,156 @@ void PostProcessingLayer::OnPostRender()
 	Application& app = Application::Get();
 	const glm::uvec4& viewport = app.GetPrimaryViewport();
 
-	// Grab the render layer from the app, get it's output and the G-Buffer
-	const RenderLayer::Sptr& renderer = app.GetLayer<RenderLayer>();
-	const Framebuffer::Sptr& output = renderer->GetRenderOutput();
-	const Framebuffer::Sptr& gBuffer = renderer->GetGBuffer();
-
-	// Stores the input FBO to the effect, we start with the renderlayer's output 
-	Framebuffer::Sptr current = output;
-
-	// Disable depth testing and depth writing, as well as blending
-	glDisable(GL_DEPTH_TEST);
-	glDepthMask(false);
-	glDisable(GL_BLEND);
+	// Grab the render layer's output and the G-Buffer from the render graph
+	const RenderGraph::Sptr& graph = app.GetRenderGraph();
+	RenderGraph::Resource gBuffer    = graph->Find("G-Buffer");
+	RenderGraph::Resource sceneColor = graph->Find("Scene Color");
+	RenderGraph::Resource backBuffer = graph->Find("Back Buffer");
+	if (gBuffer == RenderGraph::InvalidResource || sceneColor == RenderGraph::InvalidResource) {
+		return;
+	}
 
-	// Bind the quad VAO so our effects can use it
-	_quadVAO->Bind();
+	// Stores the input to the effect, we start with the renderlayer's output 
+	RenderGraph::Resource current = sceneColor;
 
-	// Iterate over all the effects in the queue
+	// Split the enabled effects into passes. Effects that can be fused are added to the end of the pass before them,
+	// so that the whole chain runs in a single generated shader
+	std::vector<std::vector<Effect::Sptr>> passes;
 	for (const auto& effect : _effects) {
 		// Only render if it's enabled
-		if (effect->Enabled) {
-			// Bind the FBO and make sure we're rendering to the whole thing
-			effect->_output->Bind();
-			glViewport(0, 0, effect->_output->GetWidth(), effect->_output->GetHeight());
-
-			// Bind color 0 from previous pass to texture slot 0 so our effects can access
-			current->BindAttachment(RenderTargetAttachment::Color0, 0);
-
-			// Apply the effect and render the fullscreen quad
-			effect->Apply(gBuffer);
-			_quadVAO->Draw();
+		if (!effect->Enabled) {
+			continue;
+		}
 
-			// Unbind output and set it as input for next pass
-			effect->_output->Unbind();
-			current = effect->_output;
+		if (_fusionEnabled && !passes.empty() && _CanFuse(passes.back(), effect)) {
+			passes.back().push_back(effect);
+		} else {
+			passes.push_back({ effect });
 		}
 	}
-	_quadVAO->Unbind();
 
-	// Restore viewport to game viewport
-	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	// Each pass reads the previous pass's output, and writes to a new transient target. The graph will alias targets
+	// that are no longer needed, so a chain of passes only needs a couple of framebuffers no matter how long it is
+	struct EffectPass {
+		RenderGraph::Resource Input;
+		RenderGraph::Resource Output;
+	};
+	for (const auto& stages : passes) {
+		// Custom effects set up their own passes
+		if (stages[0]->_fusion == EffectFusion::Custom) {
+			current = stages[0]->AddPasses(*graph, current, gBuffer, glm::uvec2(viewport.z, viewport.w));
+			continue;
+		}
+
+		// Effects that can't be fused use their own shaders, everything else goes through a generated shader
+		ShaderProgram::Sptr shader = nullptr;
+		if (stages[0]->_fusion != EffectFusion::None) {
+			shader = _GetFusedShader(stages);
+			if (shader == nullptr) {
+				continue;
+			}
+		}
 
-	// Bind the output of our post processing as the source for the blit
-	current->Bind(FramebufferBinding::Read);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		// The pass takes its name from its effects, and its output from the last one
+		std::string name = stages[0]->Name;
+		for (size_t ix = 1; ix < stages.size(); ix++) {
+			name += " + " + stages[ix]->Name;
+		}
+		const Effect::Sptr& last = stages.back();
+
+		current = graph->AddPass<EffectPass>(name, [&](RenderGraph::PassBuilder& builder, EffectPass& data) {
+			data.Input  = current;
+			data.Output = builder.Create(name, {
+				static_cast<uint32_t>(viewport.z * last->_outputScale.x),
+				static_cast<uint32_t>(viewport.w * last->_outputScale.y),
+				last->_format
+			});
+			builder.Read(current);
+			builder.Read(gBuffer);
+		}, [this, stages, shader, gBuffer](const EffectPass& data, const RenderGraph& graph) {
+			const Framebuffer::Sptr& depth = graph.GetFramebuffer(gBuffer);
+			const Framebuffer::Sptr& output = graph.GetFramebuffer(data.Output);
+
+			// Disable depth testing and depth writing, as well as blending
+			RenderState::Disable(GL_DEPTH_TEST);
+			RenderState::SetDepthMask(false);
+			RenderState::Disable(GL_BLEND);
 
-	// Blit the color buffer to our game window
-	current->Blit(
-		{ 0, 0, current->GetWidth(), current->GetHeight() },
-		{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
-		BufferFlags::Color,
-		MagFilter::Linear
-	);
+			// Bind the FBO and make sure we're rendering to the whole thing
+			output->Bind();
+			RenderState::SetViewport(0, 0, output->GetWidth(), output->GetHeight());
 
-	gBuffer->Bind(FramebufferBinding::Read);
-	current->Blit(
-		{ 0, 0, gBuffer->GetWidth(), gBuffer->GetHeight() },
-		{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
-		BufferFlags::Depth,
-		MagFilter::Nearest
-	);
+			// Bind color 0 from previous pass to texture slot 0 so our effects can access
+			graph.GetFramebuffer(data.Input)->BindAttachment(RenderTargetAttachment::Color0, 0);
+
+			_quadVAO->Bind();
+			if (shader == nullptr) {
+				// Apply the effect and render the fullscreen quad
+				stages[0]->_output = output;
+				stages[0]->Apply(depth);
+				_quadVAO->Draw();
+				stages[0]->_output = nullptr;
+			} else {
+				// Generated shaders always get the depth and normals from the G-Buffer, the effects can bind anything else they need after that
+				depth->BindAttachment(RenderTargetAttachment::Depth, 1);
+				depth->BindAttachment(RenderTargetAttachment::Color1, 2);
+				int nextSlot = 3;
+
+				shader->Bind();
+				FusedStage stage;
+				stage._shader   = shader;
+				stage._gBuffer  = depth;
+				stage._nextSlot = &nextSlot;
+				for (size_t ix = 0; ix < stages.size(); ix++) {
+					stage._prefix = "Stage" + std::to_string(ix) + "_";
+					stages[ix]->ApplyFused(stage);
+				}
+				_quadVAO->Draw();
+			}
+
+			// Unbind output, the target may be handed to another pass once we're done with it
+			output->Unbind();
+		}).Output;
+	}
 
-	gBuffer->Unbind();
+	// Copy the final image and the scene depth to the game window, this replaces the render layer's copy of the scene
+	graph->AddPass("Post Processing Blit", [&](RenderGraph::PassBuilder& builder) {
+		builder.Read(current);
+		builder.Read(gBuffer);
+		builder.Overwrite(backBuffer);
+	}, [current, gBuffer](const RenderGraph& graph) {
+		Application& app = Application::Get();
+		const glm::uvec4& viewport = app.GetPrimaryViewport();
+		const Framebuffer::Sptr& result = graph.GetFramebuffer(current);
+		const Framebuffer::Sptr& depth  = graph.GetFramebuffer(gBuffer);
+
+		VertexArrayObject::Unbind();
+
+		// Restore viewport to game viewport
+		RenderState::SetViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+
+		// Bind the output of our post processing as the source for the blit
+		result->Bind(FramebufferBinding::Read);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+		// Blit the color buffer to our game window
+		Framebuffer::Blit(
+			{ 0, 0, result->GetWidth(), result->GetHeight() },
+			{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
+			BufferFlags::Color,
+			MagFilter::Linear
+		);
+
+		depth->Bind(FramebufferBinding::Read);
+		Framebuffer::Blit(
+			{ 0, 0, depth->GetWidth(), depth->GetHeight() },
+			{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
+			BufferFlags::Depth,
+			MagFilter::Nearest
+		);
+
+		depth->Unbind();
+	});
 }
 
 void PostProcessingLayer::OnSceneLoad()
@@ -152,7 +286,6 @@ void PostProcessingLayer::OnWindowResize(const glm::ivec2& oldSize, const glm::i
 {
 	for (const auto& effect : _effects) {
 		effect->OnWindowResize(oldSize, newSize);
-		effect->_output->Resize(newSize.x, newSize.y);
 	}
 }
 
@@ -161,6 +294,131 @@ const std::vector<PostProcessingLayer::Effect::Sptr>& PostProcessingLayer::GetEf
 	return _effects;
 }
 
+nlohmann::json PostProcessingLayer::GetDefaultConfig()
+{
+	return {
+		{ "fuse_effects", _fusionEnabled }
+	};
+}
+
+bool PostProcessingLayer::_CanFuse(const std::vector<Effect::Sptr>& stages, const Effect::Sptr& effect)
+{
+	if (effect->_fusion == EffectFusion::None   || stages[0]->_fusion == EffectFusion::None ||
+		effect->_fusion == EffectFusion::Custom || stages[0]->_fusion == EffectFusion::Custom) {
+		return false;
+	}
+
+	// Effects read the previous stage by calling it, so an effect that samples its input around the pixel runs the whole
+	// chain once per sample. We only allow that when the chain is a few cheap color lookups, which costs less than writing
+	// the frame out and reading it back in. We don't need to match output sizes here, since the lookups don't care what
+	// resolution they run at
+	if (effect->_fusion == EffectFusion::Gather) {
+		return std::all_of(stages.begin(), stages.end(), [](const Effect::Sptr& stage) {
+			return stage->_fusion == EffectFusion::ColorRemap;
+		});
+	}
+
+	// Otherwise the effect only reads its own pixel, so it just needs to run at the same resolution as the stage before it
+	return effect->_outputScale == stages.back()->_outputScale;
+}
+
+ShaderProgram::Sptr PostProcessingLayer::_GetFusedShader(const std::vector<Effect::Sptr>& stages)
+{
+	// The same chain of bodies always generates the same code, so that's what we cache by
+	std::string key;
+	for (const auto& stage : stages) {
+		key += stage->_fusionSource + ";";
+	}
+	auto it = _fusedShaders.find(key);
+	if (it != _fusedShaders.end()) {
+		return it->second;
+	}
+
+	// The common header declares the inputs, outputs and G-Buffer samplers for every stage
+	std::string code = FileHelpers::ReadResolveIncludes("shaders/fragments/post_effect_fusion.glsl");
+	std::string debugName = "Fused Post Effects (";
+
+	for (size_t ix = 0; ix < stages.size(); ix++) {
+		std::string prefix = "Stage" + std::to_string(ix) + "_";
+
+		// The first stage reads the previous pass, the rest read the stage before them
+		code += "\nvec3 " + prefix + "Input(vec2 uv) {\n";
+		code += ix == 0 ? "    return texture(s_Image, uv).rgb;\n" : "    return Stage" + std::to_string(ix - 1) + "_Apply(uv);\n";
+		code += "}\n";
+
+		// Give all of the stage's identifiers a unique prefix, so that effects can't clash with each other
+		std::string body = FileHelpers::ReadResolveIncludes(stages[ix]->_fusionSource);
+		for (size_t seek = body.find("STAGE_"); seek != std::string::npos; seek = body.find("STAGE_", seek + prefix.size())) {
+			body.replace(seek, 6, prefix);
+		}
+		code += body;
+
+		debugName += (ix > 0 ? ", " : "") + stages[ix]->Name;
+	}
+
+	code += "\nvoid main() {\n";
+	code += "    outColor = vec4(Stage" + std::to_string(stages.size() - 1) + "_Apply(inUV), 1.0);\n";
+	code += "}\n";
+
+	ShaderProgram::Sptr result = std::make_shared<ShaderProgram>();
+	result->SetDebugName(debugName + ")");
+	if (!result->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex) ||
+		!result->LoadShaderPart(code.c_str(), ShaderPartType::Fragment) || !result->Link() || !result->IsValid()) {
+		LOG_WARN("Failed to generate a shader for post effects \"{}\", they will be skipped", debugName + ")");
+		result = nullptr;
+	}
+
+	// We store failures as well, so that we don't try to compile a broken chain every frame
+	_fusedShaders[key] = result;
+	return result;
+}
+
+void PostProcessingLayer::DispatchCompute(const Framebuffer::Sptr& output, const glm::uvec2& groups)
+{
+	Texture2D::Sptr texture = output->GetTextureAttachment(RenderTargetAttachment::Color0);
+	glBindImageTexture(0, texture->GetHandle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, (GLenum)texture->GetFormat());
+	glDispatchCompute(groups.x, groups.y, 1);
+
+	// The next pass will either sample or blit the output
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+PostProcessingLayer::BlurChain PostProcessingLayer::AddBlurChain(RenderGraph& graph, const std::string& name, RenderGraph::Resource input, const glm::uvec2& size, float radius)
+{
+	// Each level doubles the radius, so we need enough levels to cover the radius. The sample offsets stretch or shrink
+	// the blur to make up the difference between the radius and a power of two
+	int levels = glm::clamp((int)glm::ceil(glm::log2(glm::max(radius, 1.0f))), 1, MAX_BLUR_LEVELS);
+	float offset = glm::clamp(radius / (float)(1 << levels), 0.5f, 2.0f);
+
+	BlurChain result;
+	std::vector<glm::uvec2> sizes;
+
+	// Go down the chain, stopping early if the levels stop getting smaller
+	RenderGraph::Resource source = input;
+	glm::uvec2 levelSize = size;
+	for (int ix = 0; ix < levels && (levelSize.x > 1 || levelSize.y > 1); ix++) {
+		levelSize = glm::max((levelSize + 1u) / 2u, glm::uvec2(1));
+		source = AddBlurPass(graph, name + " (Downsample " + std::to_string(ix + 1) + ")", _blurDownsampleShader, source, levelSize, offset);
+		result.Levels.push_back(source);
+		sizes.push_back(levelSize);
+	}
+
+	// Then back up to the first level
+	for (int ix = (int)result.Levels.size() - 2; ix >= 0; ix--) {
+		source = AddBlurPass(graph, name + " (Upsample " + std::to_string(ix + 1) + ")", _blurUpsampleShader, source, sizes[ix], offset);
+	}
+	result.Output = source;
+
+	return result;
+}
+
+void PostProcessingLayer::FusedStage::BindTexture(const std::string& name, const ITexture::Sptr& texture)
+{
+	int slot = (*_nextSlot)++;
+	texture->Bind(slot);
+	_shader->SetUniform(_prefix + name, slot);
+}
+
 void PostProcessingLayer::Effect::DrawFullscreen()
 {
 	glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -3,6 +3,26 @@
 #include "Application/ApplicationLayer.h"
 #include "Utils/Macros.h"
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Textures/ITexture.h"
+#include "Graphics/RenderGraph.h"
+
+/**
+ * Describes how a post processing effect can be combined with the effects around it into a single
+ * generated shader, so that a chain of effects only reads and writes the frame once
+ */
+ENUM(EffectFusion, int,
+	// The effect is drawn with its own Apply function, and always runs as a separate pass
+	None       = 0,
+	// The effect only reads its own pixel from the previous effect, and only depends on that color (ex: a LUT lookup)
+	ColorRemap = 1,
+	// The effect only reads its own pixel from the previous effect, but may sample the G-Buffer anywhere
+	Pointwise  = 2,
+	// The effect samples the previous effect's output around its pixel (ex: a blur)
+	Gather     = 3,
+	// The effect adds its own passes to the render graph with Effect::AddPasses (ex: compute shaders), and always runs on its own
+	Custom     = 4
+);
 
 /**
  * The post processing layer will handle rendering effects after the primary
@@ -12,6 +32,41 @@ class PostProcessingLayer final : public ApplicationLayer {
 public:
 	MAKE_PTRS(PostProcessingLayer);
 
+	/**
+	 * Passed to effects that are part of a fused pass, so they can set their uniforms in the generated
+	 * shader. Each effect's identifiers are prefixed in the generated shader, so effects only need to use
+	 * the names from their GLSL body (without the STAGE_ prefix)
+	 */
+	class FusedStage {
+	public:
+		template <typename T>
+		void SetUniform(const std::string& name, const T& value) {
+			_shader->SetUniform(_prefix + name, value);
+		}
+		template <typename T>
+		void SetUniform(const std::string& name, const T* values, int count) {
+			_shader->SetUniform(_prefix + name, values, count);
+		}
+		/**
+		 * Binds a texture to the next free texture slot, and points the sampler with the given name at it
+		 */
+		void BindTexture(const std::string& name, const ITexture::Sptr& texture);
+
+		/**
+		 * Gets the G-Buffer from the deferred rendering pipeline
+		 */
+		const Framebuffer::Sptr& GetGBuffer() const { return _gBuffer; }
+
+	protected:
+		friend class PostProcessingLayer;
+
+		ShaderProgram::Sptr _shader;
+		Framebuffer::Sptr   _gBuffer;
+		std::string         _prefix;
+		// The next free texture slot, shared by all the stages in the pass
+		int*                _nextSlot;
+	};
+
 	/**
 	 * Base class for post processing effects, we extend this to create new effects
 	 */
@@ -28,11 +83,26 @@ public:
 		virtual ~Effect() = default;
 
 		/**
-		 * Overload this in derived classes to apply the effect. Texture slot 0
+		 * Overload this in derived classes that can't be fused to apply the effect. Texture slot 0
 		 * will contain the image from the previous pass
 		 * @param gBuffer The G-Buffer from the deferred rendering pipeline
 		 */
-		virtual void Apply(const Framebuffer::Sptr& gBuffer) = 0;
+		virtual void Apply(const Framebuffer::Sptr& gBuffer) {}
+		/**
+		 * Overload this in derived classes that can be fused to set the effect's uniforms
+		 * in the generated shader for the pass that the effect is part of
+		 * @param stage Gives access to the effect's uniforms in the generated shader
+		 */
+		virtual void ApplyFused(FusedStage& stage) {}
+		/**
+		 * Overload this in derived classes with a fusion of Custom to add the effect's passes to the render graph
+		 * @param graph The graph for the current frame
+		 * @param input The output of the previous effect
+		 * @param gBuffer The G-Buffer from the deferred rendering pipeline
+		 * @param size The size of the game viewport in pixels
+		 * @returns The resource that holds the effect's output
+		 */
+		virtual RenderGraph::Resource AddPasses(RenderGraph& graph, RenderGraph::Resource input, RenderGraph::Resource gBuffer, const glm::uvec2& size) { return input; }
 		/**
 		 * Allows this effect to perform logic when a new scene is loaded
 		 */
@@ -61,16 +131,35 @@ public:
 	protected:
 		friend class PostProcessingLayer;
 
-		// The output that this effect will render into
+		// The output that this effect is rendering into. This is a transient target from the render graph, so it is only set while the effect is being applied
 		Framebuffer::Sptr _output = nullptr;
 		// The scaling between this effect's output and the screen size, default 1
 		glm::vec2 _outputScale = glm::vec2(1);
 		// The render target format for the effect's buffer
 		RenderTargetType _format = RenderTargetType::ColorRgba8;
+		// How this effect can be combined with the effects around it
+		EffectFusion _fusion = EffectFusion::None;
+		// For effects that can be fused, the path to the effect's GLSL body (see fragments/post_effect_fusion.glsl)
+		std::string _fusionSource;
 		
 		Effect() = default;
 	};
 
+	/**
+	 * The targets of a blur chain added with AddBlurChain
+	 */
+	struct BlurChain {
+		// The input downsampled again and again, level i is 1/2^(i+1) the size of the input. Each level blurs over
+		// about twice as many input pixels as the one before it, so effects that need a different blur for every
+		// pixel can pick between them
+		std::vector<RenderGraph::Resource> Levels;
+		// The smallest level upsampled back to the size of the first level, blurred by roughly the requested radius
+		RenderGraph::Resource Output;
+	};
+
+	// The most levels that a blur chain can have
+	static const int MAX_BLUR_LEVELS = 8;
+
 	PostProcessingLayer();
 	virtual ~PostProcessingLayer();
 
@@ -99,6 +188,35 @@ public:
 	 */
 	void AddEffect(const Effect::Sptr& effect);
 
+	/**
+	 * Sets whether chains of compatible effects are combined into a single pass, set
+	 * with "fuse_effects" in the app settings
+	 */
+	void SetFusionEnabled(bool enabled);
+	bool IsFusionEnabled() const;
+
+	/**
+	 * Helper for compute shader passes, binds color 0 of the output to image unit 0, runs the
+	 * bound compute shader, and waits for the writes to finish before anything samples or blits the output
+	 * @param output The framebuffer that the compute shader writes to
+	 * @param groups The number of work groups to dispatch
+	 */
+	static void DispatchCompute(const Framebuffer::Sptr& output, const glm::uvec2& groups);
+
+	/**
+	 * Adds a wide blur to the render graph, using a dual filter: the input is downsampled by half over and over,
+	 * with a few bilinear taps per pass, then upsampled back the same way. Every level doubles the radius, so a
+	 * blur of any radius only takes a handful of passes, most of them at a very low resolution. The levels are
+	 * transient targets, so they're pooled with the rest of the frame's targets
+	 * @param graph The graph for the current frame
+	 * @param name The name for the passes
+	 * @param input The image to blur, alpha is blurred as well
+	 * @param size The size of the input in pixels
+	 * @param radius The radius of the blur in input pixels
+	 * @returns The levels of the blur, passes for levels that nothing reads are culled by the graph
+	 */
+	BlurChain AddBlurChain(RenderGraph& graph, const std::string& name, RenderGraph::Resource input, const glm::uvec2& size, float radius);
+
 	// Inherited from ApplicationLayer
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
@@ -106,10 +224,32 @@ public:
 	virtual void OnSceneLoad() override;
 	virtual void OnSceneUnload() override;
 	virtual void OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) override;
+	virtual nlohmann::json GetDefaultConfig() override;
 
 protected:
 	friend class Effect;
 
 	std::vector<Effect::Sptr> _effects;
 	VertexArrayObject::Sptr _quadVAO;
+
+	// The passes for blur chains, see AddBlurChain
+	ShaderProgram::Sptr _blurDownsampleShader;
+	ShaderProgram::Sptr _blurUpsampleShader;
+
+	bool _fusionEnabled;
+	// The generated shaders for each chain of effects that has been fused, keyed by the effects' GLSL bodies
+	std::unordered_map<std::string, ShaderProgram::Sptr> _fusedShaders;
+
+	/**
+	 * Checks whether an effect can be added to the end of a pass, without changing the result
+	 * @param stages The effects that are already in the pass
+	 * @param effect The effect to add
+	 */
+	static bool _CanFuse(const std::vector<Effect::Sptr>& stages, const Effect::Sptr& effect);
+	/**
+	 * Gets the generated shader that applies a chain of effects in order, generating it the first time
+	 * the chain is used
+	 * @returns The shader, or nullptr if the shader failed to compile
+	 */
+	ShaderProgram::Sptr _GetFusedShader(const std::vector<Effect::Sptr>& stages);
 };
\ No newline at end of file
@@ -15,8 +15,50 @@
 #include <GLM/gtc/type_ptr.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <GLM/gtx/common.hpp> // for fmod (floating modulus)
+#include <algorithm>
+#include <limits>
+#include <execution>
 #include "Gameplay/Components/ShadowCamera.h"
-
+#include "Graphics/Frustum.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/VertexTypes.h"
+#include "Utils/JsonGlmHelpers.h"
+
+namespace {
+	// The number of jitter offsets we cycle through for temporal upsampling
+	const uint32_t JITTER_SAMPLES = 8;
+	// The size of the tiles in compute_shaders/temporal_upsample.glsl
+	const uint32_t UPSAMPLE_TILE_SIZE = 16;
+
+	// Uniforms that we set every frame (or every light), these are hashed at compile time
+	constexpr UniformHandle UNIFORM_VIEW_TO_SHADOW("u_ViewToShadow");
+	constexpr UniformHandle UNIFORM_ATLAS_RECT("u_AtlasRect");
+	constexpr UniformHandle UNIFORM_LIGHT_DIR_VIEWSPACE("u_LightDirViewspace");
+	constexpr UniformHandle UNIFORM_LIGHT_POS_VIEWSPACE("u_LightPosViewspace");
+	constexpr UniformHandle UNIFORM_SHADOW_BIAS("u_ShadowBias");
+	constexpr UniformHandle UNIFORM_NORMAL_BIAS("u_NormalBias");
+	constexpr UniformHandle UNIFORM_ATTENUATION("u_Attenuation");
+	constexpr UniformHandle UNIFORM_INTENSITY("u_Intensity");
+	constexpr UniformHandle UNIFORM_LIGHT_COLOR("u_LightColor");
+	constexpr UniformHandle UNIFORM_REPROJECTION("u_Reprojection");
+	constexpr UniformHandle UNIFORM_JITTER("u_Jitter");
+	constexpr UniformHandle UNIFORM_HISTORY_VALID("u_HistoryValid");
+	constexpr UniformHandle UNIFORM_MATERIAL_DEPTH("u_MaterialDepth");
+
+	/// <summary>
+	/// Gets an element of the Halton sequence with the given base, which is spread evenly over [0, 1) for any number of elements
+	/// </summary>
+	float Halton(uint32_t index, uint32_t base) {
+		float result = 0.0f;
+		float fraction = 1.0f;
+		while (index > 0) {
+			fraction /= (float)base;
+			result += fraction * (float)(index % base);
+			index /= base;
+		}
+		return result;
+	}
+}
 
 RenderLayer::RenderLayer() :
 	ApplicationLayer(),
@@ -25,7 +67,53 @@ RenderLayer::RenderLayer() :
 	_frameUniforms(nullptr),
 	_instanceUniforms(nullptr),
 	_renderFlags(RenderFlags::EnableColorCorrection | RenderFlags::EnableAlbedo | RenderFlags::EnableDiffuse | RenderFlags::EnableSpecular | RenderFlags::EnableEmissive),
-	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f })
+	_compositeKeywordMask(0),
+	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f }),
+	_frustumCulling(true),
+	_instancing(true),
+	_useGeometryArena(false),
+	_depthOnlyShadows(true),
+	_occlusionCulling(true),
+	_lodEnabled(true),
+	_compactGBuffer(false),
+	_visibilityBufferEnabled(false),
+	_dynamicResolutionEnabled(false),
+	_dynamicResolution(nullptr),
+	_outputSize(0),
+	_projection(1.0f),
+	_jitter(0.0f),
+	_jitterIndex(0),
+	_prevViewProjection(1.0f),
+	_upsampledBuffer(nullptr),
+	_historyBuffers(),
+	_historyIndex(0),
+	_historyValid(false),
+	_temporalUpsampleShader(nullptr),
+	_renderQueue(),
+	_drawBatches(),
+	_drawItems(),
+	_objectData(),
+	_passMeshes(),
+	_objectBuffer(nullptr),
+	_drawIndices(),
+	_drawIndexBuffer(nullptr),
+	_geometryArena(nullptr),
+	_indirectCommands(),
+	_indirectBuffer(nullptr),
+	_lightClusters(nullptr),
+	_shadowAtlas(nullptr),
+	_shadowTiles(),
+	_occlusionBuffer(nullptr),
+	_occluded(),
+	_visibilityFBO(nullptr),
+	_visibilityObjects(),
+	_visibilityObjectBuffer(nullptr),
+	_visibilityMaterials(),
+	_visibilityItems(),
+	_casterStates(),
+	_dirtyCasterSpheres(),
+	_stats(),
+	_lastFrameStats()
 {
 	Name = "Rendering";
 	Overrides = 
@@ -42,17 +130,24 @@ void RenderLayer::OnPreRender()
 
 	Application& app = Application::Get();
 
-	// Clear the color and depth buffers
+	// Reset our counters for the new frame
+	_stats = RenderStats();
+
+	// Start timing the frame, and pick the resolution we'll render at based on the frames that the GPU has finished
+	_dynamicResolution->BeginFrame();
+	_UpdateRenderSize();
+
+	// Clear the color and depth buffers. Empty normals are (0.5, 0.5, 0.5) in the default layout, and zero in the compact layout
 	const glm::vec4 colors[4] = {
 		glm::vec4(0.0f),
-		glm::vec4(0.5f, 0.5f, 0.5f, 0.0f),
+		_compactGBuffer ? glm::vec4(0.0f) : glm::vec4(0.5f, 0.5f, 0.5f, 0.0f),
 		glm::vec4(0.0f),
 		glm::vec4(0.0f)
 	};
 
 	_primaryFBO->Bind();
 	// Clear the framebuffer. Note that this also binds and sets the viewport
-	_ClearFramebuffer(_primaryFBO, colors, 4);
+	_ClearFramebuffer(_primaryFBO, colors, _compactGBuffer ? 3 : 4);
 
 	
 	// Grab shorthands to the camera and shader from the scene
@@ -62,6 +157,17 @@ void RenderLayer::OnPreRender()
 	glm::mat4 viewProj = camera->GetViewProjection();
 	DebugDrawer::Get().SetViewProjection(viewProj);
 
+	// When we're upsampling, each frame samples a different point inside the pixels, so the upsampler can recover the detail
+	// between them. Moving the samples by the jitter means shifting the image the other way
+	_projection = camera->GetProjection();
+	_jitter = glm::vec2(0.0f);
+	if (_dynamicResolutionEnabled) {
+		_jitterIndex = (_jitterIndex + 1) % JITTER_SAMPLES;
+		_jitter = glm::vec2(Halton(_jitterIndex + 1, 2), Halton(_jitterIndex + 1, 3)) - 0.5f;
+		glm::vec2 offset = -2.0f * _jitter / glm::vec2(_primaryFBO->GetSize());
+		_projection = glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f)) * _projection;
+	}
+
 	// The current material that is bound for rendering
 	Material::Sptr currentMat = nullptr;
 	ShaderProgram::Sptr shader = nullptr;
@@ -84,10 +190,17 @@ void RenderLayer::OnPreRender()
 	_instanceUniforms->Bind(INSTANCE_UBO_BINDING);
 	_lightingUbo->Bind(LIGHTING_UBO_BINDING);
 
+	// As well as our object data buffers
+	_objectBuffer->Bind(OBJECT_SSBO_BINDING);
+	_drawIndexBuffer->Bind(DRAW_INDEX_SSBO_BINDING);
+
 	// Draw physics debug
 	app.CurrentScene()->DrawPhysicsDebug();
 
 	_InitFrameUniforms();
+
+	// Collect our objects and their transforms once, so that all of our passes can share them
+	_GatherObjects();
 }
 
 void RenderLayer::OnRender(const Framebuffer::Sptr& prevLayer)
@@ -97,21 +210,25 @@ void RenderLayer::OnRender(const Framebuffer::Sptr& prevLayer)
 	Application& app = Application::Get();
 	
 	// Make sure depth testing and culling are re-enabled
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE); 
-	glDepthMask(true); 
+	RenderState::Enable(GL_DEPTH_TEST);
+	RenderState::Enable(GL_CULL_FACE); 
+	RenderState::SetDepthMask(true); 
 
 	// Disable blending, we want to override any existing colors
-	glDisable(GL_BLEND);
+	RenderState::Disable(GL_BLEND);
 
 	// Grab shorthands to the camera and shader from the scene
 	Camera::Sptr camera = app.CurrentScene()->MainCamera;
 
+	// Objects that the visibility buffer can handle are drawn and resolved into the G-Buffer first
+	if (!_visibilityMaterials.empty()) {
+		_RenderVisibility(camera->GetView(), _projection);
+	}
+
 	// We can now render all our scene elements via the helper function
-	_RenderScene(camera->GetView(), camera->GetProjection(), _primaryFBO->GetSize());
+	_RenderScene(camera->GetView(), _projection, _primaryFBO->GetSize(), RenderPass::GBuffer);
 
-	// Use our cubemap to draw our skybox
-	app.CurrentScene()->DrawSkybox();
+	// Note that the skybox is drawn by _Composite, after lighting, since anything drawn into the G-Buffer here would be overwritten
 
 	VertexArrayObject::Unbind(); 
 }
@@ -122,35 +239,75 @@ void RenderLayer::OnPostRender() {
 	// Unbind our G-Buffer
 	_primaryFBO->Unbind(); 
 
-	// Composite our lighting 
-	_Composite();
-
-	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
-
-	// Restore viewport to game viewport
-	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	// The rest of our work goes through the render graph, so that later layers can build on our output
+	const RenderGraph::Sptr& graph = Application::Get().GetRenderGraph();
+	RenderGraph::Resource gBuffer    = graph->Import("G-Buffer", _primaryFBO);
+	RenderGraph::Resource backBuffer = graph->Find("Back Buffer");
 
-	// Blit our depth to the primary framebuffer so that other rendering can use it
-	glBlitNamedFramebuffer(
-		_primaryFBO->GetHandle(), 0,
-		0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight(),
-		viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w,
-		GL_DEPTH_BUFFER_BIT,
-		GL_NEAREST
-	);
+	// With dynamic resolution, the rest of the pipeline gets the upsampled scene instead of our output buffer
+	Framebuffer::Sptr output = _dynamicResolutionEnabled ? _upsampledBuffer : _outputBuffer;
+	RenderGraph::Resource sceneColor = graph->Import("Scene Color", output);
+	RenderGraph::Resource internalColor = _dynamicResolutionEnabled ? graph->Import("Internal Scene Color", _outputBuffer) : sceneColor;
 
-	// TODO: post processing effects
+	// Composite our lighting 
+	graph->AddPass("Deferred Lighting", [&](RenderGraph::PassBuilder& builder) {
+		builder.Read(gBuffer);
+		builder.Overwrite(internalColor);
+	}, [this](const RenderGraph&) {
+		_Composite();
+
+		// Store the stats for the frame so that they can be displayed while the next frame is being rendered. Shadows are rendered
+		// during lighting, so this is the last pass that adds to them
+		_lastFrameStats = _stats;
+
+		// Without upsampling, this is the end of the work that depends on the render resolution
+		if (!_dynamicResolutionEnabled) {
+			_dynamicResolution->EndFrame();
+		}
+	});
 
-	_outputBuffer->Unbind();
-	_outputBuffer->Bind(FramebufferBinding::Read);
-	Framebuffer::Blit(
-		{ 0, 0, _outputBuffer->GetWidth(), _outputBuffer->GetHeight() },
-		{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
-		BufferFlags::Color
-	);
+	if (_dynamicResolutionEnabled) {
+		graph->AddPass("Temporal Upsample", [&](RenderGraph::PassBuilder& builder) {
+			builder.Read(internalColor);
+			builder.Read(gBuffer);
+			builder.Overwrite(sceneColor);
+		}, [this](const RenderGraph&) {
+			_TemporalUpsample();
+			_dynamicResolution->EndFrame();
+		});
+	}
 
-	_outputBuffer->Unbind();
+	// Copy the scene to the screen. If a later layer replaces the whole back buffer (ex: post processing), this pass will be culled
+	graph->AddPass("Scene Blit", [&](RenderGraph::PassBuilder& builder) {
+		builder.Read(sceneColor);
+		builder.Read(gBuffer);
+		builder.Overwrite(backBuffer);
+	}, [this, output](const RenderGraph&) {
+		Application& app = Application::Get();
+		const glm::uvec4& viewport = app.GetPrimaryViewport();
+
+		// Restore viewport to game viewport
+		RenderState::SetViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+
+		// Blit our depth to the primary framebuffer so that other rendering can use it
+		glBlitNamedFramebuffer(
+			_primaryFBO->GetHandle(), 0,
+			0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight(),
+			viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w,
+			GL_DEPTH_BUFFER_BIT,
+			GL_NEAREST
+		);
+
+		output->Unbind();
+		output->Bind(FramebufferBinding::Read);
+		Framebuffer::Blit(
+			{ 0, 0, output->GetWidth(), output->GetHeight() },
+			{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
+			BufferFlags::Color
+		);
+
+		output->Unbind();
+	});
 }
 
 void RenderLayer::_AccumulateLighting()
@@ -176,8 +333,8 @@ void RenderLayer::_AccumulateLighting()
 	_lightingFBO->Bind();
 	_ClearFramebuffer(_lightingFBO, colors, 2);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE); 
+	RenderState::Enable(GL_BLEND);
+	RenderState::SetBlendFunc(GL_SRC_ALPHA, GL_ONE); 
 
 	// Bind our shader for processing lighting 
 	_lightAccumulationShader->Bind(); 
@@ -187,80 +344,71 @@ void RenderLayer::_AccumulateLighting()
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(1); // albedo + spec
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color1)->Bind(2); // normals + metallic
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color2)->Bind(3); // emissive
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color3)->Bind(4); // view pos
+	if (!_compactGBuffer) {
+		_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color3)->Bind(4); // view pos
+	}
 
 
 	// Send in how many active lights we have and the global lighting settings
 	data.AmbientCol = glm::vec3(0.1f);
 	int ix = 0;
+	_lightClusters->Clear();
 	app.CurrentScene()->Components().Each<Light>([&](const Light::Sptr& light) {
 		// Get the light's position in view space, since we're doing view space lighting
 		glm::vec4 pos = glm::vec4(light->GetGameObject()->GetWorldPosition(), 1.0f);
 		pos = view * pos;
 
-		// Copy to the ubo data
-		data.Lights[ix].Position = (glm::vec3)(pos) / pos.w;
-		data.Lights[ix].Intensity = light->GetIntensity();
-		data.Lights[ix].Color = light->GetColor();
-		data.Lights[ix].Attenuation = 1.0f / (1.0f + light->GetRadius());  
-
-		ix++;
-
-		// If we've reached the max # of lights the shader supports, draw to the screen and start the next batch
-		if (ix == MAX_LIGHTS) {
-			data.NumLights = MAX_LIGHTS;
-
-			// Send updated data to OpenGL
-			_lightingUbo->Update();
-
-			// Draw the fullscreen quad to accumulate the lights
-			_fullscreenQuad->Draw();
-
-			ix = 0;
+		glm::vec3 viewPos = (glm::vec3)(pos) / pos.w;
+		float attenuation = 1.0f / (1.0f + light->GetRadius());
+		_lightClusters->AddLight(viewPos, light->GetColor(), light->GetIntensity(), attenuation);
+
+		// The UBO only has room for the first few lights, which forward shaded materials will use
+		if (ix < MAX_LIGHTS) {
+			data.Lights[ix].Position = viewPos;
+			data.Lights[ix].Intensity = light->GetIntensity();
+			data.Lights[ix].Color = light->GetColor();
+			data.Lights[ix].Attenuation = attenuation;
+			ix++;
 		}
 	});
-
-	// If we have lights left over that haven't been drawn, draw them now
-	if (ix > 0) {
-		data.NumLights = ix;
-
-		// Send updated data to OpenGL
-		_lightingUbo->Update();
-
-		// Draw the fullscreen quad to accumulate the lights
+	data.NumLights = ix;
+	_lightingUbo->Update();
+
+	// Bin all the lights into clusters, and shade every light in a single pass. Each pixel only evaluates the
+	// lights in its cluster, so cost scales with the number of lights touching a pixel instead of the total count
+	_lightClusters->Build(camera->GetProjection(), camera->GetNearPlane(), camera->GetFarPlane());
+	_lightClusters->Bind(CLUSTER_LIGHTS_SSBO_BINDING, CLUSTERS_SSBO_BINDING, CLUSTER_INDICES_SSBO_BINDING);
+	if (_lightClusters->GetLightCount() > 0) {
 		_fullscreenQuad->Draw();
 	}
 
-	// Re-render the scene for shadows
-	app.CurrentScene()->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
-		// Bind the shadow camera's depth buffer and clear it
-		shadowCam->GetDepthBuffer()->Bind();
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, shadowCam->GetBufferResolution().x, shadowCam->GetBufferResolution().y);
-
-		_RenderScene(shadowCam->GetGameObject()->GetInverseTransform(), shadowCam->GetProjection(), shadowCam->GetDepthBuffer()->GetSize());
-
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	});
+	// Update any shadows that are out of date
+	_RenderShadows();
 
 	// Restore frame level uniforms
 	_InitFrameUniforms();
 
 	_lightingFBO->Bind();
-	glViewport(0, 0, _lightingFBO->GetWidth(), _lightingFBO->GetHeight());
+	RenderState::SetViewport(0, 0, _lightingFBO->GetWidth(), _lightingFBO->GetHeight());
 
 	// Bind our G-Buffer textures so that they're readable
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Depth)->Bind(0);  // depth
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(1); // albedo + spec
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color1)->Bind(2); // normals + metallic
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color2)->Bind(3); // emissive
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color3)->Bind(4); // view pos
+	if (!_compactGBuffer) {
+		_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color3)->Bind(4); // view pos
+	}
 
-	// Bind shadow composite shader
-	_shadowShader->Bind();
+	// All our lights share the same depth buffer, so we only need to bind it once
+	_shadowAtlas->GetFramebuffer()->BindAttachment(RenderTargetAttachment::Depth, 5);
 
 	// Add each shadow casting light to the lighting buffers
 	app.CurrentScene()->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
+		// Lights that could not fit in the atlas don't get drawn
+		if (shadowCam->GetDepthBuffer() == nullptr) {
+			return;
+		}
 
 		// This gets us the light -> view space matrix, which we'll inverse to go from view space to light space
 		glm::mat4 lightSpaceMatrix = camera->GetView() * shadowCam->GetGameObject()->GetTransform();
@@ -272,27 +420,34 @@ void RenderLayer::_AccumulateLighting()
 		glm::vec3 lightDirViewSpace = glm::mat3(lightSpaceMatrix) * glm::vec3(0, 0, -1.0f); 
 		glm::vec3 lightPosViewSpace = lightSpaceMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
-		// Bind depth and projection mask for reading, making sure not to stomp G-Buffer bindings
-		shadowCam->GetDepthBuffer()->BindAttachment(RenderTargetAttachment::Depth, 5);
+		// Each combination of shadow options is a separate variant of the composite shader, with the unused code compiled out
+		ShaderProgram::Sptr shader = _shadowShader->GetKeywordVariant(shadowCam->GetShaderKeywordMask(_shadowShader));
+		shader->Bind();
+
+		// Bind projection mask for reading, making sure not to stomp G-Buffer bindings
 		if (shadowCam->GetProjectionMask() != nullptr) {
 			shadowCam->GetProjectionMask()->Bind(6);
 		}
 
 		//_shadowShader->SetUniformMatrix("u_ClipToShadow", clipToShadow); 
-		_shadowShader->SetUniformMatrix("u_ViewToShadow", viewToShadow); 
+		shader->SetUniformMatrix(UNIFORM_VIEW_TO_SHADOW, viewToShadow); 
+		shader->SetUniform(UNIFORM_ATLAS_RECT, shadowCam->GetAtlasRect());
 
 		// Get color and normalize it (strip the alpha)
 		glm::vec4 color = shadowCam->GetColor();
 		color *= color.w;
 
-		_shadowShader->SetUniform("u_LightDirViewspace", lightDirViewSpace);
-		_shadowShader->SetUniform("u_ShadowBias", shadowCam->Bias);
-		_shadowShader->SetUniform("u_NormalBias", shadowCam->NormalBias);
-		_shadowShader->SetUniform("u_Attenuation", 1/shadowCam->Range);
-		_shadowShader->SetUniform("u_Intensity", shadowCam->Intensity);
-		_shadowShader->SetUniform("u_LightColor", (glm::vec3)color);
-		_shadowShader->SetUniform("u_LightPosViewspace", lightPosViewSpace);
-		_shadowShader->SetUniform("u_ShadowFlags", *shadowCam->Flags);
+		shader->SetUniform(UNIFORM_LIGHT_DIR_VIEWSPACE, lightDirViewSpace);
+		shader->SetUniform(UNIFORM_SHADOW_BIAS, shadowCam->Bias);
+		shader->SetUniform(UNIFORM_NORMAL_BIAS, shadowCam->NormalBias);
+		shader->SetUniform(UNIFORM_INTENSITY, shadowCam->Intensity);
+		shader->SetUniform(UNIFORM_LIGHT_COLOR, (glm::vec3)color);
+
+		// Only the attenuation variant uses these, the others have them compiled out
+		if (*(shadowCam->Flags & ShadowFlags::AttenuationEnabled)) {
+			shader->SetUniform(UNIFORM_ATTENUATION, 1/shadowCam->Range);
+			shader->SetUniform(UNIFORM_LIGHT_POS_VIEWSPACE, lightPosViewSpace);
+		}
 
 		// Draw the fullscreen quad to accumulate the lights
 		_fullscreenQuad->Draw();
@@ -302,6 +457,20 @@ void RenderLayer::_AccumulateLighting()
 	_lightingFBO->Unbind();
 }
 
+void RenderLayer::_ResolveCompositeKeywords()
+{
+	// The flags can be set before our shaders are loaded, in which case we resolve them once the shader exists
+	if (_compositingShader == nullptr) {
+		return;
+	}
+	std::vector<std::string> keywords;
+	if (*(_renderFlags & RenderFlags::EnableAlbedo))   keywords.push_back("ENABLE_ALBEDO");
+	if (*(_renderFlags & RenderFlags::EnableDiffuse))  keywords.push_back("ENABLE_DIFFUSE");
+	if (*(_renderFlags & RenderFlags::EnableSpecular)) keywords.push_back("ENABLE_SPECULAR");
+	if (*(_renderFlags & RenderFlags::EnableEmissive)) keywords.push_back("ENABLE_EMISSIVE");
+	_compositeKeywordMask = _compositingShader->GetKeywordMask(keywords);
+}
+
 void RenderLayer::_Composite()
 {
 	using namespace Gameplay;
@@ -311,17 +480,17 @@ void RenderLayer::_Composite()
 
 	_AccumulateLighting();
 
-	// We want to switch to our compositing shader
-	_compositingShader->Bind();
+	// We want to switch to our compositing shader, the buffers that are enabled in our render flags are compiled into variants
+	_compositingShader->GetKeywordVariant(_compositeKeywordMask)->Bind();
 
 	// Switch rendering to output
 	_outputBuffer->Bind();
-	glViewport(0, 0, _outputBuffer->GetWidth(), _outputBuffer->GetHeight());
+	RenderState::SetViewport(0, 0, _outputBuffer->GetWidth(), _outputBuffer->GetHeight());
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// Disable blending, we want to override any existing colors
-	glDisable(GL_BLEND);
+	RenderState::Disable(GL_BLEND);
 
 	// Bind our albedo and lighting buffers so we can composite a final scene
 	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(0);
@@ -332,7 +501,7 @@ void RenderLayer::_Composite()
 	_fullscreenQuad->Draw(); 
 
 	// Re-enable depth testing
-	glEnable(GL_DEPTH_TEST);
+	RenderState::Enable(GL_DEPTH_TEST);
 
 	// Blit our depth from primary FBO to our output depth buffer
 	glBlitNamedFramebuffer(
@@ -351,15 +520,15 @@ void RenderLayer::_Composite()
 
 void RenderLayer::_ClearFramebuffer(Framebuffer::Sptr& buffer, const glm::vec4* colors, int layers) {
 	// Make the entire buffer visible
-	glViewport(0, 0, buffer->GetWidth(), buffer->GetHeight());
+	RenderState::SetViewport(0, 0, buffer->GetWidth(), buffer->GetHeight());
 	// Disable depth testing
-	glEnable(GL_DEPTH_TEST); 
+	RenderState::Enable(GL_DEPTH_TEST); 
 	// Enable depth writing
-	glDepthMask(true);
+	RenderState::SetDepthMask(true);
 	// Disable blending, we want to override the colors
-	glDisable(GL_BLEND);
+	RenderState::Disable(GL_BLEND);
 	// Ignore existing depth
-	glDepthFunc(GL_ALWAYS);
+	RenderState::SetDepthFunc(GL_ALWAYS);
 
 	// Bind the buffer so we're writing to it
 	buffer->Bind();
@@ -370,17 +539,100 @@ void RenderLayer::_ClearFramebuffer(Framebuffer::Sptr& buffer, const glm::vec4*
 	_fullscreenQuad->Draw();
 
 	// Reset depth test function to default
-	glDepthFunc(GL_LESS);
+	RenderState::SetDepthFunc(GL_LESS);
+}
+
+void RenderLayer::_UpdateRenderSize()
+{
+	// The upsampled buffers are created the first time they're needed, since dynamic resolution is off by default
+	if (_dynamicResolutionEnabled && _upsampledBuffer == nullptr) {
+		FramebufferDescriptor descriptor;
+		descriptor.Width  = _outputSize.x;
+		descriptor.Height = _outputSize.y;
+		descriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorRgba16F);
+		_historyBuffers[0] = std::make_shared<Framebuffer>(descriptor);
+		_historyBuffers[1] = std::make_shared<Framebuffer>(descriptor);
+
+		// Later layers draw on top of the scene, so the upsampled buffer needs depth as well
+		descriptor.RenderTargets[RenderTargetAttachment::Depth]  = RenderTargetDescriptor(RenderTargetType::Depth32);
+		descriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
+		_upsampledBuffer = std::make_shared<Framebuffer>(descriptor);
+		_historyValid = false;
+	}
+
+	glm::ivec2 size = _dynamicResolutionEnabled ? glm::ivec2(_dynamicResolution->GetRenderSize(_outputSize)) : _outputSize;
+	if (size == _primaryFBO->GetSize()) {
+		return;
+	}
+
+	// The history is kept at the output resolution, so it's still valid after the render resolution changes
+	_primaryFBO->Resize(size);
+	_lightingFBO->Resize(size);
+	_outputBuffer->Resize(size);
+	if (_visibilityFBO != nullptr) {
+		_visibilityFBO->Resize(size);
+	}
+}
+
+void RenderLayer::_TemporalUpsample()
+{
+	using namespace Gameplay;
+
+	Camera::Sptr camera = Application::Get().CurrentScene()->MainCamera;
+	glm::mat4 viewProj = camera->GetViewProjection();
+
+	const Framebuffer::Sptr& history = _historyBuffers[_historyIndex];
+	const Framebuffer::Sptr& nextHistory = _historyBuffers[1 - _historyIndex];
+
+	_temporalUpsampleShader->Bind();
+	_temporalUpsampleShader->SetUniformMatrix(UNIFORM_REPROJECTION, _prevViewProjection * glm::inverse(viewProj));
+	_temporalUpsampleShader->SetUniform(UNIFORM_JITTER, _jitter);
+	_temporalUpsampleShader->SetUniform(UNIFORM_HISTORY_VALID, _historyValid ? 1 : 0);
+
+	_outputBuffer->BindAttachment(RenderTargetAttachment::Color0, 0);
+	_primaryFBO->BindAttachment(RenderTargetAttachment::Depth, 1);
+	history->BindAttachment(RenderTargetAttachment::Color0, 2);
+
+	Texture2D::Sptr output = _upsampledBuffer->GetTextureAttachment(RenderTargetAttachment::Color0);
+	Texture2D::Sptr next = nextHistory->GetTextureAttachment(RenderTargetAttachment::Color0);
+	glBindImageTexture(0, output->GetHandle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, (GLenum)output->GetFormat());
+	glBindImageTexture(1, next->GetHandle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, (GLenum)next->GetFormat());
+
+	glm::uvec2 groups = (glm::uvec2(_outputSize) + UPSAMPLE_TILE_SIZE - 1u) / UPSAMPLE_TILE_SIZE;
+	glDispatchCompute(groups.x, groups.y, 1);
+
+	// The result is sampled or blitted by later passes, and the history is sampled next frame
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+	// Later layers depth test against the scene, so we scale our depth up to match
+	glBlitNamedFramebuffer(
+		_primaryFBO->GetHandle(), _upsampledBuffer->GetHandle(),
+		0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight(),
+		0, 0, _upsampledBuffer->GetWidth(), _upsampledBuffer->GetHeight(),
+		GL_DEPTH_BUFFER_BIT,
+		GL_NEAREST
+	);
+
+	_historyIndex = 1 - _historyIndex;
+	_historyValid = true;
+	_prevViewProjection = viewProj;
 }
 
 void RenderLayer::OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize)
 {
 	if (newSize.x * newSize.y == 0) return;
 
-	// Set viewport and resize our primary FBO and light accumulation FBO
-	_primaryFBO->Resize(newSize);
-	_lightingFBO->Resize(newSize);
-	_outputBuffer->Resize(newSize);
+	// The upsampled buffers always match the window, and the history can't be reprojected across a resize
+	_outputSize = newSize;
+	if (_upsampledBuffer != nullptr) {
+		_upsampledBuffer->Resize(newSize);
+		_historyBuffers[0]->Resize(newSize);
+		_historyBuffers[1]->Resize(newSize);
+		_historyValid = false;
+	}
+
+	// Resize our primary FBO, light accumulation FBO and output FBO to the new render resolution
+	_UpdateRenderSize();
 
 	// Update the main camera's projection
 	Application& app = Application::Get();
@@ -392,9 +644,29 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	Application& app = Application::Get();
 
 	// GL states, we'll enable depth testing and backface fulling
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+	RenderState::Enable(GL_DEPTH_TEST);
+	RenderState::Enable(GL_CULL_FACE);
+	RenderState::SetCullFace(GL_BACK);
+
+	uint32_t shadowAtlasSize = 4096;
+	uint32_t occlusionBufferSize = 256;
+	float targetFrameTime = 12.0f;
+	float minResolutionScale = 0.5f;
+	if (config.contains(Name)) {
+		_compactGBuffer = JsonGet(config[Name], "compact_gbuffer", _compactGBuffer);
+		shadowAtlasSize = JsonGet(config[Name], "shadow_atlas_size", shadowAtlasSize);
+		occlusionBufferSize = JsonGet(config[Name], "occlusion_buffer_size", occlusionBufferSize);
+		_visibilityBufferEnabled = JsonGet(config[Name], "visibility_buffer", _visibilityBufferEnabled);
+		_dynamicResolutionEnabled = JsonGet(config[Name], "dynamic_resolution", _dynamicResolutionEnabled);
+		targetFrameTime = JsonGet(config[Name], "dynamic_resolution_target_ms", targetFrameTime);
+		minResolutionScale = JsonGet(config[Name], "dynamic_resolution_min_scale", minResolutionScale);
+	}
+
+	// Create the controller that picks our render resolution, the render targets start at the window size and are
+	// resized at the start of the first frame if needed
+	_dynamicResolution = std::make_shared<DynamicResolution>(targetFrameTime, minResolutionScale);
+	_dynamicResolution->SetEnabled(_dynamicResolutionEnabled);
+	_outputSize = app.GetWindowSize();
 
 	// Create a new descriptor for our FBO
 	FramebufferDescriptor fboDescriptor;
@@ -405,12 +677,14 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	fboDescriptor.RenderTargets[RenderTargetAttachment::Depth] = RenderTargetDescriptor(RenderTargetType::Depth32);
 	// Color layer 0 (albedo, specular)
 	fboDescriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
-	// Color layer 1 (normals, metallic)
+	// Color layer 1 (normals, metallic), normals are octahedral encoded in the compact layout
 	fboDescriptor.RenderTargets[RenderTargetAttachment::Color1] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
 	// Color layer 2 (emissive)  
 	fboDescriptor.RenderTargets[RenderTargetAttachment::Color2] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
-	// Color layer 3 (view space position)  
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color3] = RenderTargetDescriptor(RenderTargetType::ColorRgba16F);
+	// Color layer 3 (view space position), the compact layout reconstructs position from depth instead
+	if (!_compactGBuffer) {
+		fboDescriptor.RenderTargets[RenderTargetAttachment::Color3] = RenderTargetDescriptor(RenderTargetType::ColorRgba16F);
+	}
 	 
 	// Create the primary FBO
 	_primaryFBO = std::make_shared<Framebuffer>(fboDescriptor);
@@ -438,6 +712,7 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	_compositingShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
 	_compositingShader->LoadShaderPartFromFile("shaders/fragment_shaders/deferred_composite.glsl", ShaderPartType::Fragment);
 	_compositingShader->Link();
+	_ResolveCompositeKeywords();
 
 	_clearShader = ShaderProgram::Create();
 	_clearShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
@@ -449,6 +724,29 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	_shadowShader->LoadShaderPartFromFile("shaders/fragment_shaders/shadow_composite.glsl", ShaderPartType::Fragment);
 	_shadowShader->Link();
 
+	_depthShader = ShaderProgram::Create();
+	_depthShader->LoadShaderPartFromFile("shaders/vertex_shaders/depth_only.glsl", ShaderPartType::Vertex);
+	_depthShader->LoadShaderPartFromFile("shaders/fragment_shaders/depth_only.glsl", ShaderPartType::Fragment);
+	_depthShader->Link();
+	_depthShader->SetDebugName("Depth Only");
+
+	_visibilityShader = ShaderProgram::Create();
+	_visibilityShader->LoadShaderPartFromFile("shaders/vertex_shaders/visibility.glsl", ShaderPartType::Vertex);
+	_visibilityShader->LoadShaderPartFromFile("shaders/fragment_shaders/visibility.glsl", ShaderPartType::Fragment);
+	_visibilityShader->Link();
+	_visibilityShader->SetDebugName("Visibility Buffer");
+
+	_materialDepthShader = ShaderProgram::Create();
+	_materialDepthShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
+	_materialDepthShader->LoadShaderPartFromFile("shaders/fragment_shaders/visibility_material_depth.glsl", ShaderPartType::Fragment);
+	_materialDepthShader->Link();
+	_materialDepthShader->SetDebugName("Visibility Material Depth");
+
+	_temporalUpsampleShader = ShaderProgram::Create();
+	_temporalUpsampleShader->LoadShaderPartFromFile("shaders/compute_shaders/temporal_upsample.glsl", ShaderPartType::Compute);
+	_temporalUpsampleShader->Link();
+	_temporalUpsampleShader->SetDebugName("Temporal Upsample");
+
 	// We need a mesh for drawing fullscreen quads
 
 	glm::vec2 positions[6] = {
@@ -468,6 +766,27 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	_frameUniforms = std::make_shared<UniformBuffer<FrameLevelUniforms>>(BufferUsage::DynamicDraw);
 	_instanceUniforms = std::make_shared<UniformBuffer<InstanceLevelUniforms>>(BufferUsage::DynamicDraw);
 	_lightingUbo = std::make_shared<UniformBuffer<LightingUboStruct>>(BufferUsage::DynamicDraw);
+
+	// Create the buffers for our per-frame object transforms, and the per-pass object indices
+	_objectBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+	_objectBuffer->LoadData<ObjectData>(nullptr, 1);
+	_drawIndexBuffer = ShaderStorageBuffer::Create(BufferUsage::StreamDraw);
+	_drawIndexBuffer->LoadData<uint32_t>(nullptr, 1);
+	_visibilityObjectBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+	_visibilityObjectBuffer->LoadData<VisibilityObject>(nullptr, 1);
+
+	// Create the atlas that all our shadow casting lights will render into
+	_shadowAtlas = std::make_shared<ShadowAtlas>(shadowAtlasSize);
+
+	// Create the software depth buffer for occlusion culling, it doesn't need to match the aspect ratio of the screen
+	_occlusionBuffer = std::make_shared<OcclusionBuffer>(occlusionBufferSize, occlusionBufferSize / 2);
+
+	// Create the light grid for our clustered lighting
+	_lightClusters = std::make_shared<LightClusterGrid>();
+
+	// Create the buffer that our multi-draw commands will be uploaded into
+	_indirectBuffer = IndirectBuffer::Create(BufferUsage::StreamDraw);
+	_indirectBuffer->LoadData<DrawElementsIndirectCommand>(nullptr, 1);
 }
 
 const Framebuffer::Sptr& RenderLayer::GetPrimaryFBO() const {
@@ -496,12 +815,101 @@ void RenderLayer::SetClearColor(const glm::vec4 & value) {
 
 void RenderLayer::SetRenderFlags(RenderFlags value) {
 	_renderFlags = value;
+	_ResolveCompositeKeywords();
 }
 
 RenderFlags RenderLayer::GetRenderFlags() const {
 	return _renderFlags;
 }
 
+void RenderLayer::SetFrustumCullingEnabled(bool value) {
+	_frustumCulling = value;
+}
+
+bool RenderLayer::IsFrustumCullingEnabled() const {
+	return _frustumCulling;
+}
+
+void RenderLayer::SetInstancingEnabled(bool value) {
+	_instancing = value;
+}
+
+bool RenderLayer::IsInstancingEnabled() const {
+	return _instancing;
+}
+
+void RenderLayer::SetGeometryArenaEnabled(bool value) {
+	_useGeometryArena = value;
+}
+
+bool RenderLayer::IsGeometryArenaEnabled() const {
+	return _useGeometryArena;
+}
+
+void RenderLayer::SetOcclusionCullingEnabled(bool value) {
+	_occlusionCulling = value;
+}
+
+bool RenderLayer::IsOcclusionCullingEnabled() const {
+	return _occlusionCulling;
+}
+
+void RenderLayer::SetLodEnabled(bool value) {
+	_lodEnabled = value;
+}
+
+bool RenderLayer::IsLodEnabled() const {
+	return _lodEnabled;
+}
+
+void RenderLayer::SetDepthOnlyShadowsEnabled(bool value) {
+	_depthOnlyShadows = value;
+}
+
+bool RenderLayer::IsDepthOnlyShadowsEnabled() const {
+	return _depthOnlyShadows;
+}
+
+void RenderLayer::SetVisibilityBufferEnabled(bool value) {
+	_visibilityBufferEnabled = value;
+}
+
+bool RenderLayer::IsVisibilityBufferEnabled() const {
+	return _visibilityBufferEnabled;
+}
+
+bool RenderLayer::IsCompactGBufferEnabled() const {
+	return _compactGBuffer;
+}
+
+void RenderLayer::SetDynamicResolutionEnabled(bool value) {
+	if (value != _dynamicResolutionEnabled) {
+		_historyValid = false;
+	}
+	_dynamicResolutionEnabled = value;
+	_dynamicResolution->SetEnabled(value);
+}
+
+bool RenderLayer::IsDynamicResolutionEnabled() const {
+	return _dynamicResolutionEnabled;
+}
+
+const DynamicResolution::Sptr& RenderLayer::GetDynamicResolution() const {
+	return _dynamicResolution;
+}
+
+nlohmann::json RenderLayer::GetDefaultConfig() {
+	return {
+		{ "compact_gbuffer", _compactGBuffer },
+		{ "shadow_atlas_size", _shadowAtlas != nullptr ? _shadowAtlas->GetSize() : 4096 },
+		{ "occlusion_buffer_size", _occlusionBuffer != nullptr ? _occlusionBuffer->GetWidth() : 256 },
+		{ "visibility_buffer", _visibilityBufferEnabled },
+		{ "dynamic_resolution", _dynamicResolutionEnabled },
+		{ "dynamic_resolution_target_ms", _dynamicResolution != nullptr ? _dynamicResolution->GetTargetFrameTime() : 12.0f },
+		{ "dynamic_resolution_min_scale", _dynamicResolution != nullptr ? _dynamicResolution->GetMinScale() : 0.5f }
+	};
+}
+
 const Framebuffer::Sptr& RenderLayer::GetLightingBuffer() const {
 	return _lightingFBO;
 }
@@ -526,14 +934,14 @@ void RenderLayer::_InitFrameUniforms()
 
 	// Upload frame level uniforms
 	auto& frameData = _frameUniforms->GetData();
-	frameData.u_Projection = camera->GetProjection();
-	frameData.u_InvProjection = glm::inverse(camera->GetProjection());
+	frameData.u_Projection = _projection;
+	frameData.u_InvProjection = glm::inverse(_projection);
 	frameData.u_View = camera->GetView();
-	frameData.u_ViewProjection = camera->GetViewProjection();
+	frameData.u_ViewProjection = _projection * camera->GetView();
 	frameData.u_CameraPos = glm::vec4(camera->GetGameObject()->GetPosition(), 1.0f);
 	frameData.u_Time = static_cast<float>(Timing::Current().TimeSinceSceneLoad());
 	frameData.u_DeltaTime = Timing::Current().DeltaTime();
-	frameData.u_RenderFlags = _renderFlags;
+	frameData.u_RenderFlags = _renderFlags | (_compactGBuffer ? RenderFlags::CompactGBuffer : RenderFlags::None);
 	frameData.u_ZNear = camera->GetNearPlane();
 	frameData.u_ZFar = camera->GetFarPlane();
 	frameData.u_Viewport = { 0.0f, 0.0f, _primaryFBO->GetWidth(), _primaryFBO->GetHeight() };
@@ -544,20 +952,12 @@ void RenderLayer::_InitFrameUniforms()
 	_frameUniforms->Update();
 }
 
-void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& screenSize)
+void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projection, const glm::ivec2& screenSize, RenderPass pass)
 {
 	using namespace Gameplay;
 
-	Application& app = Application::Get();
-
 	glm::mat4 viewProj = projection * view;
 
-	// The current material that is bound for rendering
-	Material::Sptr currentMat = nullptr;
-	ShaderProgram::Sptr shader = nullptr;
-
-	Material::Sptr defaultMat = app.CurrentScene()->DefaultMaterial;
-
 	auto& frameData = _frameUniforms->GetData();
 	frameData.u_Projection = projection;
 	frameData.u_View = view;
@@ -566,10 +966,283 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 	frameData.u_Viewport = { 0.0f, 0.0f, screenSize.x, screenSize.y };
 	_frameUniforms->Update();
 
-	// Render all our objects
+	// We'll use the frustum of whichever camera we're rendering for to skip objects it can't see
+	Frustum frustum(viewProj);
+
+	// Shadow passes only need depth, so opaque objects don't need any material state at all, and can all share our
+	// position-only shader. Masked materials still need their textures for alpha testing, and shaders with their own
+	// vertex stage may move their vertices, so those use the depth variant of their own shader instead
+	// The visibility pass doesn't need material state either, materials are applied when the visibility buffer is resolved
+	bool depthOnly = pass == RenderPass::Shadow && _depthOnlyShadows;
+	auto passMaterial = [&](const DrawItem& item) -> Material* {
+		bool sharedDepth = depthOnly && !item.Material->Masked && item.Material->GetShader()->HasStandardVertexStage();
+		return pass == RenderPass::Visibility || sharedDepth ? nullptr : item.Material;
+	};
+	auto passShader = [&](Material* material) -> ShaderProgram::Sptr {
+		if (material == nullptr) {
+			return pass == RenderPass::Visibility ? _visibilityShader : _depthShader;
+		}
+		if (depthOnly) {
+			ShaderProgram::Sptr variant = material->GetShader()->GetDepthVariant();
+			if (variant != nullptr) {
+				return variant;
+			}
+		}
+		return material->GetShader();
+	};
+
+	// Draw the occluders that this camera can see into our software depth buffer
+	bool anyOccluders = false;
+	if (_occlusionCulling) {
+		_occlusionBuffer->Clear();
+		for (uint32_t ix = 0; ix < _drawItems.size(); ix++) {
+			const DrawItem& item = _drawItems[ix];
+			if (item.Occluder != nullptr && frustum.IsVisible(*item.LocalBounds, _objectData[ix].Model)) {
+				_occlusionBuffer->RenderOccluder(*item.Occluder, viewProj * _objectData[ix].Model);
+				anyOccluders = true;
+			}
+		}
+	}
+
+	// Test every object against the occluders, the buffer is read only at this point so we can spread the tests across threads
+	_occluded.assign(_drawItems.size(), 0);
+	if (anyOccluders) {
+		std::for_each(std::execution::par, _occluded.begin(), _occluded.end(), [&](uint8_t& occluded) {
+			size_t ix = &occluded - _occluded.data();
+			occluded = !_occlusionBuffer->IsVisible(*_drawItems[ix].LocalBounds, viewProj * _objectData[ix].Model);
+		});
+	}
+
+	// The camera's LODs were picked when the objects were gathered, shadows see objects from a different distance so
+	// they pick their own, with a coarser bias
+	_passMeshes.resize(_drawItems.size());
+	for (uint32_t ix = 0; ix < _drawItems.size(); ix++) {
+		const DrawItem& item = _drawItems[ix];
+		PassMesh& passMesh = _passMeshes[ix];
+		passMesh = { item.Mesh, item.ArenaAlloc };
+		if (pass == RenderPass::Shadow && _lodEnabled) {
+			VertexArrayObject::Sptr lod = item.Renderable->SelectLod(view * _objectData[ix].Model, projection, (float)screenSize.y, true);
+			if (lod.get() != item.Mesh) {
+				passMesh.Mesh = lod.get();
+				passMesh.ArenaAlloc = item.ArenaAlloc != nullptr ? _geometryArena->Add(lod) : nullptr;
+			}
+		}
+	}
+
+	// Add all of the visible objects to the render queue so that we can sort them by state
+	_renderQueue.Clear();
+	for (uint32_t ix = 0; ix < _drawItems.size(); ix++) {
+		const DrawItem& item = _drawItems[ix];
+		const glm::mat4& transform = _objectData[ix].Model;
+
+		// The visibility pass only draws the objects that can be resolved, and the G-Buffer pass draws the rest
+		if (pass != RenderPass::Shadow && _visibilityItems[ix] != (pass == RenderPass::Visibility ? 1 : 0)) {
+			continue;
+		}
+
+		// Skip objects that are entirely outside of the view frustum
+		if (_frustumCulling && !frustum.IsVisible(*item.LocalBounds, transform)) {
+			_stats.CulledObjects++;
+			continue;
+		}
+
+		// Skip objects that are hidden behind occluders
+		if (_occluded[ix]) {
+			_stats.OccludedObjects++;
+			continue;
+		}
+
+		// We use the distance to the object's origin along the view direction to sort front to back
+		float viewDepth = -(view * transform[3]).z;
+
+		// Instances of a material sort next to each other, so that switching between them only has to change what they override
+		Material* material = passMaterial(item);
+		uint64_t key = RenderQueue::MakeKey(
+			pass,
+			passShader(material)->GetHandle(),
+			_renderQueue.GetMaterialId(material != nullptr ? material->GetRoot() : nullptr, material),
+			_passMeshes[ix].Mesh->GetHandle(),
+			viewDepth
+		);
+		_renderQueue.Push(key, ix);
+
+		if (pass == RenderPass::Visibility) {
+			_stats.VisibilityObjects++;
+		}
+	}
+
+	_renderQueue.Sort();
+
+	// Split the sorted packets into batches that share a mesh and material. Each batch whose shader supports
+	// it is drawn with a single instanced call that reads transforms from the object buffer. Batches with meshes
+	// in the geometry arena are merged further, into a single multi-draw for each material
+	_drawBatches.clear();
+	_drawIndices.clear();
+	_indirectCommands.clear();
+	const std::vector<DrawPacket>& packets = _renderQueue.GetPackets();
+	for (uint32_t ix = 0; ix < packets.size(); ) {
+		const DrawItem& first = _drawItems[packets[ix].ItemIndex];
+		const PassMesh& firstMesh = _passMeshes[packets[ix].ItemIndex];
+		Material* material = passMaterial(first);
+
+		// Find the end of the run of packets with the same mesh and material
+		uint32_t end = ix + 1;
+		while (end < packets.size() && 
+			   passMaterial(_drawItems[packets[end].ItemIndex]) == material && 
+			   _passMeshes[packets[end].ItemIndex].Mesh == firstMesh.Mesh) {
+			end++;
+		}
+		_stats.Triangles += (firstMesh.Mesh->GetElementCount() / 3) * (end - ix);
+
+		DrawBatch batch;
+		batch.Material     = material;
+		batch.Mesh         = firstMesh.Mesh;
+		batch.FirstPacket  = ix;
+		batch.Count        = end - ix;
+		batch.BaseInstance = 0;
+		batch.Shader       = _instancing ? passShader(material)->GetInstancedVariant() : nullptr;
+		batch.Instanced    = batch.Shader != nullptr;
+		batch.Indirect     = false;
+		batch.FirstCommand = 0;
+		batch.CommandCount = 0;
+
+		if (batch.Instanced) {
+			// The base instance will point to the start of this batch's object indices
+			batch.BaseInstance = static_cast<uint32_t>(_drawIndices.size());
+			for (uint32_t packetIx = ix; packetIx < end; packetIx++) {
+				_drawIndices.push_back(packets[packetIx].ItemIndex);
+			}
+
+			// Meshes in the arena become a command in the indirect buffer, since packets are sorted by shader then
+			// material, batches for the same material will be next to each other and can share a single multi-draw
+			if (firstMesh.ArenaAlloc != nullptr) {
+				const GeometryArena::Allocation* alloc = firstMesh.ArenaAlloc;
+				_indirectCommands.push_back({ alloc->IndexCount, batch.Count, alloc->FirstIndex, alloc->BaseVertex, batch.BaseInstance });
+
+				if (!_drawBatches.empty() && _drawBatches.back().Indirect &&
+					_drawBatches.back().Material == batch.Material && _drawBatches.back().Shader == batch.Shader) {
+					_drawBatches.back().Count += batch.Count;
+					_drawBatches.back().CommandCount++;
+					ix = end;
+					continue;
+				}
+
+				batch.Indirect     = true;
+				batch.FirstCommand = static_cast<uint32_t>(_indirectCommands.size() - 1);
+				batch.CommandCount = 1;
+			}
+		} else {
+			batch.Shader = passShader(material);
+		}
+
+		_drawBatches.push_back(batch);
+		ix = end;
+	}
+
+	// Upload all the draw indices for this pass at once. LoadData re-specifies the buffer, so the driver can give
+	// us fresh storage instead of waiting on draws from the previous pass that are still reading it
+	if (!_drawIndices.empty()) {
+		_drawIndexBuffer->LoadData(_drawIndices.data(), static_cast<uint32_t>(_drawIndices.size()));
+	}
+	if (!_indirectCommands.empty()) {
+		_indirectBuffer->LoadData(_indirectCommands.data(), static_cast<uint32_t>(_indirectCommands.size()));
+		_indirectBuffer->Bind();
+	}
+
+	// The current shader and material that are bound for rendering
+	ShaderProgram* currentShader = nullptr;
+	Material* currentMat = nullptr;
+
+	// Render all our batches in sorted order
+	for (const DrawBatch& batch : _drawBatches) {
+		// If the shader has changed, bind it. Material state is per program, so we'll need to re-apply the material as well
+		if (batch.Shader.get() != currentShader) {
+			currentShader = batch.Shader.get();
+			currentShader->Bind();
+			currentMat = nullptr;
+			_stats.ProgramSwitches++;
+		}
+
+		// If the material has changed, we need to set up our material
+		if (batch.Material != currentMat) {
+			Material* previous = currentMat;
+			currentMat = batch.Material;
+			if (currentMat != nullptr) {
+				currentMat->Apply(batch.Shader, previous);
+				_stats.MaterialSwitches++;
+			}
+		}
+
+		if (batch.Indirect) {
+			// Draw every mesh using this material in one go, the commands select the mesh from the arena and the base
+			// instance for each mesh's object indices
+			_geometryArena->GetVao()->Bind();
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+				(const void*)(batch.FirstCommand * sizeof(DrawElementsIndirectCommand)), batch.CommandCount, 0);
+			VertexArrayObject::Unbind();
+			_stats.DrawCalls++;
+			_stats.IndirectDraws++;
+		} else if (batch.Instanced) {
+			// Draw the whole batch in one go, the shader will look up transforms from the object buffer
+			batch.Mesh->DrawInstanced(batch.Count, DrawMode::TriangleList, batch.BaseInstance);
+			_stats.DrawCalls++;
+			_stats.InstancedBatches++;
+		} else {
+			// Shaders that don't use our common uniforms need the instance UBO, but we can still use our cached matrices
+			for (uint32_t packetIx = batch.FirstPacket; packetIx < batch.FirstPacket + batch.Count; packetIx++) {
+				const ObjectData& object = _objectData[packets[packetIx].ItemIndex];
+
+				// Use our uniform buffer for our instance level uniforms
+				auto& instanceData = _instanceUniforms->GetData();
+				instanceData.u_Model = object.Model;
+				instanceData.u_ModelViewProjection = viewProj * object.Model;
+				instanceData.u_ModelView = view * object.Model;
+				instanceData.u_NormalMatrix = object.NormalMatrix;
+				_instanceUniforms->Update();
+
+				// Draw the object
+				batch.Mesh->Draw();
+				_stats.DrawCalls++;
+			}
+		}
+	}
+
+	if (!_indirectCommands.empty()) {
+		IndirectBuffer::UnBind();
+	}
+}
+
+void RenderLayer::_GatherObjects()
+{
+	using namespace Gameplay;
+
+	Application& app = Application::Get();
+
+	Material::Sptr defaultMat = app.CurrentScene()->DefaultMaterial;
+
+	// Static meshes get packed into the arena the first time we see them, only our standard vertex layout is supported
+	if (_useGeometryArena && _instancing && _geometryArena == nullptr) {
+		_geometryArena = std::make_shared<GeometryArena>(VertexPosNormTexColTangents::V_DECL);
+	}
+	GeometryArena* arena = _useGeometryArena && _instancing ? _geometryArena.get() : nullptr;
+
+	// The G-Buffer and visibility passes both draw from the main camera, so we can pick their LODs once up front
+	glm::mat4 view = app.CurrentScene()->MainCamera->GetView();
+	float screenHeight = (float)_primaryFBO->GetSize().y;
+
+	_drawItems.clear();
+	_objectData.clear();
+	_visibilityItems.clear();
+	_visibilityObjects.clear();
+	_visibilityMaterials.clear();
+	_dirtyCasterSpheres.clear();
+	for (auto& [key, state] : _casterStates) {
+		state.Seen = false;
+	}
 	app.CurrentScene()->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
 		// Early bail if mesh not set
-		if (renderable->GetMesh() == nullptr) {
+		VertexArrayObject::Sptr mesh = renderable->GetMesh();
+		if (mesh == nullptr) {
 			return;
 		}
 
@@ -584,32 +1257,278 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 			}
 		}
 
-		// If the material has changed, we need to bind the new shader and set up our material and frame data
-		// Note: This is a good reason why we should be sorting the render components in ComponentManager
-		if (renderable->GetMaterial() != currentMat) {
-			currentMat = renderable->GetMaterial();
-			shader = currentMat->GetShader();
+		// We calculate the normal matrix here once, so that none of our passes need to
+		const glm::mat4& transform = renderable->GetGameObject()->GetTransform();
+		VertexArrayObject::Sptr drawMesh = _lodEnabled ? renderable->SelectLod(view * transform, _projection, screenHeight, false) : mesh;
+		_drawItems.push_back({ 
+			renderable->GetMaterial().get(), 
+			drawMesh.get(), 
+			&renderable->GetMeshResource()->LocalBounds, 
+			arena != nullptr ? arena->Add(drawMesh) : nullptr,
+			renderable->IsOccluder() ? renderable->GetMeshResource()->GetOccluderMesh().get() : nullptr,
+			renderable.get()
+		});
+		_objectData.push_back({ transform, glm::mat4(glm::mat3(glm::transpose(glm::inverse(transform)))) });
+
+		// Objects in the arena can go through the visibility buffer, as long as their IDs fit and their material can be resolved.
+		// Masked materials need to discard in the geometry pass, so they're drawn into the G-Buffer instead
+		const DrawItem& item = _drawItems.back();
+		VisibilityObject visibilityObject = { 0, 0, 1.0f, 0 };
+		bool visibility = 
+			_visibilityBufferEnabled && item.ArenaAlloc != nullptr && !item.Material->Masked &&
+			_drawItems.size() <= MAX_VISIBILITY_OBJECTS &&
+			item.ArenaAlloc->IndexCount / 3 <= (1u << VISIBILITY_TRIANGLE_BITS) &&
+			item.Material->GetShader()->GetVisibilityVariant() != nullptr;
+		if (visibility) {
+			// Each material gets a depth slot for the resolve, the last slot is the far plane which is used for empty pixels
+			auto slot = std::find(_visibilityMaterials.begin(), _visibilityMaterials.end(), item.Material);
+			if (slot == _visibilityMaterials.end() && _visibilityMaterials.size() + 1 < MAX_VISIBILITY_MATERIALS) {
+				_visibilityMaterials.push_back(item.Material);
+				slot = _visibilityMaterials.end() - 1;
+			}
+			visibility = slot != _visibilityMaterials.end();
+			if (visibility) {
+				visibilityObject.FirstIndex    = item.ArenaAlloc->FirstIndex;
+				visibilityObject.BaseVertex    = item.ArenaAlloc->BaseVertex;
+				visibilityObject.MaterialDepth = (float)(slot - _visibilityMaterials.begin() + 1) / (float)MAX_VISIBILITY_MATERIALS;
+			}
+		}
+		_visibilityItems.push_back(visibility ? 1 : 0);
+		_visibilityObjects.push_back(visibilityObject);
+
+		// If the object is new or has changed since last frame, any shadows that could see it need to be updated
+		CasterState& state = _casterStates[renderable.get()];
+		bool isNew = state.Owner.expired();
+		if (isNew || state.Mesh != mesh.get() || state.Transform != transform) {
+			if (!isNew) {
+				_dirtyCasterSpheres.push_back(state.WorldSphere);
+			}
+
+			const Bounds& bounds = *_drawItems.back().LocalBounds;
+			if (bounds.IsValid) {
+				float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+				state.WorldSphere = glm::vec4(glm::vec3(transform * glm::vec4(bounds.SphereCenter, 1.0f)), bounds.SphereRadius * scale);
+			} else {
+				// Without bounds we have to assume the object could be seen by every light
+				state.WorldSphere = glm::vec4(glm::vec3(transform[3]), std::numeric_limits<float>::max());
+			}
+			_dirtyCasterSpheres.push_back(state.WorldSphere);
 
-			shader->Bind();
-			currentMat->Apply();
+			state.Owner     = renderable;
+			state.Mesh      = mesh.get();
+			state.Transform = transform;
 		}
+		state.Seen = true;
+	});
+
+	// Objects that have been removed need to be cleared out of any shadows they were in
+	for (auto it = _casterStates.begin(); it != _casterStates.end(); ) {
+		if (!it->second.Seen) {
+			_dirtyCasterSpheres.push_back(it->second.WorldSphere);
+			it = _casterStates.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	// Upload all our transforms for the frame in one go
+	if (!_objectData.empty()) {
+		_objectBuffer->LoadData(_objectData.data(), static_cast<uint32_t>(_objectData.size()));
+	}
+	if (!_visibilityMaterials.empty()) {
+		_visibilityObjectBuffer->LoadData(_visibilityObjects.data(), static_cast<uint32_t>(_visibilityObjects.size()));
+	}
+}
+
+void RenderLayer::_RenderShadows()
+{
+	using namespace Gameplay;
+
+	Application& app = Application::Get();
+	Camera::Sptr camera = app.CurrentScene()->MainCamera;
+	glm::vec3 cameraPos = camera->GetGameObject()->GetWorldPosition();
 
-		// Grab the game object so we can do some stuff with it
-		GameObject* object = renderable->GetGameObject();
+	// Lights that cover more of the screen get bigger tiles, we measure this by comparing the size of the light's
+	// range when projected onto the screen to the height of the screen
+	float projectionScale = camera->GetProjection()[1][1];
 
-		// Use our uniform buffer for our instance level uniforms
-		auto& instanceData = _instanceUniforms->GetData();
-		instanceData.u_Model = object->GetTransform();
-		instanceData.u_ModelViewProjection = viewProj * object->GetTransform();
-		instanceData.u_ModelView = view * object->GetTransform();
-		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(object->GetTransform())));
-		_instanceUniforms->Update();
+	struct TileRequest {
+		ShadowCamera* Light;
+		ShadowTile*   Tile;
+		uint32_t      Size;
+	};
+	std::vector<TileRequest> requests;
 
-		// Draw the object
-		renderable->GetMesh()->Draw();
+	for (auto& [key, tile] : _shadowTiles) {
+		tile.Seen = false;
+	}
 
+	app.CurrentScene()->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
+		ShadowTile& tile = _shadowTiles[shadowCam.get()];
+
+		// New lights (or a new light that got the address of an old one) start out with no tile
+		if (tile.Light.expired()) {
+			if (tile.Allocated) {
+				_shadowAtlas->Free(tile.Tile);
+			}
+			tile = ShadowTile();
+			tile.Light = shadowCam;
+			tile.Allocated = false;
+			tile.Valid = false;
+		}
+		tile.Seen = true;
+
+		const glm::ivec2& resolution = shadowCam->GetBufferResolution();
+		float maxSize = (float)glm::max(resolution.x, resolution.y);
+		float distance = glm::distance(cameraPos, shadowCam->GetGameObject()->GetWorldPosition());
+		float coverage = distance <= shadowCam->Range ? 1.0f : glm::clamp(shadowCam->Range * projectionScale / distance, 0.0f, 1.0f);
+
+		uint32_t size = glm::min(_shadowAtlas->GetTileSize((uint32_t)(maxSize * coverage)), _shadowAtlas->GetTileSize((uint32_t)maxSize));
+		requests.push_back({ shadowCam.get(), &tile, size });
 	});
 
+	// Release the tiles of lights that have been removed
+	for (auto it = _shadowTiles.begin(); it != _shadowTiles.end(); ) {
+		if (!it->second.Seen) {
+			if (it->second.Allocated) {
+				_shadowAtlas->Free(it->second.Tile);
+			}
+			it = _shadowTiles.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	// Release tiles that need to change size first, so that their space can be re-used. We only shrink when the tile is 
+	// 4x too big, so that lights near the threshold don't keep flipping between sizes and re-rendering
+	for (const TileRequest& request : requests) {
+		ShadowTile& tile = *request.Tile;
+		if (tile.Allocated && (request.Size > tile.Tile.Size || request.Size * 4 <= tile.Tile.Size)) {
+			_shadowAtlas->Free(tile.Tile);
+			tile.Allocated = false;
+		}
+	}
+
+	// Allocate the biggest tiles first so that the atlas packs tightly, if we run out of space we try smaller tiles
+	std::sort(requests.begin(), requests.end(), [](const TileRequest& a, const TileRequest& b) { return a.Size > b.Size; });
+	for (const TileRequest& request : requests) {
+		ShadowTile& tile = *request.Tile;
+		if (tile.Allocated) {
+			continue;
+		}
+
+		for (uint32_t size = request.Size; size >= _shadowAtlas->GetMinTileSize() && !tile.Allocated; size >>= 1) {
+			tile.Allocated = _shadowAtlas->Allocate(size, tile.Tile);
+		}
+		tile.Valid = false;
+	}
+
+	// Re-render any tiles that are out of date
+	_shadowAtlas->GetFramebuffer()->Bind();
+	RenderState::Enable(GL_SCISSOR_TEST);
+	for (const TileRequest& request : requests) {
+		ShadowTile& tile = *request.Tile;
+		if (!tile.Allocated) {
+			request.Light->SetAtlasTile(nullptr, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+			continue;
+		}
+		request.Light->SetAtlasTile(_shadowAtlas->GetFramebuffer(), _shadowAtlas->GetUvRect(tile.Tile));
+
+		glm::mat4 view = request.Light->GetGameObject()->GetInverseTransform();
+		glm::mat4 viewProj = request.Light->GetProjection() * view;
+
+		bool dirty = !tile.Valid || viewProj != tile.ViewProjection;
+		if (!dirty && !_dirtyCasterSpheres.empty()) {
+			Frustum frustum(viewProj);
+			for (const glm::vec4& sphere : _dirtyCasterSpheres) {
+				if (frustum.IsSphereVisible(glm::vec3(sphere), sphere.w)) {
+					dirty = true;
+					break;
+				}
+			}
+		}
+		if (!dirty) {
+			continue;
+		}
+
+		// Limit our clear and rendering to just this light's tile
+		RenderState::SetViewport(tile.Tile.Offset.x, tile.Tile.Offset.y, tile.Tile.Size, tile.Tile.Size);
+		RenderState::SetScissor(tile.Tile.Offset.x, tile.Tile.Offset.y, tile.Tile.Size, tile.Tile.Size);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		_RenderScene(view, request.Light->GetProjection(), glm::ivec2(tile.Tile.Size), RenderPass::Shadow);
+
+		tile.ViewProjection = viewProj;
+		tile.Valid = true;
+		_stats.ShadowTilesRendered++;
+	}
+	RenderState::Disable(GL_SCISSOR_TEST);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void RenderLayer::_RenderVisibility(const glm::mat4& view, const glm::mat4& projection)
+{
+	using namespace Gameplay;
+
+	// The visibility buffer is created the first time it's used, since it's off by default
+	if (_visibilityFBO == nullptr) {
+		FramebufferDescriptor descriptor;
+		descriptor.Width  = _primaryFBO->GetWidth();
+		descriptor.Height = _primaryFBO->GetHeight();
+		descriptor.RenderTargets[RenderTargetAttachment::Depth]  = RenderTargetDescriptor(RenderTargetType::Depth32);
+		descriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorR32UI);
+		_visibilityFBO = std::make_shared<Framebuffer>(descriptor);
+	}
+
+	// Clear to empty, then draw the IDs of all the objects that will be resolved
+	const GLuint emptyId = 0;
+	const float  farDepth = 1.0f;
+	glClearNamedFramebufferuiv(_visibilityFBO->GetHandle(), GL_COLOR, 0, &emptyId);
+	glClearNamedFramebufferfv(_visibilityFBO->GetHandle(), GL_DEPTH, 0, &farDepth);
+	_visibilityFBO->Bind();
+	_RenderScene(view, projection, _visibilityFBO->GetSize(), RenderPass::Visibility);
+
+	// Bind the visibility buffer, the arena's geometry and the per-object data, so the resolve can rebuild the triangle under each pixel
+	glBindImageTexture(VISIBILITY_IMAGE_BINDING, _visibilityFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->GetHandle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_VERTICES_SSBO_BINDING, _geometryArena->GetVertexBuffer()->GetHandle());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_INDICES_SSBO_BINDING, _geometryArena->GetIndexBuffer()->GetHandle());
+	_visibilityObjectBuffer->Bind(VISIBILITY_OBJECTS_SSBO_BINDING);
+
+	// The resolve writes into the G-Buffer. First we replace its depth with the material slot of each pixel, without touching the colors
+	_primaryFBO->Bind();
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	RenderState::SetDepthFunc(GL_ALWAYS);
+	_materialDepthShader->Bind();
+	_fullscreenQuad->Draw();
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	// Each material then draws a fullscreen quad at its slot's depth. The depth test rejects every pixel that belongs to another
+	// material before it's shaded, so each pixel only runs the material that covers it, once
+	RenderState::SetDepthFunc(GL_EQUAL);
+	RenderState::SetDepthMask(false);
+	for (uint32_t ix = 0; ix < _visibilityMaterials.size(); ix++) {
+		Material* material = _visibilityMaterials[ix];
+		ShaderProgram::Sptr shader = material->GetShader()->GetVisibilityVariant();
+		shader->Bind();
+		material->Apply(shader);
+		shader->SetUniform(UNIFORM_MATERIAL_DEPTH, (float)(ix + 1) / (float)MAX_VISIBILITY_MATERIALS);
+		_fullscreenQuad->Draw();
+		_stats.ProgramSwitches++;
+		_stats.MaterialSwitches++;
+		_stats.ResolvedMaterials++;
+	}
+	RenderState::SetDepthFunc(GL_LESS);
+	RenderState::SetDepthMask(true);
+
+	// Put the real scene depth back, so the objects drawn into the G-Buffer afterwards are depth tested against the resolved ones
+	glBlitNamedFramebuffer(
+		_visibilityFBO->GetHandle(), _primaryFBO->GetHandle(),
+		0, 0, _visibilityFBO->GetWidth(), _visibilityFBO->GetHeight(),
+		0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight(),
+		GL_DEPTH_BUFFER_BIT,
+		GL_NEAREST
+	);
 }
 
 const UniformBuffer<RenderLayer::FrameLevelUniforms>::Sptr& RenderLayer::GetFrameUniforms() const
@@ -617,3 +1536,8 @@ const UniformBuffer<RenderLayer::FrameLevelUniforms>::Sptr& RenderLayer::GetFram
 	return _frameUniforms;
 }
 
+const RenderLayer::RenderStats& RenderLayer::GetRenderStats() const
+{
+	return _lastFrameStats;
+}
+
@@ -4,7 +4,24 @@
 #include "Graphics/Buffers/UniformBuffer.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/Bounds.h"
+#include "Graphics/GeometryArena.h"
+#include "Graphics/Buffers/IndirectBuffer.h"
+#include "Graphics/LightClusterGrid.h"
+#include "Graphics/ShadowAtlas.h"
+#include "Graphics/OcclusionBuffer.h"
+#include "Graphics/DynamicResolution.h"
 
+namespace Gameplay {
+	class Material;
+}
+class RenderComponent;
+class ShadowCamera;
+
+// The maximum number of lights in the lighting UBO, used by forward shaded materials. Deferred lighting
+// uses the clustered light grid instead, and has no limit
 #define MAX_LIGHTS 8
 
 ENUM_FLAGS(RenderFlags, uint32_t,
@@ -13,7 +30,9 @@ ENUM_FLAGS(RenderFlags, uint32_t,
 	EnableAlbedo = 1 << 1,
 	EnableDiffuse = 1 << 2,
 	EnableSpecular= 1 << 3,
-	EnableEmissive= 1 << 4
+	EnableEmissive= 1 << 4,
+	// Set automatically when the G-Buffer uses the compact layout, see gbuffer_normals.glsl
+	CompactGBuffer = 1 << 5
 );
 
 class RenderLayer final : public ApplicationLayer {
@@ -97,6 +116,35 @@ public:
 		glm::mat4 EnvironmentRotation;
 	};
 
+	/// <summary>
+	/// Counters for the work done by the render layer in a single frame, summed
+	/// across all scene passes (G-Buffer and shadows)
+	/// </summary>
+	struct RenderStats {
+		// Number of draw calls issued for scene geometry
+		uint32_t DrawCalls        = 0;
+		// Number of times we had to switch to a different shader program
+		uint32_t ProgramSwitches  = 0;
+		// Number of times we had to apply a different material
+		uint32_t MaterialSwitches = 0;
+		// Number of objects that were rejected by frustum culling
+		uint32_t CulledObjects    = 0;
+		// Number of draw calls that were instanced batches
+		uint32_t InstancedBatches = 0;
+		// Number of multi-draw indirect calls issued from the geometry arena
+		uint32_t IndirectDraws    = 0;
+		// Number of shadow atlas tiles that had to be re-rendered
+		uint32_t ShadowTilesRendered = 0;
+		// Number of objects that were hidden behind occluders
+		uint32_t OccludedObjects  = 0;
+		// Number of objects that were drawn into the visibility buffer instead of the G-Buffer
+		uint32_t VisibilityObjects = 0;
+		// Number of materials that were shaded by the visibility buffer resolve
+		uint32_t ResolvedMaterials = 0;
+		// Number of triangles submitted for drawing
+		uint32_t Triangles        = 0;
+	};
+
 	RenderLayer();
 	virtual ~RenderLayer();
 
@@ -114,12 +162,86 @@ public:
 	void SetRenderFlags(RenderFlags value);
 	RenderFlags GetRenderFlags() const;
 
+	/// <summary>
+	/// Enables or disables rejecting objects that are outside of the camera's view
+	/// </summary>
+	void SetFrustumCullingEnabled(bool value);
+	bool IsFrustumCullingEnabled() const;
+
+	/// <summary>
+	/// Enables or disables automatically drawing objects with the same mesh and material as 
+	/// a single instanced draw call
+	/// </summary>
+	void SetInstancingEnabled(bool value);
+	bool IsInstancingEnabled() const;
+
+	/// <summary>
+	/// Enables or disables packing static meshes into a shared geometry arena, so that all the instanced
+	/// batches for a material can be submitted with a single multi-draw indirect call. Requires instancing
+	/// </summary>
+	void SetGeometryArenaEnabled(bool value);
+	bool IsGeometryArenaEnabled() const;
+
+	/// <summary>
+	/// Enables or disables drawing shadow passes with the depth-only pipeline, where opaque materials
+	/// skip material setup and share a position-only shader, and only masked materials alpha test
+	/// </summary>
+	void SetDepthOnlyShadowsEnabled(bool value);
+	bool IsDepthOnlyShadowsEnabled() const;
+
+	/// <summary>
+	/// Enables or disables software occlusion culling, where objects marked as occluders are drawn into a small
+	/// depth buffer on the CPU, and objects hidden behind them are skipped. Only has an effect if the scene has occluders
+	/// </summary>
+	void SetOcclusionCullingEnabled(bool value);
+	bool IsOcclusionCullingEnabled() const;
+
+	/// <summary>
+	/// Enables or disables drawing lower detail versions of meshes when they are small on screen. LODs are picked
+	/// separately for the camera and for each shadow, see RenderComponent::SelectLod
+	/// </summary>
+	void SetLodEnabled(bool value);
+	bool IsLodEnabled() const;
+
+	/// <summary>
+	/// Enables or disables the visibility buffer, where objects in the geometry arena only write their object and triangle
+	/// IDs in the geometry pass, and each visible pixel's material is evaluated exactly once by a resolve pass that fills
+	/// in the G-Buffer. Objects that the resolve can't handle are still drawn into the G-Buffer as normal. Requires the
+	/// geometry arena. The initial value can be set with "visibility_buffer" in the app settings
+	/// </summary>
+	void SetVisibilityBufferEnabled(bool value);
+	bool IsVisibilityBufferEnabled() const;
+
+	/// <summary>
+	/// Returns true if the G-Buffer uses the compact layout, where there is no view space position target (position
+	/// is reconstructed from depth) and normals are octahedral encoded. Set with "compact_gbuffer" in the app settings
+	/// </summary>
+	bool IsCompactGBufferEnabled() const;
+
+	/// <summary>
+	/// Enables or disables dynamic resolution, where the G-Buffer, lighting and output buffers are rendered at a lower
+	/// resolution whenever the GPU can't render the scene within the target frame time. The projection is jittered every
+	/// frame, and the result is brought back up to the window's resolution by reprojecting the previous frames' results.
+	/// The initial value can be set with "dynamic_resolution" in the app settings
+	/// </summary>
+	void SetDynamicResolutionEnabled(bool value);
+	bool IsDynamicResolutionEnabled() const;
+	/// <summary>
+	/// Gets the controller that picks the render resolution, can be used to change the target frame time
+	/// </summary>
+	const DynamicResolution::Sptr& GetDynamicResolution() const;
+
 	const Framebuffer::Sptr& GetLightingBuffer() const;
 	const Framebuffer::Sptr& GetRenderOutput() const;
 	const Framebuffer::Sptr& GetGBuffer() const;
 
 	const UniformBuffer<FrameLevelUniforms>::Sptr& GetFrameUniforms() const;
 
+	/// <summary>
+	/// Gets the render statistics for the last frame that was rendered
+	/// </summary>
+	const RenderStats& GetRenderStats() const;
+
 	// Inherited from ApplicationLayer
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
@@ -127,6 +249,7 @@ public:
 	virtual void OnRender(const Framebuffer::Sptr& prevLayer) override;
 	virtual void OnPostRender() override;
 	virtual void OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) override;
+	virtual nlohmann::json GetDefaultConfig() override;
 
 protected:
 	Framebuffer::Sptr   _primaryFBO;
@@ -136,13 +259,30 @@ protected:
 	ShaderProgram::Sptr _clearShader;
 	ShaderProgram::Sptr _lightAccumulationShader;
 	ShaderProgram::Sptr _compositingShader;
+	// The keywords of the compositing shader variant for our render flags, see _ResolveCompositeKeywords
+	uint32_t            _compositeKeywordMask;
 	ShaderProgram::Sptr _shadowShader;
+	// Position-only shader for drawing opaque materials in depth-only passes
+	ShaderProgram::Sptr _depthShader;
+	// Writes object and triangle IDs into the visibility buffer
+	ShaderProgram::Sptr _visibilityShader;
+	// Converts the visibility buffer into material depths for the resolve
+	ShaderProgram::Sptr _materialDepthShader;
 
 	VertexArrayObject::Sptr _fullscreenQuad;
 
 	bool              _blitFbo;
 	glm::vec4         _clearColor;
 	RenderFlags       _renderFlags;
+	bool              _frustumCulling;
+	bool              _instancing;
+	bool              _useGeometryArena;
+	bool              _depthOnlyShadows;
+	bool              _occlusionCulling;
+	bool              _lodEnabled;
+	bool              _compactGBuffer;
+	bool              _visibilityBufferEnabled;
+	bool              _dynamicResolutionEnabled;
 
 	const int FRAME_UBO_BINDING = 0;
 	UniformBuffer<FrameLevelUniforms>::Sptr _frameUniforms;
@@ -153,10 +293,196 @@ protected:
 	const int LIGHTING_UBO_BINDING = 2;
 	UniformBuffer<LightingUboStruct>::Sptr _lightingUbo;
 
+	// UBO binding 3 is where materials bind their packed parameters (see Material.h)
+
+	// Point lights binned into view space clusters, so the lighting pass only shades the lights that touch each pixel
+	const int CLUSTER_LIGHTS_SSBO_BINDING  = 2;
+	const int CLUSTERS_SSBO_BINDING        = 3;
+	const int CLUSTER_INDICES_SSBO_BINDING = 4;
+	LightClusterGrid::Sptr _lightClusters;
+
+	// Shadow casting lights render into tiles of a shared atlas. Tiles keep their contents between frames, and are
+	// only re-rendered when the light moves, or when a caster that the light can see changes
+	struct ShadowTile {
+		std::weak_ptr<ShadowCamera> Light;
+		ShadowAtlas::Tile Tile;
+		// The view projection the tile was last rendered with
+		glm::mat4 ViewProjection;
+		bool      Allocated;
+		// True if the contents of the tile are up to date
+		bool      Valid;
+		bool      Seen;
+	};
+	ShadowAtlas::Sptr _shadowAtlas;
+	std::unordered_map<const ShadowCamera*, ShadowTile> _shadowTiles;
+
+	// The occluders are drawn into this for each pass, and all the other objects are tested against it
+	OcclusionBuffer::Sptr _occlusionBuffer;
+	// For each draw item, 1 if it was hidden by occluders in the current pass
+	std::vector<uint8_t>  _occluded;
+
+	// The object and triangle IDs covering each pixel, plus depth. Created when the visibility buffer is first used
+	Framebuffer::Sptr     _visibilityFBO;
+	// The number of bits used for the triangle index in the visibility buffer, the rest store the object index plus one.
+	// Must match fragments/visibility_buffer.glsl
+	static const uint32_t VISIBILITY_TRIANGLE_BITS = 20;
+	static const uint32_t MAX_VISIBILITY_OBJECTS   = (1u << (32 - VISIBILITY_TRIANGLE_BITS)) - 1;
+	// Material depths are slot / MAX_VISIBILITY_MATERIALS, which are exact in floating point so that the depth written by
+	// the material depth pass and the depth of each material's resolve quad will always compare equal
+	static const uint32_t MAX_VISIBILITY_MATERIALS = 4096;
+	const int VISIBILITY_IMAGE_BINDING           = 0;
+	const int VISIBILITY_VERTICES_SSBO_BINDING   = 5;
+	const int VISIBILITY_INDICES_SSBO_BINDING    = 6;
+	const int VISIBILITY_OBJECTS_SSBO_BINDING    = 7;
+	// Per-object data for the resolve, matches VisibilityObjectData in fragments/visibility_buffer.glsl
+	struct VisibilityObject {
+		uint32_t FirstIndex;
+		int32_t  BaseVertex;
+		float    MaterialDepth;
+		uint32_t Padding;
+	};
+	std::vector<VisibilityObject>   _visibilityObjects;
+	ShaderStorageBuffer::Sptr       _visibilityObjectBuffer;
+	// The materials to resolve this frame, the material at index i is resolved at depth (i + 1) / MAX_VISIBILITY_MATERIALS
+	std::vector<Gameplay::Material*> _visibilityMaterials;
+	// For each draw item, 1 if it is drawn into the visibility buffer this frame
+	std::vector<uint8_t>            _visibilityItems;
+
+	// Measures the time it takes to render the scene, and picks the resolution that the G-Buffer, lighting and output buffers are rendered at
+	DynamicResolution::Sptr _dynamicResolution;
+	// The size of the window, which the scene is upsampled back to
+	glm::ivec2              _outputSize;
+	// The projection used to render the scene this frame, includes the sub-pixel jitter when dynamic resolution is enabled
+	glm::mat4               _projection;
+	// The offset of this frame's samples from the pixel centers, in render resolution pixels
+	glm::vec2               _jitter;
+	uint32_t                _jitterIndex;
+	// The camera's view projection last frame, without the jitter, for reprojecting the history
+	glm::mat4               _prevViewProjection;
+	// The upsampled scene at the output resolution, with the scene's depth
+	Framebuffer::Sptr       _upsampledBuffer;
+	// The upsampled results of the last frame and the current frame, we swap between them every frame
+	Framebuffer::Sptr       _historyBuffers[2];
+	uint32_t                _historyIndex;
+	bool                    _historyValid;
+	ShaderProgram::Sptr     _temporalUpsampleShader;
+
+	// Tracks the state of each renderable between frames, so we know which shadow tiles need re-rendering
+	struct CasterState {
+		std::weak_ptr<RenderComponent> Owner;
+		glm::mat4 Transform;
+		const VertexArrayObject* Mesh;
+		// World space bounding sphere, as (center, radius)
+		glm::vec4 WorldSphere;
+		bool      Seen;
+	};
+	std::unordered_map<const RenderComponent*, CasterState> _casterStates;
+	// The world space bounding spheres of casters that have moved, appeared or disappeared this frame. Old and new positions are both included
+	std::vector<glm::vec4> _dirtyCasterSpheres;
+
+	// Stores the data for an object that will be drawn this frame, render queue packets refer to these by index
+	struct DrawItem {
+		Gameplay::Material* Material;
+		// The mesh to draw for the camera, which may be one of the mesh's LODs
+		VertexArrayObject*  Mesh;
+		const Bounds*       LocalBounds;
+		// Where the mesh lives in the geometry arena, or nullptr if it's not in the arena
+		const GeometryArena::Allocation* ArenaAlloc;
+		// The triangles to draw into the occlusion buffer, or nullptr if the object is not an occluder
+		const OccluderMesh* Occluder;
+		// The component the item came from, so shadow passes can pick their own LODs
+		const RenderComponent* Renderable;
+	};
+
+	// The mesh that each draw item uses in the current pass. These are the same as the draw items for the camera's
+	// passes, while shadow passes pick their LODs based on how big objects are in the shadow map
+	struct PassMesh {
+		VertexArrayObject*  Mesh;
+		const GeometryArena::Allocation* ArenaAlloc;
+	};
+
+	// Per-object data stored in our object buffer, matches ObjectData in fragments/frame_uniforms.glsl
+	struct ObjectData {
+		glm::mat4 Model;
+		// Only the upper 3x3 is used, we use a mat4 to keep the columns aligned
+		glm::mat4 NormalMatrix;
+	};
+
+	// A run of sorted draws that share a mesh and material
+	struct DrawBatch {
+		// The material to apply, or nullptr for batches in depth-only passes that don't need material state
+		Gameplay::Material* Material;
+		VertexArrayObject*  Mesh;
+		// The shader to draw with, will be the instanced variant for instanced batches
+		ShaderProgram::Sptr Shader;
+		uint32_t            FirstPacket;
+		uint32_t            Count;
+		uint32_t            BaseInstance;
+		bool                Instanced;
+		// For batches drawn from the geometry arena, the range of commands in the indirect buffer
+		bool                Indirect;
+		uint32_t            FirstCommand;
+		uint32_t            CommandCount;
+	};
+
+	RenderQueue               _renderQueue;
+	std::vector<DrawBatch>    _drawBatches;
+
+	// The objects to draw this frame, and their transforms. These are gathered once per frame and shared by all passes
+	std::vector<DrawItem>     _drawItems;
+	std::vector<ObjectData>   _objectData;
+	std::vector<PassMesh>     _passMeshes;
+	const int OBJECT_SSBO_BINDING = 0;
+	ShaderStorageBuffer::Sptr _objectBuffer;
+
+	// Indices into the object buffer for instanced draws, in draw order. These are re-filled for every pass
+	std::vector<uint32_t>     _drawIndices;
+	const int DRAW_INDEX_SSBO_BINDING = 1;
+	ShaderStorageBuffer::Sptr _drawIndexBuffer;
+
+	// Static meshes packed together so that they can be drawn with multi-draw indirect, created when first needed
+	GeometryArena::Sptr       _geometryArena;
+	// The indirect draw commands for a pass, re-filled for every pass
+	std::vector<DrawElementsIndirectCommand> _indirectCommands;
+	IndirectBuffer::Sptr      _indirectBuffer;
+
+	RenderStats _stats;
+	RenderStats _lastFrameStats;
+
 	void _InitFrameUniforms();
-	void _RenderScene(const glm::mat4& view, const glm::mat4&Projection, const glm::ivec2& screenSize);
+	void _RenderScene(const glm::mat4& view, const glm::mat4&Projection, const glm::ivec2& screenSize, RenderPass pass);
+
+	/// <summary>
+	/// Collects all the renderable objects in the scene, and uploads their transforms to the object buffer
+	/// </summary>
+	void _GatherObjects();
+
+	/// <summary>
+	/// Assigns shadow atlas tiles to all the shadow casting lights, and re-renders the tiles that are out of date
+	/// </summary>
+	void _RenderShadows();
+
+	/// <summary>
+	/// Draws the objects that support it into the visibility buffer, then resolves their materials into the G-Buffer and
+	/// copies their depth over, so the rest of the objects can be drawn into the G-Buffer as normal
+	/// </summary>
+	void _RenderVisibility(const glm::mat4& view, const glm::mat4& projection);
 
 	void _AccumulateLighting();
 	void _Composite();
+	/// <summary>
+	/// Resolves the keywords for the buffers enabled in our render flags into a mask for the compositing shader, so that
+	/// we don't need to look them up by name every frame. Should be called whenever the render flags change
+	/// </summary>
+	void _ResolveCompositeKeywords();
+
+	/// <summary>
+	/// Resizes the G-Buffer, lighting and output buffers if the render resolution has changed
+	/// </summary>
+	void _UpdateRenderSize();
+	/// <summary>
+	/// Blends the output buffer into the history at the output resolution, and copies the result into the upsampled buffer
+	/// </summary>
+	void _TemporalUpsample();
 	void _ClearFramebuffer(Framebuffer::Sptr& buffer, const glm::vec4* colors, int layers);
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Application/Application.h"
 #include "Application/ApplicationLayer.h"
 #include "Application/Layers/RenderLayer.h"
+#include "Graphics/RenderState.h"
 
 DebugWindow::DebugWindow() :
 	IEditorWindow()
@@ -71,4 +72,75 @@ void DebugWindow::RenderMenuBar()
 	if (changed) {
 		renderLayer->SetRenderFlags(flags);
 	}
+
+	ImGui::Separator();
+
+	bool culling = renderLayer->IsFrustumCullingEnabled();
+	if (ImGui::Checkbox("Frustum Culling", &culling)) {
+		renderLayer->SetFrustumCullingEnabled(culling);
+	}
+
+	bool instancing = renderLayer->IsInstancingEnabled();
+	if (ImGui::Checkbox("Instancing", &instancing)) {
+		renderLayer->SetInstancingEnabled(instancing);
+	}
+
+	bool arena = renderLayer->IsGeometryArenaEnabled();
+	if (ImGui::Checkbox("Geometry Arena", &arena)) {
+		renderLayer->SetGeometryArenaEnabled(arena);
+	}
+
+	bool occlusion = renderLayer->IsOcclusionCullingEnabled();
+	if (ImGui::Checkbox("Occlusion Culling", &occlusion)) {
+		renderLayer->SetOcclusionCullingEnabled(occlusion);
+	}
+
+	bool lod = renderLayer->IsLodEnabled();
+	if (ImGui::Checkbox("Mesh LODs", &lod)) {
+		renderLayer->SetLodEnabled(lod);
+	}
+
+	bool depthOnly = renderLayer->IsDepthOnlyShadowsEnabled();
+	if (ImGui::Checkbox("Depth-only Shadows", &depthOnly)) {
+		renderLayer->SetDepthOnlyShadowsEnabled(depthOnly);
+	}
+
+	bool visibility = renderLayer->IsVisibilityBufferEnabled();
+	if (ImGui::Checkbox("Visibility Buffer", &visibility)) {
+		renderLayer->SetVisibilityBufferEnabled(visibility);
+	}
+
+	bool dynamicResolution = renderLayer->IsDynamicResolutionEnabled();
+	if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolution)) {
+		renderLayer->SetDynamicResolutionEnabled(dynamicResolution);
+	}
+	const DynamicResolution::Sptr& resolution = renderLayer->GetDynamicResolution();
+	if (dynamicResolution) {
+		float target = resolution->GetTargetFrameTime();
+		if (ImGui::DragFloat("Target GPU Time (ms)", &target, 0.1f, 1.0f, 100.0f)) {
+			resolution->SetTargetFrameTime(target);
+		}
+	}
+
+	// Show how much work the renderer did last frame, so we can see how well our draw sorting is doing
+	const RenderLayer::RenderStats& stats = renderLayer->GetRenderStats();
+	ImGui::Text("Draws: %u  Instanced: %u  Indirect: %u  Programs: %u  Materials: %u  Culled: %u", 
+		stats.DrawCalls, stats.InstancedBatches, stats.IndirectDraws, stats.ProgramSwitches, stats.MaterialSwitches, stats.CulledObjects);
+	ImGui::Text("Shadow Tiles Rendered: %u  Occluded: %u", stats.ShadowTilesRendered, stats.OccludedObjects);
+	ImGui::Text("Visibility Buffer Objects: %u  Resolved Materials: %u", stats.VisibilityObjects, stats.ResolvedMaterials);
+	ImGui::Text("Triangles: %u", stats.Triangles);
+
+	// The GPU time covers everything from clearing the G-Buffer up to the upsampled scene
+	const glm::ivec2 renderSize = renderLayer->GetGBuffer()->GetSize();
+	ImGui::Text("Render Resolution: %d x %d (%.0f%%)  Scene GPU Time: %.2f ms",
+		renderSize.x, renderSize.y, resolution->GetScale() * 100.0f, resolution->GetGpuTime());
+
+	// The state cache counts every state change we asked for, and how many of them were already set
+	const RenderState::Stats& stateStats = RenderState::GetStats();
+	ImGui::Text("GL State Changes: %u  Filtered: %u", stateStats.Calls, stateStats.Filtered);
+
+	// Transient targets are shared between passes whose lifetimes don't overlap, so there should be fewer targets than requests
+	const RenderGraph::Stats& graphStats = Application::Get().GetRenderGraph()->GetStats();
+	ImGui::Text("Render Graph Passes: %u  Culled: %u  Transient Targets: %u / %u Requests  Pooled: %u",
+		graphStats.PassesExecuted, graphStats.PassesCulled, graphStats.TransientTargets, graphStats.TransientResources, graphStats.PooledTargets);
 }
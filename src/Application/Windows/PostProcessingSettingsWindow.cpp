@@ -22,6 +22,13 @@ void PostProcessingSettingsWindow::Render()
 
 	PostProcessingLayer::Sptr layer = app.GetLayer<PostProcessingLayer>();
 
+	// Lets us compare the fused passes against running every effect on its own
+	bool fuse = layer->IsFusionEnabled();
+	if (ImGui::Checkbox("Fuse Effects", &fuse)) {
+		layer->SetFusionEnabled(fuse);
+	}
+	ImGui::Separator();
+
 	std::set<PostProcessingLayer::Effect::Sptr> unique (layer->GetEffects().begin(), layer->GetEffects().end());
 
 	for (const auto& effect : unique) {
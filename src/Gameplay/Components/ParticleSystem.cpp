@@ -4,8 +4,12 @@
 #include "Application/Application.h"
 #include "Utils/ImGuiHelper.h"
 #include "Graphics/DebugDraw.h"
+#include "Graphics/RenderState.h"
 #include "imgui_internal.h"
 
+static constexpr UniformHandle UNIFORM_GRAVITY("u_Gravity");
+static constexpr UniformHandle UNIFORM_MODEL_MATRIX("u_ModelMatrix");
+
 ParticleSystem::ParticleSystem() :
 	IComponent(),
 	_hasInit(false),
@@ -53,7 +57,7 @@ void ParticleSystem::Update()
 		size_t dataSize = (_maxParticles + _emitters.size()) * sizeof(ParticleData);
 
 		for (int ix = 0; ix < 2; ix++) {
-			glBindVertexArray(_updateVaos[ix]);
+			RenderState::BindVertexArray(_updateVaos[ix]);
 
 			// Set up our first transform feedback buffer to write to the first buffer
 			glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, _feedbackBuffers[ix]);
@@ -81,7 +85,7 @@ void ParticleSystem::Update()
 			glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Metadata2)); // metadata 
 
 
-			glBindVertexArray(_renderVaos[ix]);
+			RenderState::BindVertexArray(_renderVaos[ix]);
 			glBindBuffer(GL_ARRAY_BUFFER, _particleBuffers[ix]);
 
 			// Enable type, position and color 
@@ -99,7 +103,7 @@ void ParticleSystem::Update()
 			glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (const GLvoid*)offsetof(ParticleData, Metadata2)); // metadata 
 		}
 
-		glBindVertexArray(0);
+		RenderState::BindVertexArray(0);
 
 
 		// We create a query object to track the number of particles we're simulating
@@ -115,7 +119,7 @@ void ParticleSystem::Update()
 	}
 
 	if (_needsUpload) {
-		glBindVertexArray(0);
+		RenderState::BindVertexArray(0);
 
 		// Allocate some temp space for particles, so we can init the emitters
 		size_t dataSize = (_emitters.size()) * sizeof(ParticleData);
@@ -137,14 +141,14 @@ void ParticleSystem::Update()
 	}
 
 	// Disable rasterization, this is update only
-	glEnable(GL_RASTERIZER_DISCARD);
+	RenderState::Enable(GL_RASTERIZER_DISCARD);
 
 	// Bind the update shader and send our relevant uniforms
 	_updateShader->Bind();
-	_updateShader->SetUniform("u_Gravity", _gravity); 
-	_updateShader->SetUniformMatrix("u_ModelMatrix", GetGameObject()->GetTransform()); 
+	_updateShader->SetUniform(UNIFORM_GRAVITY, _gravity); 
+	_updateShader->SetUniformMatrix(UNIFORM_MODEL_MATRIX, GetGameObject()->GetTransform()); 
 
-	glBindVertexArray(_updateVaos[_currentVertexBuffer]);
+	RenderState::BindVertexArray(_updateVaos[_currentVertexBuffer]);
 
 	// Bind the buffer and transform feedback
 	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, _feedbackBuffers[_currentFeedbackBuffer]);
@@ -178,10 +182,10 @@ void ParticleSystem::Update()
 	// Clean up our state
 	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
 
-	glBindVertexArray(0);
+	RenderState::BindVertexArray(0);
 
 	// Re-enable rasterization for later OpenGL calls
-	glDisable(GL_RASTERIZER_DISCARD);
+	RenderState::Disable(GL_RASTERIZER_DISCARD);
 
 	_hasInit = true;
 	_needsUpload = false;
@@ -204,15 +208,15 @@ void ParticleSystem::Render()
 		_renderShader->Bind();
 
 		// Make sure no VAOs are bound
-		glBindVertexArray(_renderVaos[_currentVertexBuffer]);
+		RenderState::BindVertexArray(_renderVaos[_currentVertexBuffer]);
 
 		//glDisable(GL_DEPTH_TEST);
 		
-		glDisable(GL_BLEND);
-		glEnablei(GL_BLEND, 0);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glDepthMask(false);
-		glEnable(GL_DEPTH_TEST);
+		RenderState::Disable(GL_BLEND);
+		RenderState::EnableIndexed(GL_BLEND, 0);
+		RenderState::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		RenderState::SetDepthMask(false);
+		RenderState::Enable(GL_DEPTH_TEST);
 
 		// Bind the current feedback buffer as our drawing buffer
 		glBindBuffer(GL_ARRAY_BUFFER, _particleBuffers[_currentVertexBuffer]); 
@@ -220,9 +224,9 @@ void ParticleSystem::Render()
 		// Draw our particles using whatever data we have in transform feedback buffer
 		glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
 
-		glBindVertexArray(0);
+		RenderState::BindVertexArray(0);
 
-		glEnable(GL_DEPTH_TEST);
+		RenderState::Enable(GL_DEPTH_TEST);
 	}
 }
 
@@ -2,17 +2,24 @@
 
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/JsonGlmHelpers.h"
 
 
 RenderComponent::RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material) :
 	_mesh(mesh), 
 	_material(material), 
+	_isOccluder(false),
+	_lodBias(1.0f),
+	_shadowLodBias(4.0f),
 	_meshBuilderParams(std::vector<MeshBuilderParam>()) 
 { }
 
 RenderComponent::RenderComponent() : 
 	_mesh(nullptr), 
 	_material(nullptr), 
+	_isOccluder(false),
+	_lodBias(1.0f),
+	_shadowLodBias(4.0f),
 	_meshBuilderParams(std::vector<MeshBuilderParam>())
 { }
 
@@ -38,10 +45,63 @@ const Gameplay::Material::Sptr& RenderComponent::GetMaterial() const {
 	return _material;
 }
 
+RenderComponent* RenderComponent::SetOccluder(bool value) {
+	_isOccluder = value;
+	return this;
+}
+
+bool RenderComponent::IsOccluder() const {
+	return _isOccluder;
+}
+
+RenderComponent* RenderComponent::SetLodBias(float value) {
+	_lodBias = value;
+	return this;
+}
+
+float RenderComponent::GetLodBias() const {
+	return _lodBias;
+}
+
+RenderComponent* RenderComponent::SetShadowLodBias(float value) {
+	_shadowLodBias = value;
+	return this;
+}
+
+float RenderComponent::GetShadowLodBias() const {
+	return _shadowLodBias;
+}
+
+VertexArrayObject::Sptr RenderComponent::SelectLod(const glm::mat4& modelView, const glm::mat4& projection, float screenHeight, bool shadowPass) const {
+	if (_mesh == nullptr || _mesh->Lods.empty() || !_mesh->LocalBounds.IsValid) {
+		return GetMesh();
+	}
+
+	// Measure from the nearest point of the bounding sphere, perspective projections shrink things with distance
+	// while orthographic projections (ex: directional shadows) don't
+	const Bounds& bounds = _mesh->LocalBounds;
+	float scale = glm::max(glm::length(glm::vec3(modelView[0])), glm::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+	float distance = 1.0f;
+	if (projection[2][3] != 0.0f) {
+		distance = -(modelView * glm::vec4(bounds.SphereCenter, 1.0f)).z - bounds.SphereRadius * scale;
+		// If the camera is inside the bounds, it's as close as it can get
+		if (distance <= 0.0f) {
+			return _mesh->Mesh;
+		}
+	}
+
+	// How many pixels a unit in the mesh's local space covers at that distance
+	float pixelsPerUnit = scale * projection[1][1] * 0.5f * screenHeight / distance;
+	return _mesh->SelectLod(pixelsPerUnit, shadowPass ? _shadowLodBias : _lodBias);
+}
+
 nlohmann::json RenderComponent::ToJson() const {
 	nlohmann::json result;
 	result["mesh"] = _mesh ? _mesh->GetGUID().str() : "null";
 	result["material"] = _material ? _material->GetGUID().str() : "null";
+	result["occluder"] = _isOccluder;
+	result["lod_bias"] = _lodBias;
+	result["shadow_lod_bias"] = _shadowLodBias;
 	return result;
 }
 
@@ -49,6 +109,9 @@ RenderComponent::Sptr RenderComponent::FromJson(const nlohmann::json& data) {
 	RenderComponent::Sptr result = std::make_shared<RenderComponent>();
 	result->_mesh = ResourceManager::Get<Gameplay::MeshResource>(Guid(data["mesh"].get<std::string>()));
 	result->_material = ResourceManager::Get<Gameplay::Material>(Guid(data["material"].get<std::string>()));
+	result->_isOccluder = JsonGet(data, "occluder", false);
+	result->_lodBias = JsonGet(data, "lod_bias", 1.0f);
+	result->_shadowLodBias = JsonGet(data, "shadow_lod_bias", 4.0f);
 
 	return result;
 }
@@ -57,7 +120,12 @@ void RenderComponent::RenderImGui() {
 	ImGui::Text("Indexed:   %s", GetMesh() != nullptr ? (_mesh->Mesh->GetIndexBuffer() != nullptr ? "true" : "false") : "N/A");
 	ImGui::Text("Triangles: %d", GetMesh() != nullptr ? (_mesh->Mesh->GetElementCount() / 3) : 0);
 	ImGui::Text("Source:    %s", (_mesh == nullptr || _mesh->Filename.empty()) ? "Generated" : _mesh->Filename.c_str());
+	ImGui::Text("LODs:      %d", _mesh != nullptr ? (int)_mesh->Lods.size() : 0);
 	ImGui::Separator();
 	ImGui::Text("Material:  %s", _material != nullptr ? _material->Name.c_str() : "NULL");
 	ImGuiHelper::ResourceDragTarget<Gameplay::Material>(_material);
+	ImGui::Separator();
+	ImGui::Checkbox("Occluder", &_isOccluder);
+	ImGui::DragFloat("LOD Bias", &_lodBias, 0.1f, 0.0f, 64.0f);
+	ImGui::DragFloat("Shadow LOD Bias", &_shadowLodBias, 0.1f, 0.0f, 64.0f);
 }
@@ -42,6 +42,36 @@ public:
 	/// <param name="mat">The material for this object</param>
 	RenderComponent* SetMaterial(const Gameplay::Material::Sptr& mat);
 
+	/// <summary>
+	/// Sets whether this object should be drawn into the occlusion buffer, so that it can hide other objects before
+	/// they are submitted for rendering. This should only be used for a few large, solid objects such as walls
+	/// </summary>
+	RenderComponent* SetOccluder(bool value);
+	bool IsOccluder() const;
+
+	/// <summary>
+	/// Sets how far a LOD can stray from the full detail mesh before we switch to a more detailed one, in
+	/// pixels. Higher values will switch to lower detail LODs closer to the camera
+	/// </summary>
+	RenderComponent* SetLodBias(float value);
+	float GetLodBias() const;
+	/// <summary>
+	/// Sets the LOD bias for shadow passes. Shadow maps are lower resolution and filtered, so this can
+	/// usually be a lot coarser than the LOD bias for the camera
+	/// </summary>
+	RenderComponent* SetShadowLodBias(float value);
+	float GetShadowLodBias() const;
+
+	/// <summary>
+	/// Picks the version of the mesh to draw for a pass, based on how large the mesh's bounds are on screen
+	/// </summary>
+	/// <param name="modelView">The object's transform combined with the pass's view matrix</param>
+	/// <param name="projection">The pass's projection matrix</param>
+	/// <param name="screenHeight">The height of the pass's render target, in pixels</param>
+	/// <param name="shadowPass">True to use the shadow LOD bias</param>
+	/// <returns>The mesh to draw, which may be one of the mesh resource's LODs</returns>
+	VertexArrayObject::Sptr SelectLod(const glm::mat4& modelView, const glm::mat4& projection, float screenHeight, bool shadowPass) const;
+
 	// Inherited from IComponent
 
 	virtual void RenderImGui() override;
@@ -54,6 +84,11 @@ protected:
 	Gameplay::MeshResource::Sptr _mesh;
 	// The object's material
 	Gameplay::Material::Sptr      _material;
+	// True if the object is drawn into the occlusion buffer
+	bool                          _isOccluder;
+	// The error that LODs are allowed in pixels, for the camera and for shadows
+	float                         _lodBias;
+	float                         _shadowLodBias;
 
 	// If we want to use MeshFactory, we can populate this list
 	std::vector<MeshBuilderParam> _meshBuilderParams;
@@ -13,10 +13,15 @@ ShadowCamera::ShadowCamera() :
 	Intensity(1.0f),
 	Range(100.0f),
 	_depthBuffer(nullptr),
+	_atlasRect(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)),
 	_projectionMask(nullptr),
 	_color(glm::vec4(1.0f)),
 	_bufferResolution(glm::ivec2(512)), 
-	_projectionMatrix(glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f))
+	_projectionMatrix(glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f)),
+	_keywordMask(0),
+	_keywordFlags(ShadowFlags::None),
+	_keywordProjection(false),
+	_keywordShader()
 { }
 
 ShadowCamera::~ShadowCamera() = default;
@@ -32,9 +37,6 @@ const glm::vec4& ShadowCamera::GetColor() const {
 void ShadowCamera::SetBufferResolution(const glm::ivec2& value) {
 	LOG_ASSERT(value.x * value.y > 0, "Buffer size must be > 0");
 	_bufferResolution = value;
-	if (_depthBuffer != nullptr) {
-		_depthBuffer->Resize(value);
-	}
 }
 
 const glm::ivec2& ShadowCamera::GetBufferResolution() const {
@@ -65,16 +67,40 @@ const Texture2D::Sptr& ShadowCamera::GetProjectionMask() const {
 	return _projectionMask;
 }
 
+std::vector<std::string> ShadowCamera::GetShaderKeywords() const {
+	std::vector<std::string> result;
+	// We can only project if we have a mask to sample
+	if (*(Flags & ShadowFlags::ProjectionEnabled) && _projectionMask != nullptr) {
+		result.push_back("SHADOW_PROJECTION");
+	}
+	// Wide PCF only changes the PCF kernel
+	if (*(Flags & ShadowFlags::PcfEnabled)) {
+		result.push_back("SHADOW_PCF");
+		if (*(Flags & ShadowFlags::WidePcfEnabled)) {
+			result.push_back("SHADOW_WIDE_PCF");
+		}
+	}
+	if (*(Flags & ShadowFlags::AttenuationEnabled)) {
+		result.push_back("SHADOW_ATTENUATION");
+	}
+	return result;
+}
+
+uint32_t ShadowCamera::GetShaderKeywordMask(const ShaderProgram::Sptr& shader) {
+	bool projection = _projectionMask != nullptr;
+	if (Flags != _keywordFlags || projection != _keywordProjection || _keywordShader.lock() != shader) {
+		_keywordMask       = shader->GetKeywordMask(GetShaderKeywords());
+		_keywordFlags      = Flags;
+		_keywordProjection = projection;
+		_keywordShader     = shader;
+	}
+	return _keywordMask;
+}
+
 void ShadowCamera::OnLoad()
 {
+	// Our depth buffer is a tile in the render layer's shadow atlas, which gets assigned when we're first rendered
 	LOG_ASSERT(_bufferResolution.x * _bufferResolution.y > 0, "Buffer size must be > 0");
-
-	FramebufferDescriptor desc;
-	desc.Width  = _bufferResolution.x;
-	desc.Height = _bufferResolution.y;
-	desc.RenderTargets[RenderTargetAttachment::Depth] = RenderTargetDescriptor(RenderTargetType::Depth32, true, true);
-
-	_depthBuffer = std::make_shared<Framebuffer>(desc);
 }
 
 nlohmann::json ShadowCamera::ToJson() const
@@ -113,6 +139,17 @@ const Framebuffer::Sptr& ShadowCamera::GetDepthBuffer() const
 	return _depthBuffer;
 }
 
+const glm::vec4& ShadowCamera::GetAtlasRect() const
+{
+	return _atlasRect;
+}
+
+void ShadowCamera::SetAtlasTile(const Framebuffer::Sptr& atlas, const glm::vec4& uvRect)
+{
+	_depthBuffer = atlas;
+	_atlasRect = uvRect;
+}
+
 void ShadowCamera::RenderImGui()
 {
 	ImGui::PushID(this);
@@ -175,7 +212,7 @@ void ShadowCamera::RenderImGui()
 			int width = ImGui::GetContentRegionAvailWidth();
 
 			ImGui::Columns(1);
-			ImGuiHelper::DrawLinearDepthTexture(depth, glm::ivec2(width, width), 0.1f, 100.0f);
+			ImGuiHelper::DrawLinearDepthTexture(depth, glm::ivec2(width, width), 0.1f, 100.0f, _atlasRect);
 		}
 	}
 
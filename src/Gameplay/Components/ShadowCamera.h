@@ -45,12 +45,14 @@ public:
 	const glm::vec4& GetColor() const;
 
 	/// <summary>
-	/// Resizes this light's depth buffer, both dimensions must be non-zero
+	/// Sets the maximum resolution of this light's tile in the shadow atlas, both dimensions must be non-zero. 
+	/// Tiles are square, so the larger dimension is used, and the actual size depends on how much of the 
+	/// screen the light covers
 	/// </summary>
 	/// <param name="value">The new size of the buffer, in pixels</param>
 	void SetBufferResolution(const glm::ivec2& value);
 	/// <summary>
-	/// Returns the resolution of this light's depth buffer in pixels
+	/// Returns the maximum resolution of this light's depth buffer in pixels
 	/// </summary>
 	const glm::ivec2& GetBufferResolution() const;
 
@@ -80,9 +82,31 @@ public:
 	const Texture2D::Sptr& GetProjectionMask() const;
 
 	/// <summary>
-	/// Gets the shadow camera's depth buffer that it renders to
+	/// Gets the keywords to define in shadow_composite.glsl for this light's flags, which select the shader variant
+	/// that the light is drawn with. Options that would have no effect are left out, so they share a variant
+	/// </summary>
+	std::vector<std::string> GetShaderKeywords() const;
+	/// <summary>
+	/// Gets the mask of this light's keywords in a shader, to pass to ShaderProgram::GetKeywordVariant. The mask is
+	/// cached, and only looked up again when the flags, projection mask or shader change
+	/// </summary>
+	/// <param name="shader">The shader to resolve the keywords in</param>
+	uint32_t GetShaderKeywordMask(const ShaderProgram::Sptr& shader);
+
+	/// <summary>
+	/// Gets the shadow atlas that this camera renders into, or nullptr if it has not been given a tile yet
 	/// </summary>
 	const Framebuffer::Sptr& GetDepthBuffer() const;
+	/// <summary>
+	/// Gets the region of the depth buffer that this camera renders into, as (offset.x, offset.y, scale.x, scale.y) in texture coordinates
+	/// </summary>
+	const glm::vec4& GetAtlasRect() const;
+	/// <summary>
+	/// Sets the shadow atlas and tile that this camera renders into, this is managed by the render layer
+	/// </summary>
+	/// <param name="atlas">The framebuffer for the shadow atlas</param>
+	/// <param name="uvRect">The region of the atlas for this camera, as (offset.x, offset.y, scale.x, scale.y) in texture coordinates</param>
+	void SetAtlasTile(const Framebuffer::Sptr& atlas, const glm::vec4& uvRect);
 
 	// Inherited from IComponent
 
@@ -93,14 +117,22 @@ public:
 	MAKE_TYPENAME(ShadowCamera);
 
 protected:
-	// Framebuffer we render into to get depth
+	// The shadow atlas we render into to get depth
 	Framebuffer::Sptr _depthBuffer;
+	// The region of the atlas that belongs to this camera
+	glm::vec4         _atlasRect;
 	// The image to project from this light
 	Texture2D::Sptr   _projectionMask;
 	// The color of the light
 	glm::vec4         _color;
-	// The resolution of _depthBuffer in pixels
+	// The maximum resolution of our atlas tile in pixels
 	glm::ivec2        _bufferResolution;
 	// The projection matrix of the light
 	glm::mat4         _projectionMatrix;
+
+	// The keyword mask we last resolved, and the state it was resolved for, see GetShaderKeywordMask
+	uint32_t            _keywordMask;
+	ShadowFlags         _keywordFlags;
+	bool                _keywordProjection;
+	ShaderProgram::Wptr _keywordShader;
 };
\ No newline at end of file
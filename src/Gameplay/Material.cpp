@@ -1,4 +1,5 @@
 #include "Gameplay/Material.h"
+#include <algorithm>
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Graphics/Textures/TextureCube.h"
@@ -7,27 +8,87 @@
 #include "Utils/ImGuiHelper.h"
 #include "Graphics/Textures/Texture1D.h"
 #include "Graphics/Textures/Texture3D.h"
+#include "Graphics/RenderState.h"
+
+namespace {
+	// The uniform block that packed parameters are read from, and the struct name they're set with (see Material.h)
+	const std::string PARAMETER_BLOCK  = "b_Material";
+	const std::string PARAMETER_PREFIX = "u_Material";
+
+	// The buffers that packed parameters are stored in are shared by all materials, and are released with the last material
+	UniformBufferPool::Wptr parameterPool;
+}
 
 namespace Gameplay {
 	Material::Material(const ShaderProgram::Sptr& shader) :
 		IResource(),
+		Masked(false),
 		_shader(shader),
-		_uniforms(std::unordered_map<std::string, UniformData>())
+		_uniforms(std::unordered_map<std::string, UniformData>()),
+		_uniformTable(),
+		_parent(nullptr),
+		_parameterData(),
+		_parameterPool(nullptr),
+		_parameterRange(),
+		_parametersDirty(false),
+		_parameterRevision(0),
+		_parentRevision(0),
+		_preparedShaders()
 	{
 		_PopulateUniforms();
+		_BuildParameterLayout();
 	}
 
 	Material::Material() :
 		IResource(),
+		Masked(false),
 		_shader(nullptr),
-		_uniforms(std::unordered_map<std::string, UniformData>())
+		_uniforms(std::unordered_map<std::string, UniformData>()),
+		_uniformTable(),
+		_parent(nullptr),
+		_parameterData(),
+		_parameterPool(nullptr),
+		_parameterRange(),
+		_parametersDirty(false),
+		_parameterRevision(0),
+		_parentRevision(0),
+		_preparedShaders()
 	{ }
 
+	Material::~Material() {
+		if (_parameterPool != nullptr) {
+			_parameterPool->Free(_parameterRange);
+		}
+	}
+
 	void Material::Set(const std::string& name, ShaderDataType type, const void* value, size_t arraySize)
 	{
 		// Try and find the matching uniform
-		UniformData& uniform = _GetUniform(name);
+		_SetUniform(_GetUniform(name), name.c_str(), type, value, arraySize);
+	}
+
+	void Material::Set(UniformHandle handle, ShaderDataType type, const void* value, size_t arraySize)
+	{
+		// All of the shader's uniforms are added when the material is created, so we can find them by hash alone
+		UniformData* uniform = _LookupUniform(handle.Hash);
 
+		// Instances only store their overrides, so the first time one of the parent's parameters is set we take it over
+		if (uniform == nullptr && _parent != nullptr) {
+			const UniformData* inherited = _parent->_LookupUniform(handle.Hash);
+			if (inherited != nullptr) {
+				uniform = &_GetUniform(inherited->Name);
+			}
+		}
+
+		if (uniform != nullptr) {
+			_SetUniform(*uniform, handle.Name, type, value, arraySize);
+		} else {
+			LOG_WARN("Failed to set parameter \"{}\" in material \"{}\", shader uniform not found", handle.Name, Name);
+		}
+	}
+
+	void Material::_SetUniform(UniformData& uniform, const char* name, ShaderDataType type, const void* value, size_t arraySize)
+	{
 		// We have a uniform, let's see if we can update it
 		if (uniform.Location != -2) {
 			// If it's a texture, we update TextureAsset so it adds to the ref count
@@ -48,6 +109,7 @@ namespace Gameplay {
 				else {
 					memcpy(uniform.Value, value, ShaderDataTypeSize(type));
 				}
+				_parametersDirty |= uniform.BlockOffset != -1;
 			}
 		}
 		// We couldn't find that uniform, log a warning
@@ -61,42 +123,134 @@ namespace Gameplay {
 	}
 
 	void Material::Apply() {
-		if (_shader != nullptr) {
-			// Skip the reserved # of texture slots
-			int textureSlot = 0;
-			
-			// Iterate over the uniforms map
-			for (auto&[name, data] : _uniforms) {
-				// The typecode is basically the underlying type of the uniform
-				// ex: float, matrix, texture, etc...
-				ShaderDataTypecode typeCode = GetShaderDataTypeCode(data.Type);
-
-				// If the uniform is a texture, we try and bind it, then move to the next slot
-				if (typeCode == ShaderDataTypecode::Texture) {
-					if (textureSlot >= MAX_TEXTURE_SLOTS) {
-						LOG_WARN("Ignoring material binding, exceeds allowed number of textures");
+		Apply(_shader);
+	}
+
+	void Material::Apply(const ShaderProgram::Sptr& shader) {
+		Apply(shader, nullptr);
+	}
+
+	void Material::Apply(const ShaderProgram::Sptr& shader, const Material* previous) {
+		if (shader != nullptr) {
+			// Instances use their parent's texture units and block layout, so the parent prepares the shader for both
+			Material* root = _parent != nullptr ? _parent.get() : this;
+			int parameterBinding = root->_PrepareShader(shader);
+
+			// Our packed parameters only need to be uploaded when they change, otherwise we just bind our range
+			const UniformBufferPool::Range& range = _UpdateParameters();
+			if (range.IsValid() && parameterBinding != -1) {
+				root->_parameterPool->Bind(range, parameterBinding);
+			}
+
+			// The shader's samplers already point at our texture units, so we only need to collect the texture for each unit.
+			// Instances start with their parent's textures, and replace the ones they override
+			GLuint textures[MAX_TEXTURE_SLOTS] = { 0 };
+			int textureCount = 0;
+			auto collectTextures = [&](const Material* material) {
+				for (const auto& [name, data] : material->_uniforms) {
+					if (data.IsTextureResource() && data.Location >= 0 && data.BindingSlot != -1) {
+						textures[data.BindingSlot] = data.TextureAsset != nullptr ? data.TextureAsset->GetHandle() : 0;
+						textureCount = std::max(textureCount, data.BindingSlot + 1);
 					}
-					else {
-						ITexture::Sptr texture = data.TextureAsset;
-						if (texture != nullptr) {
-							texture->Bind(textureSlot);
+				}
+			};
+			collectTextures(root);
+			if (_parent != nullptr) {
+				collectTextures(this);
+			}
+
+			// All our textures go out in a single call
+			if (textureCount > 0) {
+				RenderState::BindTextureUnits(0, textureCount, textures);
+			}
+
+			// Everything else is a plain ol' uniform that we send on it's own
+			if (previous != nullptr && previous != this && previous->GetRoot() == root) {
+				// The shader already has the parent's values, apart from the ones the previous instance overrode. We put
+				// those back (or replace them with our own), then send the rest of our overrides
+				bool previousIsInstance = previous->_parent != nullptr;
+				if (previousIsInstance) {
+					for (const auto& [name, data] : previous->_uniforms) {
+						const UniformData* value = _FindUniform(name);
+						if (data.IsPlainUniform() && value != nullptr) {
+							_SendUniform(shader, *value);
 						}
-						else {
-							ITexture::Unbind(textureSlot);
+					}
+				}
+				if (_parent != nullptr) {
+					for (const auto& [name, data] : _uniforms) {
+						if (data.IsPlainUniform() && !(previousIsInstance && previous->_uniforms.count(name))) {
+							_SendUniform(shader, data);
 						}
-						// Send the slot to the shader
-						_shader->SetUniform(data.Location, data.Type, &textureSlot);
-						textureSlot++;
 					}
 				}
-				// The uniform is a plain ol' value type, send it in
-				else {
-					_shader->SetUniform(data.Location, data.Type, data.ArraySize > 1 ? data.ArrayBlock : data.Value, data.ArraySize);
+			} else {
+				if (_parent != nullptr) {
+					for (const auto& [name, data] : _parent->_uniforms) {
+						if (data.IsPlainUniform() && _uniforms.find(name) == _uniforms.end()) {
+							_SendUniform(shader, data);
+						}
+					}
+				}
+				for (const auto& [name, data] : _uniforms) {
+					if (data.IsPlainUniform()) {
+						_SendUniform(shader, data);
+					}
 				}
 			}
 		}
 	}
 
+	void Material::_SendUniform(const ShaderProgram::Sptr& shader, const UniformData& data) const {
+		// If we're not applying to our own shader, our cached locations won't be valid
+		int location = shader != _shader ? shader->GetUniformLocation(data.Hash) : data.Location;
+		shader->SetUniform(location, data.Type, data.ArraySize > 1 ? data.ArrayBlock : data.Value, data.ArraySize);
+	}
+
+	const Material::UniformData* Material::_FindUniform(const std::string& name) const {
+		auto it = _uniforms.find(name);
+		if (it != _uniforms.end()) {
+			return &it->second;
+		}
+		return _parent != nullptr ? _parent->_FindUniform(name) : nullptr;
+	}
+
+	const UniformBufferPool::Range& Material::_UpdateParameters() {
+		if (_parent != nullptr) {
+			// Our packed data is built on top of the parent's, so that needs to be up to date first
+			const UniformBufferPool::Range& parentRange = _parent->_UpdateParameters();
+
+			// Until we override a packed parameter, we can share the parent's range
+			if (!_parameterRange.IsValid()) {
+				bool overridesParameters = std::any_of(_uniforms.begin(), _uniforms.end(), [](const auto& pair) {
+					return pair.second.BlockOffset != -1;
+				});
+				if (!overridesParameters || !parentRange.IsValid()) {
+					_parametersDirty = false;
+					return parentRange;
+				}
+				_parameterPool = _parent->_parameterPool;
+				_parameterRange = _parameterPool->Allocate(static_cast<uint32_t>(_parent->_parameterData.size()));
+				_parametersDirty = true;
+			}
+
+			// Start again from the parent's data whenever either of us changes
+			if (_parametersDirty || _parentRevision != _parent->_parameterRevision) {
+				_parameterData = _parent->_parameterData;
+				_parentRevision = _parent->_parameterRevision;
+				_parametersDirty = true;
+			}
+		}
+
+		if (_parametersDirty && _parameterRange.IsValid()) {
+			_PackParameters();
+			_parameterPool->Upload(_parameterRange, _parameterData.data(), static_cast<uint32_t>(_parameterData.size()));
+			_parameterRevision++;
+		}
+		_parametersDirty = false;
+		return _parameterRange;
+	}
+
 	void Material::RenderImGui() {
 		ImGui::PushID(this);
 
@@ -106,10 +260,29 @@ namespace Gameplay {
 
 		if (open) {
 			ImGui::Text("Shader: %s", _shader != nullptr ? _shader->GetDebugName().c_str() : "null");
+			if (_parent != nullptr) {
+				ImGui::Text("Instance of: %s", _parent->Name.c_str());
+			}
+			ImGui::Checkbox("Masked", &Masked);
 			// Draw all of our valid uniforms
 			for (auto&[key, value] : _uniforms) {
-				if (value.Location != -2 && value.Location != -1) {
-					value.RenderImGui();
+				if (value.Location != -2 && value.Location != -1 && value.RenderImGui()) {
+					_parametersDirty = true;
+				}
+			}
+
+			// Instances can take over any of the parameters they inherit
+			if (_parent != nullptr) {
+				for (const auto& [key, value] : _parent->_uniforms) {
+					if (value.Location >= 0 && _uniforms.find(key) == _uniforms.end()) {
+						ImGui::PushID(key.c_str());
+						if (ImGui::SmallButton("Override")) {
+							_GetUniform(key);
+						}
+						ImGui::SameLine();
+						ImGui::TextDisabled("%s", key.c_str());
+						ImGui::PopID();
+					}
 				}
 			}
 
@@ -126,13 +299,41 @@ namespace Gameplay {
 		return FromJson(ToJson());
 	}
 
+	Material::Sptr Material::CreateInstance(const Material::Sptr& parent)
+	{
+		LOG_ASSERT(parent != nullptr, "Cannot create an instance of a null material");
+		Material::Sptr result = ResourceManager::CreateAsset<Material>();
+		result->Name    = parent->Name + " (Instance)";
+		result->Masked  = parent->Masked;
+		result->_parent = parent->_parent != nullptr ? parent->_parent : parent;
+		result->_shader = parent->_shader;
+
+		// Instances of an instance start with the same overrides
+		if (parent->_parent != nullptr) {
+			result->_uniforms = parent->_uniforms;
+			result->_BuildUniformTable();
+			result->_parametersDirty = true;
+		}
+		return result;
+	}
+
 	Material::Sptr Material::FromJson(const nlohmann::json& data) {
 		// Load in basic material info like shader and name
 		Material::Sptr result = std::make_shared<Material>();
 		result->OverrideGUID(Guid(data["guid"]));
 		result->Name = data["name"].get<std::string>();
-		result->_shader = ResourceManager::Get<ShaderProgram>(Guid(data["shader"]));
-		result->_PopulateUniforms();
+		result->Masked = JsonGet(data, "masked", false);
+
+		// Instances get their shader and uniforms from their parent, and only store their overrides
+		if (data.contains("parent")) {
+			result->_parent = ResourceManager::Get<Material>(Guid(data["parent"]));
+		}
+		if (result->_parent != nullptr) {
+			result->_shader = result->_parent->_shader;
+		} else {
+			result->_shader = ResourceManager::Get<ShaderProgram>(Guid(data["shader"]));
+			result->_PopulateUniforms();
+		}
 
 		// material specific parameters'
 		if (data.contains("parameters") && data["parameters"].is_object()) {
@@ -141,10 +342,22 @@ namespace Gameplay {
 				// Try loading a uniform from the blob, if successful, store it
 				Material::UniformData uniform = Material::UniformData::FromJson(value, key, result->_shader);
 				if (uniform.Location != -2) {
+					// Instances need to use the same texture units as their parent
+					if (result->_parent != nullptr) {
+						uniform.BindingSlot = result->_parent->_GetUniform(key).BindingSlot;
+					}
 					result->_uniforms[key] = uniform;
 				}
 			}
 		}
+
+		// Parameters we loaded may have replaced the uniforms that were in the table
+		result->_BuildUniformTable();
+		if (result->_parent != nullptr) {
+			result->_parametersDirty = true;
+		} else {
+			result->_BuildParameterLayout();
+		}
 		return result;
 	}
 
@@ -152,9 +365,13 @@ namespace Gameplay {
 		nlohmann::json result ={
 			{ "guid", GetGUID().str() },
 			{ "name", Name },
+			{ "masked", Masked },
 			{ "shader", _shader ? _shader->GetGUID().str() : "null" },
 			{ "parameters", nlohmann::json() }
 		};
+		if (_parent != nullptr) {
+			result["parent"] = _parent->GetGUID().str();
+		}
 
 		// Store all the uniforms
 		for (auto& [key, value] : _uniforms) {
@@ -168,10 +385,16 @@ namespace Gameplay {
 
 	Material::UniformData& Material::_GetUniform(const std::string& name)
 	{
-		UniformData& data = _uniforms[name];
-		if (data.Location == -2) {
+		auto [it, added] = _uniforms.try_emplace(name);
+		UniformData& data = it->second;
+		// Instances start from the parent's uniform, so it has the parent's layout, texture unit and value
+		if (data.Location == -2 && _parent != nullptr) {
+			data = _parent->_GetUniform(name);
+		}
+		else if (data.Location == -2) {
 			ShaderProgram::UniformInfo uniform;
-			if (_shader->FindUniform(name, &uniform)) {
+			bool blockMember = false;
+			if (_FindParameter(_shader, name, &uniform, &blockMember)) {
 				// Ignoring our reserved textures
 				if (GetShaderDataTypeCode(uniform.Type) == ShaderDataTypecode::Texture && uniform.Binding >= MAX_TEXTURE_SLOTS) {
 					data.Location = -1;
@@ -183,15 +406,216 @@ namespace Gameplay {
 				data.Location = -1;
 			}
 		}
+		if (added) {
+			_AddUniformSlot(data);
+		}
 		return data;
 	}
 
+	Material::UniformData* Material::_LookupUniform(uint32_t nameHash) const
+	{
+		auto it = std::lower_bound(_uniformTable.begin(), _uniformTable.end(), nameHash, [](const UniformSlot& slot, uint32_t hash) {
+			return slot.Hash < hash;
+		});
+		return it != _uniformTable.end() && it->Hash == nameHash ? it->Data : nullptr;
+	}
+
+	void Material::_AddUniformSlot(UniformData& uniform)
+	{
+		// Uniforms the shader doesn't have are never hashed, so there's nothing to find them by
+		if (uniform.Location < 0) {
+			return;
+		}
+		auto it = std::lower_bound(_uniformTable.begin(), _uniformTable.end(), uniform.Hash, [](const UniformSlot& slot, uint32_t hash) {
+			return slot.Hash < hash;
+		});
+		if (it != _uniformTable.end() && it->Hash == uniform.Hash) {
+			it->Data = &uniform;
+		} else {
+			_uniformTable.insert(it, { uniform.Hash, &uniform });
+		}
+	}
+
+	void Material::_BuildUniformTable()
+	{
+		_uniformTable.clear();
+		_uniformTable.reserve(_uniforms.size());
+		for (auto& [name, data] : _uniforms) {
+			_AddUniformSlot(data);
+		}
+	}
+
 	void Material::_PopulateUniforms()
 	{
 		const auto& uniforms = _shader->GetUniforms();
 		for (const auto& [key, value] : uniforms) {
 			_uniforms[key] = _GetUniform(key);
 		}
+
+		// Add the parameters in the b_Material block, using their u_Material names
+		const ShaderProgram::UniformBlockInfo* block = _shader->GetUniformBlock(PARAMETER_BLOCK);
+		if (block != nullptr) {
+			for (const auto& member : block->SubUniforms) {
+				std::string key = PARAMETER_PREFIX + member.Name.substr(PARAMETER_BLOCK.size());
+				_uniforms[key] = _GetUniform(key);
+			}
+		}
+	}
+
+	void Material::_BuildParameterLayout()
+	{
+		// Textures get units in order of their names, so that every material with the same shader picks the same
+		// units, and the shader's samplers never need to change between materials
+		std::vector<UniformData*> textures;
+		for (auto& [name, data] : _uniforms) {
+			if (data.IsTextureResource() && data.Location >= 0) {
+				textures.push_back(&data);
+			}
+		}
+		std::sort(textures.begin(), textures.end(), [](const UniformData* a, const UniformData* b) {
+			return a->Name < b->Name;
+		});
+		for (size_t ix = 0; ix < textures.size(); ix++) {
+			if (ix < MAX_TEXTURE_SLOTS) {
+				textures[ix]->BindingSlot = static_cast<int>(ix);
+			} else {
+				LOG_WARN("Ignoring texture \"{}\" in material \"{}\", exceeds allowed number of textures", textures[ix]->Name, Name);
+				textures[ix]->BindingSlot = -1;
+			}
+		}
+		_preparedShaders.clear();
+
+		// Reserve space in the shared buffers for our packed parameters
+		const ShaderProgram::UniformBlockInfo* block = _shader->GetUniformBlock(PARAMETER_BLOCK);
+		if (block != nullptr) {
+			if (_parameterPool == nullptr) {
+				_parameterPool = parameterPool.lock();
+				if (_parameterPool == nullptr) {
+					_parameterPool = std::make_shared<UniformBufferPool>();
+					parameterPool = _parameterPool;
+				}
+			}
+			_parameterPool->Free(_parameterRange);
+			_parameterRange = _parameterPool->Allocate(block->SizeInBytes);
+			_parameterData.assign(block->SizeInBytes, 0);
+			_parametersDirty = true;
+		}
+	}
+
+	void Material::_PackParameters()
+	{
+		for (const auto& [name, data] : _uniforms) {
+			if (data.BlockOffset == -1) {
+				continue;
+			}
+
+			ShaderDataTypecode typeCode = GetShaderDataTypeCode(data.Type);
+			const uint8_t* source = data.ArraySize > 1 ? reinterpret_cast<const uint8_t*>(data.ArrayBlock) : data.Value;
+			uint32_t elementSize = ShaderDataTypeSize(data.Type);
+
+			// Matrices are stored a column at a time, and std140 pads each column out to a vec4
+			uint32_t columns = 1;
+			if (typeCode == ShaderDataTypecode::Matrix || typeCode == ShaderDataTypecode::MatrixD) {
+				columns = ((uint32_t)data.Type & ShaderDataType_Size2Mask) >> 3;
+			}
+			uint32_t columnSize = elementSize / columns;
+
+			for (size_t ix = 0; ix < data.ArraySize; ix++) {
+				uint8_t* dest = _parameterData.data() + data.BlockOffset + ix * data.ArrayStride;
+				const uint8_t* element = source + ix * elementSize;
+
+				// Bools are a single byte for us, but take up 4 bytes each in a uniform block
+				if (typeCode == ShaderDataTypecode::Bool) {
+					for (uint32_t component = 0; component < elementSize; component++) {
+						uint32_t value = element[component] ? 1 : 0;
+						memcpy(dest + component * sizeof(uint32_t), &value, sizeof(uint32_t));
+					}
+				} else {
+					for (uint32_t column = 0; column < columns; column++) {
+						memcpy(dest + column * data.MatrixStride, element + column * columnSize, columnSize);
+					}
+				}
+			}
+		}
+	}
+
+	int Material::_PrepareShader(const ShaderProgram::Sptr& shader)
+	{
+		// Look for the shader in the ones we've already prepared, dropping any that have been deleted
+		for (auto it = _preparedShaders.begin(); it != _preparedShaders.end();) {
+			ShaderProgram::Sptr prepared = it->Shader.lock();
+			if (prepared == nullptr) {
+				it = _preparedShaders.erase(it);
+				continue;
+			}
+			if (prepared == shader) {
+				return it->ParameterBinding;
+			}
+			it++;
+		}
+
+		// Point the shader's samplers at our texture units
+		bool remapLocations = shader != _shader;
+		for (auto& [name, data] : _uniforms) {
+			if (data.IsTextureResource() && data.Location >= 0 && data.BindingSlot != -1) {
+				int location = remapLocations ? shader->GetUniformLocation(data.Hash) : data.Location;
+				shader->SetUniform(location, data.Type, &data.BindingSlot);
+			}
+		}
+
+		PreparedShader result;
+		result.Shader = shader;
+		result.ParameterBinding = -1;
+
+		// Other shaders (ex: depth variants) can read from our buffer, as long as every member they declare is where we packed it
+		const ShaderProgram::UniformBlockInfo* block = shader->GetUniformBlock(PARAMETER_BLOCK);
+		if (block != nullptr && _parameterRange.IsValid()) {
+			const ShaderProgram::UniformBlockInfo* layout = _shader->GetUniformBlock(PARAMETER_BLOCK);
+			bool compatible = true;
+			for (const auto& member : block->SubUniforms) {
+				auto it = std::find_if(layout->SubUniforms.begin(), layout->SubUniforms.end(), [&](const ShaderProgram::UniformInfo& other) {
+					return other.Name == member.Name;
+				});
+				if (it == layout->SubUniforms.end() || it->Location != member.Location || it->Type != member.Type || it->ArraySize != member.ArraySize) {
+					compatible = false;
+					break;
+				}
+			}
+
+			if (compatible) {
+				result.ParameterBinding = block->CurrentBinding;
+			} else {
+				LOG_WARN("Shader \"{}\" lays out {} differently than \"{}\", parameters of material \"{}\" will not be applied to it",
+					shader->GetDebugName(), PARAMETER_BLOCK, _shader->GetDebugName(), Name);
+			}
+		}
+
+		_preparedShaders.push_back(result);
+		return result.ParameterBinding;
+	}
+
+	bool Material::_FindParameter(const ShaderProgram::Sptr& shader, const std::string& name, ShaderProgram::UniformInfo* out, bool* blockMember)
+	{
+		*blockMember = false;
+		if (shader->FindUniform(name, out)) {
+			return true;
+		}
+
+		// Members of the block are set as if they were members of u_Material (ex: u_Material.Shininess -> b_Material.Shininess)
+		if (name.size() > PARAMETER_PREFIX.size() && name.compare(0, PARAMETER_PREFIX.size(), PARAMETER_PREFIX) == 0 && name[PARAMETER_PREFIX.size()] == '.') {
+			const ShaderProgram::UniformBlockInfo* block = shader->GetUniformBlock(PARAMETER_BLOCK);
+			if (block != nullptr) {
+				std::string memberName = PARAMETER_BLOCK + name.substr(PARAMETER_PREFIX.size());
+				for (const auto& member : block->SubUniforms) {
+					if (member.Name == memberName) {
+						*out = member;
+						*blockMember = true;
+						return true;
+					}
+				}
+			}
+		}
+		return false;
 	}
 
 	bool Material::UniformData::RenderImGui() {
@@ -302,6 +726,7 @@ namespace Gameplay {
 						Texture2D::Sptr tex = std::dynamic_pointer_cast<Texture2D>(TextureAsset);
 						if (ImGuiHelper::DrawTextureDrop(tex, ImVec2(ImGui::GetTextLineHeight() * 2, ImGui::GetTextLineHeight() * 2))) {
 							TextureAsset = tex;
+							modified = true;
 						}
 					}
 						break;
@@ -400,12 +825,21 @@ namespace Gameplay {
 	{
 		// We extract the uniform info from the shader to populate our info
 		ShaderProgram::UniformInfo uniform;
-		if (shader != nullptr && shader->FindUniform(uniformName, &uniform)) {
+		bool blockMember = false;
+		if (shader != nullptr && Material::_FindParameter(shader, uniformName, &uniform, &blockMember)) {
 			Name = uniformName;
+			Hash = UniformHandle::HashName(uniformName);
 			Location = uniform.Location;
 			Type = uniform.Type;
 			ArraySize = uniform.ArraySize;
 			BindingSlot = uniform.Binding;
+
+			// For block members, the location is the offset within the block
+			if (blockMember) {
+				BlockOffset = uniform.Location;
+				ArrayStride = uniform.ArrayStride;
+				MatrixStride = uniform.MatrixStride;
+			}
 			
 			// Allocate memory for array if the uniform is an array
 			if (ArraySize > 1) {
@@ -418,8 +852,13 @@ namespace Gameplay {
 		TextureAsset(nullptr) 
 	{
 		Name = other.Name;
+		Hash = other.Hash;
 		Location = other.Location;
 		ArraySize = other.ArraySize;
+		BindingSlot = other.BindingSlot;
+		BlockOffset = other.BlockOffset;
+		ArrayStride = other.ArrayStride;
+		MatrixStride = other.MatrixStride;
 		Type = other.Type;
 
 		if (GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture) {
@@ -437,10 +876,15 @@ namespace Gameplay {
 	Material::UniformData::UniformData(UniformData&& other) :
 		TextureAsset(nullptr) 
 	{
-		Name      = other.Name;
-		Location  = other.Location;
-		ArraySize = other.ArraySize;
-		Type      = other.Type;
+		Name         = other.Name;
+		Hash         = other.Hash;
+		Location     = other.Location;
+		ArraySize    = other.ArraySize;
+		BindingSlot  = other.BindingSlot;
+		BlockOffset  = other.BlockOffset;
+		ArrayStride  = other.ArrayStride;
+		MatrixStride = other.MatrixStride;
+		Type         = other.Type;
 
 		if (GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture) {
 			TextureAsset = other.TextureAsset;
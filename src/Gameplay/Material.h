@@ -2,11 +2,20 @@
 #include <memory>
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/Textures/ITexture.h"
+#include "Graphics/Buffers/UniformBufferPool.h"
 
 namespace Gameplay {
 	/// <summary>
 	/// Helper structure for material parameters to our shader
 	/// THIS IS VERY TEMPORARY
+	///
+	/// If the shader declares a std140 uniform block named b_Material, the members of that block are packed into a
+	/// range of a shared uniform buffer, which is only re-uploaded after a parameter changes. They are named as if
+	/// they were members of u_Material (ex: b_Material.Shininess is set as "u_Material.Shininess"), so parameters keep
+	/// the same names whether they are packed or not. Textures are given fixed units, and are bound with a single call
+	///
+	/// A material can also be an instance of another material (see CreateInstance). Instances share their parent's
+	/// shader, textures and parameters, and only store the parameters that have been set on them
 	/// </summary>
 	class Material : public IResource {
 	public:
@@ -23,6 +32,14 @@ namespace Gameplay {
 		/// A human readable name for the material
 		/// </summary>
 		std::string     Name;
+		/// <summary>
+		/// True if the material cuts out parts of its mesh with an alpha test, or moves its
+		/// vertices (ex: foliage, displacement mapping). Masked materials need their own shaders for
+		/// depth-only passes, and are kept out of the visibility buffer, all other materials share a
+		/// single position-only shader. Any material whose vertex stage displaces or animates its
+		/// vertices must set this, otherwise those passes will draw it with the wrong geometry
+		/// </summary>
+		bool            Masked;
 
 		/// <summary>
 		/// Default constructor, to be used by Resource manager and smart pointers only
@@ -33,6 +50,7 @@ namespace Gameplay {
 		/// </summary>
 		/// <param name="shader">The shader for the material</param>
 		Material(const ShaderProgram::Sptr& shader);
+		virtual ~Material();
 
 		/// <summary>
 		/// Sets a material parameter with the given name and type
@@ -55,6 +73,20 @@ namespace Gameplay {
 		/// <param name="arraySize">The array size in the event that the value is an array</param>
 		void Set(const std::string& name, ShaderDataType type, const void* value, size_t arraySize = 1ul);
 
+		/// <summary>
+		/// Sets a material parameter by handle, this avoids allocating or hashing the name, so it should be
+		/// preferred for parameters that are updated every frame
+		/// </summary>
+		/// <typeparam name="T">The type of parameter to set</typeparam>
+		/// <param name="handle">The handle of the uniform to set</param>
+		/// <param name="value">The value to set the parameter to</param>
+		template <typename T>
+		void Set(UniformHandle handle, const T& value) {
+			ShaderDataType type = GetShaderDataType<T>();
+			Set(handle, type, &value, 1);
+		}
+		void Set(UniformHandle handle, ShaderDataType type, const void* value, size_t arraySize = 1ul);
+
 		/// <summary>
 		/// Gets the shader that this material is using
 		/// </summary>
@@ -65,6 +97,21 @@ namespace Gameplay {
 		/// Will bind the shader, update material uniforms, and bind textures
 		/// </summary>
 		virtual void Apply();
+		/// <summary>
+		/// Applies this material's state to a different shader than the one it was created with,
+		/// such as an instanced variant of the material's shader. Uniform locations are looked
+		/// up by name, so this is slower than Apply()
+		/// </summary>
+		/// <param name="shader">The shader to apply the material's uniforms to</param>
+		void Apply(const ShaderProgram::Sptr& shader);
+		/// <summary>
+		/// Applies this material's state to a shader, where previous was the last material applied to the
+		/// same shader. If both materials share a parent, only the uniforms that either of them override
+		/// are sent, since the shader already has the rest
+		/// </summary>
+		/// <param name="shader">The shader to apply the material's uniforms to</param>
+		/// <param name="previous">The last material applied to the shader, or nullptr if unknown</param>
+		void Apply(const ShaderProgram::Sptr& shader, const Material* previous);
 
 		/// <summary>
 		/// Renders some UI controls for manipulating a material at runtime
@@ -73,10 +120,27 @@ namespace Gameplay {
 
 		/// <summary>
 		/// Creates a clone of this material, useful for cases where you have many similar 
-		/// materials with slight variations
+		/// materials with slight variations. See also CreateInstance
 		/// </summary>
 		Material::Sptr Clone() const;
 
+		/// <summary>
+		/// Creates a new material that inherits everything from a parent material, and only stores
+		/// the parameters that are set on it afterwards (ex: a tinted variant of a shared material).
+		/// Instances of an instance are created from the same parent, and copy its overrides
+		/// </summary>
+		/// <param name="parent">The material to inherit from</param>
+		static Material::Sptr CreateInstance(const Material::Sptr& parent);
+		/// <summary>
+		/// Gets the material that this material is an instance of, or nullptr if it's not an instance
+		/// </summary>
+		const Material::Sptr& GetParent() const { return _parent; }
+		/// <summary>
+		/// Gets the parent of this material if it's an instance, or otherwise the material itself. Draws
+		/// can be sorted by this, so that instances of the same parent are applied one after another
+		/// </summary>
+		const Material* GetRoot() const { return _parent != nullptr ? _parent.get() : this; }
+
 		/// <summary>
 		/// Loads a material from a JSON blob
 		/// </summary>
@@ -93,6 +157,8 @@ namespace Gameplay {
 		struct UniformData {
 			// The name of the uniform in the shader
 			std::string    Name;
+			// The hash of Name, used to look the uniform up without strings (see UniformHandle)
+			uint32_t       Hash = 0;
 			// Location of the uniform within the shader
 			int            Location = -2;
 			union {
@@ -107,7 +173,13 @@ namespace Gameplay {
 			};
 			// The size of the array, in elements
 			size_t         ArraySize;
+			// For textures, the texture unit that the material binds the texture to
 			int            BindingSlot;
+			// For members of the b_Material block, the offset of the value in the block and the strides
+			// of arrays and matrix columns. BlockOffset is -1 for uniforms that are set individually
+			int            BlockOffset = -1;
+			int            ArrayStride = 0;
+			int            MatrixStride = 0;
 
 			// The type of uniform
 			ShaderDataType Type = ShaderDataType::None;
@@ -164,6 +236,12 @@ namespace Gameplay {
 			inline bool IsTextureResource() const {
 				return GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture;
 			}
+			/// <summary>
+			/// Returns true if the uniform is sent to the shader on it's own, rather than being a texture or a packed parameter
+			/// </summary>
+			inline bool IsPlainUniform() const {
+				return Location >= 0 && BlockOffset == -1 && !IsTextureResource();
+			}
 		};
 	
 		/// <summary>
@@ -171,11 +249,103 @@ namespace Gameplay {
 		/// </summary>
 		ShaderProgram::Sptr    _shader;
 		/// <summary>
-		/// The uniforms that the material will be modifying
+		/// The uniforms that the material will be modifying, for instances this only holds the overridden uniforms
 		/// </summary>
 		std::unordered_map<std::string, UniformData> _uniforms;
+		/// <summary>
+		/// Our uniforms sorted by name hash, so that handles can find them without touching strings. Elements of
+		/// _uniforms don't move once they're added, so this only needs to be rebuilt when the whole map is replaced
+		/// </summary>
+		struct UniformSlot {
+			uint32_t     Hash;
+			UniformData* Data;
+		};
+		std::vector<UniformSlot> _uniformTable;
+		/// <summary>
+		/// The material that this material is an instance of, or nullptr
+		/// </summary>
+		Material::Sptr         _parent;
+
+		/// <summary>
+		/// The packed contents of the shader's b_Material block, and the range of the shared buffer they're uploaded to.
+		/// Both are empty if the shader does not have the block
+		/// </summary>
+		std::vector<uint8_t>       _parameterData;
+		UniformBufferPool::Sptr    _parameterPool;
+		UniformBufferPool::Range   _parameterRange;
+		// True if a parameter has changed since _parameterData was last uploaded
+		bool                       _parametersDirty;
+		// Incremented every time _parameterData is uploaded, so instances know when to re-pack on top of it
+		uint32_t                   _parameterRevision;
+		// For instances, the parent's revision that our packed data was built on
+		uint32_t                   _parentRevision;
+
+		/// <summary>
+		/// A shader that this material has been applied to, where the sampler uniforms have already been pointed at
+		/// our texture units. Samplers are assigned to units the same way for every material with the same shader,
+		/// so they never need to be set again
+		/// </summary>
+		struct PreparedShader {
+			ShaderProgram::Wptr Shader;
+			// The slot to bind our parameters to, or -1 if the shader can't read them from our buffer
+			int                 ParameterBinding;
+		};
+		std::vector<PreparedShader> _preparedShaders;
 
 		UniformData& _GetUniform(const std::string& name);
+		/// <summary>
+		/// Finds one of the uniforms stored by this material from the hash of its name, without checking the parent
+		/// </summary>
+		/// <returns>The uniform, or nullptr if this material doesn't store it</returns>
+		UniformData* _LookupUniform(uint32_t nameHash) const;
+		/// <summary>
+		/// Adds a uniform to our table of uniforms by hash, see _LookupUniform
+		/// </summary>
+		void _AddUniformSlot(UniformData& uniform);
+		/// <summary>
+		/// Rebuilds our table of uniforms by hash from scratch, for when _uniforms has been replaced
+		/// </summary>
+		void _BuildUniformTable();
+		/// <summary>
+		/// Copies a new value into one of our uniforms
+		/// </summary>
+		void _SetUniform(UniformData& uniform, const char* name, ShaderDataType type, const void* value, size_t arraySize);
 		void _PopulateUniforms();
+		/// <summary>
+		/// Assigns texture units to our textures, and allocates space for our packed parameters. Should be called
+		/// once all of the uniforms have been populated
+		/// </summary>
+		void _BuildParameterLayout();
+		/// <summary>
+		/// Copies the parameters in the b_Material block into _parameterData, with the layout from the shader
+		/// </summary>
+		void _PackParameters();
+		/// <summary>
+		/// Uploads our packed parameters if they have changed. Instances only get their own range once they override
+		/// a packed parameter, until then they use their parent's
+		/// </summary>
+		/// <returns>The range to bind for this material, which may be invalid if the shader has no b_Material block</returns>
+		const UniformBufferPool::Range& _UpdateParameters();
+		/// <summary>
+		/// Sends a uniform that is not a texture or packed parameter to the shader
+		/// </summary>
+		void _SendUniform(const ShaderProgram::Sptr& shader, const UniformData& data) const;
+		/// <summary>
+		/// Finds the value of a uniform for this material, either overridden by this material or inherited from the parent
+		/// </summary>
+		/// <returns>The uniform, or nullptr if the material and parent don't have it</returns>
+		const UniformData* _FindUniform(const std::string& name) const;
+		/// <summary>
+		/// Points a shader's samplers at our texture units the first time we're applied to it, and checks if it
+		/// can read our packed parameters
+		/// </summary>
+		/// <returns>The uniform buffer slot to bind our parameters to, or -1 if they should not be bound</returns>
+		int _PrepareShader(const ShaderProgram::Sptr& shader);
+
+		/// <summary>
+		/// Finds a parameter in a shader, either as a uniform or as a member of the b_Material block
+		/// </summary>
+		/// <param name="blockMember">Set to true if the parameter is in the b_Material block</param>
+		static bool _FindParameter(const ShaderProgram::Sptr& shader, const std::string& name, ShaderProgram::UniformInfo* out, bool* blockMember);
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <filesystem>
 
 #include "Utils/ObjLoader.h"
+#include "Utils/OptimizedObjLoader.h"
 
 namespace Gameplay {
 	MeshResource::MeshResource() :
@@ -9,7 +10,11 @@ namespace Gameplay {
 		Filename(""),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		Lods(),
+		LocalBounds(),
+		BulletTriMesh(nullptr),
+		_occluderMesh(nullptr),
+		_occluderSource(nullptr)
 	{ }
 
 	MeshResource::MeshResource(const std::string& filename) :
@@ -17,9 +22,15 @@ namespace Gameplay {
 		Filename(filename),
 		MeshBuilderParams(std::vector<MeshBuilderParam>()),
 		Mesh(nullptr),
-		BulletTriMesh(nullptr)
+		Lods(),
+		LocalBounds(),
+		BulletTriMesh(nullptr),
+		_occluderMesh(nullptr),
+		_occluderSource(nullptr)
 	{
 		Mesh = ObjLoader::LoadFromFile(filename);
+		CalculateBounds();
+		GenerateLods();
 	}
 
 	MeshResource::~MeshResource() = default;
@@ -52,14 +63,19 @@ namespace Gameplay {
 			}
 			MeshFactory::CalculateTBN(mesh);
 			result->Mesh = mesh.Bake();
+			result->Lods = MeshSimplifier::CreateLods(MeshSimplifier::GenerateLods(mesh), VertexPosNormTexColTangents::V_DECL, sizeof(VertexPosNormTexColTangents));
+			result->LocalBounds = _CalculateBounds(mesh);
 		} else {
 			result->Filename = JsonGet<std::string>(blob, "filename", "null");
 			if (result->Filename != "null" && std::filesystem::exists(result->Filename)) {
+				// The optimized loader stores the LODs in its binary file, otherwise we have to generate them every time we load
 				#ifdef OPTIMIZED_OBJ_LOADER
-				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename);
+				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename, &result->Lods);
 				#else
 				result->Mesh = ObjLoader::LoadFromFile(result->Filename);
+				result->GenerateLods();
 				#endif
+				result->CalculateBounds();
 
 			}
 		}
@@ -73,9 +89,47 @@ namespace Gameplay {
 		}
 		MeshFactory::CalculateTBN(mesh);
 		Mesh = mesh.Bake();
+		Lods = MeshSimplifier::CreateLods(MeshSimplifier::GenerateLods(mesh), VertexPosNormTexColTangents::V_DECL, sizeof(VertexPosNormTexColTangents));
+		LocalBounds = _CalculateBounds(mesh);
 	}
 
 	void MeshResource::AddParam(const MeshBuilderParam & param) {
 		MeshBuilderParams.push_back(param);
 	}
+
+	void MeshResource::CalculateBounds() {
+		LocalBounds = Bounds::FromVertexArray(Mesh);
+	}
+
+	void MeshResource::GenerateLods() {
+		Lods = MeshSimplifier::FromVertexArray(Mesh);
+	}
+
+	const VertexArrayObject::Sptr& MeshResource::SelectLod(float pixelsPerUnit, float maxError) const {
+		// LODs get coarser as we go, so we want the last one that's still within our budget
+		for (auto it = Lods.rbegin(); it != Lods.rend(); it++) {
+			if (it->Error * pixelsPerUnit <= maxError) {
+				return it->Mesh;
+			}
+		}
+		return Mesh;
+	}
+
+	const OccluderMesh::Sptr& MeshResource::GetOccluderMesh() {
+		if (_occluderSource != Mesh.get()) {
+			_occluderSource = Mesh.get();
+			_occluderMesh = OccluderMesh::FromVertexArray(Mesh);
+		}
+		return _occluderMesh;
+	}
+
+	Bounds MeshResource::_CalculateBounds(const MeshBuilder<VertexPosNormTexColTangents>& mesh) {
+		// We still have the vertices on the CPU, so there's no need to read them back from OpenGL
+		return Bounds::FromPositions(
+			reinterpret_cast<const uint8_t*>(mesh.GetVertexDataPtr()),
+			mesh.GetVertexCount(),
+			sizeof(VertexPosNormTexColTangents),
+			offsetof(VertexPosNormTexColTangents, Position)
+		);
+	}
 }
\ No newline at end of file
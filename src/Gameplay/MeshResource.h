@@ -2,6 +2,9 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Utils/MeshFactory.h"
+#include "Utils/MeshSimplifier.h"
+#include "Graphics/Bounds.h"
+#include "Graphics/OcclusionBuffer.h"
 
 // bullet triangle mesh pre-declaration
 class btTriangleMesh;
@@ -40,7 +43,15 @@ namespace Gameplay {
 		/// The VAO for rendering this mesh in OpenGL
 		/// </summary>
 		VertexArrayObject::Sptr         Mesh;
-
+		/// <summary>
+		/// Lower detail versions of the mesh, from most to least detailed. These are generated when the mesh
+		/// is loaded or generated, and may be empty for simple meshes
+		/// </summary>
+		std::vector<MeshLod>            Lods;
+		/// <summary>
+		/// The local space bounds of the mesh, calculated when the mesh is loaded or generated
+		/// </summary>
+		Bounds                          LocalBounds;
 
 		/// <summary>
 		/// The optional mesh resource for generating colliders from this mesh
@@ -60,10 +71,43 @@ namespace Gameplay {
 		/// </summary>
 		/// <param name="param">The parameter to add</param>
 		void AddParam(const MeshBuilderParam& param);
+		/// <summary>
+		/// Re-calculates the local bounds of the mesh from the VAO's position data. Should be
+		/// called if the Mesh is replaced after the resource has been loaded
+		/// </summary>
+		void CalculateBounds();
+		/// <summary>
+		/// Re-generates the LOD chain from the VAO's data. Should be called if the Mesh is replaced after the
+		/// resource has been loaded
+		/// </summary>
+		void GenerateLods();
+		/// <summary>
+		/// Picks the least detailed version of the mesh whose error stays within the given budget
+		/// </summary>
+		/// <param name="pixelsPerUnit">How many pixels one unit of the mesh's local space covers on screen</param>
+		/// <param name="maxError">The largest error that is allowed, in pixels</param>
+		/// <returns>One of the LODs, or the full detail mesh if none of them are close enough</returns>
+		const VertexArrayObject::Sptr& SelectLod(float pixelsPerUnit, float maxError) const;
+		/// <summary>
+		/// Gets the CPU side triangles of the mesh, for drawing it into an occlusion buffer. These are read back
+		/// from the VAO the first time they're needed, or when the VAO has been replaced
+		/// </summary>
+		/// <returns>The occluder geometry, or nullptr if the mesh can't be used as an occluder</returns>
+		const OccluderMesh::Sptr& GetOccluderMesh();
 
 		// Inherited from IResource
 
 		virtual nlohmann::json ToJson() const override;
 		static MeshResource::Sptr FromJson(const nlohmann::json& blob);
+
+	protected:
+		OccluderMesh::Sptr       _occluderMesh;
+		// The VAO that the occluder mesh was read from
+		const VertexArrayObject* _occluderSource;
+
+		/// <summary>
+		/// Calculates bounds directly from a mesh builder's vertices
+		/// </summary>
+		static Bounds _CalculateBounds(const MeshBuilder<VertexPosNormTexColTangents>& mesh);
 	};
 }
\ No newline at end of file
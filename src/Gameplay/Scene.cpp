@@ -15,9 +15,13 @@
 #include "Graphics/DebugDraw.h"
 #include "Graphics/Textures/TextureCube.h"
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/RenderState.h"
 #include "Application/Application.h"
 
 namespace Gameplay {
+	static constexpr UniformHandle UNIFORM_CLIPPED_VIEW("u_ClippedView");
+	static constexpr UniformHandle UNIFORM_ENVIRONMENT_ROTATION("u_EnvironmentRotation");
+
 	Scene::Scene() :
 		_objects(std::vector<GameObject::Sptr>()),
 		_deletionQueue(std::vector<std::weak_ptr<GameObject>>()),
@@ -368,19 +372,19 @@ namespace Gameplay {
 			_skyboxTexture != nullptr &&
 			MainCamera != nullptr) {
 			
-			glDepthMask(false);
-			glDisable(GL_CULL_FACE);
-			glDepthFunc(GL_LEQUAL); 
+			RenderState::SetDepthMask(false);
+			RenderState::Disable(GL_CULL_FACE);
+			RenderState::SetDepthFunc(GL_LEQUAL); 
 
 			_skyboxShader->Bind();
-			_skyboxShader->SetUniformMatrix("u_ClippedView", MainCamera->GetProjection());
-			_skyboxShader->SetUniformMatrix("u_EnvironmentRotation", _skyboxRotation * glm::inverse(glm::mat3(MainCamera->GetView())));
+			_skyboxShader->SetUniformMatrix(UNIFORM_CLIPPED_VIEW, MainCamera->GetProjection());
+			_skyboxShader->SetUniformMatrix(UNIFORM_ENVIRONMENT_ROTATION, _skyboxRotation * glm::inverse(glm::mat3(MainCamera->GetView())));
 			_skyboxTexture->Bind(0);
 			_skyboxMesh->Mesh->Draw();
 
-			glDepthFunc(GL_LESS);
-			glEnable(GL_CULL_FACE);
-			glDepthMask(true);
+			RenderState::SetDepthFunc(GL_LESS);
+			RenderState::Enable(GL_CULL_FACE);
+			RenderState::SetDepthMask(true);
 
 		}
 	}
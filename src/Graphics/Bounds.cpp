@@ -0,0 +1,70 @@
+#include "Graphics/Bounds.h"
+#include <algorithm>
+#include <cstring>
+#include <Logging.h>
+
+Bounds Bounds::FromPositions(const uint8_t* data, size_t vertexCount, size_t stride, size_t offset) {
+	Bounds result;
+	if (data == nullptr || vertexCount == 0) {
+		return result;
+	}
+
+	// Helper for pulling a position out of the data store, we memcpy to avoid unaligned reads
+	auto getPosition = [&](size_t ix) {
+		glm::vec3 pos;
+		memcpy(&pos, data + (stride * ix) + offset, sizeof(glm::vec3));
+		return pos;
+	};
+
+	// First pass we find the AABB
+	result.Min = result.Max = getPosition(0);
+	for (size_t ix = 1; ix < vertexCount; ix++) {
+		glm::vec3 pos = getPosition(ix);
+		result.Min = glm::min(result.Min, pos);
+		result.Max = glm::max(result.Max, pos);
+	}
+
+	// Second pass, we center the sphere on the box and find the furthest vertex from the center
+	result.SphereCenter = result.GetCenter();
+	float radiusSq = 0.0f;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		glm::vec3 delta = getPosition(ix) - result.SphereCenter;
+		radiusSq = std::max(radiusSq, glm::dot(delta, delta));
+	}
+	result.SphereRadius = glm::sqrt(radiusSq);
+	result.IsValid = true;
+
+	return result;
+}
+
+Bounds Bounds::FromVertexArray(const VertexArrayObject::Sptr& vao) {
+	if (vao == nullptr) {
+		return Bounds();
+	}
+
+	// Find the position attribute and the buffer that feeds it
+	const VertexArrayObject::VertexBufferBinding* binding = vao->GetBufferBinding(AttribUsage::Position);
+	if (binding == nullptr) {
+		LOG_WARN("Mesh does not have a position attribute, cannot calculate bounds");
+		return Bounds();
+	}
+	auto it = std::find_if(binding->GetAttributes().begin(), binding->GetAttributes().end(), [](const BufferAttribute& attrib) {
+		return attrib.Usage == AttribUsage::Position;
+	});
+	if (it == binding->GetAttributes().end() || it->Type != AttributeType::Float || it->Size < 3) {
+		LOG_WARN("Mesh positions are not stored as floats, cannot calculate bounds");
+		return Bounds();
+	}
+
+	// Read the vertex data back into CPU memory
+	const VertexBuffer::Sptr& buffer = binding->GetBuffer();
+	size_t stride = it->Stride != 0 ? it->Stride : sizeof(glm::vec3);
+	size_t vertexCount = buffer->GetTotalSize() / stride;
+	uint8_t* vertexStore = reinterpret_cast<uint8_t*>(malloc(buffer->GetTotalSize()));
+	glGetNamedBufferSubData(buffer->GetHandle(), 0, buffer->GetTotalSize(), vertexStore);
+
+	Bounds result = FromPositions(vertexStore, vertexCount, stride, it->Offset);
+
+	free(vertexStore);
+	return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <GLM/glm.hpp>
+
+#include "Graphics/VertexArrayObject.h"
+
+/// <summary>
+/// Stores the local space bounds of a mesh, as both an axis aligned bounding box
+/// and a bounding sphere. The sphere is cheaper to test, and the box is tighter
+/// </summary>
+struct Bounds {
+	/// <summary>
+	/// The minimum corner of the axis aligned bounding box
+	/// </summary>
+	glm::vec3 Min          = glm::vec3(0.0f);
+	/// <summary>
+	/// The maximum corner of the axis aligned bounding box
+	/// </summary>
+	glm::vec3 Max          = glm::vec3(0.0f);
+	/// <summary>
+	/// The center of the bounding sphere
+	/// </summary>
+	glm::vec3 SphereCenter = glm::vec3(0.0f);
+	/// <summary>
+	/// The radius of the bounding sphere
+	/// </summary>
+	float     SphereRadius = 0.0f;
+	/// <summary>
+	/// False if the bounds have not been calculated, in which case they should not be used for culling
+	/// </summary>
+	bool      IsValid      = false;
+
+	/// <summary>
+	/// Gets the center of the axis aligned bounding box
+	/// </summary>
+	glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+	/// <summary>
+	/// Gets the half-size of the axis aligned bounding box along each axis
+	/// </summary>
+	glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }
+
+	/// <summary>
+	/// Calculates the bounds for a list of positions in a raw vertex store
+	/// </summary>
+	/// <param name="data">The vertex data to read positions from</param>
+	/// <param name="vertexCount">The number of vertices in the data</param>
+	/// <param name="stride">The size of a single vertex, in bytes</param>
+	/// <param name="offset">The offset of the position within a vertex, in bytes</param>
+	static Bounds FromPositions(const uint8_t* data, size_t vertexCount, size_t stride, size_t offset);
+
+	/// <summary>
+	/// Calculates the bounds of a VAO, by reading the position data back from OpenGL. This should
+	/// only be used at load time, as reading from a buffer will stall the pipeline
+	/// </summary>
+	/// <param name="vao">The VAO to calculate the bounds for</param>
+	static Bounds FromVertexArray(const VertexArrayObject::Sptr& vao);
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// Matches the layout OpenGL expects for the commands in glMultiDrawElementsIndirect
+/// </summary>
+/// <see>https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glMultiDrawElementsIndirect.xhtml</see>
+struct DrawElementsIndirectCommand {
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t  BaseVertex;
+	uint32_t BaseInstance;
+};
+
+/// <summary>
+/// The indirect buffer stores draw commands that OpenGL will read when performing indirect draws
+/// </summary>
+class IndirectBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<IndirectBuffer> Sptr;
+
+	static inline Sptr Create(BufferUsage usage = BufferUsage::StreamDraw) {
+		return std::make_shared<IndirectBuffer>(usage);
+	}
+
+	/// <summary>
+	/// Creates a new indirect buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_STREAM_DRAW</param>
+	IndirectBuffer(BufferUsage usage = BufferUsage::StreamDraw) : IBuffer(BufferType::DrawIndirect, usage) { }
+
+	/// <summary>
+	/// Unbinds the current indirect buffer
+	/// </summary>
+	static void UnBind() { IBuffer::UnBind(BufferType::DrawIndirect); }
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// A shader storage buffer (SSBO) stores arbitrary arrays of data that shaders can read and write,
+/// unlike uniform buffers these can be very large and can have a runtime sized array as their last member
+/// </summary>
+class ShaderStorageBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<ShaderStorageBuffer> Sptr;
+
+	static inline Sptr Create(BufferUsage usage = BufferUsage::DynamicDraw) {
+		return std::make_shared<ShaderStorageBuffer>(usage);
+	}
+
+	/// <summary>
+	/// Creates a new shader storage buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW</param>
+	ShaderStorageBuffer(BufferUsage usage = BufferUsage::DynamicDraw) : IBuffer(BufferType::ShaderStorage, usage) { }
+
+	/// <summary>
+	/// Unbinds the shader storage buffer at the given binding slot
+	/// </summary>
+	static void UnBind(uint32_t slot) { IBuffer::UnBind(BufferType::ShaderStorage, slot); }
+};
@@ -0,0 +1,69 @@
+#include "Graphics/Buffers/UniformBufferPool.h"
+#include <algorithm>
+#include "Logging.h"
+
+UniformBufferPool::UniformBufferPool(uint32_t pageSize) :
+	_pageSize(pageSize),
+	_alignment(256),
+	_pages(),
+	_freeRanges()
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_alignment = std::max(alignment, 1);
+}
+
+UniformBufferPool::~UniformBufferPool() {
+	for (const Page& page : _pages) {
+		glDeleteBuffers(1, &page.Buffer);
+	}
+}
+
+UniformBufferPool::Range UniformBufferPool::Allocate(uint32_t size) {
+	uint32_t alignedSize = ((std::max(size, 1u) + _alignment - 1) / _alignment) * _alignment;
+	if (alignedSize > _pageSize) {
+		LOG_ERROR("Cannot allocate {} bytes from a uniform buffer pool with {} byte pages", size, _pageSize);
+		return Range();
+	}
+
+	// Re-use a freed range of the same size if we can
+	auto it = _freeRanges.find(alignedSize);
+	if (it != _freeRanges.end() && !it->second.empty()) {
+		Range result = it->second.back();
+		it->second.pop_back();
+		return result;
+	}
+
+	// Otherwise carve it off the end of the newest page, starting a new page if it's full
+	if (_pages.empty() || _pages.back().Used + alignedSize > _pageSize) {
+		Page page;
+		page.Used = 0;
+		glCreateBuffers(1, &page.Buffer);
+		glNamedBufferStorage(page.Buffer, _pageSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		_pages.push_back(page);
+	}
+
+	Page& page = _pages.back();
+	Range result;
+	result.Buffer = page.Buffer;
+	result.Offset = page.Used;
+	result.Size   = alignedSize;
+	page.Used += alignedSize;
+	return result;
+}
+
+void UniformBufferPool::Free(Range& range) {
+	if (range.IsValid()) {
+		_freeRanges[range.Size].push_back(range);
+		range = Range();
+	}
+}
+
+void UniformBufferPool::Upload(const Range& range, const void* data, uint32_t size) const {
+	LOG_ASSERT(size <= range.Size, "Data exceeds the bounds of the uniform buffer range");
+	glNamedBufferSubData(range.Buffer, range.Offset, size, data);
+}
+
+void UniformBufferPool::Bind(const Range& range, uint32_t slot) const {
+	glBindBufferRange(GL_UNIFORM_BUFFER, slot, range.Buffer, range.Offset, range.Size);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <glad/glad.h>
+
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Hands out ranges of a few large uniform buffers, so that lots of small blocks of uniforms (ex: material
+/// parameters) don't each need their own buffer. A range is bound with glBindBufferRange, so switching between
+/// blocks never needs to re-upload anything
+///
+/// Ranges are aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT. Freed ranges are kept by size and handed back out
+/// to the next allocation of the same size, since most blocks come from the same few shaders
+/// </summary>
+class UniformBufferPool final {
+public:
+	MAKE_PTRS(UniformBufferPool);
+	NO_COPY(UniformBufferPool);
+	NO_MOVE(UniformBufferPool);
+
+	/// <summary>
+	/// A range within one of the pool's buffers
+	/// </summary>
+	struct Range {
+		GLuint   Buffer = 0;
+		uint32_t Offset = 0;
+		uint32_t Size   = 0;
+
+		bool IsValid() const { return Buffer != 0; }
+	};
+
+	/// <summary>
+	/// Creates a new pool
+	/// </summary>
+	/// <param name="pageSize">The size of each buffer in bytes, this is the largest range that can be allocated</param>
+	UniformBufferPool(uint32_t pageSize = 64 * 1024);
+	~UniformBufferPool();
+
+	/// <summary>
+	/// Allocates a range of at least the given size
+	/// </summary>
+	/// <returns>The new range, or an invalid range if size is larger than a page</returns>
+	Range Allocate(uint32_t size);
+	/// <summary>
+	/// Returns a range to the pool, and resets it to an invalid range
+	/// </summary>
+	void Free(Range& range);
+
+	/// <summary>
+	/// Replaces the contents of a range, data must be at least as large as the size the range was allocated with
+	/// </summary>
+	void Upload(const Range& range, const void* data, uint32_t size) const;
+	/// <summary>
+	/// Binds a range to a uniform buffer binding slot
+	/// </summary>
+	void Bind(const Range& range, uint32_t slot) const;
+
+	uint32_t GetAlignment() const { return _alignment; }
+
+protected:
+	struct Page {
+		GLuint   Buffer;
+		uint32_t Used;
+	};
+
+	uint32_t          _pageSize;
+	uint32_t          _alignment;
+	std::vector<Page> _pages;
+
+	// Ranges that have been freed, keyed by their aligned size
+	std::unordered_map<uint32_t, std::vector<Range>> _freeRanges;
+};
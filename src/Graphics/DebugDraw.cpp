@@ -1,5 +1,7 @@
 #include "Graphics/DebugDraw.h"
 
+static constexpr UniformHandle UNIFORM_MVP("u_MVP");
+
 DebugDrawer::DebugDrawer() :
 	_colorStack(std::stack<glm::vec3>()),
 	_transformStack(std::stack<glm::mat4>()),
@@ -69,19 +71,14 @@ void DebugDrawer::FlushLines()
 {
 	if (_lineOffset > 0) {
 		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
+		__Shader->SetUniformMatrix(UNIFORM_MVP, _viewProjection * _transformStack.top());
 		glLineWidth(2.0f);
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
 		VertexArrayObject::Unbind();
 		_linesVBO->LoadData<VertexPosCol>(_lineBuffer, LINE_BATCH_SIZE * 2);
 		_linesVAO->Bind();
 		glDrawArrays((GLenum)DrawMode::LineList, 0, _lineOffset);
 		_linesVAO->Unbind();
 		_lineOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
 	}
 }
 
@@ -113,18 +110,13 @@ void DebugDrawer::FlushTris()
 {
 	if (_triangleOffset > 0) {
 		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
+		__Shader->SetUniformMatrix(UNIFORM_MVP, _viewProjection * _transformStack.top());
 		VertexArrayObject::Unbind();
 		_trisVBO->LoadData<VertexPosCol>(_triBuffer, TRI_BATCH_SIZE * 3);
 		_trisVAO->Bind();
 		glDrawArrays((GLenum)DrawMode::TriangleList, 0, _triangleOffset);
 		_trisVAO->Unbind();
 		_triangleOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
 	}
 }
 
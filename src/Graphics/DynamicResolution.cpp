@@ -0,0 +1,138 @@
+#include "Graphics/DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <Logging.h>
+
+namespace {
+	// The number of frames to measure at a scale before it can change
+	const uint32_t SETTLE_FRAMES = 8;
+	// Scales are rounded to multiples of this
+	const float    SCALE_STEP = 0.05f;
+	// The most the scale can move in a single change
+	const float    MAX_SCALE_CHANGE = 0.15f;
+	// We only raise the resolution once we're below this fraction of the budget, so that we don't go straight back over it
+	const float    HEADROOM = 0.85f;
+	// How much each new frame contributes to the displayed GPU time
+	const float    DISPLAY_SMOOTHING = 0.1f;
+}
+
+DynamicResolution::DynamicResolution(float targetFrameTime, float minScale) :
+	_queries(),
+	_frame(0),
+	_enabled(false),
+	_targetFrameTime(targetFrameTime),
+	_minScale(1.0f),
+	_scale(1.0f),
+	_gpuTime(0.0f),
+	_sampleTotal(0.0f),
+	_sampleCount(0)
+{
+	SetMinScale(minScale);
+
+	uint32_t handles[QUERY_FRAMES * 2];
+	glCreateQueries(GL_TIMESTAMP, QUERY_FRAMES * 2, handles);
+	for (uint32_t ix = 0; ix < QUERY_FRAMES; ix++) {
+		_queries[ix].Start   = handles[ix * 2];
+		_queries[ix].End     = handles[ix * 2 + 1];
+		_queries[ix].Scale   = 1.0f;
+		_queries[ix].Pending = false;
+	}
+}
+
+DynamicResolution::~DynamicResolution() {
+	for (uint32_t ix = 0; ix < QUERY_FRAMES; ix++) {
+		glDeleteQueries(1, &_queries[ix].Start);
+		glDeleteQueries(1, &_queries[ix].End);
+	}
+}
+
+void DynamicResolution::BeginFrame() {
+	// Read back every frame that the GPU has finished since we last checked, oldest first
+	for (uint32_t ix = 1; ix <= QUERY_FRAMES; ix++) {
+		FrameQuery& query = _queries[(_frame + ix) % QUERY_FRAMES];
+		if (!query.Pending) {
+			continue;
+		}
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(query.End, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE) {
+			// Later frames can't be done either
+			break;
+		}
+
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(query.Start, GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(query.End, GL_QUERY_RESULT, &end);
+		query.Pending = false;
+		_AddSample((float)(end - start) / 1000000.0f, query.Scale);
+	}
+
+	// If the GPU is more than a few frames behind, we drop the oldest result rather than wait for it
+	_frame = (_frame + 1) % QUERY_FRAMES;
+	FrameQuery& query = _queries[_frame];
+	query.Pending = false;
+	query.Scale   = GetScale();
+	glQueryCounter(query.Start, GL_TIMESTAMP);
+}
+
+void DynamicResolution::EndFrame() {
+	FrameQuery& query = _queries[_frame];
+	glQueryCounter(query.End, GL_TIMESTAMP);
+	query.Pending = true;
+}
+
+void DynamicResolution::SetEnabled(bool value) {
+	_enabled = value;
+	_sampleTotal = 0.0f;
+	_sampleCount = 0;
+}
+
+void DynamicResolution::SetMinScale(float value) {
+	LOG_ASSERT(value > 0.0f && value <= 1.0f, "Minimum resolution scale must be between 0 and 1");
+	_minScale = value;
+	_scale = std::max(_scale, _minScale);
+}
+
+glm::uvec2 DynamicResolution::GetRenderSize(const glm::uvec2& outputSize) const {
+	glm::vec2 size = glm::round(glm::vec2(outputSize) * GetScale());
+	return glm::max(glm::uvec2(size), glm::uvec2(1));
+}
+
+void DynamicResolution::_AddSample(float milliseconds, float scale) {
+	_gpuTime = _gpuTime == 0.0f ? milliseconds : glm::mix(_gpuTime, milliseconds, DISPLAY_SMOOTHING);
+
+	// Frames that were rendered before the last change don't tell us anything about the current scale
+	if (!_enabled || scale != _scale) {
+		return;
+	}
+
+	_sampleTotal += milliseconds;
+	_sampleCount++;
+	if (_sampleCount < SETTLE_FRAMES) {
+		return;
+	}
+
+	float average = _sampleTotal / (float)_sampleCount;
+	_sampleTotal = 0.0f;
+	_sampleCount = 0;
+
+	// Only adjust if we're over budget, or have enough spare time to come up without going over
+	if (average <= _targetFrameTime && average >= _targetFrameTime * HEADROOM) {
+		return;
+	}
+
+	// Time scales with the pixel count, which is the square of the scale
+	float ideal = _scale * std::sqrt(_targetFrameTime * HEADROOM / std::max(average, 0.01f));
+	ideal = glm::clamp(ideal, _scale - MAX_SCALE_CHANGE, _scale + MAX_SCALE_CHANGE);
+
+	// Round towards the current scale so that we don't overshoot, but always drop by at least one step when we're over budget
+	float steps = ideal / SCALE_STEP;
+	if (average > _targetFrameTime) {
+		ideal = std::min(std::ceil(steps) * SCALE_STEP, _scale - SCALE_STEP);
+	} else {
+		ideal = std::floor(steps) * SCALE_STEP;
+	}
+	_scale = glm::clamp(ideal, _minScale, 1.0f);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Picks the resolution that the scene is rendered at, so that the GPU time for a frame stays within a budget.
+///
+/// The GPU time between BeginFrame and EndFrame is measured with timestamp queries. Results are read back a few
+/// frames later so that we never stall waiting for the GPU. Render time scales with the number of pixels, so once
+/// enough frames have been measured at the current scale, the scale is moved by the square root of how far we are
+/// from the budget. Scales are rounded to fixed steps, and only change after several frames have been measured,
+/// so the resolution doesn't bounce around between frames, and render targets are not re-created every frame
+/// </summary>
+class DynamicResolution final {
+public:
+	MAKE_PTRS(DynamicResolution);
+	NO_COPY(DynamicResolution);
+	NO_MOVE(DynamicResolution);
+
+	/// <summary>
+	/// Creates a new resolution controller
+	/// </summary>
+	/// <param name="targetFrameTime">The GPU time budget in milliseconds</param>
+	/// <param name="minScale">The smallest scale that the resolution can drop to, on each axis</param>
+	DynamicResolution(float targetFrameTime = 12.0f, float minScale = 0.5f);
+	~DynamicResolution();
+
+	/// <summary>
+	/// Marks the start of the GPU work to measure, and reads back the results of older frames
+	/// </summary>
+	void BeginFrame();
+	/// <summary>
+	/// Marks the end of the GPU work to measure
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Enables or disables scaling, the GPU time is still measured while disabled, but the scale is always 1
+	/// </summary>
+	void SetEnabled(bool value);
+	bool IsEnabled() const { return _enabled; }
+
+	void SetTargetFrameTime(float value) { _targetFrameTime = value; }
+	float GetTargetFrameTime() const { return _targetFrameTime; }
+
+	void SetMinScale(float value);
+	float GetMinScale() const { return _minScale; }
+
+	/// <summary>
+	/// Gets the scale to apply to each axis of the output resolution
+	/// </summary>
+	float GetScale() const { return _enabled ? _scale : 1.0f; }
+	/// <summary>
+	/// Gets the average GPU time in milliseconds of the most recently measured frames
+	/// </summary>
+	float GetGpuTime() const { return _gpuTime; }
+
+	/// <summary>
+	/// Gets the size to render at for a given output size
+	/// </summary>
+	glm::uvec2 GetRenderSize(const glm::uvec2& outputSize) const;
+
+protected:
+	// The number of frames that can be in flight before we reuse a query
+	static const uint32_t QUERY_FRAMES = 4;
+
+	struct FrameQuery {
+		uint32_t Start;
+		uint32_t End;
+		// The scale that was in use when the frame was rendered
+		float    Scale;
+		// True once the end of the frame has been recorded, and the result has not been read yet
+		bool     Pending;
+	};
+
+	FrameQuery _queries[QUERY_FRAMES];
+	uint32_t   _frame;
+
+	bool  _enabled;
+	float _targetFrameTime;
+	float _minScale;
+	float _scale;
+	float _gpuTime;
+
+	// The GPU times measured since the scale last changed
+	float    _sampleTotal;
+	uint32_t _sampleCount;
+
+	/// <summary>
+	/// Adds a measured frame time, and updates the scale if we've measured enough frames
+	/// </summary>
+	void _AddSample(float milliseconds, float scale);
+};
@@ -125,6 +125,11 @@ void Framebuffer::_AddAttachment(RenderTargetAttachment attachment, const Render
 		// Common parameters
 		descriptor.GenerateMipMaps    = false;
 		descriptor.MinificationFilter = MinFilter::Linear;
+		// Integer textures are incomplete with linear filtering
+		if (target.Format == RenderTargetType::ColorR32UI) {
+			descriptor.MinificationFilter  = MinFilter::Nearest;
+			descriptor.MagnificationFilter = MagFilter::Nearest;
+		}
 		descriptor.HorizontalWrap     = WrapMode::ClampToEdge;
 		descriptor.VerticalWrap       = WrapMode::ClampToEdge;
 
@@ -0,0 +1,93 @@
+#include "Graphics/Frustum.h"
+#include <algorithm>
+
+Frustum::Frustum() :
+	_planes()
+{ }
+
+Frustum::Frustum(const glm::mat4& viewProjection) :
+	_planes()
+{
+	Update(viewProjection);
+}
+
+void Frustum::Update(const glm::mat4& viewProjection) {
+	// Gribb-Hartmann plane extraction, we need the rows of the matrix but GLM is column major
+	glm::mat4 m = glm::transpose(viewProjection);
+
+	_planes[0] = m[3] + m[0]; // Left
+	_planes[1] = m[3] - m[0]; // Right
+	_planes[2] = m[3] + m[1]; // Bottom
+	_planes[3] = m[3] - m[1]; // Top
+	_planes[4] = m[3] + m[2]; // Near
+	_planes[5] = m[3] - m[2]; // Far
+
+	// Normalize so that we can get actual distances for sphere tests
+	for (int ix = 0; ix < 6; ix++) {
+		float length = glm::length(glm::vec3(_planes[ix]));
+		if (length > 0.0f) {
+			_planes[ix] /= length;
+		}
+	}
+}
+
+bool Frustum::IsSphereVisible(const glm::vec3& center, float radius) const {
+	for (int ix = 0; ix < 6; ix++) {
+		if (glm::dot(glm::vec3(_planes[ix]), center) + _planes[ix].w < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::IsBoxVisible(const glm::vec3& center, const glm::vec3& extents) const {
+	for (int ix = 0; ix < 6; ix++) {
+		glm::vec3 normal = glm::vec3(_planes[ix]);
+		// Projected radius of the box onto the plane normal
+		float radius = glm::dot(extents, glm::abs(normal));
+		if (glm::dot(normal, center) + _planes[ix].w < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::IsVisible(const Bounds& localBounds, const glm::mat4& transform) const {
+	if (!localBounds.IsValid) {
+		return true;
+	}
+
+	// Transform the sphere into world space, scaling by the largest axis scale
+	glm::vec3 center = transform * glm::vec4(localBounds.SphereCenter, 1.0f);
+	float scale = std::max({
+		glm::length(glm::vec3(transform[0])),
+		glm::length(glm::vec3(transform[1])),
+		glm::length(glm::vec3(transform[2]))
+	});
+	float radius = localBounds.SphereRadius * scale;
+
+	// Cheap test first, if the sphere is fully outside a plane we can bail
+	bool fullyInside = true;
+	for (int ix = 0; ix < 6; ix++) {
+		float distance = glm::dot(glm::vec3(_planes[ix]), center) + _planes[ix].w;
+		if (distance < -radius) {
+			return false;
+		}
+		fullyInside &= distance >= radius;
+	}
+	if (fullyInside) {
+		return true;
+	}
+
+	// The sphere crosses a plane, use the tighter box. We transform the AABB into a world space
+	// AABB by projecting the extents onto each world axis (see Arvo, Graphics Gems 1990)
+	glm::mat3 basis = glm::mat3(transform);
+	glm::vec3 boxCenter = transform * glm::vec4(localBounds.GetCenter(), 1.0f);
+	glm::vec3 localExtents = localBounds.GetExtents();
+	glm::vec3 worldExtents = glm::vec3(
+		glm::dot(glm::abs(glm::vec3(basis[0].x, basis[1].x, basis[2].x)), localExtents),
+		glm::dot(glm::abs(glm::vec3(basis[0].y, basis[1].y, basis[2].y)), localExtents),
+		glm::dot(glm::abs(glm::vec3(basis[0].z, basis[1].z, basis[2].z)), localExtents)
+	);
+	return IsBoxVisible(boxCenter, worldExtents);
+}
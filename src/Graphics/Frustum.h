@@ -0,0 +1,44 @@
+#pragma once
+#include <GLM/glm.hpp>
+#include "Graphics/Bounds.h"
+
+/// <summary>
+/// Represents a view frustum as a set of 6 planes, extracted from a view-projection matrix.
+/// Used for rejecting objects that cannot be seen by a camera before we draw them
+/// </summary>
+class Frustum {
+public:
+	Frustum();
+	/// <summary>
+	/// Creates a frustum from the given view-projection matrix
+	/// </summary>
+	/// <param name="viewProjection">The matrix that takes world space to clip space</param>
+	Frustum(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Re-extracts the planes of the frustum from a view-projection matrix
+	/// </summary>
+	void Update(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Tests whether a world space sphere is at least partially inside the frustum
+	/// </summary>
+	bool IsSphereVisible(const glm::vec3& center, float radius) const;
+	/// <summary>
+	/// Tests whether a world space axis aligned box is at least partially inside the frustum
+	/// </summary>
+	bool IsBoxVisible(const glm::vec3& center, const glm::vec3& extents) const;
+
+	/// <summary>
+	/// Tests whether an object with the given local bounds and transform is at least partially inside 
+	/// the frustum. Tests against the bounding sphere first, and falls back to the bounding box for
+	/// objects that intersect the frustum's edges. Invalid bounds are always considered visible
+	/// </summary>
+	/// <param name="localBounds">The bounds of the object in local space</param>
+	/// <param name="transform">The object's local to world matrix</param>
+	bool IsVisible(const Bounds& localBounds, const glm::mat4& transform) const;
+
+protected:
+	// Planes are stored as (normal, distance), with normals pointing into the frustum
+	glm::vec4 _planes[6];
+};
@@ -0,0 +1,148 @@
+#include "Graphics/GeometryArena.h"
+#include <algorithm>
+#include <vector>
+#include <Logging.h>
+
+GeometryArena::GeometryArena(const VertexArrayObject::VertexDeclaration& vDecl, uint32_t initialVertices, uint32_t initialIndices) :
+	_entries(),
+	_vDecl(vDecl),
+	_stride(0),
+	_vertices(nullptr),
+	_indices(nullptr),
+	_vao(nullptr),
+	_vertexCount(0),
+	_vertexCapacity(0),
+	_indexCount(0),
+	_indexCapacity(0)
+{
+	LOG_ASSERT(!_vDecl.empty(), "Geometry arena requires a vertex declaration");
+	_stride = _vDecl[0].Stride;
+	_Reserve(initialVertices, initialIndices);
+}
+
+GeometryArena::~GeometryArena() = default;
+
+const GeometryArena::Allocation* GeometryArena::Add(const VertexArrayObject::Sptr& mesh) {
+	if (mesh == nullptr) {
+		return nullptr;
+	}
+
+	// If we've seen this mesh before, we can return the result from last time
+	auto it = _entries.find(mesh.get());
+	if (it != _entries.end() && !it->second.Source.expired()) {
+		return it->second.Compatible ? &it->second.Alloc : nullptr;
+	}
+
+	Entry& entry = _entries[mesh.get()];
+	entry.Source = mesh;
+	entry.Compatible = _IsCompatible(mesh);
+	if (!entry.Compatible) {
+		return nullptr;
+	}
+
+	const VertexBuffer::Sptr& srcVertices = mesh->GetBufferBinding(AttribUsage::Position)->GetBuffer();
+	IndexBuffer::Sptr srcIndices = mesh->GetIndexBuffer();
+	uint32_t vertexCount = srcVertices->GetElementCount();
+	uint32_t indexCount = srcIndices != nullptr ? srcIndices->GetElementCount() : vertexCount;
+
+	_Reserve(_vertexCount + vertexCount, _indexCount + indexCount);
+
+	entry.Alloc.BaseVertex  = static_cast<int32_t>(_vertexCount);
+	entry.Alloc.VertexCount = vertexCount;
+	entry.Alloc.FirstIndex  = _indexCount;
+	entry.Alloc.IndexCount  = indexCount;
+
+	// Vertices can be copied directly on the GPU
+	glCopyNamedBufferSubData(srcVertices->GetHandle(), _vertices->GetHandle(), 0, (GLintptr)_vertexCount * _stride, (GLsizeiptr)vertexCount * _stride);
+
+	// Indices stay relative to the mesh (we use the base vertex when drawing), but the arena always stores
+	// 32 bit indices, so smaller index types need to be widened on the CPU
+	if (srcIndices != nullptr && srcIndices->GetElementType() == IndexType::UInt) {
+		glCopyNamedBufferSubData(srcIndices->GetHandle(), _indices->GetHandle(), 0, (GLintptr)_indexCount * sizeof(uint32_t), (GLsizeiptr)indexCount * sizeof(uint32_t));
+	} else {
+		std::vector<uint32_t> widened(indexCount);
+		if (srcIndices != nullptr) {
+			std::vector<uint8_t> raw(srcIndices->GetTotalSize());
+			glGetNamedBufferSubData(srcIndices->GetHandle(), 0, raw.size(), raw.data());
+			for (uint32_t ix = 0; ix < indexCount; ix++) {
+				widened[ix] = srcIndices->GetElementType() == IndexType::UShort ?
+					reinterpret_cast<const uint16_t*>(raw.data())[ix] : raw[ix];
+			}
+		} else {
+			// Non-indexed meshes just get a sequential index list
+			for (uint32_t ix = 0; ix < indexCount; ix++) {
+				widened[ix] = ix;
+			}
+		}
+		glNamedBufferSubData(_indices->GetHandle(), (GLintptr)_indexCount * sizeof(uint32_t), (GLsizeiptr)indexCount * sizeof(uint32_t), widened.data());
+	}
+
+	_vertexCount += vertexCount;
+	_indexCount += indexCount;
+
+	return &entry.Alloc;
+}
+
+const GeometryArena::Allocation* GeometryArena::Find(const VertexArrayObject* mesh) const {
+	auto it = _entries.find(mesh);
+	if (it == _entries.end() || !it->second.Compatible || it->second.Source.expired()) {
+		return nullptr;
+	}
+	return &it->second.Alloc;
+}
+
+void GeometryArena::_Reserve(uint32_t vertices, uint32_t indices) {
+	if (_vao != nullptr && vertices <= _vertexCapacity && indices <= _indexCapacity) {
+		return;
+	}
+
+	// Grow geometrically so that adding many meshes doesn't copy the arena every time
+	uint32_t newVertexCapacity = std::max(vertices, _vertexCapacity + _vertexCapacity / 2);
+	uint32_t newIndexCapacity  = std::max(indices, _indexCapacity + _indexCapacity / 2);
+
+	VertexBuffer::Sptr newVertices = VertexBuffer::Create(BufferUsage::StaticDraw);
+	newVertices->LoadData(nullptr, _stride, newVertexCapacity);
+	IndexBuffer::Sptr newIndices = IndexBuffer::Create(BufferUsage::StaticDraw, IndexType::UInt);
+	newIndices->LoadData(nullptr, sizeof(uint32_t), newIndexCapacity, IndexType::UInt);
+
+	// Carry over anything that's already in the arena
+	if (_vertices != nullptr && _vertexCount > 0) {
+		glCopyNamedBufferSubData(_vertices->GetHandle(), newVertices->GetHandle(), 0, 0, (GLsizeiptr)_vertexCount * _stride);
+	}
+	if (_indices != nullptr && _indexCount > 0) {
+		glCopyNamedBufferSubData(_indices->GetHandle(), newIndices->GetHandle(), 0, 0, (GLsizeiptr)_indexCount * sizeof(uint32_t));
+	}
+
+	_vertices = newVertices;
+	_indices = newIndices;
+	_vertexCapacity = newVertexCapacity;
+	_indexCapacity = newIndexCapacity;
+
+	_vao = VertexArrayObject::Create();
+	_vao->SetDebugName("Geometry Arena");
+	_vao->AddVertexBuffer(_vertices, _vDecl);
+	_vao->SetIndexBuffer(_indices);
+	_vao->SetVDecl(_vDecl);
+}
+
+bool GeometryArena::_IsCompatible(const VertexArrayObject::Sptr& mesh) const {
+	VertexArrayObject::VertexBufferBinding* binding = mesh->GetBufferBinding(AttribUsage::Position);
+	if (binding == nullptr || binding->IsInstanced()) {
+		return false;
+	}
+
+	// The mesh's buffer must have exactly the same interleaved layout as our arena
+	const std::vector<BufferAttribute>& attribs = binding->GetAttributes();
+	if (attribs.size() != _vDecl.size()) {
+		return false;
+	}
+	for (size_t ix = 0; ix < attribs.size(); ix++) {
+		const BufferAttribute& a = attribs[ix];
+		const BufferAttribute& b = _vDecl[ix];
+		if (a.Slot != b.Slot || a.Size != b.Size || a.Type != b.Type || a.Normalized != b.Normalized ||
+			a.Stride != b.Stride || a.Offset != b.Offset) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "Graphics/VertexArrayObject.h"
+
+/// <summary>
+/// A geometry arena packs many static meshes that share a vertex declaration into one large
+/// vertex buffer and one large index buffer, so that they can all be drawn from a single VAO.
+/// This lets us submit many different meshes with one glMultiDrawElementsIndirect call
+///
+/// Meshes are copied into the arena, the source VAO is left untouched. Space is never re-used,
+/// the arena is intended for static level geometry that lives as long as the scene
+/// </summary>
+class GeometryArena final {
+public:
+	MAKE_PTRS(GeometryArena);
+
+	/// <summary>
+	/// Describes where a mesh lives inside of the arena, these map directly to the
+	/// parameters of a DrawElementsIndirectCommand
+	/// </summary>
+	struct Allocation {
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+		int32_t  BaseVertex;
+		uint32_t VertexCount;
+	};
+
+	/// <summary>
+	/// Creates a new arena for meshes with the given vertex declaration
+	/// </summary>
+	/// <param name="vDecl">The vertex declaration that all meshes in the arena must match</param>
+	/// <param name="initialVertices">The number of vertices to reserve space for</param>
+	/// <param name="initialIndices">The number of indices to reserve space for</param>
+	GeometryArena(const VertexArrayObject::VertexDeclaration& vDecl, uint32_t initialVertices = 1 << 16, uint32_t initialIndices = 1 << 18);
+	~GeometryArena();
+
+	/// <summary>
+	/// Copies a mesh into the arena if it is compatible. Meshes that have already been added will return
+	/// their existing allocation
+	/// </summary>
+	/// <param name="mesh">The mesh to add to the arena</param>
+	/// <returns>The mesh's allocation, or nullptr if the mesh's layout does not match the arena</returns>
+	const Allocation* Add(const VertexArrayObject::Sptr& mesh);
+
+	/// <summary>
+	/// Finds the allocation for a mesh that has been added to the arena
+	/// </summary>
+	/// <param name="mesh">The mesh to search for</param>
+	/// <returns>The mesh's allocation, or nullptr if the mesh is not in the arena</returns>
+	const Allocation* Find(const VertexArrayObject* mesh) const;
+
+	/// <summary>
+	/// Gets the VAO that all meshes in the arena can be drawn from. Note that this may
+	/// change when meshes are added and the arena needs to grow
+	/// </summary>
+	const VertexArrayObject::Sptr& GetVao() const { return _vao; }
+	/// <summary>
+	/// Gets the buffers that hold the arena's vertices and indices, so that shaders can fetch vertices
+	/// directly (ex: the visibility buffer resolve). Like the VAO, these change when the arena grows
+	/// </summary>
+	const VertexBuffer::Sptr& GetVertexBuffer() const { return _vertices; }
+	const IndexBuffer::Sptr& GetIndexBuffer() const { return _indices; }
+
+	uint32_t GetVertexCount() const { return _vertexCount; }
+	uint32_t GetIndexCount() const { return _indexCount; }
+
+protected:
+	struct Entry {
+		// Lets us detect if the source mesh was deleted and something else got its address
+		std::weak_ptr<VertexArrayObject> Source;
+		Allocation Alloc;
+		bool       Compatible;
+	};
+	std::unordered_map<const VertexArrayObject*, Entry> _entries;
+
+	VertexArrayObject::VertexDeclaration _vDecl;
+	uint32_t _stride;
+
+	VertexBuffer::Sptr      _vertices;
+	IndexBuffer::Sptr       _indices;
+	VertexArrayObject::Sptr _vao;
+
+	uint32_t _vertexCount;
+	uint32_t _vertexCapacity;
+	uint32_t _indexCount;
+	uint32_t _indexCapacity;
+
+	/// <summary>
+	/// Makes sure that there is space for at least the given number of vertices and indices,
+	/// growing the buffers and re-creating the VAO if needed
+	/// </summary>
+	void _Reserve(uint32_t vertices, uint32_t indices);
+	/// <summary>
+	/// Checks whether a mesh has a single interleaved vertex buffer matching our vertex declaration
+	/// </summary>
+	bool _IsCompatible(const VertexArrayObject::Sptr& mesh) const;
+};
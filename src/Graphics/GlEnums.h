@@ -17,6 +17,7 @@ ENUM(ShaderPartType, GLint,
 	 TessControl  = GL_TESS_CONTROL_SHADER,
 	 TessEval     = GL_TESS_EVALUATION_SHADER,
 	 Geometry     = GL_GEOMETRY_SHADER,
+	 Compute      = GL_COMPUTE_SHADER,
 	 Unknown      = GL_NONE // Usually good practice to have an "unknown" or "none" state for enums
 )
 
@@ -52,7 +53,8 @@ ENUM(InternalFormat, GLint,
 	RGBA8        = GL_RGBA8,
 	SRGBA        = GL_SRGB8_ALPHA8,
 	RGBA16       = GL_RGBA16,
-	RGB32AF      = GL_RGBA32F
+	RGB32AF      = GL_RGBA32F,
+	R32UI        = GL_R32UI
 	// Note: There are sized internal formats but there is a LOT of them
 )
 
@@ -749,9 +751,11 @@ ENUM(BlendEquation, uint32_t,
 /// </summary>
 /// <see>https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glBufferData.xhtml</see>
 ENUM(BufferType, GLenum,
-	Vertex  = GL_ARRAY_BUFFER,
-	Index   = GL_ELEMENT_ARRAY_BUFFER,
-	Uniform = GL_UNIFORM_BUFFER
+	Vertex        = GL_ARRAY_BUFFER,
+	Index         = GL_ELEMENT_ARRAY_BUFFER,
+	Uniform       = GL_UNIFORM_BUFFER,
+	ShaderStorage = GL_SHADER_STORAGE_BUFFER,
+	DrawIndirect  = GL_DRAW_INDIRECT_BUFFER
 )
 
 /// <summary>
@@ -869,6 +873,8 @@ ENUM(RenderTargetType, uint32_t,
 	 ColorRed8    = GL_R8,
 	 ColorRgb16F  = GL_RGB16F,
 	 ColorRgba16F = GL_RGBA16F,
+	 // Integer target, must be read with texelFetch or imageLoad
+	 ColorR32UI   = GL_R32UI,
 	 DepthStencil = GL_DEPTH24_STENCIL8,
 	 Depth16      = GL_DEPTH_COMPONENT16,
 	 Depth24      = GL_DEPTH_COMPONENT24,
@@ -2,6 +2,7 @@
 #include <GLM/gtc/matrix_transform.hpp>
 #include <GLM/gtc/matrix_inverse.hpp>
 #include "Utils/ResourceManager/ResourceManager.h"
+#include "Graphics/RenderState.h"
 #include <locale>
 #include <codecvt>
 
@@ -355,7 +356,7 @@ void GuiBatcher::PushScissorRect(const glm::vec2& min, const glm::vec2& max) {
 
 	// Draw current geo with the current scissor, then update it
 	Flush();
-	glScissor(minWin.x, maxWin.y, width, height);
+	RenderState::SetScissor(minWin.x, maxWin.y, width, height);
 }
 
 void GuiBatcher::PopScissorRect() {
@@ -371,7 +372,7 @@ void GuiBatcher::PopScissorRect() {
 
 	// Draw current geo with the current scissor, then update it
 	Flush();
-	glScissor(glm::min(bounds.Min.x, bounds.Max.x), glm::min(bounds.Min.y, bounds.Max.y), width, height);
+	RenderState::SetScissor(glm::min(bounds.Min.x, bounds.Max.x), glm::min(bounds.Min.y, bounds.Max.y), width, height);
 }
 
 void GuiBatcher::SetDefaultTexture(const Texture2D::Sptr& value) {
@@ -0,0 +1,164 @@
+#include "Graphics/LightClusterGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+LightClusterGrid::LightClusterGrid() :
+	_lights(),
+	_lightRanges(),
+	_lightClusters(),
+	_clusters(NUM_CLUSTERS, { 0, 0 }),
+	_lightIndices(),
+	_lightBuffer(nullptr),
+	_clusterBuffer(nullptr),
+	_indexBuffer(nullptr)
+{
+	_lightBuffer   = ShaderStorageBuffer::Create(BufferUsage::StreamDraw);
+	_clusterBuffer = ShaderStorageBuffer::Create(BufferUsage::StreamDraw);
+	_indexBuffer   = ShaderStorageBuffer::Create(BufferUsage::StreamDraw);
+
+	// Make sure every buffer has some storage, so that binding them before the first build is valid
+	_lightBuffer->LoadData<GpuLight>(nullptr, 1);
+	_clusterBuffer->LoadData(_clusters.data(), NUM_CLUSTERS);
+	_indexBuffer->LoadData<uint32_t>(nullptr, 1);
+}
+
+void LightClusterGrid::Clear() {
+	_lights.clear();
+	_lightRanges.clear();
+}
+
+void LightClusterGrid::AddLight(const glm::vec3& viewPos, const glm::vec3& color, float intensity, float attenuation) {
+	_lights.push_back({ glm::vec4(viewPos, intensity), glm::vec4(color, attenuation) });
+	_lightRanges.push_back(CalculateRange(color, intensity, attenuation));
+}
+
+void LightClusterGrid::Build(const glm::mat4& projection, float zNear, float zFar) {
+	// First pass, find out which clusters each light touches and count the lights per cluster
+	std::fill(_clusters.begin(), _clusters.end(), Cluster{ 0, 0 });
+	_lightClusters.resize(_lights.size());
+	for (size_t ix = 0; ix < _lights.size(); ix++) {
+		ClusterRange& range = _lightClusters[ix];
+		if (!_CalculateClusterRange(glm::vec3(_lights[ix].PositionIntensity), _lightRanges[ix], projection, zNear, zFar, range)) {
+			// Mark the range as empty so the second pass skips it
+			range.Min = glm::uvec3(1);
+			range.Max = glm::uvec3(0);
+			continue;
+		}
+		for (uint32_t z = range.Min.z; z <= range.Max.z; z++) {
+			for (uint32_t y = range.Min.y; y <= range.Max.y; y++) {
+				for (uint32_t x = range.Min.x; x <= range.Max.x; x++) {
+					_clusters[x + CLUSTERS_X * (y + CLUSTERS_Y * z)].Count++;
+				}
+			}
+		}
+	}
+
+	// Prefix sum the counts to get where each cluster's list starts
+	uint32_t total = 0;
+	for (Cluster& cluster : _clusters) {
+		cluster.Offset = total;
+		total += cluster.Count;
+		// We re-use count as a cursor while filling the index list
+		cluster.Count = 0;
+	}
+
+	// Second pass, write the light indices into each cluster's list
+	_lightIndices.resize(total);
+	for (uint32_t ix = 0; ix < _lightClusters.size(); ix++) {
+		const ClusterRange& range = _lightClusters[ix];
+		for (uint32_t z = range.Min.z; z <= range.Max.z; z++) {
+			for (uint32_t y = range.Min.y; y <= range.Max.y; y++) {
+				for (uint32_t x = range.Min.x; x <= range.Max.x; x++) {
+					Cluster& cluster = _clusters[x + CLUSTERS_X * (y + CLUSTERS_Y * z)];
+					_lightIndices[cluster.Offset + cluster.Count++] = ix;
+				}
+			}
+		}
+	}
+
+	// Upload everything, note that buffers can't be empty so we always upload at least one element
+	if (!_lights.empty()) {
+		_lightBuffer->LoadData(_lights.data(), static_cast<uint32_t>(_lights.size()));
+	}
+	_clusterBuffer->LoadData(_clusters.data(), NUM_CLUSTERS);
+	if (!_lightIndices.empty()) {
+		_indexBuffer->LoadData(_lightIndices.data(), static_cast<uint32_t>(_lightIndices.size()));
+	}
+}
+
+void LightClusterGrid::Bind(uint32_t lightSlot, uint32_t clusterSlot, uint32_t indexSlot) const {
+	_lightBuffer->Bind(lightSlot);
+	_clusterBuffer->Bind(clusterSlot);
+	_indexBuffer->Bind(indexSlot);
+}
+
+float LightClusterGrid::CalculateRange(const glm::vec3& color, float intensity, float attenuation) {
+	// Our lights fall off as intensity / (1 + attenuation * d^2), so we solve for the distance where a light's
+	// brightest channel drops below what an 8 bit target can display
+	const float threshold = 1.0f / 256.0f;
+	float brightness = intensity * std::max(color.r, std::max(color.g, color.b));
+	if (brightness <= threshold) {
+		return 0.0f;
+	}
+	if (attenuation <= 0.0f) {
+		return std::numeric_limits<float>::max();
+	}
+	return std::sqrt((brightness / threshold - 1.0f) / attenuation);
+}
+
+uint32_t LightClusterGrid::_GetSlice(float depth, float zNear, float zFar) {
+	// Exponential slices, must match GetClusterSlice in light_accumulation.glsl
+	float slice = std::log(std::max(depth, zNear) / zNear) / std::log(zFar / zNear) * CLUSTERS_Z;
+	return static_cast<uint32_t>(glm::clamp(slice, 0.0f, (float)(CLUSTERS_Z - 1)));
+}
+
+bool LightClusterGrid::_CalculateClusterRange(const glm::vec3& viewPos, float range, const glm::mat4& projection, float zNear, float zFar, ClusterRange& result) {
+	if (range <= 0.0f) {
+		return false;
+	}
+
+	// View space looks down -Z, so we flip to get a positive depth
+	float depth = -viewPos.z;
+	if (depth + range < zNear || depth - range > zFar) {
+		return false;
+	}
+	result.Min.z = _GetSlice(depth - range, zNear, zFar);
+	result.Max.z = _GetSlice(depth + range, zNear, zFar);
+
+	// If the light's sphere crosses the near plane, projecting it isn't reliable, so we'll just cover the whole screen
+	glm::vec2 ndcMin(-1.0f);
+	glm::vec2 ndcMax(1.0f);
+	if (depth - range > zNear) {
+		// Project the corners of the sphere's bounding box, and take the screen space bounds of the results
+		ndcMin = glm::vec2(std::numeric_limits<float>::max());
+		ndcMax = glm::vec2(-std::numeric_limits<float>::max());
+		for (int ix = 0; ix < 8; ix++) {
+			glm::vec3 corner = viewPos + glm::vec3(
+				(ix & 1) ? range : -range,
+				(ix & 2) ? range : -range,
+				(ix & 4) ? range : -range
+			);
+			glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+			glm::vec2 ndc = glm::vec2(clip) / clip.w;
+			ndcMin = glm::min(ndcMin, ndc);
+			ndcMax = glm::max(ndcMax, ndc);
+		}
+
+		// Reject lights that are entirely off screen
+		if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f) {
+			return false;
+		}
+	}
+
+	// Convert from NDC to cluster coordinates, these match the screen UVs the lighting pass uses
+	glm::vec2 dims((float)CLUSTERS_X, (float)CLUSTERS_Y);
+	glm::vec2 minCluster = glm::clamp((ndcMin * 0.5f + 0.5f) * dims, glm::vec2(0.0f), dims - 1.0f);
+	glm::vec2 maxCluster = glm::clamp((ndcMax * 0.5f + 0.5f) * dims, glm::vec2(0.0f), dims - 1.0f);
+	result.Min.x = static_cast<uint32_t>(minCluster.x);
+	result.Min.y = static_cast<uint32_t>(minCluster.y);
+	result.Max.x = static_cast<uint32_t>(maxCluster.x);
+	result.Max.y = static_cast<uint32_t>(maxCluster.y);
+
+	return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
+
+/// <summary>
+/// Assigns point lights to a grid of view space clusters (froxels), so that deferred lighting only needs to
+/// evaluate the lights that can actually reach a pixel. The grid is split evenly in screen space, and
+/// exponentially in depth so that clusters stay roughly cube shaped
+///
+/// Lights, the per-cluster light lists and the light indices are stored in shader storage buffers, see
+/// fragment_shaders/light_accumulation.glsl for how they are consumed
+/// </summary>
+class LightClusterGrid final {
+public:
+	MAKE_PTRS(LightClusterGrid);
+
+	// The number of clusters along each axis of the grid, must match light_accumulation.glsl
+	static const uint32_t CLUSTERS_X = 16;
+	static const uint32_t CLUSTERS_Y = 9;
+	static const uint32_t CLUSTERS_Z = 24;
+	static const uint32_t NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+	// Matches the Light struct in light_accumulation.glsl
+	struct GpuLight {
+		// View space position in xyz, intensity in w
+		glm::vec4 PositionIntensity;
+		// Color in rgb, attenuation in w
+		glm::vec4 ColorAttenuation;
+	};
+
+	// Matches the Cluster struct in light_accumulation.glsl
+	struct Cluster {
+		// The index of the first entry for this cluster in the light index list
+		uint32_t Offset;
+		// The number of lights that touch this cluster
+		uint32_t Count;
+	};
+
+	LightClusterGrid();
+	~LightClusterGrid() = default;
+
+	/// <summary>
+	/// Removes all lights from the grid
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Adds a point light to the grid, lights must be added before calling Build
+	/// </summary>
+	/// <param name="viewPos">The light's position in view space</param>
+	/// <param name="color">The color of the light</param>
+	/// <param name="intensity">The intensity multiplier for the light</param>
+	/// <param name="attenuation">The quadratic attenuation factor for the light</param>
+	void AddLight(const glm::vec3& viewPos, const glm::vec3& color, float intensity, float attenuation);
+
+	/// <summary>
+	/// Bins all the lights into clusters for the given camera, and uploads the results to the GPU
+	/// </summary>
+	/// <param name="projection">The camera's projection matrix</param>
+	/// <param name="zNear">The camera's near plane distance</param>
+	/// <param name="zFar">The camera's far plane distance</param>
+	void Build(const glm::mat4& projection, float zNear, float zFar);
+
+	/// <summary>
+	/// Binds the light, cluster and light index buffers to the given shader storage slots
+	/// </summary>
+	void Bind(uint32_t lightSlot, uint32_t clusterSlot, uint32_t indexSlot) const;
+
+	size_t GetLightCount() const { return _lights.size(); }
+	/// <summary>
+	/// Gets the total number of light/cluster pairs from the last build, useful for seeing how well the grid fits the scene
+	/// </summary>
+	size_t GetAssignmentCount() const { return _lightIndices.size(); }
+
+	/// <summary>
+	/// Gets the distance at which a light's contribution becomes too small to see, lights are only assigned
+	/// to clusters within this distance
+	/// </summary>
+	static float CalculateRange(const glm::vec3& color, float intensity, float attenuation);
+
+protected:
+	// The range of clusters that a light touches, inclusive
+	struct ClusterRange {
+		glm::uvec3 Min;
+		glm::uvec3 Max;
+	};
+
+	std::vector<GpuLight>     _lights;
+	std::vector<float>        _lightRanges;
+	std::vector<ClusterRange> _lightClusters;
+
+	std::vector<Cluster>      _clusters;
+	std::vector<uint32_t>     _lightIndices;
+
+	ShaderStorageBuffer::Sptr _lightBuffer;
+	ShaderStorageBuffer::Sptr _clusterBuffer;
+	ShaderStorageBuffer::Sptr _indexBuffer;
+
+	/// <summary>
+	/// Gets the depth slice that a positive view space depth falls into
+	/// </summary>
+	static uint32_t _GetSlice(float depth, float zNear, float zFar);
+	/// <summary>
+	/// Determines which clusters a light's sphere of influence overlaps
+	/// </summary>
+	/// <returns>False if the light does not touch any clusters</returns>
+	static bool _CalculateClusterRange(const glm::vec3& viewPos, float range, const glm::mat4& projection, float zNear, float zFar, ClusterRange& result);
+};
@@ -0,0 +1,285 @@
+#include "Graphics/OcclusionBuffer.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstring>
+#include <emmintrin.h>
+#include <Logging.h>
+
+OccluderMesh::Sptr OccluderMesh::FromVertexArray(const VertexArrayObject::Sptr& vao) {
+	if (vao == nullptr) {
+		return nullptr;
+	}
+
+	// Find the position attribute and the buffer that feeds it
+	const VertexArrayObject::VertexBufferBinding* binding = vao->GetBufferBinding(AttribUsage::Position);
+	if (binding == nullptr) {
+		LOG_WARN("Mesh does not have a position attribute, cannot use it as an occluder");
+		return nullptr;
+	}
+	auto it = std::find_if(binding->GetAttributes().begin(), binding->GetAttributes().end(), [](const BufferAttribute& attrib) {
+		return attrib.Usage == AttribUsage::Position;
+	});
+	if (it == binding->GetAttributes().end() || it->Type != AttributeType::Float || it->Size < 3) {
+		LOG_WARN("Mesh positions are not stored as floats, cannot use it as an occluder");
+		return nullptr;
+	}
+
+	OccluderMesh::Sptr result = std::make_shared<OccluderMesh>();
+
+	// Read the vertex data back into CPU memory, and pull out the positions
+	const VertexBuffer::Sptr& buffer = binding->GetBuffer();
+	size_t stride = it->Stride != 0 ? it->Stride : sizeof(glm::vec3);
+	size_t vertexCount = buffer->GetTotalSize() / stride;
+	std::vector<uint8_t> vertexStore(buffer->GetTotalSize());
+	glGetNamedBufferSubData(buffer->GetHandle(), 0, buffer->GetTotalSize(), vertexStore.data());
+
+	result->Positions.resize(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		memcpy(&result->Positions[ix], vertexStore.data() + ix * stride + it->Offset, sizeof(glm::vec3));
+	}
+
+	// Widen the indices to 32 bits, or generate them if the mesh is not indexed
+	IndexBuffer::Sptr indexBuffer = vao->GetIndexBuffer();
+	if (indexBuffer != nullptr) {
+		std::vector<uint8_t> indexStore(indexBuffer->GetTotalSize());
+		glGetNamedBufferSubData(indexBuffer->GetHandle(), 0, indexBuffer->GetTotalSize(), indexStore.data());
+
+		result->Indices.resize(indexBuffer->GetElementCount());
+		for (size_t ix = 0; ix < result->Indices.size(); ix++) {
+			switch (indexBuffer->GetElementType()) {
+				case IndexType::UByte:
+					result->Indices[ix] = indexStore[ix];
+					break;
+				case IndexType::UShort:
+					result->Indices[ix] = reinterpret_cast<const uint16_t*>(indexStore.data())[ix];
+					break;
+				case IndexType::UInt:
+				default:
+					result->Indices[ix] = reinterpret_cast<const uint32_t*>(indexStore.data())[ix];
+					break;
+			}
+		}
+	} else {
+		result->Indices.resize(vertexCount);
+		std::iota(result->Indices.begin(), result->Indices.end(), 0);
+	}
+
+	// Drop any trailing indices that don't make up a full triangle, and any that are out of range
+	result->Indices.resize(result->Indices.size() - result->Indices.size() % 3);
+	for (uint32_t index : result->Indices) {
+		if (index >= vertexCount) {
+			LOG_WARN("Mesh has indices that are out of range, cannot use it as an occluder");
+			return nullptr;
+		}
+	}
+
+	return result;
+}
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) :
+	_width((width + 3) & ~3u),
+	_height(height),
+	_depth(),
+	_clipPositions()
+{
+	LOG_ASSERT(width > 0 && height > 0, "Occlusion buffer must have a non-zero size");
+	_depth.resize(static_cast<size_t>(_width) * _height, 0.0f);
+}
+
+void OcclusionBuffer::Clear() {
+	std::fill(_depth.begin(), _depth.end(), 0.0f);
+}
+
+void OcclusionBuffer::RenderOccluder(const OccluderMesh& mesh, const glm::mat4& modelViewProjection) {
+	// Transform every vertex once, since they'll be shared between triangles
+	_clipPositions.resize(mesh.Positions.size());
+	for (size_t ix = 0; ix < mesh.Positions.size(); ix++) {
+		_clipPositions[ix] = modelViewProjection * glm::vec4(mesh.Positions[ix], 1.0f);
+	}
+
+	for (size_t ix = 0; ix + 2 < mesh.Indices.size(); ix += 3) {
+		const glm::vec4& a = _clipPositions[mesh.Indices[ix + 0]];
+		const glm::vec4& b = _clipPositions[mesh.Indices[ix + 1]];
+		const glm::vec4& c = _clipPositions[mesh.Indices[ix + 2]];
+
+		// Skip triangles that are entirely outside one of the side planes of the view volume
+		if ((a.x >  a.w && b.x >  b.w && c.x >  c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+			(a.y >  a.w && b.y >  b.w && c.y >  c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w)) {
+			continue;
+		}
+
+		_ClipAndRasterize(a, b, c);
+	}
+}
+
+bool OcclusionBuffer::IsVisible(const Bounds& bounds, const glm::mat4& modelViewProjection) const {
+	// Objects without bounds can't be tested
+	if (!bounds.IsValid) {
+		return true;
+	}
+
+	// Find the screen rectangle covered by the box, and the depth of the nearest corner
+	glm::vec2 minPos = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 maxPos = glm::vec2(std::numeric_limits<float>::lowest());
+	float nearest = 0.0f;
+	for (int ix = 0; ix < 8; ix++) {
+		glm::vec3 corner = glm::vec3(
+			(ix & 1) ? bounds.Max.x : bounds.Min.x,
+			(ix & 2) ? bounds.Max.y : bounds.Min.y,
+			(ix & 4) ? bounds.Max.z : bounds.Min.z
+		);
+		glm::vec4 clip = modelViewProjection * glm::vec4(corner, 1.0f);
+
+		// If the box crosses the near plane we can't project it, so we have to assume it can be seen
+		if (clip.w <= 0.0f || clip.z < -clip.w) {
+			return true;
+		}
+
+		glm::vec3 screen = _ToScreen(clip);
+		minPos = glm::min(minPos, glm::vec2(screen));
+		maxPos = glm::max(maxPos, glm::vec2(screen));
+		nearest = glm::max(nearest, screen.z);
+	}
+
+	// Boxes that are off screen are left for frustum culling to deal with
+	if (maxPos.x < 0.0f || maxPos.y < 0.0f || minPos.x >= _width || minPos.y >= _height) {
+		return true;
+	}
+
+	// Any extra pixels we touch by aligning the rows to groups of 4 can only make the test more conservative
+	int minX = static_cast<int>(glm::max(minPos.x, 0.0f)) & ~3;
+	int maxX = static_cast<int>(glm::min(maxPos.x, _width - 1.0f));
+	int minY = static_cast<int>(glm::max(minPos.y, 0.0f));
+	int maxY = static_cast<int>(glm::min(maxPos.y, _height - 1.0f));
+
+	// The box can be seen if any pixel in the rectangle has an occluder depth further away than the box
+	const __m128 objectDepth = _mm_set1_ps(nearest);
+	for (int y = minY; y <= maxY; y++) {
+		const float* row = _depth.data() + static_cast<size_t>(y) * _width;
+		for (int x = minX; x <= maxX; x += 4) {
+			__m128 occluderDepth = _mm_loadu_ps(row + x);
+			if (_mm_movemask_ps(_mm_cmple_ps(occluderDepth, objectDepth)) != 0) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionBuffer::_ClipAndRasterize(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+	// The near plane is where z = -w in clip space, we keep the side where z + w >= 0. Clipping a triangle
+	// against a single plane will leave us with at most 4 vertices
+	const glm::vec4* input[3] = { &a, &b, &c };
+	glm::vec4 polygon[4];
+	int count = 0;
+	for (int ix = 0; ix < 3; ix++) {
+		const glm::vec4& p = *input[ix];
+		const glm::vec4& q = *input[(ix + 1) % 3];
+		float pDist = p.z + p.w;
+		float qDist = q.z + q.w;
+		if (pDist >= 0.0f) {
+			polygon[count++] = p;
+		}
+		if ((pDist >= 0.0f) != (qDist >= 0.0f)) {
+			polygon[count++] = glm::mix(p, q, pDist / (pDist - qDist));
+		}
+	}
+
+	if (count >= 3) {
+		_RasterizeTriangle(polygon[0], polygon[1], polygon[2]);
+	}
+	if (count == 4) {
+		_RasterizeTriangle(polygon[0], polygon[2], polygon[3]);
+	}
+}
+
+void OcclusionBuffer::_RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+	if (a.w <= 0.0f || b.w <= 0.0f || c.w <= 0.0f) {
+		return;
+	}
+
+	glm::vec3 v0 = _ToScreen(a);
+	glm::vec3 v1 = _ToScreen(b);
+	glm::vec3 v2 = _ToScreen(c);
+
+	// We draw both sides of every triangle, so clockwise triangles are flipped around
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (area < 0.0f) {
+		std::swap(v1, v2);
+		area = -area;
+	}
+	if (area < 1e-6f) {
+		return;
+	}
+
+	// Find the pixels that the triangle could cover, and bail if it's entirely off screen
+	glm::vec2 minPos = glm::min(glm::vec2(v0), glm::min(glm::vec2(v1), glm::vec2(v2)));
+	glm::vec2 maxPos = glm::max(glm::vec2(v0), glm::max(glm::vec2(v1), glm::vec2(v2)));
+	if (maxPos.x < 0.0f || maxPos.y < 0.0f || minPos.x >= _width || minPos.y >= _height) {
+		return;
+	}
+	// Rows are processed in groups of 4 pixels, so we align the start
+	int minX = static_cast<int>(glm::max(minPos.x, 0.0f)) & ~3;
+	int maxX = static_cast<int>(glm::min(maxPos.x, _width - 1.0f));
+	int minY = static_cast<int>(glm::max(minPos.y, 0.0f));
+	int maxY = static_cast<int>(glm::min(maxPos.y, _height - 1.0f));
+
+	// Each edge function is positive on the inside of the edge, and is linear in x and y, so we store the
+	// value at the origin, and how much it changes per pixel. The edge opposite a vertex is also the vertex's
+	// barycentric weight (scaled by the area), which we use to interpolate depth
+	auto edge = [](const glm::vec3& p, const glm::vec3& q, float& origin, float& dx, float& dy) {
+		dx = -(q.y - p.y);
+		dy = q.x - p.x;
+		origin = (q.x - p.x) * -p.y + (q.y - p.y) * p.x;
+	};
+	float e0, e0dx, e0dy, e1, e1dx, e1dy, e2, e2dx, e2dy;
+	edge(v1, v2, e0, e0dx, e0dy);
+	edge(v2, v0, e1, e1dx, e1dy);
+	edge(v0, v1, e2, e2dx, e2dy);
+
+	float invArea = 1.0f / area;
+	float zdx = (e0dx * v0.z + e1dx * v1.z + e2dx * v2.z) * invArea;
+	float zdy = (e0dy * v0.z + e1dy * v1.z + e2dy * v2.z) * invArea;
+	// We sample depth at pixel centers, so we push it back to the furthest point the triangle could reach in the pixel
+	float z = (e0 * v0.z + e1 * v1.z + e2 * v2.z) * invArea - 0.5f * (glm::abs(zdx) + glm::abs(zdy));
+
+	const __m128 zero    = _mm_setzero_ps();
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 e0dx4   = _mm_set1_ps(e0dx);
+	const __m128 e1dx4   = _mm_set1_ps(e1dx);
+	const __m128 e2dx4   = _mm_set1_ps(e2dx);
+	const __m128 zdx4    = _mm_set1_ps(zdx);
+
+	for (int y = minY; y <= maxY; y++) {
+		float py = y + 0.5f;
+		__m128 rowE0 = _mm_set1_ps(e0 + e0dy * py);
+		__m128 rowE1 = _mm_set1_ps(e1 + e1dy * py);
+		__m128 rowE2 = _mm_set1_ps(e2 + e2dy * py);
+		__m128 rowZ  = _mm_set1_ps(z  + zdy  * py);
+
+		float* row = _depth.data() + static_cast<size_t>(y) * _width;
+		for (int x = minX; x <= maxX; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+			__m128 w0 = _mm_add_ps(rowE0, _mm_mul_ps(e0dx4, px));
+			__m128 w1 = _mm_add_ps(rowE1, _mm_mul_ps(e1dx4, px));
+			__m128 w2 = _mm_add_ps(rowE2, _mm_mul_ps(e2dx4, px));
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+
+			// Pixels outside of the triangle get a depth of 0, which will never replace what's in the buffer
+			__m128 depth = _mm_and_ps(inside, _mm_add_ps(rowZ, _mm_mul_ps(zdx4, px)));
+			_mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), depth));
+		}
+	}
+}
+
+glm::vec3 OcclusionBuffer::_ToScreen(const glm::vec4& clip) const {
+	glm::vec3 ndc = glm::vec3(clip) / clip.w;
+	return glm::vec3(
+		(ndc.x * 0.5f + 0.5f) * _width,
+		(ndc.y * 0.5f + 0.5f) * _height,
+		0.5f - ndc.z * 0.5f
+	);
+}
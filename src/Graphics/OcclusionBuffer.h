@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/Bounds.h"
+#include "Graphics/VertexArrayObject.h"
+
+/// <summary>
+/// The CPU side triangles of a mesh, for rasterizing into an occlusion buffer
+/// </summary>
+struct OccluderMesh {
+	MAKE_PTRS(OccluderMesh);
+
+	/// <summary>
+	/// The local space positions of the mesh's vertices
+	/// </summary>
+	std::vector<glm::vec3> Positions;
+	/// <summary>
+	/// The mesh's triangle list, as indices into Positions
+	/// </summary>
+	std::vector<uint32_t>  Indices;
+
+	/// <summary>
+	/// Creates occluder geometry for a triangle list VAO, by reading the positions and indices back from
+	/// OpenGL. This should only be used at load time, as reading from a buffer will stall the pipeline
+	/// </summary>
+	/// <param name="vao">The VAO to read the geometry from</param>
+	/// <returns>The occluder geometry, or nullptr if the VAO's positions are not stored as floats</returns>
+	static OccluderMesh::Sptr FromVertexArray(const VertexArrayObject::Sptr& vao);
+};
+
+/// <summary>
+/// A small software depth buffer, which a few large occluders (walls, terrain, buildings) are rasterized
+/// into on the CPU, so that objects hidden behind them can be skipped before we submit any draws.
+///
+/// The buffer stores a reversed depth for every pixel (1 at the near plane, 0 at the far plane), which is linear
+/// in screen space for both perspective and orthographic cameras, so 0 means that nothing has been drawn.
+/// Occluder depths are pushed back by their slope across a pixel so the buffer is conservative, and objects
+/// are tested with the nearest depth of their bounding box. Rows are processed 4 pixels at a
+/// time with SSE2. This class does not use OpenGL, so it can be used on machines without a GPU
+/// </summary>
+class OcclusionBuffer {
+public:
+	MAKE_PTRS(OcclusionBuffer);
+
+	/// <summary>
+	/// Creates a new occlusion buffer
+	/// </summary>
+	/// <param name="width">The width of the buffer in pixels, will be rounded up to a multiple of 4</param>
+	/// <param name="height">The height of the buffer in pixels</param>
+	OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+	~OcclusionBuffer() = default;
+
+	/// <summary>
+	/// Clears the buffer so that nothing is occluded
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Rasterizes an occluder into the buffer. Both sides of every triangle are drawn, and triangles are
+	/// clipped against the near plane
+	/// </summary>
+	/// <param name="mesh">The occluder's triangles</param>
+	/// <param name="modelViewProjection">The matrix that takes the mesh to clip space</param>
+	void RenderOccluder(const OccluderMesh& mesh, const glm::mat4& modelViewProjection);
+
+	/// <summary>
+	/// Tests whether any part of a bounding box could be seen past the occluders. This does not modify the
+	/// buffer, so it is safe to test many objects at the same time from different threads
+	/// </summary>
+	/// <param name="bounds">The local space bounds to test</param>
+	/// <param name="modelViewProjection">The matrix that takes the bounds to clip space</param>
+	/// <returns>False if the box is entirely hidden, true if it could be visible</returns>
+	bool IsVisible(const Bounds& bounds, const glm::mat4& modelViewProjection) const;
+
+	uint32_t GetWidth() const { return _width; }
+	uint32_t GetHeight() const { return _height; }
+	/// <summary>
+	/// Gets the raw contents of the buffer, with rows stored bottom to top
+	/// </summary>
+	const std::vector<float>& GetData() const { return _depth; }
+
+protected:
+	uint32_t           _width;
+	uint32_t           _height;
+	std::vector<float> _depth;
+	// Scratch space for the clip space positions of the occluder being drawn
+	std::vector<glm::vec4> _clipPositions;
+
+	/// <summary>
+	/// Clips a triangle against the near plane, then rasterizes what's left
+	/// </summary>
+	void _ClipAndRasterize(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	/// <summary>
+	/// Rasterizes a triangle where all the vertices are in front of the near plane
+	/// </summary>
+	void _RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	/// <summary>
+	/// Converts a clip space position into pixel coordinates, with the reversed depth stored in z
+	/// </summary>
+	glm::vec3 _ToScreen(const glm::vec4& clip) const;
+};
@@ -0,0 +1,206 @@
+#include "Graphics/RenderGraph.h"
+#include <algorithm>
+#include <Logging.h>
+
+// Pooled targets that go unused for this many frames are destroyed
+static const uint32_t POOL_RETAIN_FRAMES = 3;
+
+void RenderGraph::PassBuilder::Read(Resource resource) {
+	LOG_ASSERT(resource < _graph._resources.size(), "Pass \"{}\" is reading an invalid resource", _graph._passes[_pass].Name);
+	_graph._passes[_pass].Reads.push_back({ resource, _graph._resources[resource].Version });
+}
+
+void RenderGraph::PassBuilder::Write(Resource resource) {
+	// Drawing on top of the existing contents needs the previous version of the resource
+	Read(resource);
+	Overwrite(resource);
+}
+
+void RenderGraph::PassBuilder::Overwrite(Resource resource) {
+	LOG_ASSERT(resource < _graph._resources.size(), "Pass \"{}\" is writing an invalid resource", _graph._passes[_pass].Name);
+	ResourceEntry& entry = _graph._resources[resource];
+	entry.Version++;
+	_graph._passes[_pass].Writes.push_back({ resource, entry.Version });
+}
+
+RenderGraph::Resource RenderGraph::PassBuilder::Create(const std::string& name, const TargetDescriptor& descriptor) {
+	Resource result = static_cast<Resource>(_graph._resources.size());
+	_graph._resources.push_back({ name, descriptor, false, false, 0, nullptr, -1, -1, -1 });
+	_graph._passes[_pass].Creates.push_back(result);
+	Overwrite(result);
+	return result;
+}
+
+RenderGraph::RenderGraph() :
+	_resources(),
+	_passes(),
+	_pool(),
+	_frame(0),
+	_stats()
+{ }
+
+void RenderGraph::Reset() {
+	_resources.clear();
+	_passes.clear();
+	_frame++;
+
+	// Let go of targets that nothing has asked for in a while (ex: after an effect was disabled, or the window was resized)
+	_pool.erase(std::remove_if(_pool.begin(), _pool.end(), [&](const PooledTarget& target) {
+		return _frame - target.LastUsedFrame > POOL_RETAIN_FRAMES;
+	}), _pool.end());
+}
+
+RenderGraph::Resource RenderGraph::Import(const std::string& name, const Framebuffer::Sptr& buffer) {
+	Resource result = static_cast<Resource>(_resources.size());
+	TargetDescriptor descriptor = { 0, 0, RenderTargetType::Unknown };
+	if (buffer != nullptr) {
+		descriptor.Width  = buffer->GetWidth();
+		descriptor.Height = buffer->GetHeight();
+	}
+	_resources.push_back({ name, descriptor, true, false, 0, buffer, -1, -1, -1 });
+	return result;
+}
+
+void RenderGraph::MarkOutput(Resource resource) {
+	LOG_ASSERT(resource < _resources.size(), "Invalid render graph resource");
+	_resources[resource].Output = true;
+}
+
+RenderGraph::Resource RenderGraph::Find(const std::string& name) const {
+	for (uint32_t ix = 0; ix < _resources.size(); ix++) {
+		if (_resources[ix].Name == name) {
+			return ix;
+		}
+	}
+	return InvalidResource;
+}
+
+void RenderGraph::AddPass(const std::string& name, const SetupFunc& setup, const ExecuteFunc& execute) {
+	_passes.push_back({ name, execute, {}, {}, {}, false });
+	PassBuilder builder(*this, static_cast<uint32_t>(_passes.size() - 1));
+	setup(builder);
+}
+
+void RenderGraph::Execute() {
+	_Compile();
+
+	_stats = Stats();
+	for (PooledTarget& target : _pool) {
+		target.UsedThisFrame = false;
+	}
+
+	for (uint32_t ix = 0; ix < _passes.size(); ix++) {
+		PassEntry& pass = _passes[ix];
+		if (pass.Culled) {
+			_stats.PassesCulled++;
+			continue;
+		}
+
+		// Transient targets are always first used by the pass that creates them, so this is where they get their memory
+		for (Resource id : pass.Creates) {
+			ResourceEntry& resource = _resources[id];
+			resource.PoolIndex = _AcquireTarget(resource.Descriptor);
+			resource.Buffer = _pool[resource.PoolIndex].Buffer;
+			_stats.TransientResources++;
+		}
+
+		pass.Execute(*this);
+		_stats.PassesExecuted++;
+
+		// Hand back the targets that no later pass needs, so their memory can be re-used by the rest of the frame
+		for (ResourceEntry& resource : _resources) {
+			if (!resource.Imported && resource.LastPass == (int)ix && resource.PoolIndex >= 0) {
+				_pool[resource.PoolIndex].InUse = false;
+				resource.PoolIndex = -1;
+				resource.Buffer = nullptr;
+			}
+		}
+	}
+
+	for (const PooledTarget& target : _pool) {
+		if (target.UsedThisFrame) {
+			_stats.TransientTargets++;
+		}
+	}
+	_stats.PooledTargets = static_cast<uint32_t>(_pool.size());
+}
+
+const Framebuffer::Sptr& RenderGraph::GetFramebuffer(Resource resource) const {
+	LOG_ASSERT(resource < _resources.size(), "Invalid render graph resource");
+	return _resources[resource].Buffer;
+}
+
+RenderGraph::TargetDescriptor RenderGraph::GetDescriptor(Resource resource) const {
+	LOG_ASSERT(resource < _resources.size(), "Invalid render graph resource");
+	return _resources[resource].Descriptor;
+}
+
+void RenderGraph::_Compile() {
+	// Walk backwards from the final versions of our outputs, a pass is only needed if something
+	// needed reads one of the versions it writes
+	std::vector<ResourceVersion> needed;
+	for (uint32_t ix = 0; ix < _resources.size(); ix++) {
+		if (_resources[ix].Output && _resources[ix].Version > 0) {
+			needed.push_back({ ix, _resources[ix].Version });
+		}
+	}
+	for (int ix = static_cast<int>(_passes.size()) - 1; ix >= 0; ix--) {
+		PassEntry& pass = _passes[ix];
+		pass.Culled = std::none_of(pass.Writes.begin(), pass.Writes.end(), [&](const ResourceVersion& write) {
+			return std::find(needed.begin(), needed.end(), write) != needed.end();
+		});
+		if (!pass.Culled) {
+			needed.insert(needed.end(), pass.Reads.begin(), pass.Reads.end());
+		}
+	}
+
+	// Find the range of passes that use each resource, transient targets only need memory during that range
+	for (ResourceEntry& resource : _resources) {
+		resource.FirstPass = -1;
+		resource.LastPass = -1;
+	}
+	for (int ix = 0; ix < static_cast<int>(_passes.size()); ix++) {
+		const PassEntry& pass = _passes[ix];
+		if (pass.Culled) {
+			continue;
+		}
+		auto use = [&](const ResourceVersion& version) {
+			ResourceEntry& resource = _resources[version.Id];
+			if (resource.FirstPass < 0) {
+				resource.FirstPass = ix;
+			}
+			resource.LastPass = ix;
+		};
+		std::for_each(pass.Reads.begin(), pass.Reads.end(), use);
+		std::for_each(pass.Writes.begin(), pass.Writes.end(), use);
+	}
+}
+
+int RenderGraph::_AcquireTarget(const TargetDescriptor& descriptor) {
+	int result = -1;
+	for (int ix = 0; ix < static_cast<int>(_pool.size()); ix++) {
+		if (!_pool[ix].InUse && _pool[ix].Descriptor == descriptor) {
+			result = ix;
+			break;
+		}
+	}
+
+	if (result < 0) {
+		FramebufferDescriptor fboDesc;
+		fboDesc.Width  = descriptor.Width;
+		fboDesc.Height = descriptor.Height;
+		fboDesc.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(descriptor.Format);
+
+		Framebuffer::Sptr buffer = std::make_shared<Framebuffer>(fboDesc);
+		buffer->SetDebugName("Render Graph Target " + std::to_string(_pool.size()));
+
+		result = static_cast<int>(_pool.size());
+		_pool.push_back({ descriptor, buffer, false, false, _frame });
+	}
+
+	PooledTarget& target = _pool[result];
+	target.InUse         = true;
+	target.UsedThisFrame = true;
+	target.LastUsedFrame = _frame;
+	return result;
+}
@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Utils/Macros.h"
+#include "Graphics/Framebuffer.h"
+
+/// <summary>
+/// A render graph collects the passes for a frame, along with the render targets that each pass reads and writes,
+/// before anything is drawn. When the graph is executed it:
+///  - Culls passes whose results are never read, and never reach one of the graph's outputs (ex: the back buffer)
+///  - Allocates transient render targets from a pool right before the first pass that uses them, and returns them
+///    right after the last, so that targets whose lifetimes don't overlap share the same memory
+///
+/// Passes run in the order they were added. A pass can only read a version of a resource written by an earlier
+/// pass, so this is always a valid order.
+///
+/// Resources are either imported (framebuffers that live outside of the graph, such as the G-Buffer), or transient
+/// targets created by a pass, which only exist while the graph is executing. Handles are only valid for the frame
+/// they were created in
+/// </summary>
+class RenderGraph final {
+public:
+	MAKE_PTRS(RenderGraph);
+
+	typedef uint32_t Resource;
+	static const Resource InvalidResource = UINT32_MAX;
+
+	/// <summary>
+	/// Describes a transient render target, these have a single color attachment
+	/// </summary>
+	struct TargetDescriptor {
+		uint32_t         Width;
+		uint32_t         Height;
+		RenderTargetType Format;
+
+		bool operator ==(const TargetDescriptor& other) const {
+			return Width == other.Width && Height == other.Height && Format == other.Format;
+		}
+	};
+
+	/// <summary>
+	/// Counters for the last frame that the graph executed
+	/// </summary>
+	struct Stats {
+		// Number of passes that ran
+		uint32_t PassesExecuted = 0;
+		// Number of passes that were skipped because nothing used their results
+		uint32_t PassesCulled = 0;
+		// Number of transient targets that the passes asked for
+		uint32_t TransientResources = 0;
+		// Number of distinct framebuffers those targets were mapped to
+		uint32_t TransientTargets = 0;
+		// Number of framebuffers in the pool, including ones that were not used this frame
+		uint32_t PooledTargets = 0;
+	};
+
+	/// <summary>
+	/// Passed to a pass's setup function, to declare the resources that the pass uses
+	/// </summary>
+	class PassBuilder {
+	public:
+		/// <summary>
+		/// Declares that the pass samples from or blits from the resource
+		/// </summary>
+		void Read(Resource resource);
+		/// <summary>
+		/// Declares that the pass draws on top of the resource's existing contents
+		/// </summary>
+		void Write(Resource resource);
+		/// <summary>
+		/// Declares that the pass replaces the entire contents of the resource, so passes that wrote it
+		/// earlier are not needed for this pass
+		/// </summary>
+		void Overwrite(Resource resource);
+		/// <summary>
+		/// Creates a new transient render target that this pass writes to
+		/// </summary>
+		/// <param name="name">The name of the target, for debugging and for RenderGraph::Find</param>
+		/// <param name="descriptor">The size and format of the target</param>
+		Resource Create(const std::string& name, const TargetDescriptor& descriptor);
+
+	protected:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t pass) : _graph(graph), _pass(pass) {}
+
+		RenderGraph& _graph;
+		uint32_t     _pass;
+	};
+
+	typedef std::function<void(PassBuilder&)> SetupFunc;
+	typedef std::function<void(const RenderGraph&)> ExecuteFunc;
+
+	RenderGraph();
+	~RenderGraph() = default;
+
+	/// <summary>
+	/// Starts a new frame, clearing all of the passes and resources from the last frame. Pooled targets that
+	/// have not been used for a few frames are destroyed
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Adds a framebuffer that lives outside of the graph
+	/// </summary>
+	/// <param name="name">The name that other passes can use to find the resource</param>
+	/// <param name="buffer">The framebuffer, or nullptr for the default framebuffer</param>
+	Resource Import(const std::string& name, const Framebuffer::Sptr& buffer);
+	/// <summary>
+	/// Marks a resource as a result of the graph, passes that contribute to the final version of an output are never culled
+	/// </summary>
+	void MarkOutput(Resource resource);
+	/// <summary>
+	/// Finds a resource that was imported or created this frame by name
+	/// </summary>
+	/// <returns>The resource, or InvalidResource if no resource has that name</returns>
+	Resource Find(const std::string& name) const;
+
+	/// <summary>
+	/// Adds a pass to the graph. The setup function is called immediately to declare the pass's resources, the execute
+	/// function is called when the graph is executed, if the pass was not culled
+	/// </summary>
+	void AddPass(const std::string& name, const SetupFunc& setup, const ExecuteFunc& execute);
+
+	/// <summary>
+	/// Adds a pass to the graph, with some data that is filled in during setup (ex: the handles of the targets it creates) and
+	/// is passed along to the execute function
+	/// </summary>
+	/// <returns>The pass's data, after setup has run</returns>
+	template <typename T>
+	const T& AddPass(const std::string& name, const std::function<void(PassBuilder&, T&)>& setup, const std::function<void(const T&, const RenderGraph&)>& execute) {
+		std::shared_ptr<T> data = std::make_shared<T>();
+		AddPass(name,
+			[&](PassBuilder& builder) { setup(builder, *data); },
+			[data, execute](const RenderGraph& graph) { execute(*data, graph); }
+		);
+		return *data;
+	}
+
+	/// <summary>
+	/// Culls unused passes, then runs the rest in order
+	/// </summary>
+	void Execute();
+
+	/// <summary>
+	/// Gets the framebuffer for a resource. Transient targets only have a framebuffer while a pass that uses them is running
+	/// </summary>
+	const Framebuffer::Sptr& GetFramebuffer(Resource resource) const;
+	/// <summary>
+	/// Gets the descriptor for a resource. Imported resources use the size of their framebuffer, with an unknown format
+	/// </summary>
+	TargetDescriptor GetDescriptor(Resource resource) const;
+
+	/// <summary>
+	/// Gets the stats for the last frame that the graph executed
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// A version of a resource, each write to a resource creates a new version
+	struct ResourceVersion {
+		Resource Id;
+		uint32_t Version;
+
+		bool operator ==(const ResourceVersion& other) const { return Id == other.Id && Version == other.Version; }
+	};
+
+	struct ResourceEntry {
+		std::string       Name;
+		TargetDescriptor  Descriptor;
+		bool              Imported;
+		bool              Output;
+		uint32_t          Version;
+		// For imported resources, the framebuffer. For transients, the pooled framebuffer while it is in use
+		Framebuffer::Sptr Buffer;
+		// Index of the pooled target the transient is mapped to, while it is in use
+		int               PoolIndex;
+		// The first and last non-culled passes that use the resource, used for transient lifetimes
+		int               FirstPass;
+		int               LastPass;
+	};
+
+	struct PassEntry {
+		std::string                  Name;
+		ExecuteFunc                  Execute;
+		std::vector<ResourceVersion> Reads;
+		std::vector<ResourceVersion> Writes;
+		std::vector<Resource>        Creates;
+		bool                         Culled;
+	};
+
+	struct PooledTarget {
+		TargetDescriptor  Descriptor;
+		Framebuffer::Sptr Buffer;
+		bool              InUse;
+		bool              UsedThisFrame;
+		uint32_t          LastUsedFrame;
+	};
+
+	std::vector<ResourceEntry> _resources;
+	std::vector<PassEntry>     _passes;
+	std::vector<PooledTarget>  _pool;
+	uint32_t                   _frame;
+	Stats                      _stats;
+
+	/// <summary>
+	/// Marks passes that don't contribute to an output as culled, and works out the lifetimes of transient targets
+	/// </summary>
+	void _Compile();
+	/// <summary>
+	/// Finds a free pooled target that matches the descriptor, or creates a new one
+	/// </summary>
+	int _AcquireTarget(const TargetDescriptor& descriptor);
+};
@@ -0,0 +1,127 @@
+#include "Graphics/RenderQueue.h"
+#include <cstring>
+
+RenderQueue::RenderQueue() :
+	_packets(),
+	_scratch(),
+	_objectIds(),
+	_instanceIds(),
+	_instanceCounts()
+{ }
+
+void RenderQueue::Clear() {
+	_packets.clear();
+	_objectIds.clear();
+	_instanceIds.clear();
+	_instanceCounts.clear();
+}
+
+void RenderQueue::Reserve(size_t count) {
+	_packets.reserve(count);
+	_scratch.reserve(count);
+}
+
+void RenderQueue::Push(uint64_t key, uint32_t itemIndex) {
+	_packets.push_back({ key, itemIndex });
+}
+
+void RenderQueue::Sort() {
+	const size_t count = _packets.size();
+	if (count < 2) {
+		return;
+	}
+	_scratch.resize(count);
+
+	// Build histograms for all 8 bytes in a single pass over the keys
+	uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (const DrawPacket& packet : _packets) {
+		for (int byte = 0; byte < 8; byte++) {
+			histograms[byte][(packet.SortKey >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	DrawPacket* source = _packets.data();
+	DrawPacket* dest   = _scratch.data();
+
+	for (int byte = 0; byte < 8; byte++) {
+		uint32_t* histogram = histograms[byte];
+
+		// If every key has the same value for this byte, this pass would not change the order
+		const uint8_t firstValue = (source[0].SortKey >> (byte * 8)) & 0xFF;
+		if (histogram[firstValue] == count) {
+			continue;
+		}
+
+		// Convert counts into starting offsets
+		uint32_t offset = 0;
+		for (int ix = 0; ix < 256; ix++) {
+			uint32_t temp = histogram[ix];
+			histogram[ix] = offset;
+			offset += temp;
+		}
+
+		// Scatter, this is stable so lower bytes stay sorted
+		for (size_t ix = 0; ix < count; ix++) {
+			const uint8_t value = (source[ix].SortKey >> (byte * 8)) & 0xFF;
+			dest[histogram[value]++] = source[ix];
+		}
+
+		std::swap(source, dest);
+	}
+
+	// If we did an odd number of passes, the result is sitting in our scratch buffer
+	if (source != _packets.data()) {
+		_packets.swap(_scratch);
+	}
+}
+
+uint32_t RenderQueue::GetObjectId(const void* object) {
+	auto it = _objectIds.find(object);
+	if (it != _objectIds.end()) {
+		return it->second;
+	}
+	uint32_t result = static_cast<uint32_t>(_objectIds.size());
+	_objectIds[object] = result;
+	return result;
+}
+
+uint32_t RenderQueue::GetMaterialId(const void* parent, const void* material) {
+	uint32_t result = GetObjectId(parent) << INSTANCE_BITS;
+	if (material == parent) {
+		return result;
+	}
+
+	// Instances are numbered from 1, since the parent itself is 0
+	auto it = _instanceIds.find(material);
+	if (it == _instanceIds.end()) {
+		it = _instanceIds.emplace(material, ++_instanceCounts[parent]).first;
+	}
+	return result | (it->second & ((1u << INSTANCE_BITS) - 1));
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, uint32_t shaderId, uint32_t materialId, uint32_t meshId, float viewDepth) {
+	uint64_t key = 0;
+	key |= static_cast<uint64_t>(*pass       & ((1u << PASS_BITS) - 1));
+	key <<= SHADER_BITS;
+	key |= static_cast<uint64_t>(shaderId   & ((1u << SHADER_BITS) - 1));
+	key <<= MATERIAL_BITS;
+	key |= static_cast<uint64_t>(materialId & ((1u << MATERIAL_BITS) - 1));
+	key <<= MESH_BITS;
+	key |= static_cast<uint64_t>(meshId     & ((1u << MESH_BITS) - 1));
+	key <<= DEPTH_BITS;
+	key |= static_cast<uint64_t>(QuantizeDepth(viewDepth));
+	return key;
+}
+
+uint32_t RenderQueue::QuantizeDepth(float viewDepth) {
+	// Objects behind the camera sort first, they'll be clipped anyways
+	if (!(viewDepth > 0.0f)) {
+		return 0;
+	}
+	// The bit pattern of a positive IEEE float increases with the value, so we can
+	// just keep the top bits (the sign bit is always 0, so we skip it)
+	uint32_t bits;
+	memcpy(&bits, &viewDepth, sizeof(float));
+	return (bits >> (31 - DEPTH_BITS)) & ((1u << DEPTH_BITS) - 1);
+}
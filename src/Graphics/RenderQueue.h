@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <EnumToString.h>
+
+/// <summary>
+/// The passes that draw packets can be submitted for, these form the most significant
+/// bits of the sort key so packets for a pass will always be submitted together
+/// </summary>
+ENUM(RenderPass, uint32_t,
+	GBuffer    = 0,
+	Shadow     = 1,
+	// Writes object and triangle IDs for the visibility buffer, see RenderLayer::_ResolveVisibility
+	Visibility = 2
+);
+
+/// <summary>
+/// A single draw request in a render queue. The sort key packs all the state that we
+/// want to group by, and the item index refers back to whatever the owner of the queue
+/// is using to store the actual draw data
+/// </summary>
+struct DrawPacket {
+	uint64_t SortKey;
+	uint32_t ItemIndex;
+};
+
+/// <summary>
+/// A render queue collects draw packets for a pass, and sorts them so that draws sharing
+/// a shader, material and mesh are submitted back to back, with draws in a group ordered
+/// front to back to reduce overdraw
+///
+/// Sort keys are laid out from most to least significant as:
+///    [ pass : 4 ][ shader : 12 ][ material : 16 ][ mesh : 12 ][ depth : 20 ]
+///
+/// Material IDs from GetMaterialId are further split into [ parent : 10 ][ instance : 6 ], so that
+/// instances of the same parent material are drawn one after another
+/// </summary>
+class RenderQueue {
+public:
+	static const int PASS_BITS     = 4;
+	static const int SHADER_BITS   = 12;
+	static const int MATERIAL_BITS = 16;
+	static const int MESH_BITS     = 12;
+	static const int DEPTH_BITS    = 20;
+	// The low bits of the material ID that identify an instance within its parent
+	static const int INSTANCE_BITS = 6;
+
+	RenderQueue();
+	~RenderQueue() = default;
+
+	/// <summary>
+	/// Removes all packets from the queue, and resets the material ID table. Storage
+	/// is kept around so that we don't re-allocate every frame
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Reserves storage for the given number of packets
+	/// </summary>
+	void Reserve(size_t count);
+
+	/// <summary>
+	/// Adds a new packet to the queue
+	/// </summary>
+	/// <param name="key">The sort key for the packet, see MakeKey</param>
+	/// <param name="itemIndex">The index of the draw item the packet refers to</param>
+	void Push(uint64_t key, uint32_t itemIndex);
+
+	/// <summary>
+	/// Sorts the packets in the queue by their sort keys, using an LSD radix sort. Bytes that are
+	/// identical across all keys (ex: the pass when only one pass is queued) are skipped
+	/// </summary>
+	void Sort();
+
+	/// <summary>
+	/// Gets a small ID for an object that is unique for this queue until the next call to Clear,
+	/// IDs are handed out in the order objects are first seen
+	/// </summary>
+	/// <param name="object">The object to get the ID for (ex: a material)</param>
+	uint32_t GetObjectId(const void* object);
+	/// <summary>
+	/// Gets an ID for a material that sorts it next to the other instances of its parent. The parent's object ID
+	/// forms the high bits, and the instance's index within the parent forms the low INSTANCE_BITS bits
+	/// </summary>
+	/// <param name="parent">The material that the material is an instance of, or the material itself</param>
+	/// <param name="material">The material to get the ID for</param>
+	uint32_t GetMaterialId(const void* parent, const void* material);
+
+	const std::vector<DrawPacket>& GetPackets() const { return _packets; }
+	size_t Size() const { return _packets.size(); }
+	bool Empty() const { return _packets.empty(); }
+
+	/// <summary>
+	/// Packs the given parameters into a single 64 bit sort key. IDs that do not fit into
+	/// their field will be masked
+	/// </summary>
+	/// <param name="pass">The pass the draw belongs to</param>
+	/// <param name="shaderId">An ID for the shader (ex: the OpenGL program handle)</param>
+	/// <param name="materialId">An ID for the material, see GetObjectId</param>
+	/// <param name="meshId">An ID for the mesh (ex: the VAO handle)</param>
+	/// <param name="viewDepth">The distance of the object from the camera, in view space units</param>
+	static uint64_t MakeKey(RenderPass pass, uint32_t shaderId, uint32_t materialId, uint32_t meshId, float viewDepth);
+
+	/// <summary>
+	/// Quantizes a non-negative depth into DEPTH_BITS bits, preserving ordering
+	/// </summary>
+	static uint32_t QuantizeDepth(float viewDepth);
+
+protected:
+	std::vector<DrawPacket> _packets;
+	// Scratch space for the radix sort, so we don't have to allocate every frame
+	std::vector<DrawPacket> _scratch;
+
+	std::unordered_map<const void*, uint32_t> _objectIds;
+	// The index of each instance within its parent, and the number of instances seen for each parent
+	std::unordered_map<const void*, uint32_t> _instanceIds;
+	std::unordered_map<const void*, uint32_t> _instanceCounts;
+};
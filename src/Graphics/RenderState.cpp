@@ -0,0 +1,223 @@
+#include "Graphics/RenderState.h"
+#include <vector>
+#include <unordered_map>
+
+namespace {
+	/// <summary>
+	/// A single piece of cached state, which starts out unknown
+	/// </summary>
+	template <typename T>
+	struct CachedValue {
+		T    Value = T();
+		bool Valid = false;
+
+		/// <summary>
+		/// Updates the cached value, returning true if the new value needs to be sent to OpenGL
+		/// </summary>
+		bool Set(const T& value) {
+			if (Valid && Value == value) {
+				return false;
+			}
+			Value = value;
+			Valid = true;
+			return true;
+		}
+	};
+
+	std::unordered_map<GLenum, CachedValue<bool>> caps;
+	CachedValue<bool>       depthMask;
+	CachedValue<GLenum>     depthFunc;
+	CachedValue<GLenum>     cullFace;
+	CachedValue<GLenum>     frontPolygonMode;
+	CachedValue<GLenum>     backPolygonMode;
+	CachedValue<glm::uvec4> blendFunc;
+	CachedValue<glm::uvec2> blendEquation;
+	CachedValue<glm::ivec4> viewport;
+	CachedValue<glm::ivec4> scissor;
+	CachedValue<GLuint>     program;
+	CachedValue<GLuint>     vertexArray;
+	std::vector<CachedValue<GLuint>> textureUnits;
+
+	RenderState::Stats stats;
+	RenderState::Stats lastFrameStats;
+
+	/// <summary>
+	/// Counts a requested state change, returning the changed flag so it can be used inline
+	/// </summary>
+	bool Track(bool changed) {
+		stats.Calls++;
+		if (!changed) {
+			stats.Filtered++;
+		}
+		return changed;
+	}
+}
+
+void RenderState::Enable(GLenum cap) {
+	SetEnabled(cap, true);
+}
+
+void RenderState::Disable(GLenum cap) {
+	SetEnabled(cap, false);
+}
+
+void RenderState::SetEnabled(GLenum cap, bool enabled) {
+	if (Track(caps[cap].Set(enabled))) {
+		if (enabled) {
+			glEnable(cap);
+		} else {
+			glDisable(cap);
+		}
+	}
+}
+
+void RenderState::EnableIndexed(GLenum cap, GLuint index) {
+	Track(true);
+	caps[cap].Valid = false;
+	glEnablei(cap, index);
+}
+
+void RenderState::SetDepthMask(bool enabled) {
+	if (Track(depthMask.Set(enabled))) {
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void RenderState::SetDepthFunc(GLenum func) {
+	if (Track(depthFunc.Set(func))) {
+		glDepthFunc(func);
+	}
+}
+
+void RenderState::SetCullFace(GLenum face) {
+	if (Track(cullFace.Set(face))) {
+		glCullFace(face);
+	}
+}
+
+void RenderState::SetPolygonMode(GLenum face, GLenum mode) {
+	// Front and back are tracked separately, so we need to see if either one changes
+	bool changed = false;
+	if (face == GL_FRONT || face == GL_FRONT_AND_BACK) {
+		changed |= frontPolygonMode.Set(mode);
+	}
+	if (face == GL_BACK || face == GL_FRONT_AND_BACK) {
+		changed |= backPolygonMode.Set(mode);
+	}
+	if (Track(changed)) {
+		glPolygonMode(face, mode);
+	}
+}
+
+void RenderState::SetBlendFunc(GLenum src, GLenum dst) {
+	SetBlendFuncSeparate(src, dst, src, dst);
+}
+
+void RenderState::SetBlendFuncSeparate(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha) {
+	if (Track(blendFunc.Set({ srcRgb, dstRgb, srcAlpha, dstAlpha }))) {
+		glBlendFuncSeparate(srcRgb, dstRgb, srcAlpha, dstAlpha);
+	}
+}
+
+void RenderState::SetBlendEquationSeparate(GLenum rgb, GLenum alpha) {
+	if (Track(blendEquation.Set({ rgb, alpha }))) {
+		glBlendEquationSeparate(rgb, alpha);
+	}
+}
+
+void RenderState::SetViewport(int x, int y, int width, int height) {
+	if (Track(viewport.Set({ x, y, width, height }))) {
+		glViewport(x, y, width, height);
+	}
+}
+
+void RenderState::SetScissor(int x, int y, int width, int height) {
+	if (Track(scissor.Set({ x, y, width, height }))) {
+		glScissor(x, y, width, height);
+	}
+}
+
+void RenderState::UseProgram(GLuint handle) {
+	if (Track(program.Set(handle))) {
+		glUseProgram(handle);
+	}
+}
+
+void RenderState::BindVertexArray(GLuint vao) {
+	if (Track(vertexArray.Set(vao))) {
+		glBindVertexArray(vao);
+	}
+}
+
+void RenderState::BindTextureUnit(GLuint unit, GLuint texture) {
+	if (unit >= textureUnits.size()) {
+		textureUnits.resize(unit + 1);
+	}
+	if (Track(textureUnits[unit].Set(texture))) {
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void RenderState::BindTextureUnits(GLuint first, GLsizei count, const GLuint* textures) {
+	if (first + count > textureUnits.size()) {
+		textureUnits.resize(first + count);
+	}
+	// Every unit needs to be updated in the cache, so we can't stop at the first one that changes
+	bool changed = false;
+	for (GLsizei ix = 0; ix < count; ix++) {
+		changed |= textureUnits[first + ix].Set(textures[ix]);
+	}
+	if (Track(changed)) {
+		glBindTextures(first, count, textures);
+	}
+}
+
+void RenderState::OnProgramDeleted(GLuint handle) {
+	if (program.Value == handle) {
+		program.Valid = false;
+	}
+}
+
+void RenderState::OnVertexArrayDeleted(GLuint vao) {
+	if (vertexArray.Value == vao) {
+		vertexArray.Valid = false;
+	}
+}
+
+void RenderState::OnTextureDeleted(GLuint texture) {
+	for (CachedValue<GLuint>& unit : textureUnits) {
+		if (unit.Value == texture) {
+			unit.Valid = false;
+		}
+	}
+}
+
+void RenderState::Invalidate() {
+	for (auto& [cap, value] : caps) {
+		value.Valid = false;
+	}
+	depthMask.Valid        = false;
+	depthFunc.Valid        = false;
+	cullFace.Valid         = false;
+	frontPolygonMode.Valid = false;
+	backPolygonMode.Valid  = false;
+	blendFunc.Valid        = false;
+	blendEquation.Valid    = false;
+	viewport.Valid         = false;
+	scissor.Valid          = false;
+	program.Valid          = false;
+	vertexArray.Valid      = false;
+	for (CachedValue<GLuint>& unit : textureUnits) {
+		unit.Valid = false;
+	}
+}
+
+void RenderState::EndFrame() {
+	lastFrameStats = stats;
+	stats = Stats();
+	Invalidate();
+}
+
+const RenderState::Stats& RenderState::GetStats() {
+	return lastFrameStats;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Caches the OpenGL state that we change all the time (capabilities, depth and blend state, viewport,
+/// the bound program, VAO and textures), so that calls which would not actually change anything are
+/// never sent to the driver.
+///
+/// All changes to this state should go through this class, otherwise the cache will get out of sync
+/// with the real state. If something changes state behind our back (ex: ImGui's renderer), call
+/// Invalidate so that the next call for each piece of state is always forwarded
+/// </summary>
+class RenderState {
+public:
+	/// <summary>
+	/// Counts how many state changes were requested, and how many of them were swallowed by the cache
+	/// </summary>
+	struct Stats {
+		// The number of state changes that were requested
+		uint32_t Calls    = 0;
+		// The number of state changes that matched the current state, and were not forwarded to OpenGL
+		uint32_t Filtered = 0;
+	};
+
+	RenderState() = delete;
+
+	/// <summary>
+	/// Enables or disables an OpenGL capability, such as GL_DEPTH_TEST or GL_BLEND
+	/// </summary>
+	static void Enable(GLenum cap);
+	static void Disable(GLenum cap);
+	static void SetEnabled(GLenum cap, bool enabled);
+	/// <summary>
+	/// Enables a capability for a single draw buffer (ex: blending for one color attachment). This is always
+	/// forwarded, and the capability's cached state is forgotten since it's no longer the same for all buffers
+	/// </summary>
+	static void EnableIndexed(GLenum cap, GLuint index);
+
+	static void SetDepthMask(bool enabled);
+	static void SetDepthFunc(GLenum func);
+	static void SetCullFace(GLenum face);
+	static void SetPolygonMode(GLenum face, GLenum mode);
+	static void SetBlendFunc(GLenum src, GLenum dst);
+	static void SetBlendFuncSeparate(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha);
+	static void SetBlendEquationSeparate(GLenum rgb, GLenum alpha);
+	static void SetViewport(int x, int y, int width, int height);
+	static void SetScissor(int x, int y, int width, int height);
+
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vao);
+	static void BindTextureUnit(GLuint unit, GLuint texture);
+	/// <summary>
+	/// Binds textures to a range of units with a single glBindTextures call, a texture of 0 unbinds its unit. The
+	/// call is skipped if every unit in the range already has the same texture
+	/// </summary>
+	static void BindTextureUnits(GLuint first, GLsizei count, const GLuint* textures);
+
+	/// <summary>
+	/// Removes a deleted object from the cache. OpenGL unbinds objects when they're deleted, and may
+	/// hand out the same name again, so we can't assume the new object is bound
+	/// </summary>
+	static void OnProgramDeleted(GLuint program);
+	static void OnVertexArrayDeleted(GLuint vao);
+	static void OnTextureDeleted(GLuint texture);
+
+	/// <summary>
+	/// Forgets all cached state, so that the next call for each piece of state will be forwarded to OpenGL
+	/// </summary>
+	static void Invalidate();
+
+	/// <summary>
+	/// Should be called at the end of each frame, after anything that touches the OpenGL state without going
+	/// through the cache. Stores the stats for the frame and invalidates the cache
+	/// </summary>
+	static void EndFrame();
+
+	/// <summary>
+	/// Gets the stats for the last complete frame
+	/// </summary>
+	static const Stats& GetStats();
+};
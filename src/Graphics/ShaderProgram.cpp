@@ -3,20 +3,65 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
 
 #include "Utils/FileHelpers.h"
+#include "Graphics/RenderState.h"
 #include "Utils/JsonGlmHelpers.h"
 
+namespace {
+	// Identifies our program binary cache files
+	const char     PROGRAM_BINARY_MAGIC[4] = { 'S', 'P', 'B', 'N' };
+	// Bump this if the layout of the cache files changes
+	const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+	// The fixed size header at the start of every cache file, followed by the binary itself
+	struct ProgramBinaryHeader {
+		char     Magic[4];
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t Format;
+		uint32_t Length;
+	};
+}
+
+std::string ShaderProgram::_binaryCacheDirectory = "";
+
 ShaderProgram::ShaderProgram() : 
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_linkPending(false),
+	_linked(false),
+	_pendingStages(),
+	_saveBinaryOnLink(false),
+	_binaryCacheKey(0),
+	_standardVertexStage(false),
+	_instancedVariant(nullptr),
+	_instancedVariantLoaded(false),
+	_depthVariant(nullptr),
+	_depthVariantLoaded(false),
+	_visibilityVariant(nullptr),
+	_visibilityVariantLoaded(false)
 {
 	_rendererId = glCreateProgram();
 }
 
 ShaderProgram::ShaderProgram(const std::unordered_map<ShaderPartType, std::string>& filePaths) :
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_linkPending(false),
+	_linked(false),
+	_pendingStages(),
+	_saveBinaryOnLink(false),
+	_binaryCacheKey(0),
+	_standardVertexStage(false),
+	_instancedVariant(nullptr),
+	_instancedVariantLoaded(false),
+	_depthVariant(nullptr),
+	_depthVariantLoaded(false),
+	_visibilityVariant(nullptr),
+	_visibilityVariantLoaded(false)
 {
 	_rendererId = glCreateProgram();
 	for (auto& [type, path] : filePaths) {
@@ -26,60 +71,36 @@ ShaderProgram::ShaderProgram(const std::unordered_map<ShaderPartType, std::strin
 }
 
 ShaderProgram::~ShaderProgram() {
+	for (auto& [type, handle] : _pendingStages) {
+		glDeleteShader(handle);
+	}
 	if (_rendererId != 0) {
+		RenderState::OnProgramDeleted(_rendererId);
 		glDeleteProgram(_rendererId);
 		_rendererId = 0;
 	}
 }
 
 bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
-	// Creates a new shader part (VS, FS, GS, etc...)
-	GLuint handle = glCreateShader((GLenum)type);
-
-	// Load the GLSL source and compile it
-	glShaderSource(handle, 1, &source, nullptr);
-	glCompileShader(handle);
-
-	// Get the compilation status for the shader part
-	GLint status = 0;
-	glGetShaderiv(handle, GL_COMPILE_STATUS, &status);
-
-	if (status == GL_FALSE) {
-		// Get the size of the error log
-		GLint logSize = 0;
-		glGetShaderiv(handle, GL_INFO_LOG_LENGTH, &logSize);
-
-		// Create a new character buffer for the log
-		char* log = new char[logSize];
-
-		// Get the log
-		glGetShaderInfoLog(handle, logSize, &logSize, log);
-
-		// Dump error log
-		LOG_ERROR("Failed to compile shader part:\n{}", log);
-
-		// Clean up our log memory
-		delete[] log;
-
-		// Delete the broken shader result
-		glDeleteShader(handle);
-		handle = 0;
-
+	if (source == nullptr) {
+		LOG_WARN("Cannot load a shader part from a null source");
 		return false;
 	}
 
-	// If we're overwriting, warn and clean up the old program before we store
-	if (_handles[type] != 0) {
+	// If we're overwriting, warn before we replace the old source
+	if (_sources.find(type) != _sources.end()) {
 		LOG_WARN("Another shader has been attached to this slot, overwriting");
-		glDeleteShader(_handles[type]);
 	}
-	_handles[type] = handle;
+
+	// We don't compile anything until the program is linked, so that programs that are in the binary cache never need compiling
+	_sources[type] = source;
+	_ParseKeywords(_sources[type]);
 
 	// Store info about where we got this data from
 	_fileSourceMap[type].IsFilePath = false;
 	_fileSourceMap[type].Source = source;
 
-	return status != GL_FALSE;
+	return true;
 }
 
 bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type) {
@@ -92,10 +113,6 @@ bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type
 		bool result =  LoadShaderPart(source.c_str(), type);
 		_fileSourceMap[type].IsFilePath = true;
 		_fileSourceMap[type].Source = path;
-		if (result == false) {
-			LOG_ERROR("Source File: {}", path);
-		}
-		glObjectLabel(GL_SHADER, _handles[type], -1, path);
 		return result; 
 	} else {
 		LOG_WARN("Could not open file at \"{}\"", path);
@@ -104,40 +121,120 @@ bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type
 }
 
 bool ShaderProgram::Link() {
+	if (_sources.empty()) {
+		LOG_WARN("Shader \"{}\" has no stages to link", _debugName);
+		return false;
+	}
+
+	// If we're re-linking, the old link needs to finish first so we don't leak its stages
+	_FinishLink();
 
 	LOG_TRACE("Starting shader link:");
-	GLenum err = glGetError();
-	
-	// Attach all our shaders
-	for (auto& [type, id] : _handles) {
-		if (id != 0) {
-			glAttachShader(_rendererId, id);
-			LOG_TRACE("\t{} - {}", ~type, _fileSourceMap[type].IsFilePath ? _fileSourceMap[type].Source : "<from source>");
-		}
+	for (auto& [type, source] : _sources) {
+		LOG_TRACE("\t{} - {}", ~type, _fileSourceMap[type].IsFilePath ? _fileSourceMap[type].Source : "<from source>");
 	}
 
-	// Perform linking
-	glLinkProgram(_rendererId);
-	err = glGetError();
+	// If we've linked these exact sources before on this driver, we can load the result instead of compiling
+	bool useCache = !_binaryCacheDirectory.empty();
+	uint64_t key = useCache ? _GetCacheKey() : 0;
+	if (useCache && _LoadBinary(key)) {
+		LOG_TRACE("Loaded program binary from cache");
+		_saveBinaryOnLink = false;
+	} else {
+		_SubmitCompileAndLink(useCache);
+		_saveBinaryOnLink = useCache;
+		_binaryCacheKey = key;
+	}
 
-	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
-	for (auto& [type, id] : _handles) { 
-		if (id != 0) {
-			glDetachShader(_rendererId, id);
-			glDeleteShader(id);
+	// Anything other than the standard vertex shader may move vertices, so it can't be swapped for a position-only shader
+	_standardVertexStage = std::all_of(_fileSourceMap.begin(), _fileSourceMap.end(), [](const auto& pair) {
+		return pair.first == ShaderPartType::Fragment ||
+			(pair.first == ShaderPartType::Vertex && pair.second.IsFilePath && pair.second.Source == "shaders/vertex_shaders/basic.glsl");
+	});
+
+	// We don't need the sources anymore, the variants re-read them from _fileSourceMap
+	_sources.clear();
+
+	// We don't wait on the driver here, so that many programs can be compiling at once. The results are checked
+	// the first time the program is used (see _FinishLink)
+	_linkPending = true;
+	_linked = false;
+	return true;
+}
+
+bool ShaderProgram::IsValid() {
+	_FinishLink();
+	return _linked;
+}
+
+void ShaderProgram::_SubmitCompileAndLink(bool retrievable) {
+	for (auto& [type, source] : _sources) {
+		// Creates a new shader part (VS, FS, GS, etc...)
+		GLuint handle = glCreateShader((GLenum)type);
+		_pendingStages.push_back({ type, handle });
+
+		// Load the GLSL source and compile it, we don't check the status here since that would wait for the compile
+		const char* code = source.c_str();
+		glShaderSource(handle, 1, &code, nullptr);
+		glCompileShader(handle);
+
+		const ShaderSource& origin = _fileSourceMap[type];
+		if (origin.IsFilePath) {
+			glObjectLabel(GL_SHADER, handle, -1, origin.Source.c_str());
 		}
+
+		glAttachShader(_rendererId, handle);
+	}
+
+	// Ask the driver to keep the binary around so we can store it in the cache
+	if (retrievable) {
+		glProgramParameteri(_rendererId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	}
-	// Remove all the handles so we don't accidentally use them
-	_handles.clear();
 
-	err = glGetError();
+	// Perform linking, if any of the stages failed to compile this will fail as well
+	glLinkProgram(_rendererId);
+}
 
-	GLint status = 0;
+void ShaderProgram::_FinishLink() {
+	if (!_linkPending) {
+		return;
+	}
+	_linkPending = false;
+
+	// This waits for the driver if it's still working on the program
+	GLint status = GL_FALSE;
 	glGetProgramiv(_rendererId, GL_LINK_STATUS, &status);
+	_linked = status != GL_FALSE;
 
 	// If linking failed, figure out why
-	if (status == GL_FALSE)
-	{
+	if (!_linked) {
+		// Most of the time it's because one of the stages didn't compile, so we report those first
+		for (auto& [type, handle] : _pendingStages) {
+			GLint compiled = 0;
+			glGetShaderiv(handle, GL_COMPILE_STATUS, &compiled);
+
+			if (compiled == GL_FALSE) {
+				// Get the size of the error log
+				GLint logSize = 0;
+				glGetShaderiv(handle, GL_INFO_LOG_LENGTH, &logSize);
+
+				// Create a new character buffer for the log
+				char* log = new char[logSize];
+
+				// Get the log
+				glGetShaderInfoLog(handle, logSize, &logSize, log);
+
+				// Dump error log
+				LOG_ERROR("Failed to compile shader part:\n{}", log);
+				if (_fileSourceMap[type].IsFilePath) {
+					LOG_ERROR("Source File: {}", _fileSourceMap[type].Source);
+				}
+
+				// Clean up our log memory
+				delete[] log;
+			}
+		}
+
 		// Get the length of the log
 		GLint length = 0;
 		glGetProgramiv(_rendererId, GL_INFO_LOG_LENGTH, &length);
@@ -146,29 +243,379 @@ bool ShaderProgram::Link() {
 			// Read the log from openGL
 			char* log = new char[length];
 			glGetProgramInfoLog(_rendererId, length, &length, log);
-			LOG_ERROR("Shader failed to link:\n{}", log);
+			LOG_ERROR("Shader \"{}\" failed to link:\n{}", _debugName, log);
 			delete[] log; 
 		} else {
-			LOG_ERROR("Shader failed to link for an unknown reason!");
+			LOG_ERROR("Shader \"{}\" failed to link for an unknown reason!", _debugName);
 		}
 	} else {
-		LOG_TRACE("Linking complete, starting introspection");
+		LOG_TRACE("Linking \"{}\" complete, starting introspection", _debugName);
+		if (_saveBinaryOnLink) {
+			_SaveBinary(_binaryCacheKey);
+		}
+	}
+
+	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
+	for (auto& [type, handle] : _pendingStages) {
+		glDetachShader(_rendererId, handle);
+		glDeleteShader(handle);
 	}
+	_pendingStages.clear();
+	_saveBinaryOnLink = false;
 
 	// Perform our uniform introspection to see what uniforms are in the shader
 	_Introspect();
+}
+
+uint64_t ShaderProgram::_GetCacheKey() const {
+	// 64 bit FNV-1a, we don't use std::hash since it's allowed to change between builds
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t ix = 0; ix < size; ix++) {
+			hash ^= bytes[ix];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	// Binaries are only valid for the driver that created them
+	static std::string driver;
+	if (driver.empty()) {
+		driver = std::string((const char*)glGetString(GL_VENDOR)) + "\n" + (const char*)glGetString(GL_RENDERER) + "\n" + (const char*)glGetString(GL_VERSION);
+	}
+	mix(driver.data(), driver.size());
+
+	// Stages are hashed in a fixed order, since the map's order is not guaranteed
+	std::vector<ShaderPartType> types;
+	for (auto& [type, source] : _sources) {
+		types.push_back(type);
+	}
+	std::sort(types.begin(), types.end());
+	for (ShaderPartType type : types) {
+		const std::string& source = _sources.at(type);
+		mix(&type, sizeof(ShaderPartType));
+		mix(source.data(), source.size());
+	}
+
+	// Transform feedback varyings change the linked program too
+	mix(_varyings.data(), _varyings.size());
+
+	return hash;
+}
+
+std::string ShaderProgram::_GetCachePath(uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return (std::filesystem::path(_binaryCacheDirectory) / name).string();
+}
+
+bool ShaderProgram::_LoadBinary(uint64_t key) {
+	std::ifstream file(_GetCachePath(key), std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+
+	// Make sure the file is one of ours, and is the program we're looking for
+	size_t fileSize = (size_t)file.tellg();
+	file.seekg(0);
+	ProgramBinaryHeader header;
+	if (fileSize < sizeof(ProgramBinaryHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(ProgramBinaryHeader)) ||
+		memcmp(header.Magic, PROGRAM_BINARY_MAGIC, sizeof(header.Magic)) != 0 || header.Version != PROGRAM_BINARY_VERSION ||
+		header.Key != key || header.Length != fileSize - sizeof(ProgramBinaryHeader)) {
+		LOG_WARN("Ignoring invalid program binary for \"{}\"", _debugName);
+		return false;
+	}
+
+	std::vector<char> data(header.Length);
+	if (!file.read(data.data(), header.Length)) {
+		return false;
+	}
+
+	// The driver can still reject binaries (ex: it's been updated without changing its version string), in which case we just compile
+	glProgramBinary(_rendererId, (GLenum)header.Format, data.data(), (GLsizei)header.Length);
+	GLint status = GL_FALSE;
+	glGetProgramiv(_rendererId, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		LOG_TRACE("Driver rejected cached program binary, recompiling");
+		return false;
+	}
+	return true;
+}
+
+void ShaderProgram::_SaveBinary(uint64_t key) {
+	GLint length = 0;
+	glGetProgramiv(_rendererId, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	ProgramBinaryHeader header;
+	memcpy(header.Magic, PROGRAM_BINARY_MAGIC, sizeof(header.Magic));
+	header.Version = PROGRAM_BINARY_VERSION;
+	header.Key = key;
+
+	std::vector<char> data(length);
+	GLenum format = 0;
+	glGetProgramBinary(_rendererId, length, &length, &format, data.data());
+	header.Format = format;
+	header.Length = (uint32_t)length;
+
+	std::error_code error;
+	std::filesystem::create_directories(_binaryCacheDirectory, error);
+	std::ofstream file(_GetCachePath(key), std::ios::binary);
+	if (!file) {
+		LOG_WARN("Failed to write program binary for \"{}\" to the cache", _debugName);
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(ProgramBinaryHeader));
+	file.write(data.data(), length);
+}
+
+void ShaderProgram::SetBinaryCacheDirectory(const std::string& path) {
+	// Some drivers don't support any binary formats, in which case there's nothing we can cache
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (!path.empty() && formats == 0) {
+		LOG_INFO("Driver does not support program binaries, shaders will not be cached");
+		_binaryCacheDirectory = "";
+		return;
+	}
+	_binaryCacheDirectory = path;
+}
+
+const std::string& ShaderProgram::GetBinaryCacheDirectory() {
+	return _binaryCacheDirectory;
+}
 
-	return status != GL_FALSE;
+ShaderProgram::Sptr ShaderProgram::GetInstancedVariant() {
+	// We only want to try compiling once, even if the shader does not support instancing
+	if (_instancedVariantLoaded) {
+		return _instancedVariant;
+	}
+	_instancedVariantLoaded = true;
+
+	ShaderProgram::Sptr result = std::make_shared<ShaderProgram>();
+	result->SetDebugName(_debugName + " (instanced)");
+	result->_defines = _defines;
+
+	// Re-load all of our stages, with the instancing symbol defined for the vertex stage only
+	for (auto& [type, source] : _fileSourceMap) {
+		std::string code = type == ShaderPartType::Vertex ?
+			_ReadVariantSource(source, { "INSTANCED" }, { "GL_ARB_shader_draw_parameters" }) :
+			_ReadVariantSource(source);
+		if (!result->LoadShaderPart(code.c_str(), type)) {
+			return nullptr;
+		}
+		result->_fileSourceMap[type] = source;
+	}
+	if (!result->Link() || !result->IsValid()) {
+		return nullptr;
+	}
+
+	// If the shader never reads the object buffer, it's not using our common uniforms and can't be instanced
+	if (glGetProgramResourceIndex(result->_rendererId, GL_SHADER_STORAGE_BLOCK, "b_ObjectData") == GL_INVALID_INDEX) {
+		LOG_TRACE("Shader \"{}\" does not support instancing", _debugName);
+		return nullptr;
+	}
+
+	_instancedVariant = result;
+	return _instancedVariant;
+}
+
+ShaderProgram::Sptr ShaderProgram::GetDepthVariant() {
+	// We only want to try compiling once, even if compiling failed
+	if (_depthVariantLoaded) {
+		return _depthVariant;
+	}
+	_depthVariantLoaded = true;
+
+	ShaderProgram::Sptr result = std::make_shared<ShaderProgram>();
+	result->SetDebugName(_debugName + " (depth)");
+	result->_defines = _defines;
+
+	// Keep all of our stages that feed the rasterizer, so the variant generates the same depth values as this shader
+	for (auto& [type, source] : _fileSourceMap) {
+		if (type == ShaderPartType::Fragment) {
+			continue;
+		}
+		std::string code = _ReadVariantSource(source);
+		if (!result->LoadShaderPart(code.c_str(), type)) {
+			return nullptr;
+		}
+		result->_fileSourceMap[type] = source;
+	}
+	ShaderSource fragment = { "shaders/fragment_shaders/depth_masked.glsl", true };
+	std::string code = _ReadVariantSource(fragment);
+	if (!result->LoadShaderPart(code.c_str(), ShaderPartType::Fragment)) {
+		return nullptr;
+	}
+	result->_fileSourceMap[ShaderPartType::Fragment] = fragment;
+	if (!result->Link() || !result->IsValid()) {
+		return nullptr;
+	}
+
+	_depthVariant = result;
+	return _depthVariant;
+}
+
+ShaderProgram::Sptr ShaderProgram::GetVisibilityVariant() {
+	// We only want to try compiling once, even if the shader is not supported
+	if (_visibilityVariantLoaded) {
+		return _visibilityVariant;
+	}
+	_visibilityVariantLoaded = true;
+
+	// The resolve can only rebuild the outputs of our standard vertex shader
+	auto vertex = _fileSourceMap.find(ShaderPartType::Vertex);
+	auto fragment = _fileSourceMap.find(ShaderPartType::Fragment);
+	if (!_standardVertexStage || vertex == _fileSourceMap.end() || fragment == _fileSourceMap.end()) {
+		LOG_TRACE("Shader \"{}\" does not support visibility buffer resolves", _debugName);
+		return nullptr;
+	}
+
+	ShaderProgram::Sptr result = std::make_shared<ShaderProgram>();
+	result->SetDebugName(_debugName + " (visibility resolve)");
+	result->_defines = _defines;
+
+	// Our fragment stage, with the resolve appended to the end to provide the inputs and the real main function
+	std::string code = _ReadVariantSource(fragment->second, { "VISIBILITY_RESOLVE" }) + "\n" + FileHelpers::ReadResolveIncludes("shaders/fragments/visibility_resolve.glsl");
+
+	if (!result->LoadShaderPartFromFile("shaders/vertex_shaders/visibility_resolve.glsl", ShaderPartType::Vertex) ||
+		!result->LoadShaderPart(code.c_str(), ShaderPartType::Fragment) || !result->Link() || !result->IsValid()) {
+		return nullptr;
+	}
+
+	_visibilityVariant = result;
+	return _visibilityVariant;
+}
+
+uint32_t ShaderProgram::GetKeywordMask(const std::vector<std::string>& keywords) const {
+	uint32_t result = 0;
+	for (const std::string& keyword : keywords) {
+		auto it = std::find(_keywords.begin(), _keywords.end(), keyword);
+		if (it != _keywords.end()) {
+			result |= 1u << (uint32_t)(it - _keywords.begin());
+		}
+	}
+	return result;
+}
+
+ShaderProgram::Sptr ShaderProgram::GetKeywordVariant(const std::vector<std::string>& keywords) {
+	return GetKeywordVariant(GetKeywordMask(keywords));
+}
+
+ShaderProgram::Sptr ShaderProgram::GetKeywordVariant(uint32_t mask) {
+	// With no keywords defined, the variant is just this shader
+	if (mask == 0) {
+		return shared_from_this();
+	}
+
+	// Failed variants are stored as nullptr, so that we only try compiling them once
+	auto it = _keywordVariants.find(mask);
+	if (it != _keywordVariants.end()) {
+		return it->second != nullptr ? it->second : shared_from_this();
+	}
+
+	std::vector<std::string> keywords;
+	for (uint32_t ix = 0; ix < _keywords.size(); ix++) {
+		if (mask & (1u << ix)) {
+			keywords.push_back(_keywords[ix]);
+		}
+	}
+
+	std::string name = _debugName + " (";
+	for (size_t ix = 0; ix < keywords.size(); ix++) {
+		name += (ix > 0 ? ", " : "") + keywords[ix];
+	}
+
+	ShaderProgram::Sptr result = std::make_shared<ShaderProgram>();
+	result->SetDebugName(name + ")");
+	result->_defines = _defines;
+	result->_defines.insert(result->_defines.end(), keywords.begin(), keywords.end());
+
+	// Re-load all of our stages, with the keywords defined in every stage
+	bool loaded = true;
+	for (auto& [type, source] : _fileSourceMap) {
+		std::string code = _ReadVariantSource(source, keywords);
+		loaded &= result->LoadShaderPart(code.c_str(), type);
+		result->_fileSourceMap[type] = source;
+	}
+	if (!loaded || !result->Link() || !result->IsValid()) {
+		LOG_WARN("Failed to compile shader variant \"{}\", using the shader without keywords instead", result->GetDebugName());
+		result = nullptr;
+	}
+
+	_keywordVariants[mask] = result;
+	return result != nullptr ? result : shared_from_this();
+}
+
+std::string ShaderProgram::_ReadVariantSource(const ShaderSource& source, const std::vector<std::string>& defines, const std::vector<std::string>& extensions) const {
+	std::string code = source.IsFilePath ? FileHelpers::ReadResolveIncludes(source.Source) : source.Source;
+
+	// Variants of variants keep the symbols that their parent was compiled with
+	std::vector<std::string> allDefines = _defines;
+	allDefines.insert(allDefines.end(), defines.begin(), defines.end());
+	if (allDefines.empty() && extensions.empty()) {
+		return code;
+	}
+	return _InjectDefines(code, allDefines, extensions);
+}
+
+void ShaderProgram::_ParseKeywords(const std::string& source) {
+	static const std::string directive = "#pragma keywords";
+
+	size_t pos = source.find(directive);
+	while (pos != std::string::npos) {
+		size_t lineEnd = source.find('\n', pos);
+		std::istringstream line(source.substr(pos + directive.size(), lineEnd == std::string::npos ? std::string::npos : lineEnd - pos - directive.size()));
+
+		std::string keyword;
+		while (line >> keyword) {
+			if (std::find(_keywords.begin(), _keywords.end(), keyword) != _keywords.end()) {
+				continue;
+			}
+			if (_keywords.size() >= MAX_KEYWORDS) {
+				LOG_WARN("Shader \"{}\" declares more than {} keywords, ignoring \"{}\"", _debugName, MAX_KEYWORDS, keyword);
+				continue;
+			}
+			_keywords.push_back(keyword);
+		}
+
+		pos = source.find(directive, pos + directive.size());
+	}
+}
+
+std::string ShaderProgram::_InjectDefines(const std::string& source, const std::vector<std::string>& defines, const std::vector<std::string>& extensions) {
+	// Extensions need to come before any other tokens, so they go first
+	std::string block;
+	for (const std::string& extension : extensions) {
+		block += "#extension " + extension + " : require\n";
+	}
+	for (const std::string& define : defines) {
+		block += "#define " + define + "\n";
+	}
+
+	// The #version directive must come first, so we insert our defines on the line after it
+	size_t versionPos = source.find("#version");
+	if (versionPos == std::string::npos) {
+		return block + source;
+	}
+	size_t lineEnd = source.find('\n', versionPos);
+	if (lineEnd == std::string::npos) {
+		return source + "\n" + block;
+	}
+	return source.substr(0, lineEnd + 1) + block + source.substr(lineEnd + 1);
 }
 
 void ShaderProgram::Bind() {
-	// Simply calls glUseProgram with our shader handle
-	glUseProgram(_rendererId);
+	_FinishLink();
+	// Binds our program through the state cache, so re-binding the current program is free
+	RenderState::UseProgram(_rendererId);
 }
 
 void ShaderProgram::Unbind() {
 	// We unbind a shader program by using the default program (0)
-	glUseProgram(0);
+	RenderState::UseProgram(0);
 }
 
 void ShaderProgram::SetUniformMatrix(int location, const glm::mat3* value, int count, bool transposed) {
@@ -328,6 +775,7 @@ int ShaderProgram::__GetUniformLocation(const std::string& name) {
 	// Since the default constructor for UniformInfo sets location to -1,
 	// we can simply index the map and if it doesn't exist, the default
 	// will be used
+	_FinishLink();
 	return _uniforms[name].Location;
 }
 
@@ -367,6 +815,35 @@ ShaderProgram::Sptr ShaderProgram::FromJson(const nlohmann::json& data) {
 void ShaderProgram::_Introspect() {
 	_IntrospectUniforms();
 	_IntrospectUnifromBlocks();
+	_BuildUniformTable();
+}
+
+void ShaderProgram::_BuildUniformTable() {
+	_uniformTable.clear();
+	_uniformTable.reserve(_uniforms.size());
+	for (auto& [name, uniform] : _uniforms) {
+		if (uniform.Location != -1) {
+			_uniformTable.push_back({ UniformHandle::HashName(name), uniform.Location });
+		}
+	}
+
+	// Sorted so that we can binary search by hash
+	std::sort(_uniformTable.begin(), _uniformTable.end(), [](const UniformSlot& a, const UniformSlot& b) {
+		return a.Hash < b.Hash;
+	});
+	for (size_t ix = 1; ix < _uniformTable.size(); ix++) {
+		if (_uniformTable[ix].Hash == _uniformTable[ix - 1].Hash) {
+			LOG_WARN("Two uniforms in shader \"{}\" have the same name hash, handles for them will be unreliable", _debugName);
+		}
+	}
+}
+
+int ShaderProgram::GetUniformLocation(uint32_t nameHash) {
+	_FinishLink();
+	auto it = std::lower_bound(_uniformTable.begin(), _uniformTable.end(), nameHash, [](const UniformSlot& slot, uint32_t hash) {
+		return slot.Hash < hash;
+	});
+	return it != _uniformTable.end() && it->Hash == nameHash ? it->Location : -1;
 }
 
 void ShaderProgram::_IntrospectUniforms() {
@@ -478,17 +955,21 @@ void ShaderProgram::_IntrospectUnifromBlocks() {
 				GL_NAME_LENGTH,
 				GL_TYPE,
 				GL_ARRAY_SIZE,
-				GL_OFFSET
+				GL_OFFSET,
+				GL_ARRAY_STRIDE,
+				GL_MATRIX_STRIDE
 			};
 			// Query data from the program
-			int props[4];
-			glGetProgramResourceiv(_rendererId, GL_UNIFORM, activeVars[v], 4, pNames, 4, NULL, props);
+			int props[6];
+			glGetProgramResourceiv(_rendererId, GL_UNIFORM, activeVars[v], 6, pNames, 6, NULL, props);
 
 			// Store properties into the UniformInfo
 			UniformInfo var = UniformInfo();
 			var.Type = FromGLShaderDataType(props[1]);
 			var.Location = props[3];
 			var.ArraySize = props[2];
+			var.ArrayStride = props[4];
+			var.MatrixStride = props[5];
 
 			// Get the uniform name
 			var.Name.resize(props[0] - 1);
@@ -511,6 +992,7 @@ void ShaderProgram::_IntrospectUnifromBlocks() {
 
 void ShaderProgram::BindUniformBlockToSlot(const std::string& name, int uboSlot)
 {
+	_FinishLink();
 	auto& it = _uniformBlocks.find(name);
 	if (it != _uniformBlocks.end()) {
 		UniformBlockInfo& block = it->second;
@@ -519,7 +1001,13 @@ void ShaderProgram::BindUniformBlockToSlot(const std::string& name, int uboSlot)
 	}
 }
 
+const std::unordered_map<std::string, UniformInfo>& ShaderProgram::GetUniforms() {
+	_FinishLink();
+	return _uniforms;
+}
+
 bool ShaderProgram::FindUniform(const std::string& name, UniformInfo* out) {
+	_FinishLink();
 	for (auto& [key, uniform] : _uniforms) {
 		if (uniform.Name == name) {
 			if (out != nullptr) {
@@ -531,11 +1019,22 @@ bool ShaderProgram::FindUniform(const std::string& name, UniformInfo* out) {
 	return false;
 }
 
+const ShaderProgram::UniformBlockInfo* ShaderProgram::GetUniformBlock(const std::string& name) {
+	_FinishLink();
+	auto it = _uniformBlocks.find(name);
+	return it != _uniformBlocks.end() ? &it->second : nullptr;
+}
+
 GlResourceType ShaderProgram::GetResourceClass() const {
 	return GlResourceType::ShaderProgram;
 }
 
 void ShaderProgram::RegisterVaryings(const char* const* names, int numVaryings, bool interleaved /*= true*/)
 {
+	// Remember what we registered, since it changes the linked program
+	_varyings = interleaved ? "interleaved" : "separate";
+	for (int ix = 0; ix < numVaryings; ix++) {
+		_varyings += std::string(";") + names[ix];
+	}
 	glTransformFeedbackVaryings(_rendererId, numVaryings, names, interleaved ? GL_INTERLEAVED_ATTRIBS : GL_SEPARATE_ATTRIBS);
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include <glad/glad.h>
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
 #include <GLM/glm.hpp>          // for our GLM types
@@ -11,11 +13,12 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/GlEnums.h"
 #include "Graphics/IGraphicsResource.h"
+#include "Graphics/UniformHandle.h"
 
 /// <summary>
 /// This class will wrap around an OpenGL shader program
 /// </summary>
-class ShaderProgram final : public IGraphicsResource, public IResource
+class ShaderProgram final : public IGraphicsResource, public IResource, public std::enable_shared_from_this<ShaderProgram>
 {
 public:
 	DEFINE_RESOURCE(ShaderProgram);
@@ -26,11 +29,15 @@ public:
 
 public:
 	// Stores information about a uniform in the shader
+	// For members of a uniform block, Location is the byte offset of the member within the block
 	struct UniformInfo {
 		ShaderDataType Type;
 		int            ArraySize;
 		int            Location;
 		int            Binding;
+		// The bytes between array elements and matrix columns, only set for members of uniform blocks
+		int            ArrayStride;
+		int            MatrixStride;
 		std::string    Name;
 
 		UniformInfo() :
@@ -38,6 +45,8 @@ public:
 			ArraySize(0),
 			Location(-1),
 			Binding(-1),
+			ArrayStride(0),
+			MatrixStride(0),
 			Name("") {}
 	};
 
@@ -75,6 +84,7 @@ public:
 	/// <param name="source">The source code of the shader to load</param>
 	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
 	/// <returns>True if the shader is loaded, false if there was an issue</returns>
+	/// <remarks>Stages are not compiled until the program is linked, so compile errors are reported when the program is first used</remarks>
 	bool LoadShaderPart(const char* source, ShaderPartType type);
 	/// <summary>
 	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader) from an external file (in res)
@@ -93,10 +103,28 @@ public:
 	void RegisterVaryings(const char* const* names, int numVaryings, bool interleaved = true);
 
 	/// <summary>
-	/// Links the vertex and fragment shader, and allows this shader program to be used
+	/// Submits the loaded shader stages to be compiled and linked, and allows this shader program to be used. If the binary
+	/// cache is enabled (see SetBinaryCacheDirectory), a program that was linked from the same sources on an earlier run is
+	/// loaded from the cache instead of being compiled.
+	///
+	/// This does not wait for the driver, so that many programs can compile at once. The result is checked, and the uniforms
+	/// are introspected, the first time the program is bound or its uniforms are looked up, or when IsValid is called
 	/// </summary>
-	/// <returns>True if the linking was successful, false if otherwise</returns>
+	/// <returns>True if the program was submitted, false if there were no stages to link</returns>
 	bool Link();
+	/// <summary>
+	/// Waits for the program to finish linking if it hasn't yet
+	/// </summary>
+	/// <returns>True if the program linked successfully</returns>
+	bool IsValid();
+
+	/// <summary>
+	/// Sets the directory to cache linked program binaries in. Binaries are keyed by a hash of the fully resolved
+	/// sources and the driver's vendor, renderer and version, so edited shaders and driver updates are compiled from
+	/// scratch. An empty path disables the cache, as does a driver with no binary formats
+	/// </summary>
+	static void SetBinaryCacheDirectory(const std::string& path);
+	static const std::string& GetBinaryCacheDirectory();
 
 	/// <summary>
 	/// Binds this shader for use
@@ -107,7 +135,62 @@ public:
 	/// </summary>
 	static void Unbind();
 
-	const std::unordered_map<std::string, UniformInfo>& GetUniforms() const { return _uniforms; }
+	const std::unordered_map<std::string, UniformInfo>& GetUniforms();
+
+	/// <summary>
+	/// Gets a variant of this shader with INSTANCED defined in the vertex stage, where per-object
+	/// transforms are read from the frame's object buffer using the draw's base instance, instead
+	/// of the instance UBO (see fragments/frame_uniforms.glsl). The variant is compiled the first 
+	/// time it is requested
+	/// </summary>
+	/// <returns>The instanced variant, or nullptr if this shader does not support instancing</returns>
+	Sptr GetInstancedVariant();
+
+	/// <summary>
+	/// Gets a variant of this shader for depth-only passes of masked materials, which keeps this shader's vertex
+	/// stage (so vertex animation such as foliage still matches) but replaces the fragment stage with an alpha
+	/// test against u_Material.AlbedoMap (see fragment_shaders/depth_masked.glsl). The variant is compiled the
+	/// first time it is requested, and can be instanced with GetInstancedVariant
+	/// </summary>
+	/// <returns>The depth variant, or nullptr if it failed to compile</returns>
+	Sptr GetDepthVariant();
+
+	/// <summary>
+	/// Gets a variant of this shader for resolving the visibility buffer, which draws a fullscreen quad at the depth given
+	/// by the u_MaterialDepth uniform, and runs this shader's fragment stage with VISIBILITY_RESOLVE defined and the inputs
+	/// rebuilt from the visibility buffer (see fragments/visibility_resolve.glsl). Since the inputs are rebuilt the same
+	/// way the standard vertex shader calculates them, only shaders that use vertex_shaders/basic.glsl are supported
+	/// </summary>
+	/// <returns>The resolve variant, or nullptr if this shader is not supported or failed to compile</returns>
+	Sptr GetVisibilityVariant();
+
+	/// <summary>
+	/// Returns true if this shader's only stage before the fragment stage is vertex_shaders/basic.glsl, which leaves
+	/// positions as-is. Shaders that move their vertices (ex: displacement mapping) return false, and need their own
+	/// vertex stage in passes that would otherwise share a position-only shader. Set when the shader is linked
+	/// </summary>
+	bool HasStandardVertexStage() const { return _standardVertexStage; }
+
+	/// <summary>
+	/// Gets the keywords declared by this shader's sources, in the order they were declared. Keywords are declared with
+	/// a "#pragma keywords NAME_A NAME_B" line in any stage or include, and are symbols that can be defined in a variant
+	/// of the shader (see GetKeywordVariant), so that code can be removed at compile time with #ifdef rather than
+	/// branching on a uniform
+	/// </summary>
+	const std::vector<std::string>& GetKeywords() const { return _keywords; }
+	/// <summary>
+	/// Gets a mask of keywords to pass to GetKeywordVariant, where bit N is set if the Nth keyword is in the list.
+	/// Names that this shader does not declare are ignored
+	/// </summary>
+	uint32_t GetKeywordMask(const std::vector<std::string>& keywords) const;
+	/// <summary>
+	/// Gets a variant of this shader with a set of keywords defined in every stage. Each set is compiled the first
+	/// time it is requested, and cached
+	/// </summary>
+	/// <param name="mask">The keywords to define, see GetKeywordMask</param>
+	/// <returns>The variant, or this shader if no keywords are set, or if the variant failed to compile</returns>
+	Sptr GetKeywordVariant(uint32_t mask);
+	Sptr GetKeywordVariant(const std::vector<std::string>& keywords);
 
 	// Inherited from IGraphicsResource
 
@@ -120,6 +203,11 @@ public:
 
 public:
 	bool FindUniform(const std::string& name, UniformInfo* out);
+	/// <summary>
+	/// Gets the layout of one of the shader's uniform blocks
+	/// </summary>
+	/// <returns>The block, or nullptr if the shader has no active block with the given name</returns>
+	const UniformBlockInfo* GetUniformBlock(const std::string& name);
 
 	void SetUniformMatrix(int location, const glm::mat3* value, int count = 1, bool transposed = false);
 	void SetUniformMatrix(int location, const glm::mat4* value, int count = 1, bool transposed = false);
@@ -177,18 +265,77 @@ public:
 			LOG_WARN("Ignoring uniform \"{}\"", name);
 		}
 	}
+
+	/// <summary>
+	/// Gets the location of a uniform from a hash of its name, without touching any strings
+	/// </summary>
+	/// <param name="nameHash">The hash of the uniform's name, see UniformHandle</param>
+	/// <returns>The uniform's location, or -1 if the shader has no uniform with that name</returns>
+	int GetUniformLocation(uint32_t nameHash);
+	int GetUniformLocation(UniformHandle handle) { return GetUniformLocation(handle.Hash); }
+
+	// These overloads look up the uniform by handle, so they don't allocate or hash strings. Prefer these for uniforms set every frame
+
+	template <typename T>
+	void SetUniform(UniformHandle handle, const T& value) {
+		int location = GetUniformLocation(handle.Hash);
+		if (location != -1) {
+			SetUniform(location, &value, 1);
+		} else {
+			LOG_WARN("Ignoring uniform \"{}\"", handle.Name);
+		}
+	}
+	template <typename T>
+	void SetUniform(UniformHandle handle, const T* values, int count = 1) {
+		int location = GetUniformLocation(handle.Hash);
+		if (location != -1) {
+			SetUniform(location, values, count);
+		} else {
+			LOG_WARN("Ignoring uniform \"{}\"", handle.Name);
+		}
+	}
+	template <typename T>
+	void SetUniformMatrix(UniformHandle handle, const T& value, bool transposed = false) {
+		int location = GetUniformLocation(handle.Hash);
+		if (location != -1) {
+			SetUniformMatrix(location, &value, 1, transposed);
+		} else {
+			LOG_WARN("Ignoring uniform \"{}\"", handle.Name);
+		}
+	}
 	
 	void BindUniformBlockToSlot(const std::string& name, int uboSlot);
 
 protected:
-	// Stores all the handles to our shaders until we
+	// Stores the resolved source of our shaders until we
 	// are ready to compile them into a program
-	std::unordered_map<ShaderPartType, int> _handles;
+	std::unordered_map<ShaderPartType, std::string> _sources;
+	// The transform feedback varyings registered for this program, since they are part of the binary cache key
+	std::string _varyings;
+
+	// True from Link until we've checked the result of the link, see _FinishLink
+	bool _linkPending;
+	bool _linked;
+	// The stages of the pending link, which we keep so that we can read their logs if it fails
+	std::vector<std::pair<ShaderPartType, GLuint>> _pendingStages;
+	// True if the pending link should be stored in the binary cache when it finishes, under _binaryCacheKey
+	bool _saveBinaryOnLink;
+	uint64_t _binaryCacheKey;
+
+	// The directory that program binaries are cached in, or empty if the cache is disabled
+	static std::string _binaryCacheDirectory;
 	
 	// Map access to look up uniform locations and blocks
 	std::unordered_map<std::string, UniformInfo> _uniforms;
 	std::unordered_map<std::string, UniformBlockInfo> _uniformBlocks;
 
+	// The location of each uniform by the hash of its name, sorted by hash so that handles can be resolved without strings
+	struct UniformSlot {
+		uint32_t Hash;
+		int      Location;
+	};
+	std::vector<UniformSlot> _uniformTable;
+
 	// Stores information about the source of our shader parts
 	// EX: if a VS shader is loaded from a file, will contain
 	// the file path, and IsFilePath=true
@@ -197,6 +344,74 @@ protected:
 		bool        IsFilePath;
 	};
 	std::unordered_map<ShaderPartType, ShaderSource> _fileSourceMap;
+	// True if our sources only use the standard vertex shader, see HasStandardVertexStage
+	bool _standardVertexStage;
+
+	// The instanced version of this shader, see GetInstancedVariant
+	Sptr _instancedVariant;
+	bool _instancedVariantLoaded;
+	// The depth-only version of this shader, see GetDepthVariant
+	Sptr _depthVariant;
+	bool _depthVariantLoaded;
+	// The visibility buffer resolve version of this shader, see GetVisibilityVariant
+	Sptr _visibilityVariant;
+	bool _visibilityVariantLoaded;
+
+	// The most keywords that a shader can declare, since variants are keyed by a bit mask
+	static const uint32_t MAX_KEYWORDS = 32;
+	// The keywords declared by our sources, see GetKeywords
+	std::vector<std::string> _keywords;
+	// The variants for each keyword mask we've requested, nullptr if the variant failed to compile
+	std::unordered_map<uint32_t, Sptr> _keywordVariants;
+	// The symbols that this shader was compiled with if it is a variant, these are passed on to variants of this shader
+	std::vector<std::string> _defines;
+
+	/// <summary>
+	/// Inserts a list of #extension and #define directives into a GLSL source, directly after the #version directive
+	/// </summary>
+	/// <param name="source">The source to inject the defines into</param>
+	/// <param name="defines">The names of the symbols to define</param>
+	/// <param name="extensions">The names of extensions to require</param>
+	static std::string _InjectDefines(const std::string& source, const std::vector<std::string>& defines, const std::vector<std::string>& extensions = {});
+
+	/// <summary>
+	/// Reads the source for one of our stages to build a variant from, with our defines and any extra symbols injected
+	/// </summary>
+	/// <param name="source">The stage to read</param>
+	/// <param name="defines">Symbols to define on top of the ones this shader was compiled with</param>
+	/// <param name="extensions">The names of extensions to require</param>
+	std::string _ReadVariantSource(const ShaderSource& source, const std::vector<std::string>& defines = {}, const std::vector<std::string>& extensions = {}) const;
+	/// <summary>
+	/// Adds the keywords declared by a stage's source to our list of keywords
+	/// </summary>
+	void _ParseKeywords(const std::string& source);
+
+	/// <summary>
+	/// Submits each of the loaded stages to be compiled, and the program to be linked, without waiting for the results
+	/// </summary>
+	/// <param name="retrievable">True if the driver should keep the binary so that it can be stored in the cache</param>
+	void _SubmitCompileAndLink(bool retrievable);
+	/// <summary>
+	/// If a link is pending, waits for it and reports any errors, stores the binary in the cache, and introspects the program
+	/// </summary>
+	void _FinishLink();
+	/// <summary>
+	/// Gets the binary cache key for the loaded sources on the current driver
+	/// </summary>
+	uint64_t _GetCacheKey() const;
+	/// <summary>
+	/// Gets the path of the cache file for a key
+	/// </summary>
+	static std::string _GetCachePath(uint64_t key);
+	/// <summary>
+	/// Tries to load the program from the binary cache
+	/// </summary>
+	/// <returns>True if a valid binary was found and the driver accepted it</returns>
+	bool _LoadBinary(uint64_t key);
+	/// <summary>
+	/// Stores the linked program in the binary cache
+	/// </summary>
+	void _SaveBinary(uint64_t key);
 
 	/// <summary>
 	/// Performs program introspection, where we examine the uniforms that
@@ -204,6 +419,10 @@ protected:
 	/// </summary>
 	void _Introspect();
 	/// <summary>
+	/// Builds our table of uniform locations by name hash, see GetUniformLocation
+	/// </summary>
+	void _BuildUniformTable();
+	/// <summary>
 	/// Introspects uniforms which are not part of uniform blocks
 	/// </summary>
 	void _IntrospectUniforms();
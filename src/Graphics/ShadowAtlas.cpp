@@ -0,0 +1,115 @@
+#include "Graphics/ShadowAtlas.h"
+#include <algorithm>
+#include <Logging.h>
+
+ShadowAtlas::ShadowAtlas(uint32_t size, uint32_t minTileSize) :
+	_framebuffer(nullptr),
+	_size(size),
+	_minTileSize(minTileSize),
+	_freeBlocks()
+{
+	LOG_ASSERT(size > 0 && (size & (size - 1)) == 0, "Shadow atlas size must be a power of two");
+	LOG_ASSERT(minTileSize > 0 && (minTileSize & (minTileSize - 1)) == 0 && minTileSize <= size, "Minimum tile size must be a power of two no larger than the atlas");
+
+	FramebufferDescriptor desc;
+	desc.Width  = _size;
+	desc.Height = _size;
+	desc.RenderTargets[RenderTargetAttachment::Depth] = RenderTargetDescriptor(RenderTargetType::Depth32, true, true);
+	_framebuffer = std::make_shared<Framebuffer>(desc);
+
+	// Start with the whole atlas free
+	_freeBlocks.resize(_GetLevel(_minTileSize) + 1);
+	_freeBlocks[0].push_back(glm::ivec2(0));
+}
+
+bool ShadowAtlas::Allocate(uint32_t size, Tile& result) {
+	uint32_t level = _GetLevel(GetTileSize(size));
+
+	// Find the smallest free block that can fit the tile
+	int source = -1;
+	for (int ix = (int)level; ix >= 0; ix--) {
+		if (!_freeBlocks[ix].empty()) {
+			source = ix;
+			break;
+		}
+	}
+	if (source == -1) {
+		return false;
+	}
+
+	glm::ivec2 offset = _freeBlocks[source].back();
+	_freeBlocks[source].pop_back();
+
+	// Split the block down until it's the size we want, we keep the first quadrant and free the other three
+	for (uint32_t ix = source + 1; ix <= level; ix++) {
+		int half = (int)(_size >> ix);
+		_freeBlocks[ix].push_back(offset + glm::ivec2(half, 0));
+		_freeBlocks[ix].push_back(offset + glm::ivec2(0, half));
+		_freeBlocks[ix].push_back(offset + glm::ivec2(half, half));
+	}
+
+	result.Offset = offset;
+	result.Size   = _size >> level;
+	return true;
+}
+
+void ShadowAtlas::Free(const Tile& tile) {
+	uint32_t level = _GetLevel(tile.Size);
+	glm::ivec2 offset = tile.Offset;
+
+	// Merge the block with its siblings as long as they're all free
+	while (level > 0) {
+		std::vector<glm::ivec2>& blocks = _freeBlocks[level];
+		int size = (int)(_size >> level);
+		glm::ivec2 parent = offset - glm::ivec2(offset.x % (size * 2), offset.y % (size * 2));
+		const glm::ivec2 siblings[4] = {
+			parent,
+			parent + glm::ivec2(size, 0),
+			parent + glm::ivec2(0, size),
+			parent + glm::ivec2(size, size)
+		};
+
+		// All the siblings other than the one being freed need to be in the free list
+		bool canMerge = true;
+		for (const glm::ivec2& sibling : siblings) {
+			if (sibling != offset && std::find(blocks.begin(), blocks.end(), sibling) == blocks.end()) {
+				canMerge = false;
+				break;
+			}
+		}
+		if (!canMerge) {
+			break;
+		}
+
+		for (const glm::ivec2& sibling : siblings) {
+			if (sibling != offset) {
+				blocks.erase(std::find(blocks.begin(), blocks.end(), sibling));
+			}
+		}
+		offset = parent;
+		level--;
+	}
+
+	_freeBlocks[level].push_back(offset);
+}
+
+glm::vec4 ShadowAtlas::GetUvRect(const Tile& tile) const {
+	float scale = (float)tile.Size / (float)_size;
+	return glm::vec4(glm::vec2(tile.Offset) / (float)_size, scale, scale);
+}
+
+uint32_t ShadowAtlas::GetTileSize(uint32_t size) const {
+	uint32_t result = _minTileSize;
+	while (result < size && result < _size) {
+		result <<= 1;
+	}
+	return result;
+}
+
+uint32_t ShadowAtlas::_GetLevel(uint32_t size) const {
+	uint32_t level = 0;
+	while ((_size >> level) > size) {
+		level++;
+	}
+	return level;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/Framebuffer.h"
+
+/// <summary>
+/// A single large depth texture that shadow casting lights render into, each light gets a square tile
+/// of the atlas. Tiles are power of two sized, and are handed out with a quadtree buddy allocator so
+/// that tiles can be freed and re-used without fragmenting the atlas
+///
+/// Tiles are persistent, so a light that doesn't change can keep the contents of its tile between frames
+/// </summary>
+class ShadowAtlas final {
+public:
+	MAKE_PTRS(ShadowAtlas);
+
+	/// <summary>
+	/// A region of the atlas, in pixels
+	/// </summary>
+	struct Tile {
+		glm::ivec2 Offset;
+		uint32_t   Size;
+	};
+
+	/// <summary>
+	/// Creates a new shadow atlas
+	/// </summary>
+	/// <param name="size">The width and height of the atlas in pixels, must be a power of two</param>
+	/// <param name="minTileSize">The smallest tile that can be allocated, must be a power of two</param>
+	ShadowAtlas(uint32_t size = 4096, uint32_t minTileSize = 128);
+	~ShadowAtlas() = default;
+
+	/// <summary>
+	/// Allocates a tile from the atlas
+	/// </summary>
+	/// <param name="size">The size of the tile to allocate, will be rounded up to a power of two</param>
+	/// <param name="result">Will store the tile if the allocation succeeds</param>
+	/// <returns>True if a tile could be allocated, false if the atlas is full</returns>
+	bool Allocate(uint32_t size, Tile& result);
+	/// <summary>
+	/// Returns a tile to the atlas, so that the space can be re-used
+	/// </summary>
+	void Free(const Tile& tile);
+
+	/// <summary>
+	/// Gets the region of the atlas that a tile covers in texture coordinates, as (offset.x, offset.y, scale.x, scale.y)
+	/// </summary>
+	glm::vec4 GetUvRect(const Tile& tile) const;
+
+	/// <summary>
+	/// Rounds a requested tile size to a size that the atlas can allocate
+	/// </summary>
+	uint32_t GetTileSize(uint32_t size) const;
+
+	const Framebuffer::Sptr& GetFramebuffer() const { return _framebuffer; }
+	uint32_t GetSize() const { return _size; }
+	uint32_t GetMinTileSize() const { return _minTileSize; }
+
+protected:
+	Framebuffer::Sptr _framebuffer;
+	uint32_t _size;
+	uint32_t _minTileSize;
+
+	// The offsets of the free blocks for each level of the quadtree, where level 0 is the entire atlas,
+	// and each level down has blocks half the size of the level above it
+	std::vector<std::vector<glm::ivec2>> _freeBlocks;
+
+	uint32_t _GetLevel(uint32_t size) const;
+};
@@ -1,4 +1,5 @@
 #include "ITexture.h"
+#include "Graphics/RenderState.h"
 
 ITexture::Limits ITexture::__limits = ITexture::Limits();
 bool ITexture::__isStaticInit = false;
@@ -21,6 +22,7 @@ void ITexture::_Recreate()
 
 ITexture::~ITexture() {
 	if (glIsTexture(_rendererId)) {
+		RenderState::OnTextureDeleted(_rendererId);
 		glDeleteTextures(1, &_rendererId);
 		_rendererId = 0;
 	}
@@ -29,12 +31,12 @@ ITexture::~ITexture() {
 void ITexture::Bind(int slot) {
 	if (_rendererId != 0) {
 		// Instead of glActiveTexture + glBindTexture, we can one line it now :D
-		glBindTextureUnit(slot, _rendererId); 
+		RenderState::BindTextureUnit(slot, _rendererId); 
 	}
 }
 
 void ITexture::Unbind(int slot) {
-	glBindTextureUnit(slot, 0);
+	RenderState::BindTextureUnit(slot, 0);
 }
 
 void ITexture::Clear(const glm::vec4& color) {
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// Identifies a shader uniform by a hash of its name, so that uniforms can be set without building or hashing
+/// strings every time. Handles made from string literals are hashed at compile time, ex:
+///
+///     constexpr UniformHandle UNIFORM_LIGHT_COLOR("u_LightColor");
+///     shader->SetUniform(UNIFORM_LIGHT_COLOR, color);
+///
+/// Each shader resolves the hashes of its uniforms once when it is introspected (see ShaderProgram::GetUniformLocation)
+/// </summary>
+struct UniformHandle {
+	// The 32 bit FNV-1a hash of the uniform's name
+	uint32_t    Hash;
+	// The name that the handle was made from, for logging. This is not copied, so it must outlive the handle
+	const char* Name;
+
+	explicit constexpr UniformHandle(const char* name) :
+		Hash(HashName(name)),
+		Name(name) {}
+
+	/// <summary>
+	/// Hashes a uniform name, this is the same hash that handles are made with
+	/// </summary>
+	static constexpr uint32_t HashName(const char* name) {
+		uint32_t hash = 2166136261u;
+		for (; *name != '\0'; name++) {
+			hash = (hash ^ (uint8_t)*name) * 16777619u;
+		}
+		return hash;
+	}
+	static uint32_t HashName(const std::string& name) {
+		return HashName(name.c_str());
+	}
+};
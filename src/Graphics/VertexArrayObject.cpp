@@ -2,6 +2,7 @@
 #include "Buffers/IndexBuffer.h"
 #include "Buffers/VertexBuffer.h"
 #include "Logging.h"
+#include "Graphics/RenderState.h"
 
 VertexArrayObject::VertexArrayObject() :
 	_indexBuffer(nullptr),
@@ -16,6 +17,7 @@ VertexArrayObject::VertexArrayObject() :
 VertexArrayObject::~VertexArrayObject()
 {
 	if (_handle != 0) {
+		RenderState::OnVertexArrayDeleted(_handle);
 		glDeleteVertexArrays(1, &_handle);
 		_handle = 0;
 	}
@@ -43,7 +45,8 @@ VertexArrayObject::VertexBufferBinding* VertexArrayObject::AddVertexBuffer(const
 			_elementCount = _vertexCount;
 		}
 	} 
-	else if (buffer->GetElementCount() != _vertexCount) {
+	// Instanced buffers have one element per instance, so they won't match our vertex count
+	else if (!instanced && buffer->GetElementCount() != _vertexCount) {
 		LOG_WARN("Buffer element count does not match vertex count of this VAO!!!");
 	}
 
@@ -110,30 +113,28 @@ void VertexArrayObject::Draw(DrawMode mode) {
 		uint32_t elements = _elementCount == 0 ? _indexBuffer->GetElementCount() : _elementCount;
 		glDrawElements((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), nullptr);
 	}
-	Unbind();
+	// We leave the VAO bound, so drawing the same mesh again doesn't need to re-bind it
 }
 
-void VertexArrayObject::DrawInstanced(uint32_t instanceCount, DrawMode mode /*= DrawMode::TriangleList*/)
+void VertexArrayObject::DrawInstanced(uint32_t instanceCount, DrawMode mode /*= DrawMode::TriangleList*/, uint32_t baseInstance /*= 0*/)
 {
 	Bind();
 	if (_indexBuffer == nullptr) {
 		uint32_t elements = _elementCount == 0 ? _vertexBuffers[0]->Buffer->GetElementCount() : _elementCount;
-		glDrawArraysInstanced((GLenum)mode, 0, elements, instanceCount);
+		glDrawArraysInstancedBaseInstance((GLenum)mode, 0, elements, instanceCount, baseInstance);
 	}
 	else {
 		uint32_t elements = _elementCount == 0 ? _indexBuffer->GetElementCount() : _elementCount;
-		glDrawElementsInstanced((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), nullptr, instanceCount);
+		glDrawElementsInstancedBaseInstance((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), nullptr, instanceCount, baseInstance);
 	}
-	Unbind();
-	
 }
 
 void VertexArrayObject::Bind() {
-	glBindVertexArray(_handle);
+	RenderState::BindVertexArray(_handle);
 }
 
 void VertexArrayObject::Unbind() {
-	glBindVertexArray(0);
+	RenderState::BindVertexArray(0);
 }
 
 void VertexArrayObject::SetVDecl(const VertexDeclaration& vDecl) {
@@ -128,11 +128,12 @@ public:
 
 	/// <summary>
 	/// Renders this VAO with the given instance count, using the specified draw mode. 
-	/// Internally this will call glDrawArraysInstanced or glDrawElementsInstanced
+	/// Internally this will call glDrawArraysInstancedBaseInstance or glDrawElementsInstancedBaseInstance
 	/// </summary>
 	/// <param name="instanceCount">The number of instances to render</param>
 	/// <param name="mode">The primitive mode for rendering the mesh</param>
-	void DrawInstanced(uint32_t instanceCount, DrawMode mode = DrawMode::TriangleList);
+	/// <param name="baseInstance">The first element to read from instanced buffers, lets multiple draws share one instance buffer</param>
+	void DrawInstanced(uint32_t instanceCount, DrawMode mode = DrawMode::TriangleList, uint32_t baseInstance = 0);
 
 	/// <summary>
 	/// Binds this VAO as the source of data for draw operations
@@ -224,7 +224,7 @@ bool ImGuiHelper::DrawTextureDrop(Texture2D::Sptr& image, ImVec2 size)
 	return ImGuiHelper::ResourceDragTarget<Texture2D>(image);
 }
 
-void ImGuiHelper::DrawLinearDepthTexture(const Texture2D::Sptr& image, const glm::ivec2& size, float zNear, float zFar)
+void ImGuiHelper::DrawLinearDepthTexture(const Texture2D::Sptr& image, const glm::ivec2& size, float zNear, float zFar, const glm::vec4& uvRect)
 {
 	struct Data {
 		int programId;
@@ -250,7 +250,8 @@ void ImGuiHelper::DrawLinearDepthTexture(const Texture2D::Sptr& image, const glm
 		glUseProgram(data->programId);
 		glUniform2fv(1, 1, &data->nearFar.x);
 	}, temp);
-	ImGui::Image((ImTextureID)image->GetHandle(), ImVec2(size.x, size.y), ImVec2(0, 1), ImVec2(1, 0));
+	ImGui::Image((ImTextureID)image->GetHandle(), ImVec2(size.x, size.y), 
+		ImVec2(uvRect.x, uvRect.y + uvRect.w), ImVec2(uvRect.x + uvRect.z, uvRect.y));
 	drawList->AddCallback([](const ImDrawList* parent_list, const ImDrawCmd* cmd) {
 		Data* data = static_cast<Data*>(cmd->UserCallbackData);
 		glUseProgram(data->restoreProgram); 
@@ -84,7 +84,11 @@ public:
 
 	static bool DrawTextureDrop(Texture2D::Sptr& image, ImVec2 size);
 
-	static void DrawLinearDepthTexture(const Texture2D::Sptr& image, const glm::ivec2& size, float zNear, float zFar);
+	/// <summary>
+	/// Draws a depth texture, converted to linear depth
+	/// </summary>
+	/// <param name="uvRect">The region of the texture to draw, as (offset.x, offset.y, scale.x, scale.y)</param>
+	static void DrawLinearDepthTexture(const Texture2D::Sptr& image, const glm::ivec2& size, float zNear, float zFar, const glm::vec4& uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
 
 	static void DrawTextureArraySlice(const Texture2DArray::Sptr& image, uint32_t slice, const glm::ivec2& size, const ImVec4& border = ImVec4(0,0,0,0));
 
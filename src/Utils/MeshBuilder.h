@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include "Graphics/VertexArrayObject.h"
+#include "Utils/MeshOptimizer.h"
 
 /// <summary>
 /// A utility class that lets us add vertices and indices, then bake it into a final mesh, using interleaved
@@ -117,10 +118,20 @@ public:
 	size_t GetTriangleCount() const { return _indices.size() > 0 ? _indices.size() / 3 : _vertices.size() / 3; }
 
 	/// <summary>
-	/// Creates and returns a VertexArraybject from the current data
+	/// Reorders the triangles and vertices of this mesh so that they're faster to draw, see MeshOptimizer. Vertices
+	/// that aren't used by any triangles are removed, so indices returned by AddVertex are no longer valid after this
+	/// </summary>
+	void Optimize() {
+		MeshOptimizer::Optimize(_vertices, _indices);
+	}
+
+	/// <summary>
+	/// Creates and returns a VertexArraybject from the current data. Indexed meshes are optimized first, see Optimize
 	/// </summary>
 	/// <returns>A VertexArrayObject</returns>
 	VertexArrayObject::Sptr Bake() {
+		Optimize();
+
 		VertexBuffer::Sptr vbo = VertexBuffer::Create();
 		vbo->LoadData(GetVertexDataPtr(), _vertices.size());
 
@@ -0,0 +1,313 @@
+#include "Utils/MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+#include <GLM/glm.hpp>
+
+namespace {
+	// Tuning values for Forsyth's vertex scoring, from "Linear-Speed Vertex Cache Optimisation"
+	const int      SCORE_CACHE_SIZE    = 32;
+	const float    CACHE_DECAY_POWER   = 1.5f;
+	const float    LAST_TRIANGLE_SCORE = 0.75f;
+	const float    VALENCE_BOOST_SCALE = 2.0f;
+	const float    VALENCE_BOOST_POWER = 0.5f;
+	const uint32_t INVALID_INDEX       = ~0u;
+
+	// Scores a vertex by how recently it was used, and by how many triangles still need it. Vertices with only a few
+	// triangles left get a boost, so that we finish off areas of the mesh instead of leaving lone triangles behind
+	float VertexScore(int cachePosition, uint32_t liveTriangles) {
+		if (liveTriangles == 0) {
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			// The last triangle's vertices all get the same score, so we don't favour any particular winding
+			if (cachePosition < 3) {
+				score = LAST_TRIANGLE_SCORE;
+			} else {
+				score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(SCORE_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+		}
+		return score + VALENCE_BOOST_SCALE * std::pow((float)liveTriangles, -VALENCE_BOOST_POWER);
+	}
+
+	// Simulates a FIFO vertex cache by remembering when each vertex was last loaded
+	struct FifoCache {
+		std::vector<uint32_t> Timestamps;
+		uint32_t Time;
+		uint32_t Size;
+
+		FifoCache(size_t vertexCount, uint32_t size) :
+			Timestamps(vertexCount, 0),
+			Time(size + 1),
+			Size(size) {}
+
+		// Empties the cache
+		void Flush() {
+			Time += Size + 1;
+		}
+
+		// Adds a triangle's vertices, returning how many of them were not already in the cache
+		uint32_t AddTriangle(const uint32_t* triangle) {
+			uint32_t misses = 0;
+			for (int ix = 0; ix < 3; ix++) {
+				if (Time - Timestamps[triangle[ix]] > Size) {
+					Timestamps[triangle[ix]] = Time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+	};
+
+	glm::vec3 ReadPosition(const uint8_t* vertexData, size_t stride, size_t positionOffset, uint32_t vertex) {
+		glm::vec3 result;
+		memcpy(&result, vertexData + vertex * stride + positionOffset, sizeof(glm::vec3));
+		return result;
+	}
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// Find the triangles that use each vertex
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		liveTriangles[indices[ix]]++;
+	}
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		adjacencyStart[ix + 1] = adjacencyStart[ix] + liveTriangles[ix];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		adjacency[cursor[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+	}
+
+	// Score every vertex and triangle before anything is in the cache
+	std::vector<int>   cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		vertexScores[ix] = VertexScore(-1, liveTriangles[ix]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		triangleScores[ix] = vertexScores[indices[ix * 3]] + vertexScores[indices[ix * 3 + 1]] + vertexScores[indices[ix * 3 + 2]];
+	}
+	std::vector<uint8_t>  emitted(triangleCount, 0);
+	std::vector<uint32_t> result(triangleCount * 3);
+
+	// We keep a few extra slots so that vertices that fall out of the cache can have their scores updated
+	uint32_t cache[SCORE_CACHE_SIZE + 3];
+	uint32_t newCache[SCORE_CACHE_SIZE + 3];
+	int cacheCount = 0;
+
+	uint32_t best = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+	size_t scanCursor = 0;
+	for (size_t output = 0; output < triangleCount; output++) {
+		// If none of the triangles around the cache are left, carry on from the next triangle that we haven't drawn yet
+		if (best == INVALID_INDEX) {
+			while (emitted[scanCursor]) {
+				scanCursor++;
+			}
+			best = static_cast<uint32_t>(scanCursor);
+		}
+
+		const uint32_t* triangle = &indices[best * 3];
+		memcpy(&result[output * 3], triangle, sizeof(uint32_t) * 3);
+		emitted[best] = 1;
+
+		// The triangle's vertices move to the front of the cache, and the triangle is no longer live for them
+		int newCount = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t vertex = triangle[corner];
+			if (std::find(newCache, newCache + newCount, vertex) == newCache + newCount) {
+				newCache[newCount++] = vertex;
+			}
+			uint32_t* begin = &adjacency[adjacencyStart[vertex]];
+			uint32_t* end = begin + liveTriangles[vertex];
+			uint32_t* it = std::find(begin, end, best);
+			if (it != end) {
+				*it = *(end - 1);
+				liveTriangles[vertex]--;
+			}
+		}
+		for (int ix = 0; ix < cacheCount; ix++) {
+			uint32_t vertex = cache[ix];
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+				newCache[newCount++] = vertex;
+			}
+		}
+
+		// Re-score everything that was in the cache, including the vertices that just fell out of it
+		for (int ix = 0; ix < newCount; ix++) {
+			uint32_t vertex = newCache[ix];
+			cachePosition[vertex] = ix < SCORE_CACHE_SIZE ? ix : -1;
+			float score = VertexScore(cachePosition[vertex], liveTriangles[vertex]);
+			float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+			for (uint32_t adjIx = adjacencyStart[vertex]; adjIx < adjacencyStart[vertex] + liveTriangles[vertex]; adjIx++) {
+				triangleScores[adjacency[adjIx]] += delta;
+			}
+		}
+
+		// The next triangle will be the best one that uses a vertex in the cache
+		best = INVALID_INDEX;
+		float bestScore = -1.0f;
+		cacheCount = std::min(newCount, SCORE_CACHE_SIZE);
+		for (int ix = 0; ix < cacheCount; ix++) {
+			uint32_t vertex = newCache[ix];
+			cache[ix] = vertex;
+			for (uint32_t adjIx = adjacencyStart[vertex]; adjIx < adjacencyStart[vertex] + liveTriangles[vertex]; adjIx++) {
+				uint32_t candidate = adjacency[adjIx];
+				if (triangleScores[candidate] > bestScore) {
+					bestScore = triangleScores[candidate];
+					best = candidate;
+				}
+			}
+		}
+	}
+
+	memcpy(indices, result.data(), sizeof(uint32_t) * result.size());
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const uint8_t* vertexData, size_t vertexCount, size_t stride, size_t positionOffset, float threshold) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Hard boundaries are where the cache ordered triangles jump to a new part of the mesh, which shows up as a triangle
+	// that misses the cache on all three vertices. Reordering clusters that start at these points costs us nothing
+	FifoCache cache(vertexCount, FIFO_CACHE_SIZE);
+	std::vector<uint32_t> hardBounds;
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		uint32_t misses = cache.AddTriangle(&indices[ix * 3]);
+		if (ix == 0 || misses == 3) {
+			hardBounds.push_back(static_cast<uint32_t>(ix));
+		}
+	}
+	hardBounds.push_back(static_cast<uint32_t>(triangleCount));
+
+	// Hard clusters can be big, so we split them further wherever the triangles since the last split have an ACMR that's
+	// close enough to the whole hard cluster's ACMR. Each split starts with a cold cache, so that's all we give up
+	std::vector<uint32_t> clusters;
+	for (size_t hard = 0; hard + 1 < hardBounds.size(); hard++) {
+		uint32_t start = hardBounds[hard];
+		uint32_t end = hardBounds[hard + 1];
+
+		cache.Flush();
+		uint32_t clusterMisses = 0;
+		for (uint32_t ix = start; ix < end; ix++) {
+			clusterMisses += cache.AddTriangle(&indices[ix * 3]);
+		}
+		float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+		size_t firstCluster = clusters.size();
+		clusters.push_back(start);
+		cache.Flush();
+		uint32_t runningMisses = 0;
+		uint32_t runningTriangles = 0;
+		for (uint32_t ix = start; ix < end; ix++) {
+			runningMisses += cache.AddTriangle(&indices[ix * 3]);
+			runningTriangles++;
+			if ((float)runningMisses / (float)runningTriangles <= clusterThreshold && ix + 1 < end) {
+				clusters.push_back(ix + 1);
+				cache.Flush();
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+
+		// Whatever is left after the last split never reached the threshold, so we merge it into the cluster before it
+		if (clusters.size() - firstCluster > 1) {
+			clusters.pop_back();
+		}
+	}
+	clusters.push_back(static_cast<uint32_t>(triangleCount));
+	size_t clusterCount = clusters.size() - 1;
+
+	// Clusters that face away from the middle of the mesh are likely to be in front of the rest of it, so we draw
+	// those first. We sort by how far the cluster's center is in front of the mesh's center, along the cluster's normal
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		meshCenter += ReadPosition(vertexData, stride, positionOffset, indices[ix]);
+	}
+	meshCenter /= (float)(triangleCount * 3);
+
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		glm::vec3 center = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float totalArea = 0.0f;
+		for (uint32_t ix = clusters[cluster]; ix < clusters[cluster + 1]; ix++) {
+			glm::vec3 p0 = ReadPosition(vertexData, stride, positionOffset, indices[ix * 3]);
+			glm::vec3 p1 = ReadPosition(vertexData, stride, positionOffset, indices[ix * 3 + 1]);
+			glm::vec3 p2 = ReadPosition(vertexData, stride, positionOffset, indices[ix * 3 + 2]);
+			glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(faceNormal);
+			center += (p0 + p1 + p2) * (area / 3.0f);
+			normal += faceNormal;
+			totalArea += area;
+		}
+		float normalLength = glm::length(normal);
+		sortKeys[cluster] = totalArea > 0.0f && normalLength > 0.0f ? glm::dot(center / totalArea - meshCenter, normal / normalLength) : 0.0f;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	for (uint32_t cluster : order) {
+		result.insert(result.end(), indices + clusters[cluster] * 3, indices + clusters[cluster + 1] * 3);
+	}
+	memcpy(indices, result.data(), sizeof(uint32_t) * result.size());
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(uint8_t* vertexData, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount) {
+	// Number the vertices in the order that they're first used
+	std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+	uint32_t nextVertex = 0;
+	for (size_t ix = 0; ix < indexCount; ix++) {
+		uint32_t& target = remap[indices[ix]];
+		if (target == INVALID_INDEX) {
+			target = nextVertex++;
+		}
+		indices[ix] = target;
+	}
+	size_t usedVertices = nextVertex;
+
+	// Unused vertices keep their order at the end
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		if (remap[ix] == INVALID_INDEX) {
+			remap[ix] = nextVertex++;
+		}
+	}
+
+	std::vector<uint8_t> original(vertexData, vertexData + vertexCount * stride);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		memcpy(vertexData + remap[ix] * stride, original.data() + ix * stride, stride);
+	}
+	return usedVertices;
+}
+
+float MeshOptimizer::CalculateAcmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return 0.0f;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	uint32_t misses = 0;
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		misses += cache.AddTriangle(&indices[ix * 3]);
+	}
+	return (float)misses / (float)triangleCount;
+}
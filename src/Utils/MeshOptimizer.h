@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Reorders the triangles and vertices of indexed meshes so that the GPU can draw them faster, without changing
+/// what gets drawn. This is meant to be run once when a mesh is imported or built:
+///
+///   - Triangles are ordered so that they re-use vertices that are still in the post-transform cache (Forsyth's
+///     linear-speed vertex cache optimization), so fewer vertices need to be shaded
+///   - The cache-ordered triangles are then split into clusters that keep most of that cache efficiency, and the
+///     clusters are sorted so that the outward facing parts of the mesh draw first, which cuts down on overdraw
+///     (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+///   - Finally vertices are re-ordered to match the order that the triangles first use them, so vertex fetches
+///     walk through memory mostly in order. Vertices that aren't used by any triangle are dropped
+/// </summary>
+class MeshOptimizer {
+public:
+	// The size of the FIFO cache that we simulate when measuring cache efficiency
+	static const uint32_t FIFO_CACHE_SIZE = 16;
+	// How much worse the cache efficiency is allowed to get when reordering for overdraw, as a ratio
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	/// <summary>
+	/// Reorders the triangles in an index buffer to make better use of the post-transform vertex cache
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder in place</param>
+	/// <param name="indexCount">The number of indices in the triangle list</param>
+	/// <param name="vertexCount">The number of vertices that the triangle list indexes into</param>
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+	/// <summary>
+	/// Reorders clusters of triangles to reduce overdraw, the indices should already be optimized for the vertex cache
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder in place</param>
+	/// <param name="indexCount">The number of indices in the triangle list</param>
+	/// <param name="vertexData">The raw vertex store to read positions from</param>
+	/// <param name="vertexCount">The number of vertices in the store</param>
+	/// <param name="stride">The size of a single vertex, in bytes</param>
+	/// <param name="positionOffset">The offset of the position within a vertex, in bytes</param>
+	/// <param name="threshold">How much worse the cache efficiency of the result can be, as a ratio</param>
+	static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const uint8_t* vertexData, size_t vertexCount, size_t stride, size_t positionOffset,
+		float threshold = OVERDRAW_THRESHOLD);
+	/// <summary>
+	/// Reorders vertices into the order that the triangles first use them, and updates the indices to match. Unused
+	/// vertices are moved to the end
+	/// </summary>
+	/// <param name="vertexData">The raw vertex store to reorder in place</param>
+	/// <param name="vertexCount">The number of vertices in the store</param>
+	/// <param name="stride">The size of a single vertex, in bytes</param>
+	/// <param name="indices">The triangle list to remap in place</param>
+	/// <param name="indexCount">The number of indices in the triangle list</param>
+	/// <returns>The number of vertices that are used by the triangle list</returns>
+	static size_t OptimizeVertexFetch(uint8_t* vertexData, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount);
+
+	/// <summary>
+	/// Measures the average number of vertices that miss a FIFO cache per triangle (ACMR). 3 is the worst case,
+	/// and well optimized meshes usually get somewhere around 0.6 to 0.8
+	/// </summary>
+	static float CalculateAcmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = FIFO_CACHE_SIZE);
+
+	/// <summary>
+	/// Runs all of the optimizations on a mesh's vertices and indices, and drops unused vertices
+	/// </summary>
+	template <typename VertType>
+	static void Optimize(std::vector<VertType>& vertices, std::vector<uint32_t>& indices) {
+		if (indices.empty() || vertices.empty()) {
+			return;
+		}
+		OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+		OptimizeOverdraw(indices.data(), indices.size(), reinterpret_cast<const uint8_t*>(vertices.data()), vertices.size(), sizeof(VertType), offsetof(VertType, Position));
+		size_t usedVertices = OptimizeVertexFetch(reinterpret_cast<uint8_t*>(vertices.data()), vertices.size(), sizeof(VertType), indices.data(), indices.size());
+		vertices.erase(vertices.begin() + usedVertices, vertices.end());
+	}
+
+protected:
+	MeshOptimizer() = default;
+	~MeshOptimizer() = default;
+};
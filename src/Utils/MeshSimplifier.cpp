@@ -0,0 +1,449 @@
+#include "Utils/MeshSimplifier.h"
+#include "Utils/MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <cstring>
+#include <GLM/glm.hpp>
+#include <Logging.h>
+
+namespace {
+	// Border edges are weighted much more heavily than faces, so that the outline of open meshes stays put
+	const double   BORDER_WEIGHT = 10.0;
+	// A collapse can't turn a triangle more than ~75 degrees away from the way it was facing
+	const float    MIN_FLIP_DOT  = 0.25f;
+	// A safety net in case a mesh can never reach its target
+	const int      MAX_PASSES    = 100;
+	const uint32_t INVALID_INDEX = ~0u;
+
+	// Sums the weighted squared distances from a point to a set of planes
+	struct Quadric {
+		// The symmetric 3x3 part, stored as xx, xy, xz, yy, yz, zz
+		double A[6]   = { 0.0 };
+		double B[3]   = { 0.0 };
+		double C      = 0.0;
+		double Weight = 0.0;
+
+		// Adds the plane where dot(n, p) + d = 0, n must be normalized
+		void AddPlane(const glm::dvec3& n, double d, double weight) {
+			A[0] += weight * n.x * n.x; A[1] += weight * n.x * n.y; A[2] += weight * n.x * n.z;
+			A[3] += weight * n.y * n.y; A[4] += weight * n.y * n.z; A[5] += weight * n.z * n.z;
+			B[0] += weight * n.x * d;   B[1] += weight * n.y * d;   B[2] += weight * n.z * d;
+			C      += weight * d * d;
+			Weight += weight;
+		}
+
+		void Add(const Quadric& other) {
+			for (int ix = 0; ix < 6; ix++) { A[ix] += other.A[ix]; }
+			for (int ix = 0; ix < 3; ix++) { B[ix] += other.B[ix]; }
+			C      += other.C;
+			Weight += other.Weight;
+		}
+
+		double Evaluate(const glm::dvec3& p) const {
+			return
+				A[0] * p.x * p.x + 2.0 * A[1] * p.x * p.y + 2.0 * A[2] * p.x * p.z +
+				A[3] * p.y * p.y + 2.0 * A[4] * p.y * p.z + A[5] * p.z * p.z +
+				2.0 * (B[0] * p.x + B[1] * p.y + B[2] * p.z) + C;
+		}
+	};
+
+	// The cost of merging two groups at a point, as the weighted RMS distance to all of their planes. Since quadrics
+	// accumulate as groups are merged, this is the error relative to the original surface, in the mesh's units
+	float CollapseError(const Quadric& a, const Quadric& b, const glm::vec3& point) {
+		double weight = a.Weight + b.Weight;
+		if (weight <= 0.0) {
+			return 0.0f;
+		}
+		glm::dvec3 p = glm::dvec3(point);
+		double sum = a.Evaluate(p) + b.Evaluate(p);
+		return (float)glm::sqrt(glm::max(sum, 0.0) / weight);
+	}
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& value) const {
+			uint32_t bits[3];
+			memcpy(bits, &value, sizeof(bits));
+			return (size_t)((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+		}
+	};
+
+	struct Collapse {
+		uint32_t From;
+		uint32_t To;
+		float    Error;
+	};
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b) {
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	}
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const uint8_t* vertexData, size_t vertexCount, size_t stride, size_t positionOffset,
+	const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float* outError)
+{
+	std::vector<uint32_t> result(indices, indices + (indexCount - indexCount % 3));
+	float maxError = 0.0f;
+
+	// Vertices that share a position are welded into groups. Collapses move whole groups, so that seams stay closed
+	std::vector<uint32_t>  groupOf(vertexCount);
+	std::vector<glm::vec3> positions;
+	std::unordered_map<glm::vec3, uint32_t, PositionHash> groupLookup;
+	groupLookup.reserve(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		glm::vec3 position;
+		memcpy(&position, vertexData + ix * stride + positionOffset, sizeof(glm::vec3));
+		// Adding zero turns -0 into +0, so that they hash the same
+		position += glm::vec3(0.0f);
+
+		auto it = groupLookup.find(position);
+		if (it == groupLookup.end()) {
+			it = groupLookup.emplace(position, static_cast<uint32_t>(positions.size())).first;
+			positions.push_back(position);
+		}
+		groupOf[ix] = it->second;
+	}
+	size_t groupCount = positions.size();
+
+	auto isDegenerate = [&](uint32_t a, uint32_t b, uint32_t c) {
+		return groupOf[a] == groupOf[b] || groupOf[b] == groupOf[c] || groupOf[c] == groupOf[a];
+	};
+
+	// Triangles that are already degenerate would only get in the way
+	size_t writeIx = 0;
+	for (size_t ix = 0; ix < result.size(); ix += 3) {
+		if (result[ix] >= vertexCount || result[ix + 1] >= vertexCount || result[ix + 2] >= vertexCount) {
+			LOG_WARN("Mesh has indices that are out of range, cannot simplify it");
+			return std::vector<uint32_t>(indices, indices + indexCount);
+		}
+		if (!isDegenerate(result[ix], result[ix + 1], result[ix + 2])) {
+			result[writeIx++] = result[ix];
+			result[writeIx++] = result[ix + 1];
+			result[writeIx++] = result[ix + 2];
+		}
+	}
+	result.resize(writeIx);
+
+	// Each group starts with the planes of the triangles around it, weighted by their area
+	std::vector<Quadric> quadrics(groupCount);
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	edgeUses.reserve(result.size());
+	for (size_t ix = 0; ix < result.size(); ix += 3) {
+		const glm::vec3& p0 = positions[groupOf[result[ix]]];
+		glm::vec3 normal = glm::cross(positions[groupOf[result[ix + 1]]] - p0, positions[groupOf[result[ix + 2]]] - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) {
+			glm::dvec3 n = glm::dvec3(normal / length);
+			double d = -glm::dot(n, glm::dvec3(p0));
+			for (int corner = 0; corner < 3; corner++) {
+				quadrics[groupOf[result[ix + corner]]].AddPlane(n, d, length * 0.5);
+			}
+		}
+		for (int edge = 0; edge < 3; edge++) {
+			edgeUses[EdgeKey(groupOf[result[ix + edge]], groupOf[result[ix + (edge + 1) % 3]])]++;
+		}
+	}
+
+	// Edges that only belong to one triangle are on the border of the mesh. We add a plane through the edge that's
+	// perpendicular to its triangle, so that moving a border vertex away from the border is expensive
+	for (size_t ix = 0; ix < result.size(); ix += 3) {
+		const glm::vec3& p0 = positions[groupOf[result[ix]]];
+		glm::vec3 faceNormal = glm::cross(positions[groupOf[result[ix + 1]]] - p0, positions[groupOf[result[ix + 2]]] - p0);
+		for (int edge = 0; edge < 3; edge++) {
+			uint32_t a = groupOf[result[ix + edge]];
+			uint32_t b = groupOf[result[ix + (edge + 1) % 3]];
+			if (edgeUses[EdgeKey(a, b)] != 1) {
+				continue;
+			}
+			glm::vec3 edgeDir = positions[b] - positions[a];
+			glm::vec3 normal = glm::cross(edgeDir, faceNormal);
+			float length = glm::length(normal);
+			if (length > 0.0f) {
+				glm::dvec3 n = glm::dvec3(normal / length);
+				double d = -glm::dot(n, glm::dvec3(positions[a]));
+				double weight = BORDER_WEIGHT * glm::dot(edgeDir, edgeDir);
+				quadrics[a].AddPlane(n, d, weight);
+				quadrics[b].AddPlane(n, d, weight);
+			}
+		}
+	}
+
+	std::vector<uint32_t> triangleStart(groupCount + 1);
+	std::vector<uint32_t> triangleCursor(groupCount);
+	std::vector<uint32_t> triangleList;
+	std::vector<uint32_t> vertexRemap(vertexCount);
+	std::vector<uint8_t>  locked(groupCount);
+	std::vector<uint64_t> edges;
+	std::vector<Collapse> collapses;
+	// Where each vertex of the group being collapsed will end up
+	std::vector<std::pair<uint32_t, uint32_t>> targets;
+
+	// Checks if a group can be collapsed onto a neighbouring group, filling in targets and the number of triangles it removes
+	auto canCollapse = [&](uint32_t from, uint32_t to, size_t& removedTriangles) {
+		targets.clear();
+		removedTriangles = 0;
+
+		// Triangles that join the two groups tell us which vertex each of our vertices should move to, vertices on either
+		// side of a seam will follow the triangles on their own side
+		for (uint32_t ix = triangleStart[from]; ix < triangleStart[from + 1]; ix++) {
+			const uint32_t* triangle = &result[triangleList[ix] * 3];
+			uint32_t corners[3] = { vertexRemap[triangle[0]], vertexRemap[triangle[1]], vertexRemap[triangle[2]] };
+			if (isDegenerate(corners[0], corners[1], corners[2])) {
+				continue;
+			}
+			int self = groupOf[corners[0]] == from ? 0 : (groupOf[corners[1]] == from ? 1 : 2);
+			bool joined = false;
+			for (int other = 1; other < 3; other++) {
+				uint32_t corner = corners[(self + other) % 3];
+				if (groupOf[corner] != to) {
+					continue;
+				}
+				joined = true;
+				auto it = std::find_if(targets.begin(), targets.end(), [&](const auto& target) { return target.first == corners[self]; });
+				if (it == targets.end()) {
+					targets.push_back({ corners[self], corner });
+				}
+			}
+			removedTriangles += joined ? 1 : 0;
+		}
+		if (removedTriangles == 0) {
+			return false;
+		}
+
+		// Every other triangle keeps its vertex but moves it to the new position. The vertex needs somewhere to go, otherwise
+		// we'd be stretching its attributes across a seam, and the triangle can't be flipped over
+		const glm::vec3& destination = positions[to];
+		for (uint32_t ix = triangleStart[from]; ix < triangleStart[from + 1]; ix++) {
+			const uint32_t* triangle = &result[triangleList[ix] * 3];
+			uint32_t corners[3] = { vertexRemap[triangle[0]], vertexRemap[triangle[1]], vertexRemap[triangle[2]] };
+			if (isDegenerate(corners[0], corners[1], corners[2]) ||
+				groupOf[corners[0]] == to || groupOf[corners[1]] == to || groupOf[corners[2]] == to) {
+				continue;
+			}
+			int self = groupOf[corners[0]] == from ? 0 : (groupOf[corners[1]] == from ? 1 : 2);
+			if (std::none_of(targets.begin(), targets.end(), [&](const auto& target) { return target.first == corners[self]; })) {
+				return false;
+			}
+
+			glm::vec3 points[3] = { positions[groupOf[corners[0]]], positions[groupOf[corners[1]]], positions[groupOf[corners[2]]] };
+			glm::vec3 before = glm::cross(points[1] - points[0], points[2] - points[0]);
+			points[self] = destination;
+			glm::vec3 after = glm::cross(points[1] - points[0], points[2] - points[0]);
+			float afterLength = glm::length(after);
+			if (afterLength <= 0.0f || glm::dot(before, after) < MIN_FLIP_DOT * glm::length(before) * afterLength) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// Each pass picks the cheapest collapses that don't touch each other, applies them, then rebuilds the triangle list
+	for (int pass = 0; pass < MAX_PASSES && result.size() > targetIndexCount; pass++) {
+		size_t triangleCount = result.size() / 3;
+
+		// Find the triangles around each group
+		std::fill(triangleStart.begin(), triangleStart.end(), 0);
+		for (uint32_t index : result) {
+			triangleStart[groupOf[index] + 1]++;
+		}
+		for (size_t ix = 0; ix < groupCount; ix++) {
+			triangleStart[ix + 1] += triangleStart[ix];
+		}
+		std::copy(triangleStart.begin(), triangleStart.end() - 1, triangleCursor.begin());
+		triangleList.resize(result.size());
+		for (size_t ix = 0; ix < result.size(); ix++) {
+			triangleList[triangleCursor[groupOf[result[ix]]]++] = static_cast<uint32_t>(ix / 3);
+		}
+
+		// Every edge can be collapsed in either direction
+		edges.clear();
+		for (size_t ix = 0; ix < result.size(); ix += 3) {
+			for (int edge = 0; edge < 3; edge++) {
+				edges.push_back(EdgeKey(groupOf[result[ix + edge]], groupOf[result[ix + (edge + 1) % 3]]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		collapses.clear();
+		for (uint64_t edge : edges) {
+			uint32_t a = static_cast<uint32_t>(edge >> 32);
+			uint32_t b = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+			collapses.push_back({ a, b, CollapseError(quadrics[a], quadrics[b], positions[b]) });
+			collapses.push_back({ b, a, CollapseError(quadrics[a], quadrics[b], positions[a]) });
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		// Each collapse removes about two triangles, we only consider as many of the cheapest collapses as we'd need
+		// to reach the target. Collapses that get skipped because a neighbour moved will be picked up by the next pass
+		size_t targetTriangles = targetIndexCount / 3;
+		size_t goal = std::max<size_t>((triangleCount - targetTriangles) / 2, 1);
+		float errorLimit = collapses[std::min(goal, collapses.size()) - 1].Error;
+
+		std::fill(locked.begin(), locked.end(), 0);
+		std::iota(vertexRemap.begin(), vertexRemap.end(), 0);
+		size_t removed = 0;
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses) {
+			if (collapse.Error > errorLimit || triangleCount - removed <= targetTriangles) {
+				break;
+			}
+			if (locked[collapse.From] || locked[collapse.To]) {
+				continue;
+			}
+
+			size_t collapseRemoved = 0;
+			if (!canCollapse(collapse.From, collapse.To, collapseRemoved)) {
+				continue;
+			}
+			for (const auto& [vertex, target] : targets) {
+				vertexRemap[vertex] = target;
+			}
+			quadrics[collapse.To].Add(quadrics[collapse.From]);
+			locked[collapse.From] = 1;
+			locked[collapse.To] = 1;
+			removed += collapseRemoved;
+			applied++;
+			maxError = glm::max(maxError, collapse.Error);
+		}
+		if (applied == 0) {
+			break;
+		}
+
+		// Move the collapsed vertices, and drop the triangles that have collapsed down to nothing
+		writeIx = 0;
+		for (size_t ix = 0; ix < result.size(); ix += 3) {
+			uint32_t a = vertexRemap[result[ix]];
+			uint32_t b = vertexRemap[result[ix + 1]];
+			uint32_t c = vertexRemap[result[ix + 2]];
+			if (!isDegenerate(a, b, c)) {
+				result[writeIx++] = a;
+				result[writeIx++] = b;
+				result[writeIx++] = c;
+			}
+		}
+		result.resize(writeIx);
+	}
+
+	if (outError != nullptr) {
+		*outError = maxError;
+	}
+	return result;
+}
+
+std::vector<MeshSimplifier::LodData> MeshSimplifier::GenerateLods(const uint8_t* vertexData, size_t vertexCount, size_t stride, size_t positionOffset,
+	const uint32_t* indices, size_t indexCount)
+{
+	std::vector<LodData> result;
+	std::vector<uint32_t> remap(vertexCount);
+
+	// Each level is simplified from the original mesh rather than the level before it, so errors don't compound
+	size_t previousCount = indexCount - indexCount % 3;
+	for (int level = 0; level < MAX_LEVELS; level++) {
+		size_t target = (previousCount / 6) * 3;
+		if (target < MIN_TRIANGLES * 3) {
+			break;
+		}
+
+		LodData lod;
+		lod.Error = 0.0f;
+		std::vector<uint32_t> simplified = Simplify(vertexData, vertexCount, stride, positionOffset, indices, indexCount, target, &lod.Error);
+
+		// If the simplifier got stuck well short of the target, the levels after this won't do any better
+		if (simplified.empty() || simplified.size() > previousCount * 3 / 4) {
+			break;
+		}
+
+		// Reorder the level's triangles the same way as the original mesh, then only copy over the vertices that the
+		// level uses, in the order that it first uses them
+		MeshOptimizer::OptimizeVertexCache(simplified.data(), simplified.size(), vertexCount);
+		MeshOptimizer::OptimizeOverdraw(simplified.data(), simplified.size(), vertexData, vertexCount, stride, positionOffset);
+		std::fill(remap.begin(), remap.end(), INVALID_INDEX);
+		uint32_t usedVertices = 0;
+		lod.Indices.reserve(simplified.size());
+		for (uint32_t index : simplified) {
+			if (remap[index] == INVALID_INDEX) {
+				remap[index] = usedVertices++;
+				lod.Vertices.insert(lod.Vertices.end(), vertexData + index * stride, vertexData + (index + 1) * stride);
+			}
+			lod.Indices.push_back(remap[index]);
+		}
+
+		previousCount = simplified.size();
+		result.push_back(std::move(lod));
+	}
+
+	return result;
+}
+
+std::vector<MeshLod> MeshSimplifier::CreateLods(const std::vector<LodData>& levels, const VertexArrayObject::VertexDeclaration& vDecl, size_t stride) {
+	std::vector<MeshLod> result;
+	result.reserve(levels.size());
+	for (const LodData& level : levels) {
+		VertexBuffer::Sptr vbo = VertexBuffer::Create();
+		vbo->LoadData(level.Vertices.data(), static_cast<uint32_t>(stride), static_cast<uint32_t>(level.Vertices.size() / stride));
+
+		IndexBuffer::Sptr ebo = IndexBuffer::Create();
+		ebo->LoadData(level.Indices.data(), static_cast<uint32_t>(level.Indices.size()));
+
+		VertexArrayObject::Sptr vao = VertexArrayObject::Create();
+		vao->AddVertexBuffer(vbo, vDecl);
+		vao->SetIndexBuffer(ebo);
+		vao->SetVDecl(vDecl);
+
+		result.push_back({ vao, level.Error });
+	}
+	return result;
+}
+
+std::vector<MeshLod> MeshSimplifier::FromVertexArray(const VertexArrayObject::Sptr& vao) {
+	if (vao == nullptr || vao->GetIndexBuffer() == nullptr) {
+		return std::vector<MeshLod>();
+	}
+
+	// Find the position attribute, and make sure that its buffer holds the whole vertex
+	VertexArrayObject::VertexBufferBinding* binding = vao->GetBufferBinding(AttribUsage::Position);
+	if (binding == nullptr || binding->GetAttributes().size() != vao->GetVDecl().size()) {
+		return std::vector<MeshLod>();
+	}
+	const std::vector<BufferAttribute>& attributes = binding->GetAttributes();
+	auto it = std::find_if(attributes.begin(), attributes.end(), [](const BufferAttribute& attrib) {
+		return attrib.Usage == AttribUsage::Position;
+	});
+	if (it == attributes.end() || it->Type != AttributeType::Float || it->Size < 3 || it->Stride == 0) {
+		return std::vector<MeshLod>();
+	}
+
+	// Read the vertices and indices back into CPU memory, widening the indices to 32 bits
+	const VertexBuffer::Sptr& buffer = binding->GetBuffer();
+	size_t stride = it->Stride;
+	size_t vertexCount = buffer->GetTotalSize() / stride;
+	std::vector<uint8_t> vertexStore(buffer->GetTotalSize());
+	glGetNamedBufferSubData(buffer->GetHandle(), 0, buffer->GetTotalSize(), vertexStore.data());
+
+	IndexBuffer::Sptr indexBuffer = vao->GetIndexBuffer();
+	std::vector<uint8_t> indexStore(indexBuffer->GetTotalSize());
+	glGetNamedBufferSubData(indexBuffer->GetHandle(), 0, indexBuffer->GetTotalSize(), indexStore.data());
+
+	std::vector<uint32_t> indices(indexBuffer->GetElementCount());
+	for (size_t ix = 0; ix < indices.size(); ix++) {
+		switch (indexBuffer->GetElementType()) {
+			case IndexType::UByte:
+				indices[ix] = indexStore[ix];
+				break;
+			case IndexType::UShort:
+				indices[ix] = reinterpret_cast<const uint16_t*>(indexStore.data())[ix];
+				break;
+			case IndexType::UInt:
+			default:
+				indices[ix] = reinterpret_cast<const uint32_t*>(indexStore.data())[ix];
+				break;
+		}
+	}
+
+	std::vector<LodData> levels = GenerateLods(vertexStore.data(), vertexCount, stride, it->Offset, indices.data(), indices.size());
+	return CreateLods(levels, attributes, stride);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Graphics/VertexArrayObject.h"
+#include "Utils/MeshBuilder.h"
+
+/// <summary>
+/// A lower detail version of a mesh that has been uploaded to OpenGL
+/// </summary>
+struct MeshLod {
+	VertexArrayObject::Sptr Mesh;
+	/// <summary>
+	/// The furthest that the surface of the LOD strays from the original mesh, in the mesh's local units
+	/// </summary>
+	float                   Error;
+};
+
+/// <summary>
+/// Generates LOD chains for meshes using quadric error edge collapses (Garland and Heckbert).
+///
+/// Each collapse moves a vertex onto one of its neighbours, so simplified meshes re-use the original
+/// vertices and keep their normals, UVs and colors as-is. Vertices that share a position (ex: along a
+/// UV seam) are collapsed together, and only onto neighbours on the same side of the seam, so seams
+/// never tear open. Open borders are weighted heavily so that the silhouette of a mesh is kept
+/// </summary>
+class MeshSimplifier {
+public:
+	/// <summary>
+	/// A simplified level of a mesh, the vertices are copied from the original with the same layout
+	/// </summary>
+	struct LodData {
+		std::vector<uint8_t>  Vertices;
+		std::vector<uint32_t> Indices;
+		float                 Error;
+	};
+
+	// The most levels we will generate for a mesh, not including the original
+	static const int    MAX_LEVELS    = 3;
+	// We stop generating levels once they would have fewer triangles than this
+	static const size_t MIN_TRIANGLES = 64;
+
+	/// <summary>
+	/// Simplifies an indexed triangle list until it has at most the target number of indices, or until
+	/// no more edges can be collapsed
+	/// </summary>
+	/// <param name="vertexData">The raw vertex store to read positions from</param>
+	/// <param name="vertexCount">The number of vertices in the store</param>
+	/// <param name="stride">The size of a single vertex, in bytes</param>
+	/// <param name="positionOffset">The offset of the position within a vertex, in bytes</param>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="indexCount">The number of indices in the triangle list</param>
+	/// <param name="targetIndexCount">The number of indices to simplify down to</param>
+	/// <param name="outError">If not null, receives the largest error of the simplified mesh</param>
+	/// <returns>The simplified triangle list, indexing into the same vertices</returns>
+	static std::vector<uint32_t> Simplify(const uint8_t* vertexData, size_t vertexCount, size_t stride, size_t positionOffset,
+		const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float* outError = nullptr);
+
+	/// <summary>
+	/// Generates a LOD chain for a raw mesh, where each level has roughly half the triangles of the one before it.
+	/// Levels only contain the vertices they use, and are reordered for drawing in the same way as MeshOptimizer
+	/// </summary>
+	/// <returns>The levels, from most to least detailed, not including the original mesh</returns>
+	static std::vector<LodData> GenerateLods(const uint8_t* vertexData, size_t vertexCount, size_t stride, size_t positionOffset,
+		const uint32_t* indices, size_t indexCount);
+
+	/// <summary>
+	/// Generates a LOD chain for a mesh builder
+	/// </summary>
+	template <typename VertType>
+	static std::vector<LodData> GenerateLods(const MeshBuilder<VertType>& mesh) {
+		return GenerateLods(
+			reinterpret_cast<const uint8_t*>(mesh.GetVertexDataPtr()), mesh.GetVertexCount(), sizeof(VertType), offsetof(VertType, Position),
+			mesh.GetIndexDataPtr(), mesh.GetIndexCount()
+		);
+	}
+
+	/// <summary>
+	/// Uploads generated levels to OpenGL
+	/// </summary>
+	/// <param name="levels">The levels to upload</param>
+	/// <param name="vDecl">The vertex declaration of the levels' vertices</param>
+	/// <param name="stride">The size of a single vertex, in bytes</param>
+	static std::vector<MeshLod> CreateLods(const std::vector<LodData>& levels, const VertexArrayObject::VertexDeclaration& vDecl, size_t stride);
+
+	/// <summary>
+	/// Generates and uploads a LOD chain for a VAO, by reading its data back from OpenGL. This should only be used at
+	/// load time, as reading from a buffer will stall the pipeline. Only VAOs with a single interleaved vertex buffer
+	/// are supported
+	/// </summary>
+	static std::vector<MeshLod> FromVertexArray(const VertexArrayObject::Sptr& vao);
+
+protected:
+	MeshSimplifier() = default;
+	~MeshSimplifier() = default;
+};
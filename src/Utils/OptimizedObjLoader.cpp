@@ -7,6 +7,7 @@
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <cstring>
 
 #include "Utils/StringUtils.h"
 #include "GLFW/glfw3.h"
@@ -17,7 +18,7 @@ const std::string binaryExtension = ".bin";
 
 namespace fs = std::filesystem;
 
-VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename) {
+VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename, std::vector<MeshLod>* lods) {
 	// Get the file extension and lowercase it
 	fs::path filePath = std::filesystem::path(filename);
 	std::string extension = filePath.extension().string();
@@ -27,16 +28,16 @@ VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& file
 	if (extension == ".obj") {
 		// Get the binary path
 		fs::path binPath = filePath.replace_extension(binaryExtension);
-		// If the file does not exist, convert the OBJ file to a binary file
-		if (!fs::exists(binPath)) {
+		// If the file does not exist or is out of date, convert the OBJ file to a binary file
+		if (!fs::exists(binPath) || _ReadBinaryVersion(binPath.string()) < BINARY_VERSION) {
 			ConvertToBinary(filename, binPath.string());
 		}
 		// Load the corresponding binary file
-		return _LoadFromBinFile(binPath.string());
+		return _LoadFromBinFile(binPath.string(), lods);
 	} 
 	// Load our fancy binary files
 	else if (extension == ".bin") {
-		return _LoadFromBinFile(filename);
+		return _LoadFromBinFile(filename, lods);
 	}
 	// We've never met this extension in our life
 	else {
@@ -62,11 +63,19 @@ void OptimizedObjLoader::ConvertToBinary(const std::string& inFile, const std::s
 		outFileName = path.string();
 	}
 
+	// Reorder the mesh for the vertex cache, overdraw and vertex fetches, so we don't pay for the OBJ's face order at runtime
+	float acmrBefore = MeshOptimizer::CalculateAcmr(mesh->GetIndexDataPtr(), mesh->GetIndexCount(), mesh->GetVertexCount());
+	mesh->Optimize();
+	float acmrAfter = MeshOptimizer::CalculateAcmr(mesh->GetIndexDataPtr(), mesh->GetIndexCount(), mesh->GetVertexCount());
+
+	// Generate the LOD chain now, so that we don't have to simplify the mesh every time it's loaded
+	std::vector<MeshSimplifier::LodData> lods = MeshSimplifier::GenerateLods(*mesh);
+
 	// Save the mesh to the file
-	SaveBinaryFile(*mesh, outFileName);
+	SaveBinaryFile(*mesh, outFileName, lods);
 
 	float endTime = static_cast<float>(glfwGetTime());
-	LOG_TRACE("Converted OBJ file to binary \"{}\" in {} seconds ({} vertices, {} indices)", inFile, endTime - startTime, mesh->GetVertexCount(), mesh->GetIndexCount());
+	LOG_TRACE("Converted OBJ file to binary \"{}\" in {} seconds ({} vertices, {} indices, {} LODs, ACMR {} -> {})", inFile, endTime - startTime, mesh->GetVertexCount(), mesh->GetIndexCount(), lods.size(), acmrBefore, acmrAfter);
 
 	// We no longer need the mesh data, free it
 	delete mesh;
@@ -233,7 +242,7 @@ MeshBuilder<VertexPosNormTexColTangents>* OptimizedObjLoader::_LoadFromObjFile(c
 	return mesh;
 }
 
-VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string& filename) {
+VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string& filename, std::vector<MeshLod>* lods) {
 
 	// Open the output file
 	std::ifstream file(filename, std::ios::binary);
@@ -258,8 +267,8 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 
 	// TODO: validate header
 
-	// Handle our version
-	if (header.Version == 0x01) {
+	// Handle our version, version 2 is version 1 with LODs tacked on to the end, and version 3 only differs in the ordering of the data
+	if (header.Version >= 0x01 && header.Version <= 0x03) {
 		// Determine how many bytes we need in the file
 		size_t requiredBytes =
 			sizeof(BinaryHeader) +
@@ -280,49 +289,92 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 			file.read(reinterpret_cast<char*>(&vertexDeclaration[ix]), sizeof(BufferAttribute));
 		}
 
-		// These will have the buffer pointers
-		IndexBuffer::Sptr indices = nullptr;
-		VertexBuffer::Sptr vertices = nullptr;
-
-		// If we have index data, load it
-		if (header.NumIndices > 0) {
-			// Create index buffer
-			indices = IndexBuffer::Create(BufferUsage::StaticDraw);
-
-			// Create memory to store indices, then read from the file
-			void* dataStore = malloc(header.NumIndices * GetIndexTypeSize(header.IndicesType));
-			file.read(reinterpret_cast<char*>(dataStore), header.NumIndices * GetIndexTypeSize(header.IndicesType));
-			
-			// Load data into OpenGL and free the CPU memory we allocated
-			indices->LoadData(dataStore, GetIndexTypeSize(header.IndicesType), header.NumIndices, header.IndicesType);
-			free(dataStore);
-		}
-
-		// Create a new VBO
-		vertices = VertexBuffer::Create(BufferUsage::StaticDraw);
-
-		// Create memory to store vertices and load from file
-		void* vertexStore = malloc(header.NumVertices * (size_t)header.VertexStride);
-		file.read(reinterpret_cast<char*>(vertexStore), header.NumVertices * (size_t)header.VertexStride);
-
-		// Load data into OpenGL and free the CPU copy
-		vertices->LoadData(vertexStore, header.VertexStride, header.NumVertices);
-		free(vertexStore);
-
-		// Create the VAO and attach our index and vertex buffers
-		VertexArrayObject::Sptr result = VertexArrayObject::Create();
-		result->SetIndexBuffer(indices);
-		result->AddVertexBuffer(vertices, vertexDeclaration);
+		VertexArrayObject::Sptr result = _ReadVao(file, vertexDeclaration, header.NumIndices, header.IndicesType, header.NumVertices, header.VertexStride);
+
+		// Read in the LOD chain if the caller wants it
+		uint8_t numLods = 0;
+		if (header.Version >= 0x02 && lods != nullptr && size >= requiredBytes + sizeof(uint8_t)) {
+			file.read(reinterpret_cast<char*>(&numLods), sizeof(uint8_t));
+			requiredBytes += sizeof(uint8_t);
+
+			lods->clear();
+			lods->reserve(numLods);
+			for (int ix = 0; ix < numLods; ix++) {
+				LodHeader lodHeader = LodHeader();
+				if (size < requiredBytes + sizeof(LodHeader)) {
+					LOG_ERROR("Not enough data in the file for LOD {}!", ix);
+					break;
+				}
+				file.read(reinterpret_cast<char*>(&lodHeader), sizeof(LodHeader));
+				requiredBytes +=
+					sizeof(LodHeader) +
+					(header.VertexStride * (size_t)lodHeader.NumVertices) +
+					(lodHeader.NumIndices * GetIndexTypeSize(header.IndicesType));
+				if (size < requiredBytes) {
+					LOG_ERROR("Not enough data in the file for LOD {}!", ix);
+					break;
+				}
 
-		// Copy in the vertex declaration we loaded
-		result->SetVDecl(vertexDeclaration);
+				lods->push_back({ _ReadVao(file, vertexDeclaration, lodHeader.NumIndices, header.IndicesType, lodHeader.NumVertices, header.VertexStride), lodHeader.Error });
+			}
+		}
 
 		// Calculate and trace out how long it took us to load
 		float endTime = static_cast<float>(glfwGetTime());
-		LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, header.NumVertices, header.NumIndices);
+		LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices, {} LODs)", filename, endTime - startTime, header.NumVertices, header.NumIndices, numLods);
 
 		return result;
 	}
 
 	return nullptr;
 }
+
+uint16_t OptimizedObjLoader::_ReadBinaryVersion(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	BinaryHeader header = BinaryHeader();
+	if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(BinaryHeader))) {
+		return 0;
+	}
+	return memcmp(header.HeaderBytes, HEADER_BYTES, sizeof(HEADER_BYTES)) == 0 ? header.Version : 0;
+}
+
+VertexArrayObject::Sptr OptimizedObjLoader::_ReadVao(std::ifstream& file, const std::vector<BufferAttribute>& vDecl, uint32_t numIndices, IndexType indexType, uint32_t numVertices, uint16_t vertexStride) {
+	// These will have the buffer pointers
+	IndexBuffer::Sptr indices = nullptr;
+	VertexBuffer::Sptr vertices = nullptr;
+
+	// If we have index data, load it
+	if (numIndices > 0) {
+		// Create index buffer
+		indices = IndexBuffer::Create(BufferUsage::StaticDraw);
+
+		// Create memory to store indices, then read from the file
+		void* dataStore = malloc(numIndices * GetIndexTypeSize(indexType));
+		file.read(reinterpret_cast<char*>(dataStore), numIndices * GetIndexTypeSize(indexType));
+		
+		// Load data into OpenGL and free the CPU memory we allocated
+		indices->LoadData(dataStore, GetIndexTypeSize(indexType), numIndices, indexType);
+		free(dataStore);
+	}
+
+	// Create a new VBO
+	vertices = VertexBuffer::Create(BufferUsage::StaticDraw);
+
+	// Create memory to store vertices and load from file
+	void* vertexStore = malloc(numVertices * (size_t)vertexStride);
+	file.read(reinterpret_cast<char*>(vertexStore), numVertices * (size_t)vertexStride);
+
+	// Load data into OpenGL and free the CPU copy
+	vertices->LoadData(vertexStore, vertexStride, numVertices);
+	free(vertexStore);
+
+	// Create the VAO and attach our index and vertex buffers
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	result->SetIndexBuffer(indices);
+	result->AddVertexBuffer(vertices, vDecl);
+
+	// Copy in the vertex declaration we loaded
+	result->SetVDecl(vDecl);
+
+	return result;
+}
@@ -12,6 +12,7 @@
 #include "Graphics/VertexTypes.h"
 
 #include "Utils/MeshBuilder.h"
+#include "Utils/MeshSimplifier.h"
 
 /// <summary>
 /// An optimized OBJ loader that can convert an OBJ file to a binary representation
@@ -21,13 +22,15 @@ class OptimizedObjLoader {
 public:
 	/// <summary>
 	/// Loads a VAO from an OBJ file. On the first time this is called for an OBJ file, will convert the OBJ file 
-	/// to a binary file and load that instead. On subsequent runs, the binary file will be loaded instead
+	/// to a binary file and load that instead. On subsequent runs, the binary file will be loaded instead. Binary
+	/// files from an older version of the format are re-converted if the OBJ file is still around
 	/// </summary>
 	/// <param name="filename">The path to the .obj or .bin file to load</param>
+	/// <param name="lods">If not null, receives the LOD chain that was generated when the file was converted</param>
 	/// <returns>A VAO loaded from disk</returns>
-	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename);
+	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename, std::vector<MeshLod>* lods = nullptr);
 	/// <summary>
-	/// Manually converts an OBJ file into a binary mesh file
+	/// Manually converts an OBJ file into a binary mesh file, generating its LOD chain
 	/// </summary>
 	/// <param name="inFile">The path to OBJ file to convert</param>
 	/// <param name="outFile">The output path for the bin file, or empty to use the inFile path and replace the extension with .bin</param>
@@ -39,10 +42,15 @@ public:
 	/// <typeparam name="VertexType"></typeparam>
 	/// <param name="mesh"></param>
 	/// <param name="outFilename"></param>
+	/// <param name="lods">The LOD chain to store with the mesh, the LODs must use the same vertex type as the mesh</param>
 	template <typename VertexType>
-	static void SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename);
+	static void SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename, const std::vector<MeshSimplifier::LodData>& lods = {});
 
 protected:
+	// The version of the binary format that we write, version 2 added LODs after the mesh data, and version 3 files
+	// have had their triangles and vertices optimized (the layout is the same as version 2)
+	static const uint16_t BINARY_VERSION = 0x03;
+
 	// Will be put at the start of the binary file, contains info about the contents of the file
 	struct BinaryHeader {
 		// A check value so we can ensure that we're loading in the right file type
@@ -61,11 +69,27 @@ protected:
 		uint8_t   NumAttributes = 0;
 	};
 
+	// Comes before each LOD's index and vertex data. LODs are stored after the mesh, and use its index type and attributes
+	struct LodHeader {
+		// The furthest that the LOD strays from the mesh, in the mesh's local units
+		float     Error = 0.0f;
+		uint32_t  NumIndices = 0;
+		uint32_t  NumVertices = 0;
+	};
+
 	OptimizedObjLoader() = default;
 	~OptimizedObjLoader() = default;
 
 	static MeshBuilder<VertexPosNormTexColTangents>* _LoadFromObjFile(const std::string& filename);
-	static VertexArrayObject::Sptr _LoadFromBinFile(const std::string& filename);
+	static VertexArrayObject::Sptr _LoadFromBinFile(const std::string& filename, std::vector<MeshLod>* lods);
+	/// <summary>
+	/// Reads the format version of a binary file, or 0 if the file can't be read
+	/// </summary>
+	static uint16_t _ReadBinaryVersion(const std::string& filename);
+	/// <summary>
+	/// Reads index and vertex data from a binary file into a new VAO
+	/// </summary>
+	static VertexArrayObject::Sptr _ReadVao(std::ifstream& file, const std::vector<BufferAttribute>& vDecl, uint32_t numIndices, IndexType indexType, uint32_t numVertices, uint16_t vertexStride);
 };
 
 template <typename VertexType>
@@ -78,7 +102,7 @@ void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std
 
 	// Create the fixed size header for our output file
 	BinaryHeader header  = BinaryHeader();
-	header.Version       = 0x01; // This is version 1! Update this and implement different readers if changes to format are made
+	header.Version       = BINARY_VERSION; // Update this and implement different readers if changes to format are made
 	header.NumIndices    = mesh.GetIndexCount();
 	header.IndicesType   = IndexType::UInt;
 	header.NumVertices   = mesh.GetVertexCount();
@@ -99,4 +123,17 @@ void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std
 
 	// Write vertex data to file
 	file.write(reinterpret_cast<const char*>(mesh.GetVertexDataPtr()), mesh.GetVertexCount() * sizeof(VertexType));
+
+	// Write the LOD chain, each LOD has a small header followed by its indices and vertices
+	uint8_t numLods = static_cast<uint8_t>(lods.size());
+	file.write(reinterpret_cast<const char*>(&numLods), sizeof(uint8_t));
+	for (int ix = 0; ix < numLods; ix++) {
+		LodHeader lodHeader = LodHeader();
+		lodHeader.Error       = lods[ix].Error;
+		lodHeader.NumIndices  = static_cast<uint32_t>(lods[ix].Indices.size());
+		lodHeader.NumVertices = static_cast<uint32_t>(lods[ix].Vertices.size() / sizeof(VertexType));
+		file.write(reinterpret_cast<const char*>(&lodHeader), sizeof(LodHeader));
+		file.write(reinterpret_cast<const char*>(lods[ix].Indices.data()), lods[ix].Indices.size() * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(lods[ix].Vertices.data()), lods[ix].Vertices.size());
+	}
 }
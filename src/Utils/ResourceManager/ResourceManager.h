@@ -88,6 +88,15 @@ public:
 
 		// Create the type loader for the type
 		_typeLoaders[typeName] = [](const nlohmann::json& data) {
+			// Resources can be loaded early by ones that depend on them (ex: a material instance's parent), loading
+			// them again would leave the registry holding a different object than the one that was handed out
+			Guid guid = Guid(data["guid"]);
+			auto& resources = _resources[std::type_index(typeid(T))];
+			auto existing = resources.find(guid);
+			if (existing != resources.end() && existing->second != nullptr) {
+				return guid;
+			}
+
 			IResource::Sptr res = T::FromJson(data);
 			res->OverrideGUID(Guid(data["guid"]));
 			_resources[std::type_index(typeid(T))][res->GetGUID()] = res;